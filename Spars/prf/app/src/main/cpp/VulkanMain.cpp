@@ -34,9 +34,15 @@
 
 #include "engine2d/image_layout.h"
 #include "engine2d/BufferManager.h"
+#include "engine2d/BufferManagerBenchmark.h"
+#include "engine2d/ManagerLookupBenchmark.h"
+#include "engine2d/DescriptorStressBenchmark.h"
 #include "engine2d/PipelineManager.h"
 #include "engine2d/ImageManager.h"
 #include "engine2d/Engine2D.h"
+#include "engine2d/TextureDiskCache.h"
+#include "engine2d/TextureDiskCacheBenchmark.h"
+#include "engine2d/GlyphRasterizerBenchmark.h"
 
 #include "renderTree/RenderNode.h"
 #include "renderTree/AnimationsList.h"
@@ -46,6 +52,10 @@
 #include "renderWorker/RenderWorkerPool.h"
 
 #include "treeParser/TreeParser.h"
+#include "treeParser/BinaryTree.h"
+#include "treeParser/BinaryTreeBenchmark.h"
+#include "utils/AssetFileBenchmark.h"
+#include "utils/StartupGraph.h"
 #include "config.h"
 
 #include <vulkan_wrapper.h>
@@ -54,7 +64,9 @@
 #include <cstring>
 #include <vector>
 #include <cstdlib>
+#include <algorithm>
 #include <chrono>
+#include <random>
 #include <android/trace.h>
 
 VulkanDeviceInfo deviceInfo;
@@ -62,10 +74,15 @@ VulkanSwapchainInfo swapchainInfo;
 VulkanRenderInfo renderInfo;
 
 RenderWorkerPool renderWorkerPool;
+ResourcePrefetcher *resourcePrefetcher = nullptr; // 资源预取（PREFETCH_RESOURCES）
+TextureDiskCache *textureDiskCache = nullptr; // 磁盘纹理缓存（TEXTURE_DISK_CACHE）
+std::string pipelineCachePath; // 磁盘管线缓存文件（PIPELINE_CACHE）
+bool pipelineCacheWarm = false; // 启动时是否加载到了有效的管线缓存
 
 RenderNode *rootNode; // 所需绘制内容（渲染树）的根节点
 AnimationsList animationsList; // 所有动画列表
 uint64_t frameIndex = 0; // TODO: 移入vsync
+std::chrono::steady_clock::time_point initStartTime; // InitVulkan开始的时间，用于统计首帧耗时
 
 
 RenderNode *testRenderTree() {
@@ -115,6 +132,64 @@ RenderNode *testRenderTree() {
     return rootNode;
 }
 
+// 释放整棵渲染树（RenderNode的析构函数不释放子节点）
+static void deleteRenderTree(RenderNode *node) {
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        deleteRenderTree(node->getChild(i));
+    }
+    delete node;
+}
+
+#if GLYPH_CACHE_BENCHMARK
+int32_t glyphBenchmarkWidth, glyphBenchmarkHeight; // 合成场景的尺寸（解析得到的显示尺寸）
+
+// 合成的CJK文本场景：每行一个文本节点，字号在几种之间轮换，字符为随机的CJK统一表意文字
+RenderNode *glyphBenchmarkTree(uint32_t seed) {
+    const float pixelHeights[] = {24.0f, 32.0f, 48.0f};
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint32_t> codepointDist(0x4E00, 0x9FFF);
+
+    RenderNode *rootNode = new RenderNode(nullptr, 0, 0, 0, glyphBenchmarkWidth, glyphBenchmarkHeight);
+    int32_t y = 0;
+    for (uint64_t i = 0; y < glyphBenchmarkHeight; i++) {
+        float pixelHeight = pixelHeights[i % 3];
+        int32_t rowHeight = static_cast<int32_t>(pixelHeight * 1.5f);
+        RenderNode *textNode = new RenderNode(rootNode, i + 1, 0, y, glyphBenchmarkWidth, rowHeight);
+        rootNode->addChild(textNode);
+
+        // 约半行的字符（UTF-8编码，均为3字节）
+        std::string str;
+        uint32_t charCount = std::max(1, static_cast<int>(glyphBenchmarkWidth / pixelHeight / 2));
+        for (uint32_t j = 0; j < charCount; j++) {
+            uint32_t c = codepointDist(random);
+            str.push_back(static_cast<char>(0xE0 | (c >> 12)));
+            str.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+            str.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+        Paint paint;
+        paint.setColor(0xFF000000);
+        Text text = Text::MakeText(0, 0, pixelHeight, str, GLYPH_CACHE_BENCHMARK_FONT);
+        auto textCmd = std::make_shared<TextDrawCmd>(paint, text);
+        textNode->addDrawCmd(textCmd);
+        y += rowHeight;
+    }
+    return rootNode;
+}
+
+/**
+ * 每隔GLYPH_CACHE_BENCHMARK_INTERVAL帧换一批文本（上一帧已等待fence，此时工作线程空闲）
+ * @return 本帧是否切换了文本
+ */
+static bool switchGlyphScene(uint64_t frame) {
+    if (frame == 0 || frame % GLYPH_CACHE_BENCHMARK_INTERVAL != 0) {
+        return false;
+    }
+    deleteRenderTree(rootNode);
+    rootNode = glyphBenchmarkTree(static_cast<uint32_t>(frame / GLYPH_CACHE_BENCHMARK_INTERVAL));
+    return true;
+}
+#endif
+
 /*
  * setImageLayout():
  *    Helper function to transition color buffer layout
@@ -124,10 +199,36 @@ void setImageLayout(VkCommandBuffer cmdBuffer, VkImage image,
                     VkPipelineStageFlags srcStages,
                     VkPipelineStageFlags destStages);
 
+// 删除交换链及依附于它的render pass、指令池与同步原语（swapchain任务创建的资源）
+static void deleteSwapchainResources() {
+    vkDestroySemaphore(deviceInfo.device_, renderInfo.imageAvailableSemaphore_, nullptr);
+    vkDestroyFence(deviceInfo.device_, renderInfo.renderFinishedFence_, nullptr);
+
+    vkFreeCommandBuffers(deviceInfo.device_, renderInfo.cmdPool_, renderInfo.cmdBuffer_.size(),
+                         renderInfo.cmdBuffer_.data());
+    renderInfo.cmdBuffer_.clear();
+
+    vkDestroyCommandPool(deviceInfo.device_, renderInfo.cmdPool_, nullptr);
+    vkDestroyRenderPass(deviceInfo.device_, renderInfo.renderPass_, nullptr);
+    DeleteSwapChain(deviceInfo.device_, &swapchainInfo);
+}
+
+// 删除预取线程与磁盘缓存（在Engine2D删除之后）
+static void deleteResourceLoaders() {
+    // ImageManager与GlyphManager已删除，不会再取用预取结果
+    delete resourcePrefetcher;
+    resourcePrefetcher = nullptr;
+
+    // 预取线程已停止，不会再读写磁盘缓存（已映射的像素均已解除映射）
+    delete textureDiskCache;
+    textureDiskCache = nullptr;
+}
+
 // InitVulkan: Vulkan状态的初始化
 //   Initialize Vulkan Context when android application window is created
 //   upon return, vulkan is ready to draw frames
 bool InitVulkan(android_app *app) {
+    initStartTime = std::chrono::steady_clock::now();
 
     // 获取libvulkan.so中含有的vulkan函数
     if (!InitVulkan()) {
@@ -135,53 +236,191 @@ bool InitVulkan(android_app *app) {
         return false;
     }
 
-    // 依次创建vulkan全局数据结构
-    deviceInfo.instance_ = getInstance();
-    deviceInfo.surface_ = getSurface(deviceInfo.instance_, app->window);
-    deviceInfo.physicalDevice_ = getPhysicalDevice(deviceInfo.instance_, deviceInfo.surface_);
-    deviceInfo.queueFamilyIndex_ = getQueueFamilyIndex(deviceInfo.physicalDevice_);
-    deviceInfo.device_ = getDevice(deviceInfo.physicalDevice_, deviceInfo.queueFamilyIndex_);
-    deviceInfo.queue_ = getQueue(deviceInfo.device_, deviceInfo.queueFamilyIndex_);
-
-    // 创建交换链
-    getSwapChain(deviceInfo.surface_, deviceInfo.physicalDevice_, deviceInfo.queueFamilyIndex_, deviceInfo.device_, &swapchainInfo);
-
-    // 创建render pass
-    renderInfo.renderPass_ = getRenderPass(deviceInfo.device_, swapchainInfo.displayFormat_);
-
-    // 依次创建Image、imageView、FrameBuffer
-    getFrameBuffers(deviceInfo.device_, renderInfo.renderPass_, &swapchainInfo);
-
-    // 创建指令池
-    renderInfo.cmdPool_ = getCommandPool(deviceInfo.device_, deviceInfo.queueFamilyIndex_);
-
-    // 创建指令缓冲（为帧缓冲中的每一帧）
-    getCommandBuffers(deviceInfo.device_, swapchainInfo.swapchainLength_, renderInfo.cmdPool_, &renderInfo);
-
-    // 创建同步原语
-    getImageAvailableSemaphore(deviceInfo.device_, &renderInfo);
-    getRenderFinishedFence(deviceInfo.device_, &renderInfo);
-
-    // 创建管线缓存
-    // renderInfo.pipelineCache_ = getPipelineCache(deviceInfo.device_);
+    // 磁盘缓存与预取线程在任务图之前创建：解析时收集资源，Engine2D初始化时传入
+#if TEXTURE_DISK_CACHE
+    textureDiskCache = new TextureDiskCache(std::string(app->activity->internalDataPath) + "/texture_cache", TEXTURE_DISK_CACHE_BUDGET);
+#if TEXTURE_DISK_CACHE_CLEAR_ON_START
+    textureDiskCache->clear();
+#endif
+#endif
+#if PREFETCH_RESOURCES
+    resourcePrefetcher = new ResourcePrefetcher(app, PREFETCH_THREADS, TEXTURE_DECODE_AT_DISPLAY_SIZE);
+    resourcePrefetcher->setDiskCache(textureDiskCache);
+#endif
+
+    /*
+     * 启动任务图：解析（及预取线程的解码）不依赖Vulkan，与设备、交换链的创建并发
+     *   parse ------------------------------------------------------------+
+     *   device --+-- swapchain [main] ----------------+                   |
+     *            +-- pipelineCache -------------------+-- pipelines ------+-- 完成
+     *            +-- engine2d ------------------------+-- workers [main] -+
+     */
+    StartupGraph startupGraph(STARTUP_TASK_GRAPH);
 
+// ============================ 以下为所需绘制内容 ==============================
+    uint32_t parseTask = startupGraph.addTask("parse", [app] {
+        int32_t width, height;
+#if BINARY_RENDER_TREE
+        BinaryTree binaryTree;
+        rootNode = binaryTree.loadOrConvert(app, RS_TREE_PATH, BinaryTree::cachePath(app->activity->internalDataPath, RS_TREE_PATH),
+                                            width, height, &animationsList, resourcePrefetcher);
+#else
+        TreeParser treeParser;
+        rootNode = treeParser.parse(app, RS_TREE_PATH, width, height, &animationsList, resourcePrefetcher);
+#endif
+//        rootNode = testRenderTree();
+//        LOGI("%s", rootNode->dumpTree().c_str());
+#if ASSET_IO_BENCHMARK
+        runAssetFileBenchmark(app, RS_TREE_PATH, rootNode);
+#endif
+#if BINARY_TREE_BENCHMARK
+        runBinaryTreeBenchmark(app);
+#endif
+#if TEXTURE_DISK_CACHE && TEXTURE_DISK_CACHE_BENCHMARK
+        runTextureDiskCacheBenchmark(app, textureDiskCache, rootNode);
+#endif
+#if GLYPH_RASTER_BENCHMARK
+        runGlyphRasterizerBenchmark(app, GLYPH_RASTER_THREADS);
+#endif
+#if SDF_TEXT_BENCHMARK
+        runSdfTextBenchmark(app, SDF_BASE_PIXEL_HEIGHT, SDF_SPREAD);
+#endif
+#if GLYPH_CACHE_BENCHMARK
+        // 用合成的CJK文本场景代替解析的渲染树（保留其显示尺寸），字形在首次绘制时光栅化
+        deleteRenderTree(rootNode);
+        animationsList.clear();
+        glyphBenchmarkWidth = width;
+        glyphBenchmarkHeight = height;
+        rootNode = glyphBenchmarkTree(0);
+#endif
+        if (resourcePrefetcher) {
+            resourcePrefetcher->start(width, height);
+        }
+    });
+
+// ============================ 以下为Vulkan全局数据结构 ============================
+    uint32_t deviceTask = startupGraph.addTask("device", [app] {
+        // 依次创建vulkan全局数据结构
+        deviceInfo.instance_ = getInstance();
+        deviceInfo.surface_ = getSurface(deviceInfo.instance_, app->window);
+        deviceInfo.physicalDevice_ = getPhysicalDevice(deviceInfo.instance_, deviceInfo.surface_);
+        deviceInfo.queueFamilyIndex_ = getQueueFamilyIndex(deviceInfo.physicalDevice_);
+        deviceInfo.transferQueueFamilyIndex_ = getTransferQueueFamilyIndex(deviceInfo.physicalDevice_, deviceInfo.queueFamilyIndex_);
+        deviceInfo.pushDescriptor_ = PUSH_DESCRIPTORS && hasDeviceExtension(deviceInfo.physicalDevice_, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        LOGI("push descriptors %s", deviceInfo.pushDescriptor_ ? "on" : (PUSH_DESCRIPTORS ? "unsupported" : "off"));
+        deviceInfo.device_ = getDevice(deviceInfo.physicalDevice_, deviceInfo.queueFamilyIndex_, deviceInfo.transferQueueFamilyIndex_, deviceInfo.pushDescriptor_);
+        deviceInfo.queue_ = getQueue(deviceInfo.device_, deviceInfo.queueFamilyIndex_);
+        deviceInfo.transferQueue_ = getQueue(deviceInfo.device_, deviceInfo.transferQueueFamilyIndex_);
+    }, {}, true);
+
+    uint32_t swapchainTask = startupGraph.addTask("swapchain", [] {
+        // 创建交换链
+        getSwapChain(deviceInfo.surface_, deviceInfo.physicalDevice_, deviceInfo.queueFamilyIndex_, deviceInfo.device_, &swapchainInfo);
+
+        // 创建render pass
+        renderInfo.renderPass_ = getRenderPass(deviceInfo.device_, swapchainInfo.displayFormat_);
+
+        // 依次创建Image、imageView、FrameBuffer
+        getFrameBuffers(deviceInfo.device_, renderInfo.renderPass_, &swapchainInfo);
+
+        // 创建指令池
+        renderInfo.cmdPool_ = getCommandPool(deviceInfo.device_, deviceInfo.queueFamilyIndex_);
+
+        // 创建指令缓冲（为帧缓冲中的每一帧）
+        getCommandBuffers(deviceInfo.device_, swapchainInfo.swapchainLength_, renderInfo.cmdPool_, &renderInfo);
+
+        // 创建同步原语
+        getImageAvailableSemaphore(deviceInfo.device_, &renderInfo);
+        getRenderFinishedFence(deviceInfo.device_, &renderInfo);
+    }, {deviceTask}, true);
+
+    uint32_t pipelineCacheTask = startupGraph.addTask("pipelineCache", [app] {
+#if PIPELINE_CACHE
+        // 创建管线缓存：从磁盘加载上次写回的数据，热启动时创建管线只需反序列化
+        pipelineCachePath = std::string(app->activity->internalDataPath) + "/pipeline_cache.bin";
+#if PIPELINE_CACHE_CLEAR_ON_START
+        remove(pipelineCachePath.c_str());
+#endif
+        std::vector<uint8_t> pipelineCacheData = loadPipelineCacheData(deviceInfo.physicalDevice_, pipelineCachePath);
+        pipelineCacheWarm = !pipelineCacheData.empty();
+        renderInfo.pipelineCache_ = getPipelineCache(deviceInfo.device_, pipelineCacheData);
+        LOGI("pipeline cache %s (%zu bytes loaded)", pipelineCacheWarm ? "warm" : "cold", pipelineCacheData.size());
+#endif
+    }, {deviceTask});
 
 // ============================ 以下为2d引擎资源管理 ============================
-
-    // 初始化2D引擎绘制接口类
-    Engine2D::init(app, &deviceInfo, &swapchainInfo, &renderInfo);
-
+    uint32_t engineTask = startupGraph.addTask("engine2d", [app] {
+#if BUFFER_CONTENTION_BENCHMARK
+        runBufferContentionBenchmark(deviceInfo.device_, deviceInfo.physicalDevice_);
+#endif
+#if MANAGER_LOOKUP_BENCHMARK
+        runManagerLookupBenchmark();
+#endif
+#if DESCRIPTOR_STRESS_BENCHMARK
+        runDescriptorStressBenchmark(deviceInfo.device_, deviceInfo.physicalDevice_);
+#endif
+
+        // 初始化2D引擎绘制接口类（只保存交换链与render pass的指针，创建管线时才读取）
+        Engine2D::init(app, &deviceInfo, &swapchainInfo, &renderInfo, resourcePrefetcher, textureDiskCache);
+    }, {deviceTask});
+
+#if PREWARM_PIPELINES
+    startupGraph.addTask("pipelines", [] {
+        // 管线并行创建（管线缓存命中时只需反序列化），首帧的工作线程不再阻塞在findPipeline上
+        Engine2D::prewarmPipelines();
+#if PIPELINE_CACHE
+        // 冷启动时所有管线已创建，立即写回（应用常在不调用DeleteVulkan的情况下被杀）
+        if (!pipelineCacheWarm) {
+            LOGI("pipeline cache saved: %zu bytes", savePipelineCache(deviceInfo.device_, renderInfo.pipelineCache_, pipelineCachePath));
+        }
+#endif
+    }, {swapchainTask, pipelineCacheTask, engineTask});
+#endif
 
 // ============================ 以下为渲染线程管理 ==============================
-    renderWorkerPool.init();
-    renderWorkerPool.start();
-
-// ============================ 以下为所需绘制内容 ==============================
-    TreeParser treeParser;
-    int32_t width, height;
-    rootNode = treeParser.parse(app, RS_TREE_PATH, width, height, &animationsList);
-//    rootNode = testRenderTree();
-//    LOGI("%s", rootNode->dumpTree().c_str());
+    uint32_t workersTask = startupGraph.addTask("workers", [] {
+        renderWorkerPool.init();
+        renderWorkerPool.start();
+    }, {engineTask}, true);
+
+    // 任一任务失败时按依赖的逆序撤销已完成的任务（失败的任务自身创建了一半的资源不在此释放）
+    startupGraph.setTeardown(workersTask, [] {
+        renderWorkerPool.join();
+    });
+    startupGraph.setTeardown(engineTask, [] {
+        Engine2D::del(); // 预热的管线由Engine2D的PipelineManager持有，一并删除
+    });
+    startupGraph.setTeardown(pipelineCacheTask, [] {
+#if PIPELINE_CACHE
+        vkDestroyPipelineCache(deviceInfo.device_, renderInfo.pipelineCache_, nullptr);
+        renderInfo.pipelineCache_ = VK_NULL_HANDLE;
+#endif
+    });
+    startupGraph.setTeardown(swapchainTask, [] {
+        deleteSwapchainResources();
+    });
+    startupGraph.setTeardown(deviceTask, [] {
+        vkDestroyDevice(deviceInfo.device_, nullptr);
+        vkDestroySurfaceKHR(deviceInfo.instance_, deviceInfo.surface_, nullptr);
+        vkDestroyInstance(deviceInfo.instance_, nullptr);
+        deviceInfo.device_ = VK_NULL_HANDLE;
+        deviceInfo.instance_ = VK_NULL_HANDLE;
+    });
+    startupGraph.setTeardown(parseTask, [] {
+        deleteRenderTree(rootNode);
+        rootNode = nullptr;
+        animationsList.clear();
+    });
+
+    try {
+        startupGraph.run();
+    } catch (const std::exception &e) {
+        LOGE("InitVulkan failed: %s", e.what());
+        startupGraph.teardown();
+        deleteResourceLoaders();
+        return false;
+    }
+    startupGraph.dumpTimeline("InitVulkan");
 
     deviceInfo.initialized_ = true;
 
@@ -208,18 +447,18 @@ bool IsVulkanReady() {
 void DeleteVulkan() {
     renderWorkerPool.join();
 
-    vkDestroySemaphore(deviceInfo.device_, renderInfo.imageAvailableSemaphore_, nullptr);
-    vkDestroyFence(deviceInfo.device_, renderInfo.renderFinishedFence_, nullptr);
+    deleteSwapchainResources();
 
-    vkFreeCommandBuffers(deviceInfo.device_, renderInfo.cmdPool_, renderInfo.cmdBuffer_.size(),
-                         renderInfo.cmdBuffer_.data());
-    renderInfo.cmdBuffer_.clear();
+    Engine2D::del(); // 删除Engine2D维护的BufferManager和PipelineManager和ImageManager
 
-    vkDestroyCommandPool(deviceInfo.device_, renderInfo.cmdPool_, nullptr);
-    vkDestroyRenderPass(deviceInfo.device_, renderInfo.renderPass_, nullptr);
-    DeleteSwapChain(deviceInfo.device_, &swapchainInfo);
+#if PIPELINE_CACHE
+    // 写回运行期间新创建的管线（如resize后重建的）
+    savePipelineCache(deviceInfo.device_, renderInfo.pipelineCache_, pipelineCachePath);
+    vkDestroyPipelineCache(deviceInfo.device_, renderInfo.pipelineCache_, nullptr);
+    renderInfo.pipelineCache_ = VK_NULL_HANDLE;
+#endif
 
-    Engine2D::del(); // 删除Engine2D维护的BufferManager和PipelineManager和ImageManager
+    deleteResourceLoaders();
 
     vkDestroyDevice(deviceInfo.device_, nullptr);
     vkDestroyInstance(deviceInfo.instance_, nullptr);
@@ -228,9 +467,69 @@ void DeleteVulkan() {
 }
 
 // Draw one frame
+#if RESIZE_BENCHMARK
+/**
+ * 模拟surface resize：每隔RESIZE_BENCHMARK_INTERVAL帧切换显示区域（framebuffer不变，只改变displaySize_）
+ * 前两次保留几何缓存与管线，后两次全部重建，之后循环
+ * @return 本帧是否发生了resize
+ */
+static bool simulateResize(uint64_t frame, bool *rebuildAll) {
+    static VkExtent2D fullSize = swapchainInfo.displaySize_;
+    if (frame == 0 || frame % RESIZE_BENCHMARK_INTERVAL != 0) {
+        return false;
+    }
+    uint64_t resizeCount = frame / RESIZE_BENCHMARK_INTERVAL - 1;
+    *rebuildAll = (resizeCount / 2) % 2 == 1;
+    if (resizeCount % 2 == 0) {
+        swapchainInfo.displaySize_.width = fullSize.width * 3 / 4;
+    } else {
+        swapchainInfo.displaySize_ = fullSize;
+    }
+    Engine2D::onResize(*rebuildAll);
+    return true;
+}
+#endif
+
+#if TEXTURE_CACHE_BENCHMARK
+// 压力测试依次遍历的场景
+static const char *BENCHMARK_SCENES[] = {
+        "RSTree/chatting-M70.txt", "RSTree/chatting-X5.txt", "RSTree/chatting-XT.txt",
+        "RSTree/desktop-M70.txt", "RSTree/desktop-X5.txt", "RSTree/desktop-XT.txt",
+        "RSTree/investment-M70.txt", "RSTree/investment-X5.txt", "RSTree/investment-XT.txt",
+        "RSTree/lifestyle-M70.txt", "RSTree/lifestyle-X5.txt", "RSTree/lifestyle-XT.txt",
+        "RSTree/movies-M70.txt", "RSTree/movies-X5.txt", "RSTree/movies-XT.txt",
+        "RSTree/music-M70.txt", "RSTree/music-X5.txt", "RSTree/music-XT.txt",
+        "RSTree/services-M70.txt", "RSTree/services-X5.txt", "RSTree/services-XT.txt",
+        "RSTree/settings-M70.txt", "RSTree/settings-X5.txt", "RSTree/settings-XT.txt",
+        "RSTree/shopping-M70.txt", "RSTree/shopping-X5.txt", "RSTree/shopping-XT.txt",
+        "RSTree/social-M70.txt", "RSTree/social-X5.txt", "RSTree/social-XT.txt",
+};
+static const uint32_t BENCHMARK_SCENE_COUNT = sizeof(BENCHMARK_SCENES) / sizeof(BENCHMARK_SCENES[0]);
+
+/**
+ * 每隔TEXTURE_CACHE_BENCHMARK_INTERVAL帧切换到下一个场景（上一帧已等待fence，此时工作线程空闲）
+ * @return 本帧是否切换了场景
+ */
+static bool switchScene(android_app *app, uint64_t frame) {
+    if (frame == 0 || frame % TEXTURE_CACHE_BENCHMARK_INTERVAL != 0) {
+        return false;
+    }
+    uint64_t sceneIndex = (frame / TEXTURE_CACHE_BENCHMARK_INTERVAL) % BENCHMARK_SCENE_COUNT;
+    deleteRenderTree(rootNode);
+    animationsList.clear();
+    TreeParser treeParser;
+    int32_t width, height;
+    rootNode = treeParser.parse(app, BENCHMARK_SCENES[sceneIndex], width, height, &animationsList);
+    return true;
+}
+#endif
+
 bool VulkanDrawFrame(android_app *app) {
 
     ATrace_beginSection("MyVulkanDrawFrame");
+#if FIRST_FRAME_STATS
+    auto frameStart = std::chrono::steady_clock::now();
+#endif
 
     // 获取图片index
     uint32_t nextIndex;
@@ -241,6 +540,20 @@ bool VulkanDrawFrame(android_app *app) {
     CALL_VK(vkResetFences(deviceInfo.device_, 1, &renderInfo.renderFinishedFence_));
 
     ATrace_beginSection("EndToEndDuration");
+#if RESIZE_BENCHMARK
+    // 上一帧已等待fence，此时GPU与工作线程空闲
+    auto resizeStart = std::chrono::steady_clock::now();
+    bool rebuildAll = false;
+    bool resized = simulateResize(frameIndex, &rebuildAll);
+#endif
+#if TEXTURE_CACHE_BENCHMARK
+    auto switchStart = std::chrono::steady_clock::now();
+    bool switched = switchScene(app, frameIndex);
+#endif
+#if GLYPH_CACHE_BENCHMARK
+    auto glyphSwitchStart = std::chrono::steady_clock::now();
+    bool glyphSwitched = switchGlyphScene(frameIndex);
+#endif
     // 动画
     ATrace_beginSection("animate");
     VSyncInfo vSyncInfo = { // TODO: 后续接入vsync
@@ -261,6 +574,7 @@ bool VulkanDrawFrame(android_app *app) {
     drawTaskList.generateFromRenderTree(rootNode);
     ATrace_endSection();
 
+
     // 填写绘制命令
     // 首先，重置该帧在上次轮转时使用的资源
     vkResetCommandBuffer(renderInfo.cmdBuffer_[nextIndex], 0);
@@ -269,24 +583,125 @@ bool VulkanDrawFrame(android_app *app) {
     // 渲染（生成VkCommandBuffer）
     renderWorkerPool.renderAll(deviceInfo, swapchainInfo, renderInfo, nextIndex, &drawTaskList);
 
+    // 提交该帧新纹理的上传（合并为一次提交），渲染在片段着色器阶段等待上传完成
+    VkSemaphore uploadSemaphore = Engine2D::submitUploads();
+
     // 提交指令
-    VkPipelineStageFlags waitStageMask =
-            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    VkSemaphore waitSemaphores[2] = {renderInfo.imageAvailableSemaphore_, uploadSemaphore};
+    VkPipelineStageFlags waitStageMasks[2] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT};
     VkSubmitInfo submit_info = {.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
             .pNext = nullptr,
-            .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &renderInfo.imageAvailableSemaphore_,
-            .pWaitDstStageMask = &waitStageMask,
+            .waitSemaphoreCount = uploadSemaphore != VK_NULL_HANDLE ? 2u : 1u,
+            .pWaitSemaphores = waitSemaphores,
+            .pWaitDstStageMask = waitStageMasks,
             .commandBufferCount = 1,
             .pCommandBuffers = &renderInfo.cmdBuffer_[nextIndex],
             .signalSemaphoreCount = 0,
             .pSignalSemaphores = nullptr};
-    CALL_VK(vkQueueSubmit(deviceInfo.queue_, 1, &submit_info, renderInfo.renderFinishedFence_));
+    {
+        std::lock_guard<std::mutex> queueLocker(Engine2D::queueMutex());
+        CALL_VK(vkQueueSubmit(deviceInfo.queue_, 1, &submit_info, renderInfo.renderFinishedFence_));
+    }
     ATrace_endSection();
 
     // Wait timeout set to 1 second
     CALL_VK(vkWaitForFences(deviceInfo.device_, 1, &renderInfo.renderFinishedFence_, VK_TRUE, 1000000000));
 
+#if FIRST_FRAME_STATS
+    if (vSyncInfo.frameIndex < COLD_START_FRAMES) {
+        static double firstFrameMs = 0.0;
+        static double worstFrameMs = 0.0;
+        static uint64_t worstFrameIndex = 0;
+        auto frameEnd = std::chrono::steady_clock::now();
+        double frameMs = std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+        if (vSyncInfo.frameIndex == 0) {
+            firstFrameMs = frameMs;
+            LOGI("first frame [%s]: %.3f ms (%.3f ms since InitVulkan)", RS_TREE_PATH, frameMs,
+                 std::chrono::duration<double, std::milli>(frameEnd - initStartTime).count());
+            Engine2D::dumpUploadStats();
+            Engine2D::dumpInFlightStats(); // 首帧中各工作线程等待同一资源创建
+            if (resourcePrefetcher) {
+                resourcePrefetcher->dump();
+            }
+        }
+        if (frameMs > worstFrameMs) {
+            worstFrameMs = frameMs;
+            worstFrameIndex = vSyncInfo.frameIndex;
+        }
+        if (vSyncInfo.frameIndex == COLD_START_FRAMES - 1) {
+            LOGI("cold start [%s]: first frame %.3f ms, worst frame %.3f ms (frame %llu) over %d frames, non-blocking textures %s, prefetch %s, "
+                 "pipeline cache %s, prewarm pipelines %s",
+                 RS_TREE_PATH, firstFrameMs, worstFrameMs, (unsigned long long) worstFrameIndex, COLD_START_FRAMES,
+                 NONBLOCKING_TEXTURE ? "on" : "off", PREFETCH_RESOURCES ? "on" : "off",
+                 PIPELINE_CACHE ? (pipelineCacheWarm ? "warm" : "cold") : "off", PREWARM_PIPELINES ? "on" : "off");
+            Engine2D::dumpUploadStats();
+            Engine2D::dumpTextureCacheStats(); // 纹理占用、解码与缩小耗时
+            Engine2D::dumpInFlightStats(); // 冷启动期间累计的等待次数与阻塞时间
+            if (resourcePrefetcher) {
+                resourcePrefetcher->dump();
+            }
+            if (textureDiskCache) {
+                textureDiskCache->dump(); // 命中时跳过解码
+            }
+        }
+    }
+#endif
+
+#if RESIZE_BENCHMARK
+    if (resized) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - resizeStart).count();
+        LOGI("resize to %ux%u (%s): time to first frame %.3f ms", swapchainInfo.displaySize_.width,
+             swapchainInfo.displaySize_.height, rebuildAll ? "full rebuild" : "keep geometry and pipelines", ms);
+    }
+#endif
+
+#if TEXTURE_CACHE_BENCHMARK
+    if (switched) {
+        // 统计切换场景后首帧（包括解析）的耗时，每遍历一轮所有场景打印一次
+        static double worstSwitchMs = 0.0;
+        static double totalSwitchMs = 0.0;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - switchStart).count();
+        worstSwitchMs = std::max(worstSwitchMs, ms);
+        totalSwitchMs += ms;
+        uint64_t switchCount = vSyncInfo.frameIndex / TEXTURE_CACHE_BENCHMARK_INTERVAL;
+        if (switchCount % BENCHMARK_SCENE_COUNT == 0) {
+            LOGI("scene cycle %llu: %u scenes, switch frame avg %.3f ms, worst %.3f ms",
+                 (unsigned long long) (switchCount / BENCHMARK_SCENE_COUNT), BENCHMARK_SCENE_COUNT,
+                 totalSwitchMs / BENCHMARK_SCENE_COUNT, worstSwitchMs);
+            Engine2D::dumpTextureCacheStats();
+            worstSwitchMs = 0.0;
+            totalSwitchMs = 0.0;
+        }
+    }
+#endif
+
+#if TEXT_LAYOUT_BENCHMARK
+    {
+        // 工作线程已完成该帧的所有绘制任务；每段结束时打印并切换排版缓存的开关（第一段为TEXT_LAYOUT_CACHE）
+        static bool layoutCacheOn = TEXT_LAYOUT_CACHE;
+        static uint64_t textDrawTimeNs = 0;
+        textDrawTimeNs += Engine2D::takeTextDrawTime();
+        if ((vSyncInfo.frameIndex + 1) % TEXT_LAYOUT_BENCHMARK_INTERVAL == 0) {
+            LOGI("text layout benchmark [%s]: layout cache %s, text draw %.3f ms/frame (all workers)", RS_TREE_PATH,
+                 layoutCacheOn ? "on" : "off", static_cast<double>(textDrawTimeNs) / TEXT_LAYOUT_BENCHMARK_INTERVAL / 1e6);
+            layoutCacheOn = !layoutCacheOn;
+            Engine2D::setTextLayoutCache(layoutCacheOn);
+            textDrawTimeNs = 0;
+        }
+    }
+#endif
+
+#if GLYPH_CACHE_BENCHMARK
+    if (glyphSwitched) {
+        // 换一批文本后的首帧包含所有新字形的光栅化与上传，以及超出atlas页时的字形淘汰
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - glyphSwitchStart).count();
+        LOGI("glyph scene %llu: switch frame %.3f ms",
+             (unsigned long long) (vSyncInfo.frameIndex / GLYPH_CACHE_BENCHMARK_INTERVAL), ms);
+        Engine2D::dumpTextureCacheStats();
+    }
+#endif
+
 
     // 递交显示
     ATrace_beginSection("SendPresent");
@@ -301,7 +716,10 @@ bool VulkanDrawFrame(android_app *app) {
             .pImageIndices = &nextIndex,
             .pResults = &result,
     };
-    vkQueuePresentKHR(deviceInfo.queue_, &presentInfo);
+    {
+        std::lock_guard<std::mutex> queueLocker(Engine2D::queueMutex());
+        vkQueuePresentKHR(deviceInfo.queue_, &presentInfo);
+    }
     ATrace_endSection();
 
     ATrace_endSection();
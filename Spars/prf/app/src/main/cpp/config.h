@@ -1,9 +1,114 @@
 #ifndef PRF_CONFIG_H
 #define PRF_CONFIG_H
 
-#define RS_TREE_PATH "RSTree/services-X5.txt"
+#define RS_TREE_PATH "RSTree/services-X5.txt" // RSTree/animrows-X5.txt为30行HorLnrMov动画的测试场景
 #define RENDER_THREAD_COUNT 5
 #define DIVIDE_BY 1.6
 #define MAINTHREAD_CORE 9
 
+// 为1时统计每帧上传的vertex/index字节数，并与旧格式（float颜色+UINT32索引）对比
+#define UPLOAD_STATS 0
+// 为1时统计BufferManager的分配耗时、占用与浪费，并定期打印
+#define BUFFER_STATS 0
+#define STATS_INTERVAL 120 // 每隔多少帧打印一次统计
+// 为1时在初始化时运行BufferManager多线程争用测试（全局锁 vs 线程缓存）
+#define BUFFER_CONTENTION_BENCHMARK 0
+// 为1时在初始化时对比Manager热路径查找的吞吐（共享锁 vs 无锁快照，1~8个线程）
+#define MANAGER_LOOKUP_BENCHMARK 0
+// 为1时启用跨帧几何缓存：内容相同的DrawTask直接复用之前生成的vertex/index数据
+#define GEOMETRY_CACHE 1
+#define GEOMETRY_CACHE_BUDGET (4 << 20) // 几何缓存占用的字节上限
+// 为1时统计几何缓存命中率与工作线程每帧绘制的CPU时间，并定期打印
+#define GEOMETRY_CACHE_STATS 0
+// 为1时动画节点的子树以该节点为原点生成几何，移动只改变push constant中的平移，几何缓存可以跨帧命中
+#define NODE_LOCAL_GEOMETRY 1
+// 为1时纹理上传只录制指令，由主线程在提交该帧前合并为一次提交（有独立transfer队列时使用之）；为0时每张纹理提交后等待fence（用于对比）
+#define ASYNC_TEXTURE_UPLOAD 1
+// 为1时纹理未就绪不阻塞工作线程：后台线程解码并上传，期间以图片平均色的矩形占位（依赖ASYNC_TEXTURE_UPLOAD）
+#define NONBLOCKING_TEXTURE 1
+#define TEXTURE_LOADER_THREADS 2 // 后台纹理加载线程数
+#if NONBLOCKING_TEXTURE && !ASYNC_TEXTURE_UPLOAD
+#error "NONBLOCKING_TEXTURE requires ASYNC_TEXTURE_UPLOAD: background loaders must not submit to the queue"
+#endif
+// 为1时在Vulkan初始化之前解析渲染树，收集所有图片与字体，由后台线程池在初始化期间解码与光栅化（首屏优先）；为0时首次使用才解码
+#define PREFETCH_RESOURCES 1
+#define PREFETCH_THREADS 3 // 预取线程数
+// 纹理与字形atlas页的LRU缓存预算（字节），超出时在帧开始时淘汰最久未使用的，淘汰后延迟销毁
+#define TEXTURE_CACHE_BUDGET (64 << 20)
+#define GLYPH_CACHE_BUDGET (8 << 20)
+#define GLYPH_RASTER_THREADS 2 // 并行光栅化的辅助线程数（一次绘制中未缓存的字形较多时与工作线程一起光栅化）
+// 为1时按字符串缓存文本排版（字形四边形），绘制已排版的字符串只需平移复制；为0时每次逐字符查找字形并排版
+#define TEXT_LAYOUT_CACHE 1
+// 为1时文本使用有向距离场（SDF）：每种字体只有一张以SDF_BASE_PIXEL_HEIGHT光栅化的距离场atlas，任意字号由text_sdf.frag绘制，
+// 不同字号的文本可以合批；为0时每种字体大小一张位图atlas
+#define SDF_TEXT 0
+#define SDF_BASE_PIXEL_HEIGHT 48 // 距离场的光栅化字号
+#define SDF_SPREAD 6 // 距离场在轮廓两侧覆盖的像素数（基准字号下）
+// 为1时源图片大于其最大绘制尺寸时在CPU上缩小到该尺寸再上传（预取时按解析收集到的最大尺寸，否则按首次绘制的尺寸）
+#define TEXTURE_DECODE_AT_DISPLAY_SIZE 1
+// 为1时为独立纹理在CPU上生成完整的mip链（按绘制尺寸解码后很少缩小采样，默认关闭）
+#define TEXTURE_MIPMAPS 0
+// 为1时宽高均不超过ATLAS_MAX_IMAGE_SIZE的图片放入共享的atlas页（shelf装箱），同一页上相邻的图片绘制合批为一次draw call
+#define TEXTURE_ATLAS 1
+#define ATLAS_MAX_IMAGE_SIZE 128 // 放入atlas的图片宽高上限（像素）
+#define ATLAS_PAGE_SIZE 1024 // atlas页的宽高（像素）
+#define ATLAS_MAX_PAGES 8 // atlas页数上限，放不下时改为独立的纹理
+// 为1时将解码（及缩小）后的像素写入应用私有目录，之后的启动直接mmap，跳过解码（源图片改变时校验失败并重新解码）
+#define TEXTURE_DISK_CACHE 1
+#define TEXTURE_DISK_CACHE_BUDGET (64 << 20) // 磁盘缓存的字节上限，超出时删除最久未使用的文件
+#define TEXTURE_DISK_CACHE_CLEAR_ON_START 0 // 为1时启动时清空磁盘缓存（测量冷启动）
+// 为1时在初始化时对比不使用缓存、冷缓存与热缓存下解码渲染树中所有图片的耗时（依赖TEXTURE_DISK_CACHE）
+#define TEXTURE_DISK_CACHE_BENCHMARK 0
+// 为1时使用持久化到磁盘的VkPipelineCache：启动时加载，冷启动创建完管线后与退出时写回
+#define PIPELINE_CACHE 1
+#define PIPELINE_CACHE_CLEAR_ON_START 0 // 为1时启动时删除缓存文件（测量冷启动）
+// 为1时在初始化时并行创建所有管线（每种一个线程），工作线程不再在首帧中阻塞等待管线创建
+#define PREWARM_PIPELINES 1
+// 为1时定期打印纹理缓存的命中、未命中与淘汰统计，以及纹理显存分配数、descriptor数与每帧draw call数
+#define TEXTURE_CACHE_STATS 0
+// 为1时每隔TEXTURE_CACHE_BENCHMARK_INTERVAL帧切换到下一个场景（依次遍历30个场景），每遍历一轮打印纹理缓存统计（压力测试）
+#define TEXTURE_CACHE_BENCHMARK 0
+#define TEXTURE_CACHE_BENCHMARK_INTERVAL 30
+// 为1时新建描述符集的写入推迟到主线程录制绑定之前，合并为一次vkUpdateDescriptorSets；为0时创建时逐个写入（持锁）
+#define BATCH_DESCRIPTOR_UPDATES 1
+// 为1时若设备支持VK_KHR_push_descriptor，图片与文字的纹理在录制时以push descriptor写入，不分配描述符集
+#define PUSH_DESCRIPTORS 0
+// 为1时图片与文字管线的描述符布局使用immutable sampler（图片为重复采样器，文字为atlas的clamp采样器），绑定时不再读取descriptor中的采样器
+#define IMMUTABLE_SAMPLERS 1
+// 为1时在初始化时为DESCRIPTOR_STRESS_TEXTURE_COUNT个不同的纹理创建描述符集（逐个写入与合并写入对比），打印分配延迟、池数与回收复用
+#define DESCRIPTOR_STRESS_BENCHMARK 0
+#define DESCRIPTOR_STRESS_TEXTURE_COUNT 5000
+// 为1时用随机CJK文本（U+4E00-U+9FFF，几种字号）的合成场景代替渲染树，每隔GLYPH_CACHE_BENCHMARK_INTERVAL帧换一批文本，
+// 每次切换打印切换帧耗时与字形缓存统计（首次光栅化耗时、淘汰数与atlas占用）
+#define GLYPH_CACHE_BENCHMARK 0
+#define GLYPH_CACHE_BENCHMARK_INTERVAL 60
+#define GLYPH_CACHE_BENCHMARK_FONT "/system/fonts/NotoSansCJK-Regular.ttc"
+// 为1时在初始化时测量investment与chatting场景中各字体大小的atlas光栅化耗时（打开字体、缓存字体与并行光栅化对比）
+#define GLYPH_RASTER_BENCHMARK 0
+// 为1时在初始化时对比investment与chatting场景中SDF与位图文本的atlas数、字形像素与覆盖率误差（在CPU上按text_sdf.frag重建）
+#define SDF_TEXT_BENCHMARK 0
+// 为1时每隔TEXT_LAYOUT_BENCHMARK_INTERVAL帧切换一次文本排版缓存的开关，打印上一段中工作线程每帧绘制文本的CPU时间
+// （使用文本较多的场景，如RSTree/chatting-X5.txt；几何缓存命中时不生成顶点，GEOMETRY_CACHE为0时可对比顶点生成）
+#define TEXT_LAYOUT_BENCHMARK 0
+#define TEXT_LAYOUT_BENCHMARK_INTERVAL 300
+// 为1时在初始化时对比复制与只读视图两种方式读取渲染树与图片的耗时与峰值RSS
+#define ASSET_IO_BENCHMARK 0
+// 为1时打印首帧耗时（从InitVulkan开始与首帧本身）、冷启动期间最差帧耗时及纹理上传统计
+#define FIRST_FRAME_STATS 0
+#define COLD_START_FRAMES 120 // 冷启动统计覆盖的帧数
+// 为1时启动步骤按依赖并发执行（解析与设备、交换链的创建重叠，引擎初始化与交换链的创建重叠），为0时按原顺序串行执行（对比）
+// 两种方式均在InitVulkan结束时打印启动时间线
+#define STARTUP_TASK_GRAPH 1
+// 为1时启动时加载RS_TREE_PATH转换得到的二进制渲染树（internalDataPath中，mmap后直接创建节点，不解析文本），
+// 二进制文件不存在或已过期（源文本内容、格式版本或DIVIDE_BY改变）时解析文本并写出二进制文件供下次启动使用
+#define BINARY_RENDER_TREE 1
+// 为1时在初始化时对比所有XT场景与合成渲染树的文本解析与二进制加载耗时
+#define BINARY_TREE_BENCHMARK 0
+#define BINARY_TREE_BENCHMARK_REPEAT 20 // XT场景每种方式重复的次数
+#define BINARY_TREE_SYNTHETIC_NODES 100000 // 合成渲染树的节点数
+// 为1时每隔RESIZE_BENCHMARK_INTERVAL帧模拟一次surface resize（显示区域的宽在原尺寸与3/4之间切换），
+// 依次使用保留几何与管线、全部重建两种方式，打印resize后首帧的耗时
+#define RESIZE_BENCHMARK 0
+#define RESIZE_BENCHMARK_INTERVAL 300
+
 #endif //PRF_CONFIG_H
@@ -76,7 +76,10 @@ void DrawTaskList::drawRenderNode(RenderNode *renderNode) {
         // 首先试图合批，若未成功合批，则将该DrawCmd单独封装成DrawTask插在末尾
         if (!batchDrawCmdWithDrawTasks(drawCmd.get(), renderNode)) {
             uint32_t taskId = drawTasks_.size(); // 确保插入id始终从0开始递增
-            drawTasks_.push_back(drawCmd->encapsulateIntoDrawTask(taskId, renderNode));
+            std::shared_ptr<DrawTask> drawTask = drawCmd->encapsulateIntoDrawTask(taskId, renderNode);
+            drawTask->originX_ = renderNode->getOriginX();
+            drawTask->originY_ = renderNode->getOriginY();
+            drawTasks_.push_back(drawTask);
         }
 
     }
@@ -94,7 +97,14 @@ bool DrawTaskList::batchDrawCmdWithDrawTasks(DrawCmd *drawCmd, RenderNode *rende
         }
 
         Rect cmdBoundBox = drawCmd->getAbsoluteBoundingBox(renderNode);
-        uint32_t ret = drawTasks_[size - 1 - i]->batchWith(drawCmd, cmdBoundBox, renderNode);
+        DrawTask *drawTask = drawTasks_[size - 1 - i].get();
+        uint32_t ret;
+        if (drawTask->originX_ == renderNode->getOriginX() && drawTask->originY_ == renderNode->getOriginY()) {
+            ret = drawTask->batchWith(drawCmd, cmdBoundBox, renderNode);
+        } else {
+            // 原点不同（属于不同的变换节点）不可合批，只判断是否重叠
+            ret = drawTask->DrawTask::batchWith(drawCmd, cmdBoundBox, renderNode);
+        }
 
         if (ret == BATCH_SUCCESSFUL) {
             return true;
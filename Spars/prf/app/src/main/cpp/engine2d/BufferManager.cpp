@@ -4,93 +4,403 @@
 
 #include "BufferManager.h"
 #include "../vulkan/utils.h"
+#include "../config.h"
 
-BufferManager::BufferManager(VkDevice device, VkPhysicalDevice physicalDevice, VkBufferUsageFlags usage) {
+#include <algorithm>
+#include <chrono>
+
+std::atomic<uint32_t> BufferManager::nextManagerId_(0);
+
+BufferManager::BufferManager(VkDevice device, VkPhysicalDevice physicalDevice, VkBufferUsageFlags usage, bool useThreadCache) {
     device_ = device;
     physicalDevice_ = physicalDevice;
     usage_ = usage;
+    useThreadCache_ = useThreadCache;
+    managerId_ = nextManagerId_.fetch_add(1);
+
+    // 用一个临时VkBuffer查询可用的内存类型：优先HOST_COHERENT，否则退回仅HOST_VISIBLE（需手动flush）
+    VkBufferCreateInfo probeInfo = {};
+    probeInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    probeInfo.size = MIN_BUFFER_SIZE;
+    probeInfo.usage = usage_;
+    probeInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer probeBuffer;
+    CALL_VK(vkCreateBuffer(device_, &probeInfo, nullptr, &probeBuffer));
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device_, probeBuffer, &memRequirements);
+    vkDestroyBuffer(device_, probeBuffer, nullptr);
+
+    coherent_ = mapMemoryTypeToIndex(memRequirements.memoryTypeBits,
+                                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                     &memoryTypeIndex_);
+    if (!coherent_) {
+        mapMemoryTypeToIndex(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, &memoryTypeIndex_);
+    }
+
+    // index buffer的偏移需为索引大小的整数倍，这里统一按16字节对齐；
+    // 非coherent内存flush的范围需按nonCoherentAtomSize对齐，因此段也按其对齐
+    alignment_ = 16;
+    if (!coherent_) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice_, &properties);
+        alignment_ = std::max<uint64_t>(alignment_, properties.limits.nonCoherentAtomSize);
+    }
 }
 
 BufferManager::~BufferManager() {
     std::unique_lock<std::mutex> locker(mutex_);
-    // 释放所有的VkBuffer和VkDeviceMemory
-    for(auto iter = freeBufferLists_.begin(); iter != freeBufferLists_.end(); iter++) {
-        while (!iter->second.empty()) {
-            // 取出
-            VulkanBufferInfo bufferInfo = iter->second.front();
-            iter->second.pop_front();
-
-            // 删除
-            vkDestroyBuffer(device_, bufferInfo.buffer_, nullptr);
-            vkFreeMemory(device_, bufferInfo.bufferMemory_, nullptr);
-        }
+    // 释放所有大块（段不持有独立的VkBuffer和VkDeviceMemory）
+    for(auto iter = blocks_.begin(); iter != blocks_.end(); iter++) {
+        vkDestroyBuffer(device_, iter->second.buffer_, nullptr);
+        vkFreeMemory(device_, iter->second.memory_, nullptr);
     }
+    blocks_.clear();
+    freeBufferLists_.clear();
+    threadCaches_.clear(); // 线程局部的指针不会再被使用（managerId_不复用）
 
-    for(auto iter = usedBufferLists_.begin(); iter != usedBufferLists_.end(); iter++) {
-        while (!iter->second.empty()) {
-            // 取出
-            VulkanBufferInfo bufferInfo = iter->second.front();
-            iter->second.pop_front();
-
-            // 删除
-            vkDestroyBuffer(device_, bufferInfo.buffer_, nullptr);
-            vkFreeMemory(device_, bufferInfo.bufferMemory_, nullptr);
-        }
+    for(VulkanBufferInfo &bufferInfo : staticBufferList_) {
+        vkDestroyBuffer(device_, bufferInfo.buffer_, nullptr);
+        vkFreeMemory(device_, bufferInfo.bufferMemory_, nullptr);
     }
+    staticBufferList_.clear();
 }
 
 void BufferManager::freeAllBuffers(uint32_t frameIndex) {
     std::unique_lock<std::mutex> locker(mutex_);
-    std::list<VulkanBufferInfo>& usedBufferList = usedBufferLists_[frameIndex];
 
-    // 将所有VkBuffer还至freeBufferLists_
-    while(!usedBufferList.empty()) {
-        // 取出
-        VulkanBufferInfo bufferInfo = usedBufferList.front();
-        usedBufferList.pop_front();
+    // 每个线程缓存按size class整体splice，代价与段的数量无关
+    // 此处访问其他线程的缓存依赖调用约定：没有线程正在分配（见allocBuffer）
+    for(auto &cache : threadCaches_) {
+        recycleCacheLocked(cache.get(), frameIndex);
+    }
+    recycleCacheLocked(&sharedCache_, frameIndex);
 
-        // 加入
-        freeBufferLists_[bufferInfo.size_].push_back(bufferInfo);
+    // 每帧调用一次，借此推进帧序号并回收长期空闲的大块
+    frameCounter_.fetch_add(1, std::memory_order_relaxed);
+    trimIdleBlocks();
+}
+
+void BufferManager::recycleCacheLocked(ThreadCache *cache, uint32_t frameIndex) {
+    auto frameIter = cache->usedLists_.find(frameIndex);
+    if (frameIter != cache->usedLists_.end()) {
+        for(auto iter = frameIter->second.begin(); iter != frameIter->second.end(); iter++) {
+            std::list<Segment> &freeList = cache->freeLists_[iter->first];
+            freeList.splice(freeList.end(), iter->second);
+
+            // 该线程缓存积攒过多，整体还给全局，供其他线程使用
+            if (freeList.size() > CACHE_MAX_SEGMENTS) {
+                returnToGlobalLocked(iter->first, freeList);
+            }
+        }
+
+        cache->liveBytes_ -= cache->frameLiveBytes_[frameIndex];
+        cache->wasteBytes_ -= cache->frameWasteBytes_[frameIndex];
+        cache->frameLiveBytes_[frameIndex] = 0;
+        cache->frameWasteBytes_[frameIndex] = 0;
     }
 
+    // 长期不分配的线程缓存（如线程已退出），将所有free段还给全局
+    if (frameCounter_.load() - cache->lastAllocFrame_ > CACHE_IDLE_FRAMES) {
+        for(auto iter = cache->freeLists_.begin(); iter != cache->freeLists_.end(); iter++) {
+            returnToGlobalLocked(iter->first, iter->second);
+        }
+    }
 }
 
 VulkanBufferInfo BufferManager::allocBuffer(uint32_t frameIndex, uint64_t size) {
+    if (useThreadCache_) {
+        // 不加锁：线程缓存只有当前线程访问；freeAllBuffers/getStats会读写所有线程缓存，调用约定保证它们不与分配并发
+        return allocFromCache(getThreadCache(), frameIndex, size, false);
+    }
+
+    // 不使用线程缓存：所有线程在全局锁下共用一个缓存
     std::unique_lock<std::mutex> locker(mutex_);
-    size = roundUpToPowerOfTwo(size);
-    std::list<VulkanBufferInfo>& freeBufferList = freeBufferLists_[size];
+    return allocFromCache(&sharedCache_, frameIndex, size, true);
+}
 
-    // 已有空闲已分配VkBuffer
-    if(!freeBufferList.empty()) {
-        // 取出
-        VulkanBufferInfo bufferInfo = freeBufferList.front();
-        freeBufferList.pop_front();
+BufferManager::ThreadCache *BufferManager::getThreadCache() {
+    // 每个线程为每个BufferManager保存一个缓存指针，按managerId_索引
+    static thread_local std::vector<ThreadCache *> threadLocalCaches;
+    if (threadLocalCaches.size() <= managerId_) {
+        threadLocalCaches.resize(managerId_ + 1, nullptr);
+    }
+    ThreadCache *&cache = threadLocalCaches[managerId_];
+    if (cache == nullptr) {
+        // 该线程第一次分配，创建并登记缓存（每个线程只发生一次）
+        std::unique_lock<std::mutex> locker(mutex_);
+        threadCaches_.push_back(std::make_unique<ThreadCache>());
+        cache = threadCaches_.back().get();
+    }
+    return cache;
+}
+
+VulkanBufferInfo BufferManager::allocFromCache(ThreadCache *cache, uint32_t frameIndex, uint64_t size, bool locked) {
+#if BUFFER_STATS
+    auto start = std::chrono::steady_clock::now();
+#endif
+    uint64_t requestedSize = size;
+    size = roundUpToSizeClass(size);
+    std::list<Segment> &freeList = cache->freeLists_[size];
+
+    // 缓存为空，从全局批量补充
+    if (freeList.empty()) {
+        if (locked) {
+            refillLocked(size, freeList);
+        } else {
+            std::unique_lock<std::mutex> locker(mutex_);
+            refillLocked(size, freeList);
+        }
+        cache->refillCount_++;
+    }
+
+    // 将段从free列表移动到该帧的used列表（不产生新的节点）
+    std::list<Segment> &usedList = cache->usedLists_[frameIndex][size];
+    usedList.splice(usedList.end(), freeList, freeList.begin());
+    Segment &segment = usedList.back();
+    segment.info_.requestedSize_ = requestedSize;
+    segment.block_->lastUsedFrame_.store(frameCounter_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    cache->liveBytes_ += requestedSize;
+    cache->wasteBytes_ += size - requestedSize;
+    cache->frameLiveBytes_[frameIndex] += requestedSize;
+    cache->frameWasteBytes_[frameIndex] += size - requestedSize;
+    cache->allocCount_++;
+    cache->lastAllocFrame_ = frameCounter_.load(std::memory_order_relaxed);
+
+#if BUFFER_STATS
+    cache->allocTimeNs_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+#endif
+    return segment.info_;
+}
+
+void BufferManager::refillLocked(uint64_t sizeClass, std::list<Segment> &freeList) {
+    // 优先使用全局free段，从id最小的大块开始取
+    std::map<uint32_t, std::list<Segment>> &globalFreeLists = freeBufferLists_[sizeClass];
+    if (!globalFreeLists.empty()) {
+        uint32_t count = 0;
+        while (count < REFILL_COUNT && !globalFreeLists.empty()) {
+            std::list<Segment> &blockFreeList = globalFreeLists.begin()->second;
+            auto last = blockFreeList.begin();
+            for (; count < REFILL_COUNT && last != blockFreeList.end(); count++) {
+                last++;
+            }
+            freeList.splice(freeList.end(), blockFreeList, blockFreeList.begin(), last);
+            if (blockFreeList.empty()) {
+                globalFreeLists.erase(globalFreeLists.begin());
+            }
+        }
+        return;
+    }
 
-        // 加入
-        usedBufferLists_[frameIndex].push_back(bufferInfo);
-        return bufferInfo;
+    // 较大的申请使用独立的大块，避免占满公共大块
+    if (sizeClass > BLOCK_SIZE / 4) {
+        uint32_t blockId = createBlock(sizeClass);
+        carveFromBlock(blockId, sizeClass, freeList);
+        return;
     }
-    // 创建新的VkBuffer
-    else {
 
-        // 创建
-        VulkanBufferInfo bufferInfo;
-        createBuffer(size, bufferInfo.buffer_, bufferInfo.bufferMemory_);
-        bufferInfo.size_ = size;
+    // 从当前大块中切分若干段，不够则新建大块
+    uint64_t count = std::max<uint64_t>(1, std::min<uint64_t>(REFILL_COUNT, REFILL_BYTES / sizeClass));
+    for (uint64_t i = 0; i < count; i++) {
+        if (currentBlockId_ == 0 || !carveFromBlock(currentBlockId_, sizeClass, freeList)) {
+            if (i > 0) {
+                break; // 已经切出了一些，剩下的留给新大块以后再切
+            }
+            currentBlockId_ = createBlock(BLOCK_SIZE);
+            carveFromBlock(currentBlockId_, sizeClass, freeList);
+        }
+    }
+}
 
-        // 加入
-        usedBufferLists_[frameIndex].push_back(bufferInfo);
-        return bufferInfo;
+void BufferManager::returnToGlobalLocked(uint64_t sizeClass, std::list<Segment> &segments) {
+    std::map<uint32_t, std::list<Segment>> &globalFreeLists = freeBufferLists_[sizeClass];
+    while (!segments.empty()) {
+        std::list<Segment> &blockFreeList = globalFreeLists[segments.front().info_.blockId_];
+        blockFreeList.splice(blockFreeList.end(), segments, segments.begin());
     }
 }
 
-uint64_t BufferManager::roundUpToPowerOfTwo(uint64_t size) {
+VulkanBufferInfo BufferManager::allocStaticBuffer(uint64_t size) {
+    std::unique_lock<std::mutex> locker(mutex_);
+
+    // 创建，持久映射
+    VulkanBufferInfo bufferInfo;
+    bufferInfo.requestedSize_ = size;
+    size = (size + alignment_ - 1) / alignment_ * alignment_; // 保证flush范围对齐
+    createBuffer(size, bufferInfo.buffer_, bufferInfo.bufferMemory_);
+    bufferInfo.size_ = size;
+    CALL_VK(vkMapMemory(device_, bufferInfo.bufferMemory_, 0, VK_WHOLE_SIZE, 0, &bufferInfo.mappedData_));
+
+    // 加入，仅为了析构时释放
+    staticBufferList_.push_back(bufferInfo);
+    return bufferInfo;
+}
+
+VulkanBufferInfo BufferManager::allocPersistentBuffer(uint64_t size) {
+    std::unique_lock<std::mutex> locker(mutex_);
+
+    // 与帧内分配共用size class与大块，补充出的多余段直接留在全局free列表
+    uint64_t requestedSize = size;
+    size = roundUpToSizeClass(size);
+    std::list<Segment> segments;
+    refillLocked(size, segments);
+    std::list<Segment> extra;
+    extra.splice(extra.end(), segments, std::next(segments.begin()), segments.end());
+    returnToGlobalLocked(size, extra);
+
+    Segment &segment = segments.front();
+    segment.info_.requestedSize_ = requestedSize;
+    segment.block_->persistentCount_++;
+    stats_.persistentBytes_ += size;
+    return segment.info_;
+}
+
+void BufferManager::freePersistentBuffer(const VulkanBufferInfo &bufferInfo) {
+    std::unique_lock<std::mutex> locker(mutex_);
+
+    MemoryBlock &block = blocks_[bufferInfo.blockId_];
+    block.persistentCount_--;
+    block.lastUsedFrame_.store(frameCounter_.load()); // 从现在开始计算空闲帧数
+
+    Segment segment;
+    segment.info_ = bufferInfo;
+    segment.block_ = &block;
+    freeBufferLists_[bufferInfo.size_][bufferInfo.blockId_].push_back(segment);
+    stats_.persistentBytes_ -= bufferInfo.size_;
+}
+
+void BufferManager::flushBuffer(const VulkanBufferInfo &bufferInfo) {
+    if (coherent_) {
+        return;
+    }
+    // 段的offset_与size_均按nonCoherentAtomSize对齐
+    VkMappedMemoryRange range = {};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = bufferInfo.bufferMemory_;
+    range.offset = bufferInfo.offset_;
+    range.size = bufferInfo.size_;
+    CALL_VK(vkFlushMappedMemoryRanges(device_, 1, &range));
+}
+
+BufferManagerStats BufferManager::getStats() {
+    std::unique_lock<std::mutex> locker(mutex_);
+    return getStatsLocked();
+}
+
+BufferManagerStats BufferManager::getStatsLocked() {
+    // 大块相关的统计在stats_中，其余由各线程缓存汇总（读取其他线程的缓存，调用时不能有线程正在分配）
+    BufferManagerStats stats = stats_;
+    auto accumulate = [&stats](const ThreadCache &cache) {
+        stats.liveBytes_ += cache.liveBytes_;
+        stats.wasteBytes_ += cache.wasteBytes_;
+        stats.allocCount_ += cache.allocCount_;
+        stats.refillCount_ += cache.refillCount_;
+        stats.allocTimeNs_ += cache.allocTimeNs_;
+    };
+    for(auto &cache : threadCaches_) {
+        accumulate(*cache);
+    }
+    accumulate(sharedCache_);
+    return stats;
+}
+
+/* size class：每个2的整数次幂区间再均分为4档，取整浪费不超过20%（原先按2的整数次幂取整最多浪费50%） */
+uint64_t BufferManager::roundUpToSizeClass(uint64_t size) {
     if (size <= MIN_BUFFER_SIZE) return MIN_BUFFER_SIZE;
-    size_t power = MIN_BUFFER_SIZE;
-    while (power < size) {
+    uint64_t power = MIN_BUFFER_SIZE;
+    while (power * 2 < size) {
         power *= 2;
     }
-    return power;
+    // 此时 power < size <= 2 * power
+    uint64_t step = power / 4;
+    uint64_t sizeClass = (size + step - 1) / step * step;
+    return (sizeClass + alignment_ - 1) / alignment_ * alignment_;
+}
+
+bool BufferManager::carveFromBlock(uint32_t blockId, uint64_t size, std::list<Segment> &freeList) {
+    MemoryBlock &block = blocks_[blockId];
+    uint64_t offset = (block.top_ + alignment_ - 1) / alignment_ * alignment_;
+    if (offset + size > block.size_) {
+        return false;
+    }
+    block.top_ = offset + size;
+
+    Segment segment;
+    segment.info_.buffer_ = block.buffer_;
+    segment.info_.bufferMemory_ = block.memory_;
+    segment.info_.offset_ = offset;
+    segment.info_.size_ = size;
+    segment.info_.mappedData_ = static_cast<char *>(block.mappedData_) + offset;
+    segment.info_.blockId_ = blockId;
+    segment.block_ = &block;
+    freeList.push_back(segment);
+    return true;
+}
+
+uint32_t BufferManager::createBlock(uint64_t size) {
+    uint32_t blockId = nextBlockId_++;
+    MemoryBlock &block = blocks_[blockId];
+    createBuffer(size, block.buffer_, block.memory_);
+    block.size_ = size;
+    block.lastUsedFrame_.store(frameCounter_.load());
+    CALL_VK(vkMapMemory(device_, block.memory_, 0, VK_WHOLE_SIZE, 0, &block.mappedData_));
+
+    stats_.blockCount_++;
+    stats_.blockAllocCount_++;
+    stats_.reservedBytes_ += size;
+    stats_.peakReservedBytes_ = std::max(stats_.peakReservedBytes_, stats_.reservedBytes_);
+    return blockId;
+}
+
+void BufferManager::destroyBlock(uint32_t blockId) {
+    MemoryBlock &block = blocks_[blockId];
+
+    // 从全局与各线程缓存的free列表中移除该大块的所有段（used列表中不会有，见trimIdleBlocks）
+    auto isInBlock = [blockId](const Segment &segment) {
+        return segment.info_.blockId_ == blockId;
+    };
+    for(auto iter = freeBufferLists_.begin(); iter != freeBufferLists_.end(); iter++) {
+        iter->second.erase(blockId);
+    }
+    for(auto &cache : threadCaches_) {
+        for(auto iter = cache->freeLists_.begin(); iter != cache->freeLists_.end(); iter++) {
+            iter->second.remove_if(isInBlock);
+        }
+    }
+    for(auto iter = sharedCache_.freeLists_.begin(); iter != sharedCache_.freeLists_.end(); iter++) {
+        iter->second.remove_if(isInBlock);
+    }
+
+    // 释放内存时会隐式unmap
+    vkDestroyBuffer(device_, block.buffer_, nullptr);
+    vkFreeMemory(device_, block.memory_, nullptr);
+
+    stats_.blockCount_--;
+    stats_.trimmedBlockCount_++;
+    stats_.reservedBytes_ -= block.size_;
+
+    if (currentBlockId_ == blockId) {
+        currentBlockId_ = 0;
+    }
+    blocks_.erase(blockId);
+}
+
+void BufferManager::trimIdleBlocks() {
+    // 段最多被同时在飞的几帧使用，大块BLOCK_IDLE_FRAMES帧没有段被分配出去，说明它的段都已回到free列表
+    // 仍有persistent段的大块不回收
+    uint64_t currentFrame = frameCounter_.load();
+    std::vector<uint32_t> idleBlockIds;
+    for(auto iter = blocks_.begin(); iter != blocks_.end(); iter++) {
+        if (iter->second.persistentCount_ == 0 && currentFrame - iter->second.lastUsedFrame_.load() >= BLOCK_IDLE_FRAMES) {
+            idleBlockIds.push_back(iter->first);
+        }
+    }
+
+    // 调用时所有帧的GPU工作都已完成（resetFrame位于等待fence之后），可以直接销毁
+    for(uint32_t blockId : idleBlockIds) {
+        destroyBlock(blockId);
+    }
 }
 
 /* 创建VkBuffer的一系辅助函数 */
@@ -131,9 +441,7 @@ void BufferManager::createBuffer(VkDeviceSize size, VkBuffer &buffer, VkDeviceMe
     VkMemoryAllocateInfo allocInfo = {};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
-    mapMemoryTypeToIndex(memRequirements.memoryTypeBits,
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         &allocInfo.memoryTypeIndex);
+    allocInfo.memoryTypeIndex = memoryTypeIndex_; // 构造时已选定
 
     CALL_VK(vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory));
 
@@ -153,13 +461,24 @@ void BufferManager::dump() {
     }
     LOGI("%s buffer manager:", usageStr.c_str());
 
+    BufferManagerStats stats = getStatsLocked();
+    LOGI("\tblocks %llu, reserved %llu bytes (peak %llu), live %llu bytes, waste %llu bytes, persistent %llu bytes",
+         (unsigned long long) stats.blockCount_, (unsigned long long) stats.reservedBytes_,
+         (unsigned long long) stats.peakReservedBytes_, (unsigned long long) stats.liveBytes_,
+         (unsigned long long) stats.wasteBytes_, (unsigned long long) stats.persistentBytes_);
+    LOGI("\tallocs %llu (avg %.1f ns), refills %llu, vkAllocateMemory %llu, trimmed blocks %llu, thread caches %zu",
+         (unsigned long long) stats.allocCount_,
+         stats.allocCount_ == 0 ? 0.0 : (double) stats.allocTimeNs_ / (double) stats.allocCount_,
+         (unsigned long long) stats.refillCount_, (unsigned long long) stats.blockAllocCount_,
+         (unsigned long long) stats.trimmedBlockCount_, threadCaches_.size());
+
     LOGI("\tfreeBufferLists_:");
     for(auto iter = freeBufferLists_.begin(); iter != freeBufferLists_.end(); iter++) {
-        LOGI("\t\t[%d] size %d", iter->first, iter->second.size());
+        size_t segmentCount = 0;
+        for(auto &blockFreeList : iter->second) {
+            segmentCount += blockFreeList.second.size();
+        }
+        LOGI("\t\t[%d] size %d (%d blocks)", iter->first, segmentCount, iter->second.size());
     }
 
-    LOGI("\tusedBufferLists_:");
-    for(auto iter = usedBufferLists_.begin(); iter != usedBufferLists_.end(); iter++) {
-        LOGI("\t\t[%d] size %d", iter->first, iter->second.size());
-    }
-}
\ No newline at end of file
+}
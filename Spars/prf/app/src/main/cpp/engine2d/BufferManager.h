@@ -7,44 +7,146 @@
 
 #include <vulkan_wrapper.h>
 
+#include <atomic>
 #include <map>
 #include <list>
+#include <memory>
+#include <vector>
 #include <mutex>
 #include <string>
 
-// 缓冲管理信息
+// 缓冲管理信息（从某个大块VkDeviceMemory中切分出的一段）
 struct VulkanBufferInfo {
-    VkBuffer buffer_;
+    VkBuffer buffer_; // 所在大块的VkBuffer，绑定时需要使用offset_
     VkDeviceMemory bufferMemory_;
-    uint64_t size_; // 该buffer的大小，需为2的整数次幂
+    VkDeviceSize offset_ = 0; // 在所在大块中的偏移
+    uint64_t size_; // 该段的大小，为某个size class的大小
+    uint64_t requestedSize_ = 0; // 实际申请的大小，用于统计浪费
+    void *mappedData_ = nullptr; // 持久映射的地址（已加上offset_），直接memcpy即可
+    uint32_t blockId_ = 0; // 所在大块的id
+};
+
+// 分配器统计信息
+struct BufferManagerStats {
+    uint64_t blockCount_ = 0; // 当前持有的大块数量
+    uint64_t reservedBytes_ = 0; // 所有大块的总大小
+    uint64_t peakReservedBytes_ = 0; // reservedBytes_的峰值
+    uint64_t liveBytes_ = 0; // 正在被帧使用的段（申请大小）
+    uint64_t persistentBytes_ = 0; // 不随帧回收的段（如几何缓存）占用的字节
+    uint64_t wasteBytes_ = 0; // 正在被帧使用的段因size class取整浪费的字节
+    uint64_t allocCount_ = 0; // 累计allocBuffer次数
+    uint64_t refillCount_ = 0; // 累计线程缓存从全局批量补充的次数（即分配路径上加全局锁的次数）
+    uint64_t blockAllocCount_ = 0; // 累计vkAllocateMemory次数
+    uint64_t trimmedBlockCount_ = 0; // 累计被回收的大块数量
+    uint64_t allocTimeNs_ = 0; // 累计allocBuffer耗时（BUFFER_STATS开启时统计）
 };
 
 /*
  * 管理系统中所有的某种类型的VkBuffer
  * 暂时有两个实例，处理index buffer或vertex buffer, TODO: uniform buffer
+ * 内存按大块（BLOCK_SIZE）申请并持久映射，按size class切分成段；
+ * 每个调用线程（工作线程）持有一个线程缓存，分配时不加锁，缓存为空时才加全局锁批量补充；
+ * 帧回收时将每个线程缓存中该帧的used段按size class整体splice回free列表，与段的数量无关；
+ * 连续BLOCK_IDLE_FRAMES帧没有段被分配出去的大块会被释放
  */
 class BufferManager
 {
 public:
-    BufferManager(VkDevice device, VkPhysicalDevice physicalDevice, VkBufferUsageFlags usage); // 该BufferManager管理的VkBuffer类型
+    // 该BufferManager管理的VkBuffer类型；useThreadCache为false时所有线程共用一个加锁的缓存（用于对比）
+    BufferManager(VkDevice device, VkPhysicalDevice physicalDevice, VkBufferUsageFlags usage, bool useThreadCache = true);
     ~BufferManager(); // 释放所有的VkBuffer和VkDeviceMemory
-    void freeAllBuffers(uint32_t frameIndex); // 归还该帧使用的所有缓冲
-    VulkanBufferInfo allocBuffer(uint32_t frameIndex, uint64_t size); // 为帧frameIndex申请一个大小至少为size的VkBuffer
 
+    // 归还该帧使用的所有缓冲，并回收长期空闲的大块；调用时不能有线程正在分配（resetFrame时工作线程空闲）
+    void freeAllBuffers(uint32_t frameIndex);
+    VulkanBufferInfo allocBuffer(uint32_t frameIndex, uint64_t size); // 为帧frameIndex申请一个大小至少为size的缓冲段
+    VulkanBufferInfo allocStaticBuffer(uint64_t size); // 申请一个不随帧轮转的VkBuffer（如共享的quad index buffer），析构时释放
+    void flushBuffer(const VulkanBufferInfo &bufferInfo); // 写入mappedData_后调用，内存非coherent时flush
+
+    // 申请一个不随帧回收的段（如几何缓存），需显式调用freePersistentBuffer归还
+    VulkanBufferInfo allocPersistentBuffer(uint64_t size);
+    // 归还allocPersistentBuffer申请的段，调用时GPU不能再使用该段
+    void freePersistentBuffer(const VulkanBufferInfo &bufferInfo);
+
+    BufferManagerStats getStats(); // 获取统计信息，与freeAllBuffers一样需在没有线程分配时调用
     void dump(); // 以log的形式打印 for debug
 
 private:
+    // 一个大块：一个VkBuffer绑定一整块VkDeviceMemory，按bump指针切分
+    struct MemoryBlock {
+        VkBuffer buffer_;
+        VkDeviceMemory memory_;
+        void *mappedData_;
+        uint64_t size_;
+        uint64_t top_ = 0; // 尚未切分部分的起始偏移
+        std::atomic<uint64_t> lastUsedFrame_{0}; // 最近一次有段被分配出去时的帧序号，由分配线程无锁写入
+        uint32_t persistentCount_ = 0; // 尚未归还的persistent段数量，不为0时不会被回收（受mutex_保护）
+    };
+
+    // 一个段及其所在大块（std::map的节点地址稳定，大块只在没有线程分配时释放）
+    struct Segment {
+        VulkanBufferInfo info_;
+        MemoryBlock *block_;
+    };
+
+    // 线程缓存，只被所属线程访问（freeAllBuffers/getStats除外，彼时没有线程分配），因此成员不加锁
+    // free列表不按大块排序（只有不超过CACHE_MAX_SEGMENTS个段），还给全局时再按大块归位
+    struct ThreadCache {
+        std::map<uint64_t, std::list<Segment>> freeLists_; // size class -> free段
+        std::map<uint32_t, std::map<uint64_t, std::list<Segment>>> usedLists_; // 帧 -> size class -> used段
+        std::map<uint32_t, uint64_t> frameLiveBytes_; // 每帧的申请字节数，回收时整体扣除
+        std::map<uint32_t, uint64_t> frameWasteBytes_;
+        uint64_t liveBytes_ = 0;
+        uint64_t wasteBytes_ = 0;
+        uint64_t allocCount_ = 0;
+        uint64_t refillCount_ = 0;
+        uint64_t allocTimeNs_ = 0;
+        uint64_t lastAllocFrame_ = 0; // 最近一次分配时的帧序号
+    };
+
     VkDevice device_;
     VkPhysicalDevice physicalDevice_;
     VkBufferUsageFlags usage_;
+    uint32_t memoryTypeIndex_; // 所有大块使用的内存类型
+    bool coherent_; // 内存类型是否为HOST_COHERENT，否则写入后需要flush
+    uint64_t alignment_; // 段的对齐，内存非coherent时不小于nonCoherentAtomSize
+    bool useThreadCache_;
+    uint32_t managerId_; // 用于索引线程局部的缓存指针
+    static std::atomic<uint32_t> nextManagerId_;
 
-    std::mutex mutex_; // 保护下面两个list
+    std::mutex mutex_; // 保护下面所有成员（线程缓存除外）
 
     const uint64_t MIN_BUFFER_SIZE = 32L;
-    std::map<uint64_t, std::list<VulkanBufferInfo>> freeBufferLists_; // 按照2的整数次幂管理所有free buffers
-    std::map<uint32_t, std::list<VulkanBufferInfo>> usedBufferLists_; // 按照正在被哪一个轮转的帧使用，管理所有的used buffers
+    const uint64_t BLOCK_SIZE = 1L << 20; // 1MB，大于BLOCK_SIZE/4的申请使用独立的大块
+    const uint32_t BLOCK_IDLE_FRAMES = 120; // 大块空闲多少帧后释放，需远大于同时在飞的帧数
+    const uint32_t REFILL_COUNT = 16; // 线程缓存每次从全局补充的段数上限
+    const uint64_t REFILL_BYTES = 16L << 10; // 线程缓存每次新切分的字节数上限
+    const size_t CACHE_MAX_SEGMENTS = 256; // 回收后线程缓存某个size class的free段超过该值时整体还给全局
+    const uint32_t CACHE_IDLE_FRAMES = 8; // 线程缓存多少帧没有分配后（如线程已退出）将所有free段还给全局
+
+    std::map<uint32_t, MemoryBlock> blocks_; // 所有大块，按id索引
+    uint32_t nextBlockId_ = 1;
+    uint32_t currentBlockId_ = 0; // 当前用于切分的大块，0表示没有
+    std::atomic<uint64_t> frameCounter_{0}; // 每次freeAllBuffers加一
+
+    // 全局free段：size class -> 大块id -> 段；补充时优先取id较小（较旧）的大块，让新近的大块能够空闲下来被释放
+    std::map<uint64_t, std::map<uint32_t, std::list<Segment>>> freeBufferLists_;
+    std::vector<std::unique_ptr<ThreadCache>> threadCaches_; // 所有线程缓存
+    ThreadCache sharedCache_; // useThreadCache_为false时所有线程共用，受mutex_保护
+    std::list<VulkanBufferInfo> staticBufferList_; // 不随帧轮转的buffers
+
+    BufferManagerStats stats_; // 仅大块相关的统计，其余由线程缓存汇总
 
-    uint64_t roundUpToPowerOfTwo(uint64_t size);
+    BufferManagerStats getStatsLocked();
+    ThreadCache *getThreadCache();
+    VulkanBufferInfo allocFromCache(ThreadCache *cache, uint32_t frameIndex, uint64_t size, bool locked);
+    void refillLocked(uint64_t sizeClass, std::list<Segment> &freeList);
+    void returnToGlobalLocked(uint64_t sizeClass, std::list<Segment> &segments); // 将段按所在大块放回全局free列表
+    void recycleCacheLocked(ThreadCache *cache, uint32_t frameIndex);
+    uint64_t roundUpToSizeClass(uint64_t size);
+    bool carveFromBlock(uint32_t blockId, uint64_t size, std::list<Segment> &freeList);
+    uint32_t createBlock(uint64_t size);
+    void destroyBlock(uint32_t blockId);
+    void trimIdleBlocks();
     bool mapMemoryTypeToIndex(uint32_t typeBits, VkFlags requirements_mask, uint32_t *typeIndex);
     void createBuffer(VkDeviceSize size, VkBuffer &buffer, VkDeviceMemory &bufferMemory);
 };
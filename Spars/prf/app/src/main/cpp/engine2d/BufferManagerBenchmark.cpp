@@ -0,0 +1,123 @@
+#include "BufferManagerBenchmark.h"
+#include "BufferManager.h"
+#include "../log.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define BENCHMARK_THREAD_COUNT 8
+#define BENCHMARK_FRAME_COUNT 300
+#define BENCHMARK_ALLOCS_PER_FRAME 1000 // 每个线程每帧的申请次数
+#define BENCHMARK_SWAPCHAIN_LENGTH 3
+
+// 每帧开始时主线程放行所有线程，所有线程完成后主线程回收
+class FrameBarrier {
+public:
+    void startFrame(uint32_t frameIndex) {
+        std::unique_lock<std::mutex> locker(mutex_);
+        frameIndex_ = frameIndex;
+        running_ = BENCHMARK_THREAD_COUNT;
+        generation_++;
+        cv_.notify_all();
+    }
+
+    void waitFrameDone() {
+        std::unique_lock<std::mutex> locker(mutex_);
+        cv_.wait(locker, [this] { return running_ == 0; });
+    }
+
+    // 返回false表示结束
+    bool waitFrameStart(uint64_t &seenGeneration, uint32_t &frameIndex) {
+        std::unique_lock<std::mutex> locker(mutex_);
+        cv_.wait(locker, [this, &seenGeneration] { return generation_ != seenGeneration || stop_; });
+        if (stop_) {
+            return false;
+        }
+        seenGeneration = generation_;
+        frameIndex = frameIndex_;
+        return true;
+    }
+
+    void threadDone() {
+        std::unique_lock<std::mutex> locker(mutex_);
+        if (--running_ == 0) {
+            cv_.notify_all();
+        }
+    }
+
+    void stop() {
+        std::unique_lock<std::mutex> locker(mutex_);
+        stop_ = true;
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint64_t generation_ = 0;
+    uint32_t frameIndex_ = 0;
+    uint32_t running_ = 0;
+    bool stop_ = false;
+};
+
+static void runOnce(VkDevice device, VkPhysicalDevice physicalDevice, bool useThreadCache) {
+    BufferManager bufferManager(device, physicalDevice, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, useThreadCache);
+    FrameBarrier barrier;
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < BENCHMARK_THREAD_COUNT; t++) {
+        threads.emplace_back([&bufferManager, &barrier, t] {
+            std::minstd_rand rand(t + 1);
+            std::uniform_int_distribution<uint64_t> sizeDist(32, 512); // 与单个图元的vertex数据大小相当
+            uint64_t seenGeneration = 0;
+            uint32_t frameIndex;
+            while (barrier.waitFrameStart(seenGeneration, frameIndex)) {
+                for (uint32_t i = 0; i < BENCHMARK_ALLOCS_PER_FRAME; i++) {
+                    bufferManager.allocBuffer(frameIndex, sizeDist(rand));
+                }
+                barrier.threadDone();
+            }
+        });
+    }
+
+    uint64_t allocNs = 0; // 所有线程完成申请的墙钟时间
+    uint64_t resetNs = 0; // 帧回收耗时
+    for (uint32_t frame = 0; frame < BENCHMARK_FRAME_COUNT; frame++) {
+        uint32_t frameIndex = frame % BENCHMARK_SWAPCHAIN_LENGTH;
+
+        auto resetStart = std::chrono::steady_clock::now();
+        bufferManager.freeAllBuffers(frameIndex); // 所有申请线程都停在barrier上，回收时不会有线程访问自己的缓存
+        auto allocStart = std::chrono::steady_clock::now();
+
+        barrier.startFrame(frameIndex);
+        barrier.waitFrameDone();
+
+        auto end = std::chrono::steady_clock::now();
+        resetNs += std::chrono::duration_cast<std::chrono::nanoseconds>(allocStart - resetStart).count();
+        allocNs += std::chrono::duration_cast<std::chrono::nanoseconds>(end - allocStart).count();
+    }
+    barrier.stop();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    BufferManagerStats stats = bufferManager.getStats();
+    double totalAllocs = static_cast<double>(BENCHMARK_THREAD_COUNT) * BENCHMARK_ALLOCS_PER_FRAME * BENCHMARK_FRAME_COUNT;
+    LOGI("buffer contention benchmark [%s]: %d threads x %d allocs x %d frames",
+         useThreadCache ? "thread cache" : "global lock", BENCHMARK_THREAD_COUNT, BENCHMARK_ALLOCS_PER_FRAME, BENCHMARK_FRAME_COUNT);
+    LOGI("\tthroughput %.2f Mallocs/s, wall %.1f ns/alloc, frame reset %.1f us/frame",
+         totalAllocs / (static_cast<double>(allocNs) / 1e9) / 1e6, static_cast<double>(allocNs) / totalAllocs,
+         static_cast<double>(resetNs) / BENCHMARK_FRAME_COUNT / 1e3);
+    LOGI("\tlock acquisitions (refills) %llu, vkAllocateMemory %llu, peak reserved %llu bytes",
+         (unsigned long long) stats.refillCount_, (unsigned long long) stats.blockAllocCount_,
+         (unsigned long long) stats.peakReservedBytes_);
+}
+
+void runBufferContentionBenchmark(VkDevice device, VkPhysicalDevice physicalDevice) {
+    runOnce(device, physicalDevice, false);
+    runOnce(device, physicalDevice, true);
+}
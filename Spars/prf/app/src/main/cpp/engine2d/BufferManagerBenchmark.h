@@ -0,0 +1,12 @@
+#ifndef PRF_BUFFERMANAGERBENCHMARK_H
+#define PRF_BUFFERMANAGERBENCHMARK_H
+
+#include <vulkan_wrapper.h>
+
+/**
+ * BufferManager多线程争用测试（BUFFER_CONTENTION_BENCHMARK）
+ * 8个线程满速申请小缓冲，主线程逐帧回收，分别测试全局锁与线程缓存两种模式，结果以log输出
+ */
+void runBufferContentionBenchmark(VkDevice device, VkPhysicalDevice physicalDevice);
+
+#endif //PRF_BUFFERMANAGERBENCHMARK_H
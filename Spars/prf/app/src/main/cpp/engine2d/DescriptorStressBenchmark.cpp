@@ -0,0 +1,195 @@
+#include "DescriptorStressBenchmark.h"
+#include "SamplerDescriptorManager.h"
+#include "ImageManager.h"
+#include "pipeline_helper.h"
+#include "../config.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#define BENCHMARK_TEXTURES_PER_FRAME 250 // 每帧新出现的纹理数
+
+static uint32_t findMemoryType_helper(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+// 所有图像视图共用的1x1纹理（只写入描述符，不采样）
+struct StressTexture {
+    VkImage image_;
+    VkDeviceMemory memory_;
+    VkSampler sampler_;
+    std::vector<VkImageView> views_;
+};
+
+static void createStressTexture_helper(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t viewCount, StressTexture *texture) {
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {1, 1, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    if (vkCreateImage(device, &imageInfo, nullptr, &texture->image_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, texture->image_, &memRequirements);
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType_helper(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &texture->memory_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate image memory!");
+    }
+    vkBindImageMemory(device, texture->image_, texture->memory_, 0);
+
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &texture->sampler_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+
+    // 每个视图作为一张不同的纹理
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = texture->image_;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    texture->views_.resize(viewCount);
+    for (uint32_t i = 0; i < viewCount; i++) {
+        if (vkCreateImageView(device, &viewInfo, nullptr, &texture->views_[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create texture image view!");
+        }
+    }
+}
+
+static void destroyStressTexture_helper(VkDevice device, StressTexture &texture) {
+    for (VkImageView view : texture.views_) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    vkDestroySampler(device, texture.sampler_, nullptr);
+    vkDestroyImage(device, texture.image_, nullptr);
+    vkFreeMemory(device, texture.memory_, nullptr);
+}
+
+/**
+ * 逐帧创建[begin, end)中视图的描述符集：工作线程按下标交错分担，每帧结束时主线程写入（合并写入时）
+ * latencies返回每次查找并创建的耗时，flushNs累加写入耗时
+ */
+static void createFrames_helper(SamplerDescriptorManager &manager, VkDescriptorSetLayout layout, StressTexture &texture,
+                                uint32_t begin, uint32_t end, std::vector<uint64_t> *latencies, uint64_t *flushNs) {
+    for (uint32_t frameBegin = begin; frameBegin < end; frameBegin += BENCHMARK_TEXTURES_PER_FRAME) {
+        uint32_t frameEnd = std::min(frameBegin + BENCHMARK_TEXTURES_PER_FRAME, end);
+        std::vector<std::vector<uint64_t>> threadLatencies(RENDER_THREAD_COUNT);
+        std::vector<std::thread> threads;
+        for (uint32_t t = 0; t < RENDER_THREAD_COUNT; t++) {
+            threads.emplace_back([&, t] {
+                for (uint32_t i = frameBegin + t; i < frameEnd; i += RENDER_THREAD_COUNT) {
+                    VulkanImageInfo imageInfo = {};
+                    imageInfo.textureImageView_ = texture.views_[i];
+                    imageInfo.textureSampler_ = texture.sampler_;
+
+                    auto start = std::chrono::steady_clock::now();
+                    VkDescriptorSet descriptorSet;
+                    if (!manager.findSamplerDescriptor(imageInfo.textureImageView_, &descriptorSet)) {
+                        manager.createAndInsertSamplerDescriptor(imageInfo.textureImageView_, layout, imageInfo, &descriptorSet);
+                    }
+                    threadLatencies[t].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start).count());
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        for (std::vector<uint64_t> &threadLatency : threadLatencies) {
+            latencies->insert(latencies->end(), threadLatency.begin(), threadLatency.end());
+        }
+
+        auto flushStart = std::chrono::steady_clock::now();
+        manager.flushWrites();
+        *flushNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - flushStart).count();
+        manager.endFrame();
+    }
+}
+
+static void logLatencies_helper(const char *phase, std::vector<uint64_t> &latencies, uint64_t flushNs, uint32_t frameCount) {
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t sum = 0;
+    for (uint64_t latency : latencies) {
+        sum += latency;
+    }
+    size_t count = latencies.size();
+    LOGI("\t%s: %zu descriptors, create mean %.2f us, p50 %.2f us, p99 %.2f us, max %.2f us, write %.3f ms/frame",
+         phase, count, count == 0 ? 0.0 : sum / 1e3 / count,
+         count == 0 ? 0.0 : latencies[count / 2] / 1e3, count == 0 ? 0.0 : latencies[count * 99 / 100] / 1e3,
+         count == 0 ? 0.0 : latencies.back() / 1e3, frameCount == 0 ? 0.0 : flushNs / 1e6 / frameCount);
+}
+
+static void runOnce(VkDevice device, VkDescriptorSetLayout layout, StressTexture &texture, bool batchUpdates) {
+    const uint32_t textureCount = static_cast<uint32_t>(texture.views_.size());
+    const uint32_t frameCount = (textureCount + BENCHMARK_TEXTURES_PER_FRAME - 1) / BENCHMARK_TEXTURES_PER_FRAME;
+    SamplerDescriptorManager manager(device, batchUpdates);
+    LOGI("descriptor stress benchmark [%s]: %u textures, %d per frame, %d threads",
+         batchUpdates ? "batched writes" : "immediate writes", textureCount, BENCHMARK_TEXTURES_PER_FRAME, RENDER_THREAD_COUNT);
+
+    // 所有纹理第一次出现：从池中分配，池用满时新建
+    std::vector<uint64_t> latencies;
+    uint64_t flushNs = 0;
+    createFrames_helper(manager, layout, texture, 0, textureCount, &latencies, &flushNs);
+    logLatencies_helper("first use", latencies, flushNs, frameCount);
+
+    // 淘汰前一半后重新出现：复用回收的描述符集，不再新建池
+    for (uint32_t i = 0; i < textureCount / 2; i++) {
+        manager.releaseSamplerDescriptor(texture.views_[i]);
+    }
+    manager.endFrame();
+    latencies.clear();
+    flushNs = 0;
+    createFrames_helper(manager, layout, texture, 0, textureCount / 2, &latencies, &flushNs);
+    logLatencies_helper("after eviction", latencies, flushNs, (frameCount + 1) / 2);
+
+    DescriptorStats stats = manager.getDescriptorStats();
+    LOGI("\t%llu pools, %llu allocated, %llu reused, %llu writes in %llu vkUpdateDescriptorSets",
+         (unsigned long long) stats.poolCount_, (unsigned long long) stats.allocCount_,
+         (unsigned long long) stats.recycleCount_, (unsigned long long) stats.writeCount_,
+         (unsigned long long) stats.updateCallCount_);
+}
+
+void runDescriptorStressBenchmark(VkDevice device, VkPhysicalDevice physicalDevice) {
+    StressTexture texture;
+    createStressTexture_helper(device, physicalDevice, DESCRIPTOR_STRESS_TEXTURE_COUNT, &texture);
+    VkDescriptorSetLayout layout = createDescriptorSetLayoutImage(device);
+
+    runOnce(device, layout, texture, false);
+    runOnce(device, layout, texture, true);
+
+    vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    destroyStressTexture_helper(device, texture);
+}
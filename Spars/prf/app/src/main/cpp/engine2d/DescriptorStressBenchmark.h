@@ -0,0 +1,13 @@
+#ifndef PRF_DESCRIPTORSTRESSBENCHMARK_H
+#define PRF_DESCRIPTORSTRESSBENCHMARK_H
+
+#include <vulkan_wrapper.h>
+
+/**
+ * 描述符分配压力测试（DESCRIPTOR_STRESS_BENCHMARK）
+ * 为DESCRIPTOR_STRESS_TEXTURE_COUNT个不同的图像视图创建描述符集（远超单个池的容量），每帧RENDER_THREAD_COUNT个线程并发创建一批，
+ * 主线程在帧末写入；之后淘汰一半再重新创建，测试回收复用。分别测试逐个写入与合并写入，以log输出创建延迟、写入耗时与池数
+ */
+void runDescriptorStressBenchmark(VkDevice device, VkPhysicalDevice physicalDevice);
+
+#endif //PRF_DESCRIPTORSTRESSBENCHMARK_H
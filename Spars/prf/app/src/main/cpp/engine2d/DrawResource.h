@@ -8,6 +8,7 @@
 #include "BufferManager.h"
 #include "PipelineManager.h"
 #include "SamplerDescriptorManager.h"
+#include "VertexFormat.h"
 #include "../drawTaskContainer/DrawTaskList.h"
 
 //#define MAX_COLLECT_REORDER 5
@@ -24,6 +25,8 @@ public:
     VulkanBufferInfo indexBufferInfo_;
     VulkanDescriptorSetInfo descriptorSetInfo_;
     uint32_t indexCount_;
+    VkIndexType indexType_ = VK_INDEX_TYPE_UINT32; // 顶点数量不超过65536时使用UINT16
+    DrawTransform transform_; // 录制时通过push constant提供
 
     // 以下方法为插入OrderedPriorityQueue中必须的运算符
 //    bool operator>(const DrawResource& dr) const;
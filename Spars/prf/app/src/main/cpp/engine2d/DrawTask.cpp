@@ -4,6 +4,7 @@
 
 #include "DrawTask.h"
 #include "Engine2D.h"
+#include "../config.h"
 
 std::string getDrawTaskTypeString(DrawTaskType type)
 {
@@ -34,7 +35,7 @@ std::string DrawTask::getTypeName()
     return getDrawTaskTypeString(getType());
 }
 
-// 默认不可以合批，ImageDrawTask可采用这个默认函数
+// 默认不可以合批
 uint32_t DrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode) {
     if (isOverlap(cmdBoundingBox, boundingBox_)) {
         return BATCH_FAIL_OVERLAP;
@@ -62,8 +63,8 @@ uint32_t RectsDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Render
     if(drawCmd->getType() == RECT_DRAWCMD) {
         // 可以合批
         RectDrawCmd *rectDrawCmd = dynamic_cast<RectDrawCmd*>(drawCmd);
-        rects_.push_back(Rect::MakeXYWH(renderNode->getAbsX() + rectDrawCmd->rect_.x_,
-                                       renderNode->getAbsY() + rectDrawCmd->rect_.y_,
+        rects_.push_back(Rect::MakeXYWH(renderNode->getLocalX() + rectDrawCmd->rect_.x_,
+                                       renderNode->getLocalY() + rectDrawCmd->rect_.y_,
                                        rectDrawCmd->rect_.w_,
                                        rectDrawCmd->rect_.h_));
         paints_.push_back(drawCmd->getPaint());
@@ -80,10 +81,10 @@ uint32_t RectsDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Render
 }
 
 void RectsDrawTask::createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                  VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo) {
+                                  VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo) {
     char vsFilePath[] = "shaders/rects.vert.spv";
     char fsFilePath[] = "shaders/rects.frag.spv";
-    createGraphicsPipelineHelper(androidAppCtx, device, extent2D, renderPass, pipelineInfo, vsFilePath, fsFilePath);
+    createGraphicsPipelineHelper(androidAppCtx, device, extent2D, renderPass, pipelineCache, pipelineInfo, vsFilePath, fsFilePath);
 }
 
 
@@ -106,8 +107,8 @@ uint32_t CirclesDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Rend
     if(drawCmd->getType() == CIRCLE_DRAWCMD) {
         // 可以合批
         CircleDrawCmd *circleDrawCmd = dynamic_cast<CircleDrawCmd*>(drawCmd);
-        circles_.push_back(Circle::MakeXYR(renderNode->getAbsX() + circleDrawCmd->circle_.x_,
-                                          renderNode->getAbsY() + circleDrawCmd->circle_.y_,
+        circles_.push_back(Circle::MakeXYR(renderNode->getLocalX() + circleDrawCmd->circle_.x_,
+                                          renderNode->getLocalY() + circleDrawCmd->circle_.y_,
                                            circleDrawCmd->circle_.r_));
         paints_.push_back(drawCmd->getPaint());
 
@@ -123,16 +124,22 @@ uint32_t CirclesDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Rend
 }
 
 void CirclesDrawTask::createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                             VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo) {
+                                             VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo) {
     char vsFilePath[] = "shaders/circles.vert.spv";
     char fsFilePath[] = "shaders/circles.frag.spv";
-    createGraphicsPipelineHelper(androidAppCtx, device, extent2D, renderPass, pipelineInfo, vsFilePath, fsFilePath);
+    createGraphicsPipelineHelper(androidAppCtx, device, extent2D, renderPass, pipelineCache, pipelineInfo, vsFilePath, fsFilePath);
 }
 
 
 // 图片绘制任务
-ImageDrawTask::ImageDrawTask(uint32_t taskId, Rect &boundingBox, Image &image, Paint &paint) : DrawTask(taskId, boundingBox), image_(image) {
+ImageDrawTask::ImageDrawTask(uint32_t taskId, Rect &boundingBox, Image &image, Paint &paint) : DrawTask(taskId, boundingBox) {
+    images_.push_back(image);
     paint_ = paint;
+    atlasPage_ = Engine2D::getImageAtlasPage(image);
+}
+
+const std::vector<Image> &ImageDrawTask::getImages() const {
+    return images_;
 }
 
 DrawTaskType ImageDrawTask::getType() {
@@ -140,7 +147,34 @@ DrawTaskType ImageDrawTask::getType() {
 }
 
 DrawResource ImageDrawTask::draw() {
-    return Engine2D::drawImage(image_, paint_);
+    if (images_.size() == 1) {
+        return Engine2D::drawImage(images_[0], paint_);
+    }
+    return Engine2D::drawImages(images_, paint_);
+}
+
+uint32_t ImageDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode)
+{
+    if(drawCmd->getType() == IMAGE_DRAWCMD && atlasPage_ >= 0) {
+        ImageDrawCmd *imageDrawCmd = dynamic_cast<ImageDrawCmd*>(drawCmd);
+        Image image = Image::MakeImage(Rect::MakeXYWH(renderNode->getLocalX() + imageDrawCmd->image_.rect_.x_,
+                                                      renderNode->getLocalY() + imageDrawCmd->image_.rect_.y_,
+                                                      imageDrawCmd->image_.rect_.w_,
+                                                      imageDrawCmd->image_.rect_.h_),
+                                       imageDrawCmd->image_.path_);
+
+        // 只有已就绪、且与本任务位于同一atlas页的图片才可以合批（采样同一张纹理）
+        if (Engine2D::getImageAtlasPage(image) == atlasPage_) {
+            images_.push_back(image);
+
+            // 新的包围矩形
+            boundingBox_ = getLargerRect(cmdBoundingBox, boundingBox_);
+            return BATCH_SUCCESSFUL;
+        }
+    }
+
+    // 不同类型或不同纹理不可合批
+    return DrawTask::batchWith(drawCmd, cmdBoundingBox, renderNode);
 }
 
 
@@ -163,12 +197,12 @@ uint32_t TextsDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Render
     if(drawCmd->getType() == TEXT_DRAWCMD) {
         TextDrawCmd *textDrawCmd = dynamic_cast<TextDrawCmd*>(drawCmd);
 
-        // 只有相同字体和相同pixelHeight才可以合批（因为VkPipeline可以采样同一张atlas）
+        // 只有采样同一张atlas（同一strike）的文本才可以合批：相同字体，非SDF时还需相同pixelHeight（SDF时所有字号共用一张距离场atlas）
         if (texts_.empty() ||
             (textDrawCmd->text_.fontPath_ == texts_[0].fontPath_ &&
-            textDrawCmd->text_.pixelHeight_ == texts_[0].pixelHeight_)) {
-            texts_.push_back(Text::MakeText(renderNode->getAbsX() + textDrawCmd->text_.x_,
-                                            renderNode->getAbsY() + textDrawCmd->text_.y_,
+            (SDF_TEXT || textDrawCmd->text_.pixelHeight_ == texts_[0].pixelHeight_))) {
+            texts_.push_back(Text::MakeText(renderNode->getLocalX() + textDrawCmd->text_.x_,
+                                            renderNode->getLocalY() + textDrawCmd->text_.y_,
                                             textDrawCmd->text_.pixelHeight_,
                                             textDrawCmd->text_.str_,
                                             textDrawCmd->text_.fontPath_));
@@ -205,8 +239,8 @@ uint32_t RRectsDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Rende
     if(drawCmd->getType() == RRECT_DRAWCMD) {
         // 可以合批
         RRectDrawCmd *rrectDrawCmd = dynamic_cast<RRectDrawCmd*>(drawCmd);
-        rrects_.push_back(RRect::MakeXYWHR(renderNode->getAbsX() + rrectDrawCmd->rrect_.x_,
-                                        renderNode->getAbsY() + rrectDrawCmd->rrect_.y_,
+        rrects_.push_back(RRect::MakeXYWHR(renderNode->getLocalX() + rrectDrawCmd->rrect_.x_,
+                                        renderNode->getLocalY() + rrectDrawCmd->rrect_.y_,
                                         rrectDrawCmd->rrect_.w_,
                                         rrectDrawCmd->rrect_.h_,
                                         rrectDrawCmd->rrect_.r_));
@@ -224,8 +258,8 @@ uint32_t RRectsDrawTask::batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, Rende
 }
 
 void RRectsDrawTask::createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                           VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo) {
+                                           VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo) {
     char vsFilePath[] = "shaders/rrects.vert.spv";
     char fsFilePath[] = "shaders/rrects.frag.spv";
-    createGraphicsPipelineHelperRRect(androidAppCtx, device, extent2D, renderPass, pipelineInfo, vsFilePath, fsFilePath);
+    createGraphicsPipelineHelperRRect(androidAppCtx, device, extent2D, renderPass, pipelineCache, pipelineInfo, vsFilePath, fsFilePath);
 }
\ No newline at end of file
@@ -55,6 +55,10 @@ public:
     // 该任务的绘制范围，为了合批和乱序插入
     Rect boundingBox_; // TODO: public for convenience
 
+    // 该任务几何的原点，即所属变换节点的绝对位置（像素），图元坐标相对于该原点，绘制时通过push constant平移
+    int32_t originX_ = 0;
+    int32_t originY_ = 0;
+
     /**
      * 合批一个DrawCmd，若不重写，默认不可以合批
      * @param drawCmd 要合批的指令
@@ -75,7 +79,7 @@ public:
     DrawResource draw() override;
     uint32_t batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode) override;
     static void createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo);
+                                VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo);
 };
 
 class CirclesDrawTask : public DrawTask
@@ -89,19 +93,21 @@ public:
     DrawResource draw() override;
     uint32_t batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode) override;
     static void createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                       VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo);
+                                       VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo);
 };
 
 class ImageDrawTask : public DrawTask
 {
 private:
+    std::vector<Image> images_;
     Paint paint_;
+    int32_t atlasPage_; // 所有图片所在的atlas页，-1表示不在atlas中（或尚未就绪），不可合批
 public:
-    Image image_; // TODO: for convenience
     ImageDrawTask(uint32_t taskId, Rect &boundingBox, Image &image, Paint &paint);
+    const std::vector<Image> &getImages() const;
     DrawTaskType getType() override;
     DrawResource draw() override;
-    // uint32_t batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode) override; // 图片绘制无法合批
+    uint32_t batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode) override; // 只有位于同一atlas页的图片可以合批
 //    static void createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
 //                                       VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo);
 };
@@ -131,7 +137,7 @@ public:
     DrawResource draw() override;
     uint32_t batchWith(DrawCmd *drawCmd, Rect &cmdBoundingBox, RenderNode *renderNode) override;
     static void createGraphicsPipeline(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                       VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo);
+                                       VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo);
 };
 
 #endif //PRF_DRAWTASK_H
@@ -4,23 +4,47 @@
 
 #include "Engine2D.h"
 
+#include <chrono>
 #include <cmath>
+#include <stdexcept>
+#include <thread>
 
 // 静态变量初始化
 uint32_t Engine2D::frameIndex_;
 BufferManager *Engine2D::vertexBufferManager_;
 BufferManager *Engine2D::indexBufferManager_;
 PipelineManager *Engine2D::pipelineManager_;
+SamplerCache *Engine2D::samplerCache_;
+TextureUploader *Engine2D::textureUploader_;
 ImageManager *Engine2D::imageManager_;
 GlyphManager *Engine2D::glyphManager_;
 SamplerDescriptorManager *Engine2D::samplerDescriptorManager_;
+VulkanBufferInfo Engine2D::quadIndexBufferInfo_;
+GeometryCache *Engine2D::geometryCache_ = nullptr;
+
+std::atomic<uint64_t> Engine2D::uploadBytes_(0);
+std::atomic<uint64_t> Engine2D::legacyUploadBytes_(0);
+uint64_t Engine2D::statsFrameCount_ = 0;
+uint64_t Engine2D::statsUploadBytes_ = 0;
+uint64_t Engine2D::statsLegacyUploadBytes_ = 0;
+std::atomic<uint64_t> Engine2D::drawTimeNs_(0);
+uint64_t Engine2D::statsDrawTimeNs_ = 0;
+std::atomic<uint64_t> Engine2D::drawCallCount_(0);
+std::atomic<uint64_t> Engine2D::imageDrawCallCount_(0);
+std::atomic<uint64_t> Engine2D::imageCount_(0);
+std::atomic<uint64_t> Engine2D::textDrawCallCount_(0);
+std::atomic<uint64_t> Engine2D::textCount_(0);
+uint64_t Engine2D::statsDrawCallFrameCount_ = 0;
+bool Engine2D::textLayoutCache_ = TEXT_LAYOUT_CACHE;
+std::atomic<uint64_t> Engine2D::textDrawTimeNs_(0);
 
 android_app *Engine2D::androidAppCtx_;
 VulkanDeviceInfo *Engine2D::deviceInfo_;
 VulkanSwapchainInfo *Engine2D::swapchainInfo_;
 VulkanRenderInfo *Engine2D::renderInfo_;
 
-void Engine2D::init(android_app *androidAppCtx, VulkanDeviceInfo* deviceInfo, VulkanSwapchainInfo* swapchainInfo, VulkanRenderInfo* renderInfo) {
+void Engine2D::init(android_app *androidAppCtx, VulkanDeviceInfo* deviceInfo, VulkanSwapchainInfo* swapchainInfo, VulkanRenderInfo* renderInfo,
+                    ResourcePrefetcher *prefetcher, TextureDiskCache *diskCache) {
 
     androidAppCtx_ = androidAppCtx;
     deviceInfo_ = deviceInfo;
@@ -31,21 +55,79 @@ void Engine2D::init(android_app *androidAppCtx, VulkanDeviceInfo* deviceInfo, Vu
     vertexBufferManager_ = new BufferManager(deviceInfo->device_, deviceInfo->physicalDevice_, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
     indexBufferManager_ = new BufferManager(deviceInfo->device_, deviceInfo->physicalDevice_, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 
+    // 预先生成所有四边形批次共享的index buffer：0,1,2,2,3,0, 4,5,6,6,7,4, ...
+    std::vector<uint16_t> quadIndices;
+    quadIndices.reserve(MAX_SHARED_QUAD_COUNT * 6);
+    for (uint32_t i = 0; i < MAX_SHARED_QUAD_COUNT; i++) {
+        uint16_t base = static_cast<uint16_t>(i * 4);
+        quadIndices.push_back(base);
+        quadIndices.push_back(base + 1);
+        quadIndices.push_back(base + 2);
+        quadIndices.push_back(base + 2);
+        quadIndices.push_back(base + 3);
+        quadIndices.push_back(base);
+    }
+    uint64_t quadIndicesSize = sizeof(uint16_t) * quadIndices.size();
+    quadIndexBufferInfo_ = indexBufferManager_->allocStaticBuffer(quadIndicesSize);
+    memcpy(quadIndexBufferInfo_.mappedData_, quadIndices.data(), quadIndicesSize);
+    indexBufferManager_->flushBuffer(quadIndexBufferInfo_);
+
+#if GEOMETRY_CACHE
+    // 跨帧复用内容相同的绘制任务生成的几何数据
+    geometryCache_ = new GeometryCache(vertexBufferManager_, indexBufferManager_, GEOMETRY_CACHE_BUDGET);
+#endif
+
     // 维护所有的VkPipeline
     pipelineManager_ = new PipelineManager(deviceInfo->device_);
 
+    // 纹理上传使用独立的指令池（及独立的transfer队列，如果有）
+    textureUploader_ = new TextureUploader(deviceInfo->device_, deviceInfo->physicalDevice_, deviceInfo->queueFamilyIndex_,
+                                           deviceInfo->transferQueueFamilyIndex_, deviceInfo->transferQueue_, ASYNC_TEXTURE_UPLOAD);
+
+    // 采样器与图片解耦，按采样状态共享
+    samplerCache_ = new SamplerCache(deviceInfo->device_);
+
     // 维护所有的VkImage
-    imageManager_ = new ImageManager(androidAppCtx, deviceInfo->device_, deviceInfo->physicalDevice_, renderInfo->cmdPool_, deviceInfo_->queue_);
+    imageManager_ = new ImageManager(androidAppCtx, deviceInfo->device_, deviceInfo->physicalDevice_, textureUploader_, samplerCache_,
+                                     TEXTURE_CACHE_BUDGET);
 
     // 维护所有的字体atlas
-    glyphManager_ = new GlyphManager(androidAppCtx, deviceInfo->device_, deviceInfo->physicalDevice_, renderInfo->cmdPool_, deviceInfo_->queue_);
+    glyphManager_ = new GlyphManager(androidAppCtx, deviceInfo->device_, deviceInfo->physicalDevice_, textureUploader_, samplerCache_,
+                                     GLYPH_CACHE_BUDGET, GLYPH_RASTER_THREADS);
+
+    // 首次创建纹理时使用预取线程已解码的结果
+    imageManager_->setPrefetcher(prefetcher);
+    glyphManager_->setPrefetcher(prefetcher);
+
+    // 按绘制尺寸解码，可选生成mip链
+    imageManager_->setDecodeOptions(TEXTURE_DECODE_AT_DISPLAY_SIZE, TEXTURE_MIPMAPS);
+    imageManager_->setDiskCache(diskCache);
+
+#if TEXTURE_ATLAS
+    // 小图片共享atlas页，同一页的图片绘制可以合批
+    imageManager_->enableAtlas(ATLAS_PAGE_SIZE, ATLAS_MAX_PAGES, ATLAS_MAX_IMAGE_SIZE);
+#endif
+
+#if NONBLOCKING_TEXTURE
+    // 后台解码并录制上传，工作线程不再等待纹理
+    imageManager_->startLoader(TEXTURE_LOADER_THREADS);
+#endif
 
     // 维护所有sampler相关的descriptor
-    samplerDescriptorManager_ = new SamplerDescriptorManager(deviceInfo->device_);
+    samplerDescriptorManager_ = new SamplerDescriptorManager(deviceInfo->device_, BATCH_DESCRIPTOR_UPDATES);
+    if (deviceInfo->pushDescriptor_) {
+        SamplerDescriptorManager::loadPushDescriptor(deviceInfo->device_);
+    }
 }
 
 void Engine2D::del() {
-    // 删除所有VkImage相关，包括sampler, imageView, image, imageMemory
+    // 后台加载线程会使用textureUploader_，先停止
+    imageManager_->stopLoader();
+
+    // 等待所有上传完成并释放暂存缓冲，需在删除VkImage之前
+    delete textureUploader_;
+
+    // 删除所有VkImage相关，包括imageView, image, imageMemory
     delete imageManager_;
     delete glyphManager_;
 
@@ -55,6 +137,12 @@ void Engine2D::del() {
     // 删除所有VkPipeline和VkPipelineLayout
     delete pipelineManager_;
 
+    // 删除所有sampler，需在使用它的纹理、descriptor与描述符布局（immutable sampler）之后
+    delete samplerCache_;
+
+    // 归还几何缓存的段，需在BufferManager之前删除
+    delete geometryCache_;
+
     // 调用析构函数，释放VkBuffer与VkDeviceMemory
     delete vertexBufferManager_;
     delete indexBufferManager_;
@@ -62,18 +150,355 @@ void Engine2D::del() {
 
 void Engine2D::resetFrame(uint32_t frameIndex) {
     frameIndex_ = frameIndex;
+    // 回收时读写各工作线程的线程缓存（无锁），依赖此时工作线程空闲（renderAll已返回，下一帧尚未分发）
     vertexBufferManager_->freeAllBuffers(frameIndex);
     indexBufferManager_->freeAllBuffers(frameIndex);
+    if (geometryCache_ != nullptr) {
+        geometryCache_->endFrame();
+    }
+    textureUploader_->collect(); // 上一帧已等待fence，其等待的上传都已完成
+    // 纹理LRU淘汰与延迟销毁，需在collect之后（销毁前检查上传是否完成）
+    imageManager_->endFrame(samplerDescriptorManager_);
+    glyphManager_->endFrame(samplerDescriptorManager_);
+    // 释放上一帧发布的查找快照（纹理淘汰可能刚回收了descriptor）
+    samplerDescriptorManager_->endFrame();
+    pipelineManager_->endFrame();
 //  vertexBufferManager_->dump();
 //  indexBufferManager_->dump();
+
+#if UPLOAD_STATS
+    // 此时工作线程已完成上一帧的所有绘制任务，计数器中即为上一帧的上传量
+    statsUploadBytes_ += uploadBytes_.exchange(0);
+    statsLegacyUploadBytes_ += legacyUploadBytes_.exchange(0);
+    statsFrameCount_++;
+    if (statsFrameCount_ == STATS_INTERVAL) {
+        uint64_t avgBytes = statsUploadBytes_ / statsFrameCount_;
+        uint64_t avgLegacyBytes = statsLegacyUploadBytes_ / statsFrameCount_;
+        double drop = avgLegacyBytes == 0 ? 0.0 : 100.0 * (1.0 - static_cast<double>(avgBytes) / static_cast<double>(avgLegacyBytes));
+        LOGI("upload stats [%s]: %llu bytes/frame (legacy %llu bytes/frame, -%.1f%%)", RS_TREE_PATH,
+             static_cast<unsigned long long>(avgBytes), static_cast<unsigned long long>(avgLegacyBytes), drop);
+        statsFrameCount_ = 0;
+        statsUploadBytes_ = 0;
+        statsLegacyUploadBytes_ = 0;
+    }
+#endif
+
+#if BUFFER_STATS
+    static uint64_t bufferStatsFrameCount = 0;
+    if (++bufferStatsFrameCount == STATS_INTERVAL) {
+        vertexBufferManager_->dump();
+        indexBufferManager_->dump();
+        bufferStatsFrameCount = 0;
+    }
+#endif
+
+#if GEOMETRY_CACHE_STATS
+    // 工作线程已完成上一帧的所有绘制任务，计数器中即为上一帧所有工作线程绘制的CPU时间之和
+    statsDrawTimeNs_ += drawTimeNs_.exchange(0);
+    static uint64_t geometryStatsFrameCount = 0;
+    if (++geometryStatsFrameCount == STATS_INTERVAL) {
+        LOGI("draw time [%s]: %.3f ms/frame (all workers, geometry cache %s, node-local geometry %s)", RS_TREE_PATH,
+             static_cast<double>(statsDrawTimeNs_) / STATS_INTERVAL / 1e6, geometryCache_ != nullptr ? "on" : "off",
+             NODE_LOCAL_GEOMETRY ? "on" : "off");
+        if (geometryCache_ != nullptr) {
+            geometryCache_->dump();
+        }
+        statsDrawTimeNs_ = 0;
+        geometryStatsFrameCount = 0;
+    }
+#endif
+
+#if TEXTURE_CACHE_STATS
+    // 工作线程每次绘制累加draw call计数，统计图片合批（atlas）与文本合批的效果
+    if (++statsDrawCallFrameCount_ == STATS_INTERVAL) {
+        LOGI("draw calls [%s]: %.1f per frame, of which %.1f image draws for %.1f images, atlas %s, %.1f text draws for %.1f texts, sdf %s",
+             RS_TREE_PATH, static_cast<double>(drawCallCount_.exchange(0)) / STATS_INTERVAL,
+             static_cast<double>(imageDrawCallCount_.exchange(0)) / STATS_INTERVAL,
+             static_cast<double>(imageCount_.exchange(0)) / STATS_INTERVAL, TEXTURE_ATLAS ? "on" : "off",
+             static_cast<double>(textDrawCallCount_.exchange(0)) / STATS_INTERVAL,
+             static_cast<double>(textCount_.exchange(0)) / STATS_INTERVAL, SDF_TEXT ? "on" : "off");
+        dumpTextureCacheStats();
+        statsDrawCallFrameCount_ = 0;
+    }
+#endif
+}
+
+void Engine2D::onResize(bool rebuildAll) {
+    if (!rebuildAll) {
+        return;
+    }
+    if (geometryCache_ != nullptr) {
+        geometryCache_->clear();
+    }
+    pipelineManager_->clear();
+    samplerDescriptorManager_->clear(); // 描述符集的layout随管线一起销毁
+}
+
+VkSemaphore Engine2D::submitUploads() {
+    return textureUploader_->submit();
+}
+
+std::mutex &Engine2D::queueMutex() {
+    return textureUploader_->queueMutex();
+}
+
+void Engine2D::dumpUploadStats() {
+    textureUploader_->dump();
+}
+
+void Engine2D::dumpTextureCacheStats() {
+    imageManager_->dump();
+    glyphManager_->dump();
+    samplerCache_->dump();
+    samplerDescriptorManager_->dump();
+}
+
+static void dumpInFlightStats_helper(const char *name, const InFlightStats &stats) {
+    LOGI("%s: waited on in-flight creation %llu times, stalled %.3f ms (%.3f ms/wait), failed %llu",
+         name, (unsigned long long) stats.waitCount_, stats.stallTimeNs_ / 1e6,
+         stats.waitCount_ == 0 ? 0.0 : stats.stallTimeNs_ / 1e6 / stats.waitCount_,
+         (unsigned long long) stats.failCount_);
+}
+
+void Engine2D::dumpInFlightStats() {
+    dumpInFlightStats_helper("PipelineManager", pipelineManager_->getInFlightStats());
+    dumpInFlightStats_helper("ImageManager", imageManager_->getInFlightStats());
+    dumpInFlightStats_helper("GlyphManager", glyphManager_->getInFlightStats());
+    dumpInFlightStats_helper("SamplerDescriptorManager", samplerDescriptorManager_->getInFlightStats());
+}
+
+void Engine2D::setTranslate(int32_t x, int32_t y, DrawResource *drawResource) {
+    // 顶点与平移均为像素坐标，像素到NDC的缩放按当前显示尺寸填写，因此缓存的几何在resize后仍可使用
+    drawResource->transform_.translateX_ = static_cast<float>(x);
+    drawResource->transform_.translateY_ = static_cast<float>(y);
+    drawResource->transform_.scaleX_ = 2.0f / static_cast<float>(swapchainInfo_->displaySize_.width);
+    drawResource->transform_.scaleY_ = 2.0f / static_cast<float>(swapchainInfo_->displaySize_.height);
+}
+
+void Engine2D::recordDrawCall(uint64_t imageCount, uint64_t textCount) {
+#if TEXTURE_CACHE_STATS
+    drawCallCount_.fetch_add(1, std::memory_order_relaxed);
+    if (imageCount > 0) {
+        imageDrawCallCount_.fetch_add(1, std::memory_order_relaxed);
+        imageCount_.fetch_add(imageCount, std::memory_order_relaxed);
+    }
+    if (textCount > 0) {
+        textDrawCallCount_.fetch_add(1, std::memory_order_relaxed);
+        textCount_.fetch_add(textCount, std::memory_order_relaxed);
+    }
+#endif
+}
+
+void Engine2D::recordDrawTime(uint64_t ns) {
+#if GEOMETRY_CACHE_STATS
+    drawTimeNs_.fetch_add(ns, std::memory_order_relaxed);
+#endif
+}
+
+void Engine2D::setTextLayoutCache(bool enabled) {
+    textLayoutCache_ = enabled;
+}
+
+uint64_t Engine2D::takeTextDrawTime() {
+    return textDrawTimeNs_.exchange(0);
+}
+
+void Engine2D::createPipeline(uint32_t key, VulkanPipelineInfo *pipelineInfo) {
+    try {
+        buildPipeline(key, pipelineInfo);
+    } catch (...) {
+        // 通知等待该管线的任务，避免其一直阻塞
+        pipelineManager_->abandonPipeline(key, std::current_exception());
+        throw;
+    }
+    pipelineManager_->insertPipeline(key, *pipelineInfo);
+}
+
+void Engine2D::buildPipeline(uint32_t key, VulkanPipelineInfo *pipelineInfo) {
+    VkPipelineCache pipelineCache = renderInfo_->pipelineCache_; // 所有管线共用，驱动内部同步，可在多个线程中同时使用
+    switch (key) {
+        case RECT_PIPELINE:
+            RectsDrawTask::createGraphicsPipeline(androidAppCtx_, deviceInfo_->device_,
+                                                  swapchainInfo_->displaySize_, renderInfo_->renderPass_, pipelineCache,
+                                                  pipelineInfo);
+            break;
+        case CIRCLE_PIPELINE:
+            CirclesDrawTask::createGraphicsPipeline(androidAppCtx_, deviceInfo_->device_,
+                                                    swapchainInfo_->displaySize_, renderInfo_->renderPass_, pipelineCache,
+                                                    pipelineInfo);
+            break;
+        case RRECT_PIPELINE:
+            RRectsDrawTask::createGraphicsPipeline(androidAppCtx_, deviceInfo_->device_,
+                                                   swapchainInfo_->displaySize_, renderInfo_->renderPass_, pipelineCache,
+                                                   pipelineInfo);
+            break;
+        case IMAGE_PIPELINE: {
+            // 独立纹理与atlas页共用重复采样器：atlas中的图片四周有1像素的扩展，纹理坐标在子矩形内，不会采到页外
+            VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayoutImage(
+                    deviceInfo_->device_, deviceInfo_->pushDescriptor_,
+                    getImmutableSampler(SamplerState::MakeTexture())); // descriptorSetLayout 会随着vkPipeline销毁
+
+            // 该函数内包含 pipelineInfo->descriptorSetLayout_ = descriptorSetLayout; 因此后续可以使用
+            createGraphicsPipelineHelperImage(androidAppCtx_, *deviceInfo_,
+                                              *swapchainInfo_, *renderInfo_,
+                                              pipelineInfo,
+                                              "shaders/image.vert.spv", "shaders/image.frag.spv", descriptorSetLayout);
+            break;
+        }
+        case TEXT_PIPELINE:
+        case TEXT_SDF_PIPELINE: {
+            VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayoutImage(
+                    deviceInfo_->device_, deviceInfo_->pushDescriptor_,
+                    getImmutableSampler(SamplerState::MakeAtlas())); // descriptorSetLayout 会随着vkPipeline销毁
+
+            // 距离场atlas（SDF_TEXT）用text_sdf.frag按屏幕像素宽度重建轮廓
+            char *fsFilePath = key == TEXT_SDF_PIPELINE ? (char *) "shaders/text_sdf.frag.spv" : (char *) "shaders/text.frag.spv";
+            // 该函数内包含 pipelineInfo->descriptorSetLayout_ = descriptorSetLayout; 因此后续可以使用
+            createGraphicsPipelineHelperText(androidAppCtx_, *deviceInfo_,
+                                             *swapchainInfo_, *renderInfo_,
+                                             pipelineInfo,
+                                             "shaders/text.vert.spv", fsFilePath,
+                                             descriptorSetLayout);
+            break;
+        }
+        default:
+            throw std::runtime_error("unknown pipeline key!");
+    }
+}
+
+void Engine2D::prewarmPipelines() {
+    auto start = std::chrono::steady_clock::now();
+    // 运行时只会用到其中一种文字管线
+    const uint32_t keys[] = {RECT_PIPELINE, CIRCLE_PIPELINE, IMAGE_PIPELINE, SDF_TEXT ? TEXT_SDF_PIPELINE : TEXT_PIPELINE, RRECT_PIPELINE};
+    std::vector<std::thread> threads;
+    for (uint32_t key : keys) {
+        threads.emplace_back([key] {
+            VulkanPipelineInfo pipelineInfo;
+            try {
+                if (!pipelineManager_->findPipeline(key, &pipelineInfo)) {
+                    createPipeline(key, &pipelineInfo);
+                }
+            } catch (const std::exception &e) {
+                // 已通知等待者，绘制时再次尝试创建
+                LOGE("Engine2D::prewarmPipelines pipeline %u failed: %s", key, e.what());
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    LOGI("prewarmed %zu pipelines in %.3f ms (pipeline cache %s)", threads.size(),
+         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(),
+         renderInfo_->pipelineCache_ != VK_NULL_HANDLE ? "on" : "off");
+}
+
+void Engine2D::useSamplerDescriptor(VulkanImageInfo &imageInfo, DrawResource *drawResource) {
+    drawResource->descriptorSetInfo_.valid_ = true;
+    if (deviceInfo_->pushDescriptor_) {
+        // 录制时直接push该纹理，无需查找或分配描述符集
+        drawResource->descriptorSetInfo_.push_ = true;
+        drawResource->descriptorSetInfo_.imageInfo_ = {};
+        drawResource->descriptorSetInfo_.imageInfo_.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        drawResource->descriptorSetInfo_.imageInfo_.imageView = imageInfo.textureImageView_;
+        drawResource->descriptorSetInfo_.imageInfo_.sampler = imageInfo.textureSampler_;
+        return;
+    }
+
+    // findSamplerDescriptor可能会阻塞（若其他任务正在创建）
+    if(!samplerDescriptorManager_->findSamplerDescriptor(imageInfo.textureImageView_, &drawResource->descriptorSetInfo_.descriptorSet_)) {
+        // 未创建过该descriptor，则创建
+        samplerDescriptorManager_->createAndInsertSamplerDescriptor(imageInfo.textureImageView_, drawResource->pipelineInfo_.descriptorSetLayout_, imageInfo, &drawResource->descriptorSetInfo_.descriptorSet_);
+    }
 }
 
+VkSampler Engine2D::getImmutableSampler(const SamplerState &state) {
+#if IMMUTABLE_SAMPLERS
+    return samplerCache_->getSampler(state);
+#else
+    return VK_NULL_HANDLE;
+#endif
+}
+
+void Engine2D::flushDescriptorWrites() {
+    samplerDescriptorManager_->flushWrites();
+}
+
+void Engine2D::uploadVertexData(const void *data, uint64_t size, VulkanBufferInfo *bufferInfo, bool persistent) {
+    *bufferInfo = persistent ? vertexBufferManager_->allocPersistentBuffer(size) : vertexBufferManager_->allocBuffer(frameIndex_, size);
+    memcpy(bufferInfo->mappedData_, data, size); // 大块内存持久映射，无需map/unmap
+    vertexBufferManager_->flushBuffer(*bufferInfo);
+}
+
+void Engine2D::uploadIndexData(const std::vector<uint32_t> &indexData, uint32_t vertexCount, DrawResource *drawResource, bool persistent) {
+    if (indexData.empty()) {
+        // 没有需要绘制的图元：不申请段（blockId_为0，几何缓存不会归还它），录制时跳过
+        drawResource->indexBufferInfo_ = VulkanBufferInfo();
+        drawResource->indexType_ = VK_INDEX_TYPE_UINT16;
+        drawResource->indexCount_ = 0;
+        return;
+    }
+
+    uint64_t size;
+    if (vertexCount <= 65536) {
+        // 索引值都可以用16位表示
+        size = sizeof(uint16_t) * indexData.size();
+        drawResource->indexBufferInfo_ = persistent ? indexBufferManager_->allocPersistentBuffer(size) : indexBufferManager_->allocBuffer(frameIndex_, size);
+        auto *dst = static_cast<uint16_t *>(drawResource->indexBufferInfo_.mappedData_);
+        for (size_t i = 0; i < indexData.size(); i++) {
+            dst[i] = static_cast<uint16_t>(indexData[i]);
+        }
+        drawResource->indexType_ = VK_INDEX_TYPE_UINT16;
+    } else {
+        size = sizeof(uint32_t) * indexData.size();
+        drawResource->indexBufferInfo_ = persistent ? indexBufferManager_->allocPersistentBuffer(size) : indexBufferManager_->allocBuffer(frameIndex_, size);
+        memcpy(drawResource->indexBufferInfo_.mappedData_, indexData.data(), size);
+        drawResource->indexType_ = VK_INDEX_TYPE_UINT32;
+    }
+    indexBufferManager_->flushBuffer(drawResource->indexBufferInfo_);
+
+    drawResource->indexCount_ = indexData.size();
+    recordUpload(size, 0);
+}
+
+void Engine2D::useQuadIndices(uint32_t quadCount, DrawResource *drawResource, bool persistent) {
+    if (quadCount <= MAX_SHARED_QUAD_COUNT) {
+        // 直接使用共享的index buffer，无需上传
+        drawResource->indexBufferInfo_ = quadIndexBufferInfo_;
+        drawResource->indexType_ = VK_INDEX_TYPE_UINT16;
+        drawResource->indexCount_ = quadCount * 6;
+        return;
+    }
+
+    // 超出共享buffer的上限（极少出现），退回逐帧生成
+    std::vector<uint32_t> indexData;
+    indexData.reserve(quadCount * 6);
+    for (uint32_t i = 0; i < quadCount; i++) {
+        uint32_t base = i * 4;
+        indexData.push_back(base);
+        indexData.push_back(base + 1);
+        indexData.push_back(base + 2);
+        indexData.push_back(base + 2);
+        indexData.push_back(base + 3);
+        indexData.push_back(base);
+    }
+    uploadIndexData(indexData, quadCount * 4, drawResource, persistent);
+}
+
+void Engine2D::recordUpload(uint64_t bytes, uint64_t legacyBytes) {
+#if UPLOAD_STATS
+    uploadBytes_.fetch_add(bytes, std::memory_order_relaxed);
+    legacyUploadBytes_.fetch_add(legacyBytes, std::memory_order_relaxed);
+#endif
+}
+
+
 DrawResource Engine2D::drawRects(std::vector<Rect> &rects, std::vector<Paint> &paints) {
 
     // 检查
     if (rects.size() != paints.size()) {
         LOGE("drawRects inputs do not match!");
     }
+    recordDrawCall(0, 0);
 
     // 该任务生成的绘制资源
     DrawResource drawResource;
@@ -81,154 +506,171 @@ DrawResource Engine2D::drawRects(std::vector<Rect> &rects, std::vector<Paint> &p
     // 创建VkPipeline（如果未曾被创建过）
     if(!pipelineManager_->findPipeline(RECT_PIPELINE, &drawResource.pipelineInfo_)) {
         // 未曾创建过，则创建
-        RectsDrawTask::createGraphicsPipeline(androidAppCtx_, deviceInfo_->device_,
-                               swapchainInfo_->displaySize_, renderInfo_->renderPass_,
-                               &drawResource.pipelineInfo_);
-        pipelineManager_->insertPipeline(RECT_PIPELINE, drawResource.pipelineInfo_);
+        createPipeline(RECT_PIPELINE, &drawResource.pipelineInfo_);
     }
 
-    // 生成vertex和index数据
-    std::vector<float> vertexData;
-    std::vector<uint32_t> indexData;
+    // 命中几何缓存则跳过顶点生成与上传
+    std::string geometryKey;
+    bool cacheable = false;
+    if (geometryCache_ != nullptr) {
+        geometryKey = GeometryCache::makeKey(RECT_PIPELINE, rects, paints);
+        if (geometryCache_->find(geometryKey, &drawResource, &cacheable)) {
+            return drawResource;
+        }
+    }
+
+    // 生成vertex数据，index使用共享的quad index buffer
+    std::vector<ColorVertex> vertexData;
+    vertexData.reserve(rects.size() * 4);
 
     for(int i = 0; i < rects.size(); i++) {
         // 插入顶点坐标
-        float left = coordinateXToVulkan(rects[i].x_);
-        float top = coordinateYToVulkan(rects[i].y_);
-        float right = coordinateXToVulkan(rects[i].x_ + rects[i].w_);
-        float bottom = coordinateYToVulkan(rects[i].y_ + rects[i].h_);
-        vertexData.push_back(left);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(right);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(right);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(left);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-
-        uint32_t base = i * 4;
-        indexData.push_back(base);
-        indexData.push_back(base + 1);
-        indexData.push_back(base + 2);
-        indexData.push_back(base + 2);
-        indexData.push_back(base + 3);
-        indexData.push_back(base);
+        float left = rects[i].x_;
+        float top = rects[i].y_;
+        float right = rects[i].x_ + rects[i].w_;
+        float bottom = rects[i].y_ + rects[i].h_;
+        uint32_t color = packColor(paints[i]);
+        vertexData.push_back({makeVertexPos(left, top), color});
+        vertexData.push_back({makeVertexPos(right, top), color});
+        vertexData.push_back({makeVertexPos(right, bottom), color});
+        vertexData.push_back({makeVertexPos(left, bottom), color});
     }
 
     // 创建VkBuffer
-    drawResource.vertexBufferInfo_ = vertexBufferManager_->allocBuffer(frameIndex_, sizeof(float) * vertexData.size());
-    void *data;
-    vkMapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_, 0, sizeof(float) * vertexData.size(),0, &data);
-    memcpy(data, vertexData.data(), sizeof(float) * vertexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_);
+    uploadVertexData(vertexData.data(), sizeof(ColorVertex) * vertexData.size(), &drawResource.vertexBufferInfo_, cacheable);
+    useQuadIndices(rects.size(), &drawResource, cacheable);
 
-    // 创建VkBuffer
-    drawResource.indexBufferInfo_ = indexBufferManager_->allocBuffer(frameIndex_, sizeof(uint32_t) * indexData.size());
-    vkMapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_, 0, sizeof(uint32_t) * indexData.size(),0, &data);
-    memcpy(data, indexData.data(), sizeof(uint32_t) * indexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_);
+    recordUpload(sizeof(ColorVertex) * vertexData.size(),
+                 sizeof(float) * LEGACY_COLOR_VERTEX_FLOATS * vertexData.size() + sizeof(uint32_t) * drawResource.indexCount_);
 
-    drawResource.indexCount_ = indexData.size();
+    if (cacheable) {
+        geometryCache_->insert(geometryKey, drawResource);
+    }
 
     return drawResource;
 }
 
 DrawResource Engine2D::drawImage(Image &image, Paint &paint) {
 
-    // 该任务生成的绘制资源
-    DrawResource drawResource;
-
     VulkanImageInfo imageInfo; // 该值不需要返回给收集线程，收集线程只需要descriptor即可
 
+#if NONBLOCKING_TEXTURE
+    // 纹理未就绪时不阻塞：由后台线程加载，本帧以平均色的矩形占位，之后的帧上传完成后自动换成纹理
+    uint32_t placeholderColor;
+    if (!imageManager_->findImageInfoNonBlocking(image, &imageInfo, &placeholderColor)) {
+        std::vector<Rect> rects = {image.rect_};
+        std::vector<Paint> paints(1);
+        paints[0].setColor(placeholderColor);
+        return drawRects(rects, paints);
+    }
+#else
     // findImageInfo可能会阻塞（若其他任务正在创建）
     if (!imageManager_->findImageInfo(image, &imageInfo)) {
         // 未创建过该图像，则创建
         imageManager_->createAndInsertImageInfo(image, &imageInfo);
     }
+#endif
+
+    std::vector<Image> images = {image};
+    std::vector<VulkanImageInfo> imageInfos = {imageInfo};
+    return drawImageQuads(images, imageInfos);
+}
+
+DrawResource Engine2D::drawImages(std::vector<Image> &images, Paint &paint) {
+
+    // 合批时所有图片都驻留在同一atlas页且上传完成，通常这里的查找都会直接命中。
+    // 不在该页上的图片（如生成任务之后被淘汰）按单张图片的方式查找并触发加载，本帧跳过，之后的帧重新合批
+    std::vector<Image> pageImages;
+    std::vector<VulkanImageInfo> pageImageInfos;
+    pageImages.reserve(images.size());
+    pageImageInfos.reserve(images.size());
+    for (Image &image : images) {
+        VulkanImageInfo imageInfo;
+#if NONBLOCKING_TEXTURE
+        uint32_t placeholderColor;
+        if (!imageManager_->findImageInfoNonBlocking(image, &imageInfo, &placeholderColor)) {
+            continue;
+        }
+#else
+        if (!imageManager_->findImageInfo(image, &imageInfo)) {
+            imageManager_->createAndInsertImageInfo(image, &imageInfo);
+        }
+#endif
+        if (imageInfo.atlasRegion_.page_ < 0 ||
+            (!pageImageInfos.empty() && imageInfo.atlasRegion_.page_ != pageImageInfos[0].atlasRegion_.page_)) {
+            continue;
+        }
+        pageImages.push_back(image);
+        pageImageInfos.push_back(imageInfo);
+    }
+
+    if (pageImages.empty()) {
+        // 没有可以合批绘制的图片，按单张图片绘制第一张（未就绪时为占位颜色）
+        return drawImage(images[0], paint);
+    }
+    return drawImageQuads(pageImages, pageImageInfos);
+}
+
+int32_t Engine2D::getImageAtlasPage(Image &image) {
+    int32_t page;
+    if (!imageManager_->findAtlasPage(image, &page)) {
+        return -1;
+    }
+    return page;
+}
+
+DrawResource Engine2D::drawImageQuads(std::vector<Image> &images, std::vector<VulkanImageInfo> &imageInfos) {
+    recordDrawCall(images.size(), 0);
+
+    // 该任务生成的绘制资源
+    DrawResource drawResource;
+    VulkanImageInfo &imageInfo = imageInfos[0]; // 所有图片采样同一张纹理
 
     // 创建VkPipeline（如果未曾被创建过），findPipeline可能会阻塞（若其他任务正在创建）
     if(!pipelineManager_->findPipeline(IMAGE_PIPELINE, &drawResource.pipelineInfo_)) {
         // 未曾创建过，则创建
-        VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayoutImage(
-                deviceInfo_->device_); // descriptorSetLayout 会随着vkPipeline销毁
+        createPipeline(IMAGE_PIPELINE, &drawResource.pipelineInfo_);
+    }
 
-        // 该函数内包含 pipelineInfo->descriptorSetLayout_ = descriptorSetLayout; 因此后续可以使用
-        createGraphicsPipelineHelperImage(androidAppCtx_, *deviceInfo_,
-                                                                   *swapchainInfo_, *renderInfo_,
-                                                                   &drawResource.pipelineInfo_,
-                                                                   "shaders/image.vert.spv", "shaders/image.frag.spv", descriptorSetLayout);
+    useSamplerDescriptor(imageInfo, &drawResource); // 此图元需使用descriptor
 
-        pipelineManager_->insertPipeline(IMAGE_PIPELINE, drawResource.pipelineInfo_);
+    // 命中几何缓存则跳过顶点生成与上传
+    std::string geometryKey;
+    bool cacheable = false;
+    if (geometryCache_ != nullptr) {
+        geometryKey = GeometryCache::makeKey(IMAGE_PIPELINE, images, imageInfos);
+        if (geometryCache_->find(geometryKey, &drawResource, &cacheable)) {
+            return drawResource;
+        }
     }
 
-    // findSamplerDescriptor可能会阻塞（若其他任务正在创建）
-    drawResource.descriptorSetInfo_.valid_ = true; // 此图元需使用descriptor
-    if(!samplerDescriptorManager_->findSamplerDescriptor(imageInfo.textureImageView_, &drawResource.descriptorSetInfo_.descriptorSet_)) {
-        // 未创建过该descriptor，则创建
-        samplerDescriptorManager_->createAndInsertSamplerDescriptor(imageInfo.textureImageView_, drawResource.pipelineInfo_.descriptorSetLayout_, imageInfo, &drawResource.descriptorSetInfo_.descriptorSet_);
+    // 生成vertex数据，index使用共享的quad index buffer；atlas中的图片使用页中子矩形的纹理坐标
+    std::vector<ImageVertex> vertexData;
+    vertexData.reserve(images.size() * 4);
+    for (size_t i = 0; i < images.size(); i++) {
+        Rect &rect = images[i].rect_;
+        VulkanImageInfo &info = imageInfos[i];
+
+        float left = rect.x_;
+        float top = rect.y_;
+        float right = rect.x_ + rect.w_;
+        float bottom = rect.y_ + rect.h_;
+        vertexData.push_back({makeVertexPos(left, top), info.uvLeft_, info.uvTop_});
+        vertexData.push_back({makeVertexPos(right, top), info.uvRight_, info.uvTop_});
+        vertexData.push_back({makeVertexPos(right, bottom), info.uvRight_, info.uvBottom_});
+        vertexData.push_back({makeVertexPos(left, bottom), info.uvLeft_, info.uvBottom_});
     }
 
-    // 生成vertex和index数据
-    std::vector<float> vertexData;
-    std::vector<uint32_t> indexData;
-
-    // 插入顶点坐标
-    Rect &rect = image.rect_;
-
-    float left = coordinateXToVulkan(rect.x_);
-    float top = coordinateYToVulkan(rect.y_);
-    float right = coordinateXToVulkan(rect.x_ + rect.w_);
-    float bottom = coordinateYToVulkan(rect.y_ + rect.h_);
-    vertexData.push_back(left);
-    vertexData.push_back(top);
-    vertexData.push_back(0.0);
-    vertexData.push_back(0.0);
-    vertexData.push_back(right);
-    vertexData.push_back(top);
-    vertexData.push_back(1.0);
-    vertexData.push_back(0.0);
-    vertexData.push_back(right);
-    vertexData.push_back(bottom);
-    vertexData.push_back(1.0);
-    vertexData.push_back(1.0);
-    vertexData.push_back(left);
-    vertexData.push_back(bottom);
-    vertexData.push_back(0.0);
-    vertexData.push_back(1.0);
-
-    indexData.push_back(0);
-    indexData.push_back(1);
-    indexData.push_back(2);
-    indexData.push_back(2);
-    indexData.push_back(3);
-    indexData.push_back(0);
-
     // 创建VkBuffer
-    drawResource.vertexBufferInfo_ = vertexBufferManager_->allocBuffer(frameIndex_, sizeof(float) * vertexData.size());
-    void *data;
-    vkMapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_, 0, sizeof(float) * vertexData.size(),0, &data);
-    memcpy(data, vertexData.data(), sizeof(float) * vertexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_);
+    uint64_t vertexDataSize = sizeof(ImageVertex) * vertexData.size();
+    uploadVertexData(vertexData.data(), vertexDataSize, &drawResource.vertexBufferInfo_, cacheable);
+    useQuadIndices(static_cast<uint32_t>(images.size()), &drawResource, cacheable);
 
-    // 创建VkBuffer
-    drawResource.indexBufferInfo_ = indexBufferManager_->allocBuffer(frameIndex_, sizeof(uint32_t) * indexData.size());
-    vkMapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_, 0, sizeof(uint32_t) * indexData.size(),0, &data);
-    memcpy(data, indexData.data(), sizeof(uint32_t) * indexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_);
+    recordUpload(vertexDataSize, (sizeof(float) * LEGACY_IMAGE_VERTEX_FLOATS * 4 + sizeof(uint32_t) * 6) * images.size());
 
-    drawResource.indexCount_ = indexData.size();
+    if (cacheable) {
+        geometryCache_->insert(geometryKey, drawResource);
+    }
 
     return drawResource;
 }
@@ -239,6 +681,7 @@ DrawResource Engine2D::drawCircles(std::vector<Circle> &circles, std::vector<Pai
     if (circles.size() != paints.size()) {
         LOGE("drawCircles inputs do not match!");
     }
+    recordDrawCall(0, 0);
 
     // 该任务生成的绘制资源
     DrawResource drawResource;
@@ -246,14 +689,21 @@ DrawResource Engine2D::drawCircles(std::vector<Circle> &circles, std::vector<Pai
     // 创建VkPipeline（如果未曾被创建过）
     if(!pipelineManager_->findPipeline(CIRCLE_PIPELINE, &drawResource.pipelineInfo_)) {
         // 未曾创建过，则创建
-        CirclesDrawTask::createGraphicsPipeline(androidAppCtx_, deviceInfo_->device_,
-                                     swapchainInfo_->displaySize_, renderInfo_->renderPass_,
-                                     &drawResource.pipelineInfo_);
-        pipelineManager_->insertPipeline(CIRCLE_PIPELINE, drawResource.pipelineInfo_);
+        createPipeline(CIRCLE_PIPELINE, &drawResource.pipelineInfo_);
+    }
+
+    // 命中几何缓存则跳过顶点生成与上传
+    std::string geometryKey;
+    bool cacheable = false;
+    if (geometryCache_ != nullptr) {
+        geometryKey = GeometryCache::makeKey(CIRCLE_PIPELINE, circles, paints);
+        if (geometryCache_->find(geometryKey, &drawResource, &cacheable)) {
+            return drawResource;
+        }
     }
 
     // 生成vertex和index数据
-    std::vector<float> vertexData;
+    std::vector<ColorVertex> vertexData;
     std::vector<uint32_t> indexData;
 
     int base = 0;
@@ -263,23 +713,17 @@ DrawResource Engine2D::drawCircles(std::vector<Circle> &circles, std::vector<Pai
         int triCount = static_cast<int>(circles[i].r_ / 4); // 根据半径决定细分数量
         triCount = triCount > 20 ? triCount : 20; // 细分数量至少为20
 
+        uint32_t color = packColor(paints[i]);
+
         // 圆心
-        vertexData.push_back(coordinateXToVulkan(circles[i].x_));
-        vertexData.push_back(coordinateYToVulkan(circles[i].y_));
-        vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
+        vertexData.push_back({makeVertexPos(circles[i].x_, circles[i].y_), color});
 
         // 细分并插入顶点坐标
         for (int j = 0; j < triCount; j++) {
             double radians = 2 * M_PI / triCount * j; // 划分角度
             float x = circles[i].x_ + circles[i].r_ * static_cast<float>(cos(radians));
             float y = circles[i].y_ + circles[i].r_ * static_cast<float>(sin(radians));
-            vertexData.push_back(coordinateXToVulkan(x));
-            vertexData.push_back(coordinateYToVulkan(y));
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
+            vertexData.push_back({makeVertexPos(x, y), color});
         }
 
         // 组织三角形
@@ -296,147 +740,165 @@ DrawResource Engine2D::drawCircles(std::vector<Circle> &circles, std::vector<Pai
     }
 
     // 创建VkBuffer
-    drawResource.vertexBufferInfo_ = vertexBufferManager_->allocBuffer(frameIndex_, sizeof(float) * vertexData.size());
-    void *data;
-    vkMapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_, 0, sizeof(float) * vertexData.size(),0, &data);
-    memcpy(data, vertexData.data(), sizeof(float) * vertexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_);
+    uploadVertexData(vertexData.data(), sizeof(ColorVertex) * vertexData.size(), &drawResource.vertexBufferInfo_, cacheable);
+    uploadIndexData(indexData, vertexData.size(), &drawResource, cacheable);
 
-    // 创建VkBuffer
-    drawResource.indexBufferInfo_ = indexBufferManager_->allocBuffer(frameIndex_, sizeof(uint32_t) * indexData.size());
-    vkMapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_, 0, sizeof(uint32_t) * indexData.size(),0, &data);
-    memcpy(data, indexData.data(), sizeof(uint32_t) * indexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_);
+    recordUpload(sizeof(ColorVertex) * vertexData.size(),
+                 sizeof(float) * LEGACY_COLOR_VERTEX_FLOATS * vertexData.size() + sizeof(uint32_t) * indexData.size());
 
-    drawResource.indexCount_ = indexData.size();
+    if (cacheable) {
+        geometryCache_->insert(geometryKey, drawResource);
+    }
 
     return drawResource;
 }
 
 
+// 文本的基线：Text的(x_, y_)为左上角，字形以FT_Set_Pixel_Sizes(0, pixelHeight)光栅化，基线取其下方一个字号（em框的底边）
+// 排版缓存与逐字符两种路径都由此计算，保证两者位置一致
+static float textBaseline_helper(const Text &text) {
+    return text.y_ + text.pixelHeight_;
+}
+
 DrawResource Engine2D::drawTexts(std::vector<Text> &texts, std::vector<Paint> &paints) {
 
     // 检查
     if (texts.size() != paints.size() || texts.empty()) {
         LOGE("drawTexts inputs do not match!");
     }
+    recordDrawCall(0, texts.size());
 
     // 该任务生成的绘制资源
     DrawResource drawResource;
 
     GlyphInfo glyphInfo; // 该值不需要返回给收集线程，收集线程只需要descriptor即可
 
-    // findTextTmageInfo可能会阻塞（若其他任务正在创建），合批时已确认过只有相同字体才可以合批
-    if (!glyphManager_->findTextTmageInfo(texts[0], &glyphInfo)) {
-        // 未创建过该字体atlas，则创建
-        glyphManager_->createAndInsertTextImageInfo(texts[0], &glyphInfo);
+    // findTextTmageInfo可能会阻塞（若其他任务正在创建），合批时已确认过只有相同strike（字体，非SDF时还需相同字号）才可以合批
+    Text strikeKey = GlyphManager::makeStrikeKey(texts[0]);
+    if (!glyphManager_->findTextTmageInfo(strikeKey, &glyphInfo)) {
+        // 未创建过该字体大小的strike，则创建
+        glyphManager_->createAndInsertTextImageInfo(strikeKey, &glyphInfo);
     }
 
     // 创建VkPipeline（如果未曾被创建过），findPipeline可能会阻塞（若其他任务正在创建）
-    if(!pipelineManager_->findPipeline(TEXT_PIPELINE, &drawResource.pipelineInfo_)) {
+    uint32_t pipelineKey = glyphInfo.sdf_ ? TEXT_SDF_PIPELINE : TEXT_PIPELINE;
+    if(!pipelineManager_->findPipeline(pipelineKey, &drawResource.pipelineInfo_)) {
         // 未曾创建过，则创建
-        VkDescriptorSetLayout descriptorSetLayout = createDescriptorSetLayoutImage(
-                deviceInfo_->device_); // descriptorSetLayout 会随着vkPipeline销毁
-
-        // 该函数内包含 pipelineInfo->descriptorSetLayout_ = descriptorSetLayout; 因此后续可以使用
-        createGraphicsPipelineHelperText(androidAppCtx_, *deviceInfo_,
-                                          *swapchainInfo_, *renderInfo_,
-                                          &drawResource.pipelineInfo_,
-                                          "shaders/text.vert.spv", "shaders/text.frag.spv", descriptorSetLayout);
-
-        pipelineManager_->insertPipeline(TEXT_PIPELINE, drawResource.pipelineInfo_);
+        createPipeline(pipelineKey, &drawResource.pipelineInfo_);
     }
 
-    // findSamplerDescriptor可能会阻塞（若其他任务正在创建）
-    drawResource.descriptorSetInfo_.valid_ = true; // 此图元需使用descriptor
-    if(!samplerDescriptorManager_->findSamplerDescriptor(glyphInfo.atlasInfo_.textureImageView_, &drawResource.descriptorSetInfo_.descriptorSet_)) {
-        // 未创建过该descriptor，则创建
-        samplerDescriptorManager_->createAndInsertSamplerDescriptor(glyphInfo.atlasInfo_.textureImageView_, drawResource.pipelineInfo_.descriptorSetLayout_, glyphInfo.atlasInfo_, &drawResource.descriptorSetInfo_.descriptorSet_);
+    useSamplerDescriptor(glyphInfo.atlasInfo_, &drawResource); // 此图元需使用descriptor
+
+#if TEXT_LAYOUT_BENCHMARK
+    auto textStart = std::chrono::steady_clock::now();
+#endif
+
+    // 查找所有文本的排版（或逐字符查找字形），未缓存的字形在此光栅化并上传（同一次绘制中的新字形合并为一次上传）
+    std::vector<std::shared_ptr<const TextRun>> runs;
+    std::vector<std::vector<uint32_t>> codepoints;
+    std::vector<GlyphMetrics> glyphs;
+    uint64_t generation = 0;
+    size_t quadCapacity = 0;
+    if (textLayoutCache_) {
+        glyphManager_->findTextRuns(glyphInfo, texts, &runs);
+        for (const std::shared_ptr<const TextRun> &run : runs) {
+            quadCapacity += run->quads_.size();
+        }
+    } else {
+        codepoints.resize(texts.size());
+        std::vector<uint32_t> allCodepoints;
+        for (int i = 0; i < texts.size(); i++) {
+            Text::decodeUtf8(texts[i].str_, &codepoints[i]);
+            allCodepoints.insert(allCodepoints.end(), codepoints[i].begin(), codepoints[i].end());
+        }
+        generation = glyphManager_->findGlyphs(glyphInfo, allCodepoints, &glyphs);
+        quadCapacity = allCodepoints.size();
     }
 
-    // 生成vertex和index数据
-    std::vector<float> vertexData;
-    std::vector<uint32_t> indexData;
-
-    int count = 0;
-    for(int i = 0; i < texts.size(); i++) {
-
-        float horiAccPx = texts[i].x_;
-
-        for(int j = 0; j < texts[i].str_.size(); j++) {
-
-            char c = texts[i].str_.at(j);
-            float leftSample = 0.0;
-            float rightSample = glyphInfo.glyphRight_[c];
-            float topSample = glyphInfo.glyphTop_[c];
-            float bottomSample = glyphInfo.glyphBottom_[c];
-
-            // 插入顶点坐标和纹理采样坐标
-            float left = coordinateXToVulkan(horiAccPx + glyphInfo.glyphLeftOffsets_[c]);
-            float top = coordinateYToVulkan(texts[i].y_ + texts[i].pixelHeight_ - glyphInfo.glyphTopOffsets_[c]); // TODO: 这里暂时加上texts[i].pixelHeight_
-            float right = coordinateXToVulkan(horiAccPx + glyphInfo.glyphLeftOffsets_[c] + rightSample * glyphInfo.maxGlyphWidth_);
-            float bottom = coordinateYToVulkan(texts[i].y_ + texts[i].pixelHeight_ - glyphInfo.glyphTopOffsets_[c] + glyphInfo.maxGlyphHeight_ * (bottomSample - topSample) * ASCII_CHAR_COUNT);
-            horiAccPx += (glyphInfo.glyphLeftOffsets_[c] + rightSample * glyphInfo.maxGlyphWidth_); // * 1.2; // 1.2 为字间距
+    // 命中几何缓存则跳过顶点生成与上传
+    std::string geometryKey;
+    bool cacheable = false;
+    if (geometryCache_ != nullptr) {
+        geometryKey = textLayoutCache_ ? GeometryCache::makeKey(pipelineKey, texts, paints, glyphInfo.strikeId_, runs)
+                                       : GeometryCache::makeKey(pipelineKey, texts, paints, glyphInfo.strikeId_, generation);
+        if (geometryCache_->find(geometryKey, &drawResource, &cacheable)) {
+#if TEXT_LAYOUT_BENCHMARK
+            textDrawTimeNs_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - textStart).count(), std::memory_order_relaxed);
+#endif
+            return drawResource;
+        }
+    }
 
-            // TODO: 暂时为空格做了个特判
-            if (c == ' ') {
-                horiAccPx += glyphInfo.maxGlyphWidth_ * 0.5;
+    // 生成vertex数据，index使用共享的quad index buffer
+    std::vector<TextVertex> vertexData;
+    vertexData.reserve(quadCapacity * 4);
+
+    if (textLayoutCache_) {
+        // 已排版的字形四边形平移（SDF时缩放）到文本位置
+        for (int i = 0; i < texts.size(); i++) {
+            uint32_t color = packColor(paints[i]);
+            float scale = texts[i].pixelHeight_ / glyphInfo.pixelHeight_; // 排版为strike字号下的，SDF时缩放到绘制字号
+            float originX = texts[i].x_;
+            float baseline = textBaseline_helper(texts[i]);
+            for (const GlyphQuad &quad : runs[i]->quads_) {
+                float left = originX + quad.left_ * scale;
+                float top = baseline + quad.top_ * scale;
+                float right = originX + quad.right_ * scale;
+                float bottom = baseline + quad.bottom_ * scale;
+                vertexData.push_back({makeVertexPos(left, top), quad.uvLeft_, quad.uvTop_, color});
+                vertexData.push_back({makeVertexPos(right, top), quad.uvRight_, quad.uvTop_, color});
+                vertexData.push_back({makeVertexPos(right, bottom), quad.uvRight_, quad.uvBottom_, color});
+                vertexData.push_back({makeVertexPos(left, bottom), quad.uvLeft_, quad.uvBottom_, color});
+            }
+        }
+    } else {
+        size_t glyphIndex = 0;
+        for(int i = 0; i < texts.size(); i++) {
+
+            float horiAccPx = texts[i].x_;
+            float baseline = textBaseline_helper(texts[i]);
+            uint32_t color = packColor(paints[i]);
+            float scale = texts[i].pixelHeight_ / glyphInfo.pixelHeight_; // 度量为strike字号下的，SDF时缩放到绘制字号
+
+            for(size_t j = 0; j < codepoints[i].size(); j++) {
+
+                const GlyphMetrics &glyph = glyphs[glyphIndex++];
+                float penX = horiAccPx;
+                horiAccPx += glyph.advance_ * scale;
+                if (glyph.width_ == 0 || glyph.height_ == 0) {
+                    continue; // 空格等没有位图的字形只前进
+                }
+
+                // 插入顶点坐标和纹理采样坐标
+                float left = penX + glyph.left_ * scale;
+                float top = baseline - glyph.top_ * scale;
+                float right = left + glyph.width_ * scale;
+                float bottom = top + glyph.height_ * scale;
+
+                vertexData.push_back({makeVertexPos(left, top), glyph.uvLeft_, glyph.uvTop_, color});
+                vertexData.push_back({makeVertexPos(right, top), glyph.uvRight_, glyph.uvTop_, color});
+                vertexData.push_back({makeVertexPos(right, bottom), glyph.uvRight_, glyph.uvBottom_, color});
+                vertexData.push_back({makeVertexPos(left, bottom), glyph.uvLeft_, glyph.uvBottom_, color});
             }
-
-            vertexData.push_back(left);
-            vertexData.push_back(top);
-            vertexData.push_back(leftSample);
-            vertexData.push_back(topSample);
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(right);
-            vertexData.push_back(top);
-            vertexData.push_back(rightSample);
-            vertexData.push_back(topSample);
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(right);
-            vertexData.push_back(bottom);
-            vertexData.push_back(rightSample);
-            vertexData.push_back(bottomSample);
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(left);
-            vertexData.push_back(bottom);
-            vertexData.push_back(leftSample);
-            vertexData.push_back(bottomSample);
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-
-            indexData.push_back(count + 0);
-            indexData.push_back(count + 1);
-            indexData.push_back(count + 2);
-            indexData.push_back(count + 2);
-            indexData.push_back(count + 3);
-            indexData.push_back(count + 0);
-            count += 4;
         }
     }
 
     // 创建VkBuffer
-    drawResource.vertexBufferInfo_ = vertexBufferManager_->allocBuffer(frameIndex_, sizeof(float) * vertexData.size());
-    void *data;
-    vkMapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_, 0, sizeof(float) * vertexData.size(),0, &data);
-    memcpy(data, vertexData.data(), sizeof(float) * vertexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_);
+    uploadVertexData(vertexData.data(), sizeof(TextVertex) * vertexData.size(), &drawResource.vertexBufferInfo_, cacheable);
+    useQuadIndices(vertexData.size() / 4, &drawResource, cacheable);
 
-    // 创建VkBuffer
-    drawResource.indexBufferInfo_ = indexBufferManager_->allocBuffer(frameIndex_, sizeof(uint32_t) * indexData.size());
-    vkMapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_, 0, sizeof(uint32_t) * indexData.size(),0, &data);
-    memcpy(data, indexData.data(), sizeof(uint32_t) * indexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_);
+    recordUpload(sizeof(TextVertex) * vertexData.size(),
+                 sizeof(float) * LEGACY_TEXT_VERTEX_FLOATS * vertexData.size() + sizeof(uint32_t) * drawResource.indexCount_);
 
-    drawResource.indexCount_ = indexData.size();
+    if (cacheable) {
+        geometryCache_->insert(geometryKey, drawResource);
+    }
 
+#if TEXT_LAYOUT_BENCHMARK
+    textDrawTimeNs_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - textStart).count(), std::memory_order_relaxed);
+#endif
     return drawResource;
 }
 
@@ -446,6 +908,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
     if (rrects.size() != paints.size()) {
         LOGE("drawRects inputs do not match!");
     }
+    recordDrawCall(0, 0);
 
     // 该任务生成的绘制资源
     DrawResource drawResource;
@@ -453,14 +916,21 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
     // 创建VkPipeline（如果未曾被创建过）
     if(!pipelineManager_->findPipeline(RRECT_PIPELINE, &drawResource.pipelineInfo_)) {
         // 未曾创建过，则创建
-        RRectsDrawTask::createGraphicsPipeline(androidAppCtx_, deviceInfo_->device_,
-                                              swapchainInfo_->displaySize_, renderInfo_->renderPass_,
-                                              &drawResource.pipelineInfo_);
-        pipelineManager_->insertPipeline(RRECT_PIPELINE, drawResource.pipelineInfo_);
+        createPipeline(RRECT_PIPELINE, &drawResource.pipelineInfo_);
+    }
+
+    // 命中几何缓存则跳过顶点生成与上传
+    std::string geometryKey;
+    bool cacheable = false;
+    if (geometryCache_ != nullptr) {
+        geometryKey = GeometryCache::makeKey(RRECT_PIPELINE, rrects, paints);
+        if (geometryCache_->find(geometryKey, &drawResource, &cacheable)) {
+            return drawResource;
+        }
     }
 
     // 生成vertex和index数据
-    std::vector<float> vertexData;
+    std::vector<ColorVertex> vertexData;
     std::vector<uint32_t> indexData;
 
     int base = 0;
@@ -469,6 +939,8 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         float radius = std::min(rrects[i].w_, rrects[i].h_) / 2.0;
         radius = std::min(radius, rrects[i].r_); // 最大可用半径
 
+        uint32_t color = packColor(paints[i]);
+
         /* 先画四个圆角 */
         // 每个扇形的三角形数量
         int triCount = static_cast<int>(radius / 16); // 根据半径决定细分数量
@@ -478,12 +950,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         // 左上角圆心
         float cornerX = rrects[i].x_ + radius;
         float cornerY = rrects[i].y_ + radius;
-        vertexData.push_back(coordinateXToVulkan(cornerX));
-        vertexData.push_back(coordinateYToVulkan(cornerY));
-        vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        vertexData.push_back({makeVertexPos(cornerX, cornerY), color});
 
         // 细分并插入顶点坐标（左上角）
         double baseRadians =  0.5 * M_PI;
@@ -491,12 +958,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
             double radians = baseRadians + incRadians * j; // 划分角度
             float x = cornerX + radius * static_cast<float>(cos(radians));
             float y = cornerY - radius * static_cast<float>(sin(radians));
-            vertexData.push_back(coordinateXToVulkan(x));
-            vertexData.push_back(coordinateYToVulkan(y));
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(paints[i].a_);
+            vertexData.push_back({makeVertexPos(x, y), color});
         }
 
         // 组织三角形
@@ -512,12 +974,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         // 右上角圆心
         cornerX = rrects[i].x_ + rrects[i].w_ - radius;
         cornerY = rrects[i].y_ + radius;
-        vertexData.push_back(coordinateXToVulkan(cornerX));
-        vertexData.push_back(coordinateYToVulkan(cornerY));
-        vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        vertexData.push_back({makeVertexPos(cornerX, cornerY), color});
 
         // 细分并插入顶点坐标（右上角）
         baseRadians =  0;
@@ -525,12 +982,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
             double radians = baseRadians + incRadians * j; // 划分角度
             float x = cornerX + radius * static_cast<float>(cos(radians));
             float y = cornerY - radius * static_cast<float>(sin(radians));
-            vertexData.push_back(coordinateXToVulkan(x));
-            vertexData.push_back(coordinateYToVulkan(y));
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(paints[i].a_);
+            vertexData.push_back({makeVertexPos(x, y), color});
         }
 
         // 组织三角形
@@ -545,12 +997,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         // 左下角圆心
         cornerX = rrects[i].x_ + radius;
         cornerY = rrects[i].y_ + rrects[i].h_ - radius;
-        vertexData.push_back(coordinateXToVulkan(cornerX));
-        vertexData.push_back(coordinateYToVulkan(cornerY));
-        vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        vertexData.push_back({makeVertexPos(cornerX, cornerY), color});
 
         // 细分并插入顶点坐标（左上角）
         baseRadians =  1.0 * M_PI;
@@ -558,12 +1005,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
             double radians = baseRadians + incRadians * j; // 划分角度
             float x = cornerX + radius * static_cast<float>(cos(radians));
             float y = cornerY - radius * static_cast<float>(sin(radians));
-            vertexData.push_back(coordinateXToVulkan(x));
-            vertexData.push_back(coordinateYToVulkan(y));
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(paints[i].a_);
+            vertexData.push_back({makeVertexPos(x, y), color});
         }
 
         // 组织三角形
@@ -578,12 +1020,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         // 右下角圆心
         cornerX = rrects[i].x_ + rrects[i].w_ - radius;
         cornerY = rrects[i].y_ + rrects[i].h_ - radius;
-        vertexData.push_back(coordinateXToVulkan(cornerX));
-        vertexData.push_back(coordinateYToVulkan(cornerY));
-        vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        vertexData.push_back({makeVertexPos(cornerX, cornerY), color});
 
         // 细分并插入顶点坐标（左上角）
         baseRadians =  1.5 * M_PI;
@@ -591,12 +1028,7 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
             double radians = baseRadians + incRadians * j; // 划分角度
             float x = cornerX + radius * static_cast<float>(cos(radians));
             float y = cornerY - radius * static_cast<float>(sin(radians));
-            vertexData.push_back(coordinateXToVulkan(x));
-            vertexData.push_back(coordinateYToVulkan(y));
-            vertexData.push_back(paints[i].r_); // TODO: 暂时每个顶点都有颜色值
-            vertexData.push_back(paints[i].g_);
-            vertexData.push_back(paints[i].b_);
-            vertexData.push_back(paints[i].a_);
+            vertexData.push_back({makeVertexPos(x, y), color});
         }
 
         // 组织三角形
@@ -610,34 +1042,14 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
 
         // 插入三个长方形，从上到下
         // 插入顶点坐标
-        float left = coordinateXToVulkan(rrects[i].x_ + radius);
-        float top = coordinateYToVulkan(rrects[i].y_);
-        float right = coordinateXToVulkan(rrects[i].x_ + rrects[i].w_ - radius);
-        float bottom = coordinateYToVulkan(rrects[i].y_ + radius);
-        vertexData.push_back(left);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(right);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(right);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(left);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        float left = rrects[i].x_ + radius;
+        float top = rrects[i].y_;
+        float right = rrects[i].x_ + rrects[i].w_ - radius;
+        float bottom = rrects[i].y_ + radius;
+        vertexData.push_back({makeVertexPos(left, top), color});
+        vertexData.push_back({makeVertexPos(right, top), color});
+        vertexData.push_back({makeVertexPos(right, bottom), color});
+        vertexData.push_back({makeVertexPos(left, bottom), color});
 
         indexData.push_back(base);
         indexData.push_back(base + 1);
@@ -649,34 +1061,14 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         base += 4;
 
         // 插入顶点坐标
-        left = coordinateXToVulkan(rrects[i].x_);
-        top = coordinateYToVulkan(rrects[i].y_ + radius);
-        right = coordinateXToVulkan(rrects[i].x_ + rrects[i].w_);
-        bottom = coordinateYToVulkan(rrects[i].y_ + rrects[i].h_ - radius);
-        vertexData.push_back(left);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(right);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(right);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(left);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        left = rrects[i].x_;
+        top = rrects[i].y_ + radius;
+        right = rrects[i].x_ + rrects[i].w_;
+        bottom = rrects[i].y_ + rrects[i].h_ - radius;
+        vertexData.push_back({makeVertexPos(left, top), color});
+        vertexData.push_back({makeVertexPos(right, top), color});
+        vertexData.push_back({makeVertexPos(right, bottom), color});
+        vertexData.push_back({makeVertexPos(left, bottom), color});
 
         indexData.push_back(base);
         indexData.push_back(base + 1);
@@ -688,34 +1080,14 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
         base += 4;
 
         // 插入顶点坐标
-        left = coordinateXToVulkan(rrects[i].x_ + radius);
-        top = coordinateYToVulkan(rrects[i].y_ + rrects[i].h_ - radius);
-        right = coordinateXToVulkan(rrects[i].x_ + rrects[i].w_ - radius);
-        bottom = coordinateYToVulkan(rrects[i].y_ + rrects[i].h_);
-        vertexData.push_back(left);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(right);
-        vertexData.push_back(top);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(right);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
-        vertexData.push_back(left);
-        vertexData.push_back(bottom);
-        vertexData.push_back(paints[i].r_);
-        vertexData.push_back(paints[i].g_);
-        vertexData.push_back(paints[i].b_);
-        vertexData.push_back(paints[i].a_);
+        left = rrects[i].x_ + radius;
+        top = rrects[i].y_ + rrects[i].h_ - radius;
+        right = rrects[i].x_ + rrects[i].w_ - radius;
+        bottom = rrects[i].y_ + rrects[i].h_;
+        vertexData.push_back({makeVertexPos(left, top), color});
+        vertexData.push_back({makeVertexPos(right, top), color});
+        vertexData.push_back({makeVertexPos(right, bottom), color});
+        vertexData.push_back({makeVertexPos(left, bottom), color});
 
         indexData.push_back(base);
         indexData.push_back(base + 1);
@@ -728,29 +1100,15 @@ DrawResource Engine2D::drawRRects(std::vector<RRect> &rrects, std::vector<Paint>
     }
 
     // 创建VkBuffer
-    drawResource.vertexBufferInfo_ = vertexBufferManager_->allocBuffer(frameIndex_, sizeof(float) * vertexData.size());
-    void *data;
-    vkMapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_, 0, sizeof(float) * vertexData.size(),0, &data);
-    memcpy(data, vertexData.data(), sizeof(float) * vertexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.vertexBufferInfo_.bufferMemory_);
+    uploadVertexData(vertexData.data(), sizeof(ColorVertex) * vertexData.size(), &drawResource.vertexBufferInfo_, cacheable);
+    uploadIndexData(indexData, vertexData.size(), &drawResource, cacheable);
 
-    // 创建VkBuffer
-    drawResource.indexBufferInfo_ = indexBufferManager_->allocBuffer(frameIndex_, sizeof(uint32_t) * indexData.size());
-    vkMapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_, 0, sizeof(uint32_t) * indexData.size(),0, &data);
-    memcpy(data, indexData.data(), sizeof(uint32_t) * indexData.size());
-    vkUnmapMemory(deviceInfo_->device_, drawResource.indexBufferInfo_.bufferMemory_);
+    recordUpload(sizeof(ColorVertex) * vertexData.size(),
+                 sizeof(float) * LEGACY_RRECT_VERTEX_FLOATS * vertexData.size() + sizeof(uint32_t) * indexData.size());
 
-    drawResource.indexCount_ = indexData.size();
+    if (cacheable) {
+        geometryCache_->insert(geometryKey, drawResource);
+    }
 
     return drawResource;
 }
-
-
-
-float Engine2D::coordinateXToVulkan(float x) {
-    return x / static_cast<float>(swapchainInfo_->displaySize_.width) * 2.0f - 1.0f;
-}
-
-float Engine2D::coordinateYToVulkan(float y) {
-    return y / static_cast<float>(swapchainInfo_->displaySize_.height) * 2.0f - 1.0f;
-}
\ No newline at end of file
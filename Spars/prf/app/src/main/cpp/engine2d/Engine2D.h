@@ -6,12 +6,17 @@
 #define PRF_ENGINE2D_H
 
 #include "BufferManager.h"
+#include "GeometryCache.h"
+#include "TextureUploader.h"
 #include "PipelineManager.h"
 #include "ImageManager.h"
 #include "GlyphManager.h"
+#include "ResourcePrefetcher.h"
+#include "SamplerCache.h"
 #include "SamplerDescriptorManager.h"
 #include "DrawTask.h"
 #include "DrawResource.h"
+#include "VertexFormat.h"
 #include "paint/Paint.h"
 #include "rects/Rect.h"
 #include "circles/Circle.h"
@@ -20,17 +25,43 @@
 #include "../vulkan/utils.h"
 
 #include <game-activity/native_app_glue/android_native_app_glue.h>
+#include <atomic>
 #include <vector>
 
 /* 所有绘制接口类
  * 该类函数的调用位于工作线程 */
 class Engine2D {
 public:
-    static void init(android_app *androidAppCtx, VulkanDeviceInfo* deviceInfo, VulkanSwapchainInfo* swapchainInfo, VulkanRenderInfo* renderInfo); // 创建
+    // 创建，prefetcher可为空（不预取），diskCache可为空（不使用磁盘纹理缓存）
+    static void init(android_app *androidAppCtx, VulkanDeviceInfo* deviceInfo, VulkanSwapchainInfo* swapchainInfo, VulkanRenderInfo* renderInfo,
+                     ResourcePrefetcher *prefetcher = nullptr, TextureDiskCache *diskCache = nullptr);
     static void del(); // 删除
 
     static void resetFrame(uint32_t frameIndex); // 每帧开始时，重置上一次轮转的资源
 
+    /**
+     * 显示尺寸变化后调用（GPU与工作线程空闲）
+     * 几何为像素坐标、viewport为动态状态，缓存的几何与管线均与显示尺寸无关，无需处理
+     * @param rebuildAll 为true时清空几何缓存、管线与描述符，用于对比全部重建的开销
+     */
+    static void onResize(bool rebuildAll);
+
+    /**
+     * 提交工作线程在该帧录制的纹理上传（主线程在提交该帧之前调用）
+     * @return 该帧渲染需等待的信号量，没有上传时为VK_NULL_HANDLE
+     */
+    static VkSemaphore submitUploads();
+    // 渲染队列的提交锁：没有独立的transfer队列时，阻塞模式的纹理上传在工作线程中向同一VkQueue提交
+    static std::mutex &queueMutex();
+    static void dumpUploadStats(); // 打印纹理上传统计
+    static void dumpTextureCacheStats(); // 打印纹理与字体atlas缓存的命中、淘汰统计，以及纹理显存分配数、采样器数与descriptor数
+    static void dumpInFlightStats(); // 打印各Manager等待其他任务创建资源的次数、阻塞时间与创建失败次数（冷启动时集中发生）
+    // 每种管线一个线程并行创建（运行时会用到的5种），与绘制时的创建走同一路径，已创建或正在创建的不会重复创建
+    static void prewarmPipelines();
+
+    // 写入工作线程新建的描述符集（BATCH_DESCRIPTOR_UPDATES），主线程录制绑定描述符集之前调用
+    static void flushDescriptorWrites();
+
     /**
      * 绘制一系列的长方形
      * @param rects 长方形信息
@@ -55,6 +86,17 @@ public:
     */
     static DrawResource drawImage(Image &image, Paint &paint);
 
+    /**
+    * 绘制一系列位于同一atlas页的图片（一次draw call）
+    * @param images 图片信息，生成任务时均驻留在同一atlas页（由getImageAtlasPage保证），之后不在该页上的图片本帧跳过
+    * @param paint 绘制样式
+    * @return 已生成的资源
+    */
+    static DrawResource drawImages(std::vector<Image> &images, Paint &paint);
+
+    // 图片所在的atlas页（生成DrawTask时调用），未驻留、未上传完成或不在atlas中时返回-1，此时不可与其他图片合批
+    static int32_t getImageAtlasPage(Image &image);
+
     /**
      * 绘制一系列的文本
      * @param texts 文本信息
@@ -71,6 +113,17 @@ public:
      */
     static DrawResource drawRRects(std::vector<RRect> &rrects, std::vector<Paint> &paints);
 
+    // 设置绘制资源的变换，x和y为几何原点的屏幕像素坐标；像素到NDC的转换在vertex shader中完成
+    static void setTranslate(int32_t x, int32_t y, DrawResource *drawResource);
+
+    // 记录工作线程执行一个绘制任务的CPU时间（GEOMETRY_CACHE_STATS）
+    static void recordDrawTime(uint64_t ns);
+
+    // 开关文本排版缓存（默认为TEXT_LAYOUT_CACHE，工作线程空闲时调用）
+    static void setTextLayoutCache(bool enabled);
+    // 返回并清零工作线程绘制文本（排版、生成顶点与上传）的累计CPU时间（TEXT_LAYOUT_BENCHMARK）
+    static uint64_t takeTextDrawTime();
+
 private:
     static uint32_t frameIndex_; // 当前正在绘制的轮转帧
 
@@ -79,9 +132,22 @@ private:
     static BufferManager *vertexBufferManager_;
     static BufferManager *indexBufferManager_;
 
+    /* 所有矩形、图片、文字批次共享的静态quad index buffer（UINT16），init时生成 */
+    static const uint32_t MAX_SHARED_QUAD_COUNT = 16384; // 65536个顶点，UINT16索引的上限
+    static VulkanBufferInfo quadIndexBufferInfo_;
+
+    /* 跨帧几何缓存，GEOMETRY_CACHE为0时为nullptr */
+    static GeometryCache *geometryCache_;
+
     /* 管理系统全局所有的VkPipeline */
     static PipelineManager *pipelineManager_;
 
+    /* 按采样状态去重的采样器，ImageManager、GlyphManager与管线的immutable sampler共用 */
+    static SamplerCache *samplerCache_;
+
+    /* 纹理上传服务，ImageManager与GlyphManager共用 */
+    static TextureUploader *textureUploader_;
+
     /* 管理系统全局所有的VkImage */
     static ImageManager *imageManager_;
     static GlyphManager *glyphManager_;
@@ -95,9 +161,49 @@ private:
     static VulkanSwapchainInfo *swapchainInfo_;
     static VulkanRenderInfo *renderInfo_;
 
-    // 将屏幕像素坐标转换为vulkan[-1,1]坐标
-    static float coordinateXToVulkan(float x);
-    static float coordinateYToVulkan(float y);
+    /* 上传字节数统计（UPLOAD_STATS），由工作线程累加，resetFrame时打印 */
+    static std::atomic<uint64_t> uploadBytes_; // 当前格式实际上传的字节数
+    static std::atomic<uint64_t> legacyUploadBytes_; // 若使用旧格式（float颜色+UINT32索引）需上传的字节数
+    static uint64_t statsFrameCount_;
+    static uint64_t statsUploadBytes_;
+    static uint64_t statsLegacyUploadBytes_;
+
+    /* 工作线程绘制CPU时间统计（GEOMETRY_CACHE_STATS） */
+    static std::atomic<uint64_t> drawTimeNs_;
+    static uint64_t statsDrawTimeNs_;
+
+    /* draw call统计（TEXTURE_CACHE_STATS），每个DrawTask对应一次draw call，由工作线程累加，resetFrame时定期打印 */
+    static std::atomic<uint64_t> drawCallCount_;
+    static std::atomic<uint64_t> imageDrawCallCount_;
+    static std::atomic<uint64_t> imageCount_;
+    static std::atomic<uint64_t> textDrawCallCount_;
+    static std::atomic<uint64_t> textCount_;
+    static uint64_t statsDrawCallFrameCount_;
+
+    /* 文本排版缓存：为true时使用GlyphManager缓存的字符串排版，否则每次逐字符查找字形并排版 */
+    static bool textLayoutCache_;
+    static std::atomic<uint64_t> textDrawTimeNs_; // TEXT_LAYOUT_BENCHMARK
+
+    // findPipeline返回false之后创建管线（写入pipelineInfo）并插入，创建失败时通知等待该管线的任务后重新抛出
+    static void createPipeline(uint32_t key, VulkanPipelineInfo *pipelineInfo);
+    // 按key创建管线对象（使用renderInfo中的管线缓存），不插入PipelineManager
+    static void buildPipeline(uint32_t key, VulkanPipelineInfo *pipelineInfo);
+    // 为采样该纹理的绘制填写descriptor：启用push descriptor时记录纹理，否则查找或创建描述符集（layout为drawResource的管线的）
+    static void useSamplerDescriptor(VulkanImageInfo &imageInfo, DrawResource *drawResource);
+    // 管线描述符布局的immutable sampler：IMMUTABLE_SAMPLERS为0时返回VK_NULL_HANDLE（采样器由descriptor提供）
+    static VkSampler getImmutableSampler(const SamplerState &state);
+    // 将数据拷贝到一个该帧的vertex buffer中，persistent为true时申请不随帧回收的段（用于几何缓存）
+    static void uploadVertexData(const void *data, uint64_t size, VulkanBufferInfo *bufferInfo, bool persistent = false);
+    // 将索引拷贝到一个该帧的index buffer中，vertexCount不超过65536时压缩为UINT16
+    static void uploadIndexData(const std::vector<uint32_t> &indexData, uint32_t vertexCount, DrawResource *drawResource, bool persistent = false);
+    // quadCount个四边形（每个4个顶点）使用共享的quad index buffer，超出上限时退回生成索引
+    static void useQuadIndices(uint32_t quadCount, DrawResource *drawResource, bool persistent = false);
+    // 图片已就绪后生成绘制资源，所有图片需采样同一张纹理（同一atlas页）
+    static DrawResource drawImageQuads(std::vector<Image> &images, std::vector<VulkanImageInfo> &imageInfos);
+    // 记录一次绘制的上传字节数
+    static void recordUpload(uint64_t bytes, uint64_t legacyBytes);
+    // 记录一次draw call及其中的图片数或文本数
+    static void recordDrawCall(uint64_t imageCount, uint64_t textCount);
 };
 
 
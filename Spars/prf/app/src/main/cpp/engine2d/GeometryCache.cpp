@@ -0,0 +1,257 @@
+#include "GeometryCache.h"
+#include "GlyphManager.h"
+#include "../log.h"
+
+#include <algorithm>
+
+// 将POD数据按字节追加到key中
+template<typename T>
+static void appendToKey(std::string &key, const T &value) {
+    key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+static void appendPaintsToKey(std::string &key, std::vector<Paint> &paints) {
+    for (Paint &paint : paints) {
+        appendToKey(key, paint.r_);
+        appendToKey(key, paint.g_);
+        appendToKey(key, paint.b_);
+        appendToKey(key, paint.a_);
+    }
+}
+
+GeometryCache::GeometryCache(BufferManager *vertexBufferManager, BufferManager *indexBufferManager, uint64_t budgetBytes) {
+    vertexBufferManager_ = vertexBufferManager;
+    indexBufferManager_ = indexBufferManager;
+    budgetBytes_ = budgetBytes;
+}
+
+GeometryCache::~GeometryCache() {
+    clear();
+}
+
+std::string GeometryCache::makeKey(uint32_t pipelineKey, std::vector<Rect> &rects, std::vector<Paint> &paints) {
+    std::string key;
+    key.reserve(sizeof(uint32_t) + rects.size() * (sizeof(Rect) + sizeof(Paint)));
+    appendToKey(key, pipelineKey);
+    for (Rect &rect : rects) {
+        appendToKey(key, rect.x_);
+        appendToKey(key, rect.y_);
+        appendToKey(key, rect.w_);
+        appendToKey(key, rect.h_);
+    }
+    appendPaintsToKey(key, paints);
+    return key;
+}
+
+std::string GeometryCache::makeKey(uint32_t pipelineKey, std::vector<Circle> &circles, std::vector<Paint> &paints) {
+    std::string key;
+    key.reserve(sizeof(uint32_t) + circles.size() * (sizeof(Circle) + sizeof(Paint)));
+    appendToKey(key, pipelineKey);
+    for (Circle &circle : circles) {
+        appendToKey(key, circle.x_);
+        appendToKey(key, circle.y_);
+        appendToKey(key, circle.r_);
+    }
+    appendPaintsToKey(key, paints);
+    return key;
+}
+
+std::string GeometryCache::makeKey(uint32_t pipelineKey, std::vector<RRect> &rrects, std::vector<Paint> &paints) {
+    std::string key;
+    key.reserve(sizeof(uint32_t) + rrects.size() * (sizeof(RRect) + sizeof(Paint)));
+    appendToKey(key, pipelineKey);
+    for (RRect &rrect : rrects) {
+        appendToKey(key, rrect.x_);
+        appendToKey(key, rrect.y_);
+        appendToKey(key, rrect.w_);
+        appendToKey(key, rrect.h_);
+        appendToKey(key, rrect.r_);
+    }
+    appendPaintsToKey(key, paints);
+    return key;
+}
+
+static void appendTextToKey(std::string &key, const Text &text) {
+    // 字形度量由字体和大小决定，二者相同且字形在atlas中的位置未变时生成的几何相同
+    appendToKey(key, text.x_);
+    appendToKey(key, text.y_);
+    appendToKey(key, text.pixelHeight_);
+    appendToKey(key, static_cast<uint32_t>(text.str_.size()));
+    key.append(text.str_);
+    appendToKey(key, static_cast<uint32_t>(text.fontPath_.size()));
+    key.append(text.fontPath_);
+}
+
+std::string GeometryCache::makeKey(uint32_t pipelineKey, std::vector<Text> &texts, std::vector<Paint> &paints,
+                                   uint64_t strikeId, uint64_t generation) {
+    std::string key;
+    appendToKey(key, pipelineKey);
+    appendToKey(key, strikeId);
+    appendToKey(key, generation);
+    for (Text &text : texts) {
+        appendTextToKey(key, text);
+    }
+    appendPaintsToKey(key, paints);
+    return key;
+}
+
+std::string GeometryCache::makeKey(uint32_t pipelineKey, std::vector<Text> &texts, std::vector<Paint> &paints,
+                                   uint64_t strikeId, const std::vector<std::shared_ptr<const TextRun>> &runs) {
+    std::string key;
+    appendToKey(key, pipelineKey);
+    appendToKey(key, strikeId);
+    for (size_t i = 0; i < texts.size(); i++) {
+        appendToKey(key, runs[i]->id_);
+        appendTextToKey(key, texts[i]);
+    }
+    appendPaintsToKey(key, paints);
+    return key;
+}
+
+std::string GeometryCache::makeKey(uint32_t pipelineKey, std::vector<Image> &images, std::vector<VulkanImageInfo> &imageInfos) {
+    // 几何由矩形与纹理坐标决定（atlas中的图片被淘汰后重新放入时，纹理坐标可能改变）
+    std::string key;
+    key.reserve(sizeof(uint32_t) + images.size() * 8 * sizeof(float));
+    appendToKey(key, pipelineKey);
+    for (size_t i = 0; i < images.size(); i++) {
+        appendToKey(key, images[i].rect_.x_);
+        appendToKey(key, images[i].rect_.y_);
+        appendToKey(key, images[i].rect_.w_);
+        appendToKey(key, images[i].rect_.h_);
+        appendToKey(key, imageInfos[i].uvLeft_);
+        appendToKey(key, imageInfos[i].uvTop_);
+        appendToKey(key, imageInfos[i].uvRight_);
+        appendToKey(key, imageInfos[i].uvBottom_);
+    }
+    return key;
+}
+
+bool GeometryCache::find(const std::string &key, DrawResource *drawResource, bool *cacheable) {
+    {
+        std::shared_lock<std::shared_mutex> locker(mutex_); // 读取操作使用shared_lock
+        auto iter = entryMap_.find(key);
+        if (iter != entryMap_.end()) {
+            Entry &entry = iter->second;
+            drawResource->vertexBufferInfo_ = entry.vertexBufferInfo_;
+            drawResource->indexBufferInfo_ = entry.indexBufferInfo_;
+            drawResource->indexType_ = entry.indexType_;
+            drawResource->indexCount_ = entry.indexCount_;
+            entry.lastUsedFrame_.store(frameCounter_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            hitCount_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    missCount_.fetch_add(1, std::memory_order_relaxed);
+
+    // 未命中：第一次出现的key只登记，再次出现时才缓存
+    std::size_t hash = std::hash<std::string>()(key);
+    std::unique_lock<std::mutex> locker(doorkeeperMutex_);
+    *cacheable = doorkeeper_.erase(hash) > 0;
+    if (!*cacheable) {
+        if (doorkeeper_.size() >= DOORKEEPER_MAX_SIZE) {
+            doorkeeper_.clear();
+        }
+        doorkeeper_.insert(hash);
+    }
+    return false;
+}
+
+void GeometryCache::insert(const std::string &key, const DrawResource &drawResource) {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    auto result = entryMap_.try_emplace(key);
+    if (!result.second) {
+        // 其他任务已插入相同的key，本次的段可能已被录制到命令中，帧结束后再归还
+        pendingFreeList_.emplace_back(drawResource.vertexBufferInfo_, drawResource.indexBufferInfo_);
+        return;
+    }
+
+    Entry &entry = result.first->second;
+    entry.vertexBufferInfo_ = drawResource.vertexBufferInfo_;
+    entry.indexBufferInfo_ = drawResource.indexBufferInfo_;
+    entry.indexType_ = drawResource.indexType_;
+    entry.indexCount_ = drawResource.indexCount_;
+    entry.bytes_ = entry.vertexBufferInfo_.size_ + (entry.indexBufferInfo_.blockId_ != 0 ? entry.indexBufferInfo_.size_ : 0);
+    entry.lastUsedFrame_.store(frameCounter_.load());
+    bytes_ += entry.bytes_;
+    insertCount_++;
+}
+
+void GeometryCache::endFrame() {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    frameCounter_.fetch_add(1);
+
+    for (auto &buffers : pendingFreeList_) {
+        releaseBuffers(buffers.first, buffers.second);
+    }
+    pendingFreeList_.clear();
+
+    if (bytes_ <= budgetBytes_) {
+        return;
+    }
+
+    // 超出预算：按最近使用的帧从旧到新淘汰，直到回到预算内
+    std::vector<std::pair<uint64_t, std::unordered_map<std::string, Entry>::iterator>> candidates;
+    candidates.reserve(entryMap_.size());
+    for (auto iter = entryMap_.begin(); iter != entryMap_.end(); iter++) {
+        candidates.emplace_back(iter->second.lastUsedFrame_.load(), iter);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto &a, const auto &b) {
+        return a.first < b.first;
+    });
+    for (auto &candidate : candidates) {
+        if (bytes_ <= budgetBytes_) {
+            break;
+        }
+        Entry &entry = candidate.second->second;
+        releaseBuffers(entry.vertexBufferInfo_, entry.indexBufferInfo_);
+        bytes_ -= entry.bytes_;
+        evictCount_++;
+        entryMap_.erase(candidate.second);
+    }
+}
+
+void GeometryCache::clear() {
+    {
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        for (auto iter = entryMap_.begin(); iter != entryMap_.end(); iter++) {
+            releaseBuffers(iter->second.vertexBufferInfo_, iter->second.indexBufferInfo_);
+        }
+        entryMap_.clear();
+        bytes_ = 0;
+        for (auto &buffers : pendingFreeList_) {
+            releaseBuffers(buffers.first, buffers.second);
+        }
+        pendingFreeList_.clear();
+    }
+    std::lock_guard<std::mutex> locker(doorkeeperMutex_);
+    doorkeeper_.clear();
+}
+
+void GeometryCache::releaseBuffers(const VulkanBufferInfo &vertexBufferInfo, const VulkanBufferInfo &indexBufferInfo) {
+    vertexBufferManager_->freePersistentBuffer(vertexBufferInfo);
+    if (indexBufferInfo.blockId_ != 0) {
+        indexBufferManager_->freePersistentBuffer(indexBufferInfo);
+    }
+}
+
+GeometryCacheStats GeometryCache::getStats() {
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    GeometryCacheStats stats;
+    stats.entryCount_ = entryMap_.size();
+    stats.bytes_ = bytes_;
+    stats.hitCount_ = hitCount_.load();
+    stats.missCount_ = missCount_.load();
+    stats.insertCount_ = insertCount_;
+    stats.evictCount_ = evictCount_;
+    return stats;
+}
+
+void GeometryCache::dump() {
+    GeometryCacheStats stats = getStats();
+    uint64_t lookups = stats.hitCount_ + stats.missCount_;
+    LOGI("geometry cache: %llu entries, %llu/%llu bytes, hit rate %.1f%% (%llu/%llu), inserts %llu, evictions %llu",
+         (unsigned long long) stats.entryCount_, (unsigned long long) stats.bytes_, (unsigned long long) budgetBytes_,
+         lookups == 0 ? 0.0 : 100.0 * (double) stats.hitCount_ / (double) lookups,
+         (unsigned long long) stats.hitCount_, (unsigned long long) lookups,
+         (unsigned long long) stats.insertCount_, (unsigned long long) stats.evictCount_);
+}
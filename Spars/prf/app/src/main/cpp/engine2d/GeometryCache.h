@@ -0,0 +1,111 @@
+#ifndef PRF_GEOMETRYCACHE_H
+#define PRF_GEOMETRYCACHE_H
+
+#include <vulkan_wrapper.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "BufferManager.h"
+#include "DrawResource.h"
+#include "paint/Paint.h"
+#include "rects/Rect.h"
+#include "circles/Circle.h"
+#include "image/Image.h"
+#include "text/Text.h"
+#include "rrects/RRect.h"
+
+struct TextRun; // GlyphManager.h
+
+// 几何缓存统计信息
+struct GeometryCacheStats {
+    uint64_t entryCount_ = 0;
+    uint64_t bytes_ = 0; // 所有条目占用的vertex/index段大小
+    uint64_t hitCount_ = 0;
+    uint64_t missCount_ = 0;
+    uint64_t insertCount_ = 0;
+    uint64_t evictCount_ = 0;
+};
+
+/*
+ * 跨帧的几何缓存：以DrawTask的内容（图元与paint）为key，缓存生成好的vertex/index段
+ * 命中时工作线程跳过顶点生成与上传，直接使用缓存的段
+ * 缓存的段通过BufferManager::allocPersistentBuffer申请，不随帧轮转；
+ * 淘汰与释放只在endFrame（resetFrame，此时GPU空闲、工作线程空闲）中进行，帧内只增不减
+ * 顶点为相对变换节点的像素坐标，NDC转换在vertex shader中完成，因此显示尺寸变化时缓存仍然有效
+ */
+class GeometryCache {
+public:
+    GeometryCache(BufferManager *vertexBufferManager, BufferManager *indexBufferManager, uint64_t budgetBytes);
+    ~GeometryCache(); // 归还所有段
+
+    // 生成key，pipelineKey区分不同的图元类型
+    static std::string makeKey(uint32_t pipelineKey, std::vector<Rect> &rects, std::vector<Paint> &paints);
+    static std::string makeKey(uint32_t pipelineKey, std::vector<Circle> &circles, std::vector<Paint> &paints);
+    static std::string makeKey(uint32_t pipelineKey, std::vector<RRect> &rrects, std::vector<Paint> &paints);
+    // strikeId与generation为字形缓存的strike及其版本号（字形被淘汰或strike重建后，顶点中的纹理坐标失效）
+    static std::string makeKey(uint32_t pipelineKey, std::vector<Text> &texts, std::vector<Paint> &paints,
+                               uint64_t strikeId, uint64_t generation);
+    // 使用缓存的排版时以各文本排版的id代替版本号：只有引用了被淘汰字形的排版重建后，包含它的几何才失效
+    static std::string makeKey(uint32_t pipelineKey, std::vector<Text> &texts, std::vector<Paint> &paints,
+                               uint64_t strikeId, const std::vector<std::shared_ptr<const TextRun>> &runs);
+    static std::string makeKey(uint32_t pipelineKey, std::vector<Image> &images, std::vector<VulkanImageInfo> &imageInfos);
+
+    /**
+     * 查找缓存的几何数据：
+     *  若有：      将vertex/index段写入drawResource，返回true
+     *  若没有：    返回false，cacheable表示该key是否值得缓存（第二次出现才缓存，避免只出现一次的几何占满缓存）
+     */
+    bool find(const std::string &key, DrawResource *drawResource, bool *cacheable);
+
+    // 插入缓存，drawResource中的段需由allocPersistentBuffer申请（共享的quad index buffer除外）
+    void insert(const std::string &key, const DrawResource &drawResource);
+
+    // 每帧开始时调用（工作线程空闲、GPU空闲）：推进帧序号，按LRU淘汰超出预算的条目，释放延迟归还的段
+    void endFrame();
+
+    // 清空所有条目（仅用于对比resize时全部重建的开销），调用条件与endFrame相同
+    void clear();
+
+    GeometryCacheStats getStats();
+    void dump(); // 以log的形式打印 for debug
+
+private:
+    struct Entry {
+        VulkanBufferInfo vertexBufferInfo_;
+        VulkanBufferInfo indexBufferInfo_; // blockId_为0表示不属于缓存的buffer（共享的quad index buffer），不由缓存归还
+        VkIndexType indexType_;
+        uint32_t indexCount_;
+        uint64_t bytes_;
+        std::atomic<uint64_t> lastUsedFrame_{0}; // 命中时在共享锁下更新，淘汰时按此近似LRU
+    };
+
+    BufferManager *vertexBufferManager_;
+    BufferManager *indexBufferManager_;
+    uint64_t budgetBytes_;
+
+    std::shared_mutex mutex_; // 保护下面的map和列表，查找使用共享锁
+    std::unordered_map<std::string, Entry> entryMap_;
+    std::vector<std::pair<VulkanBufferInfo, VulkanBufferInfo>> pendingFreeList_; // 并发插入了相同key时多出的vertex/index段，等到endFrame再归还
+    uint64_t bytes_ = 0;
+
+    std::mutex doorkeeperMutex_;
+    std::unordered_set<std::size_t> doorkeeper_; // 见过一次的key的哈希
+    const size_t DOORKEEPER_MAX_SIZE = 16384; // 超过后清空
+
+    std::atomic<uint64_t> frameCounter_{0};
+    std::atomic<uint64_t> hitCount_{0};
+    std::atomic<uint64_t> missCount_{0};
+    uint64_t insertCount_ = 0;
+    uint64_t evictCount_ = 0;
+
+    void releaseBuffers(const VulkanBufferInfo &vertexBufferInfo, const VulkanBufferInfo &indexBufferInfo); // 归还一个条目的段
+};
+
+
+#endif //PRF_GEOMETRYCACHE_H
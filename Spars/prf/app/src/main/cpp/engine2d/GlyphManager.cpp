@@ -5,18 +5,88 @@
 #include "GlyphManager.h"
 #include "../log.h"
 
-#include "stb_image.h"
-
 #include "PipelineManager.h"
+#include "ResourcePrefetcher.h"
+#include "SamplerDescriptorManager.h"
+#include "TextureAtlas.h"
 #include "../vulkan/utils.h"
+#include "../config.h"
 
 #include <stdexcept>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_set>
 #include <android/trace.h>
 
-// 使用freetype
-#include "ft2build.h"
-#include FT_FREETYPE_H
+struct CachedRun;
+
+// 缓存在atlas页中的一个字形
+struct CachedGlyph {
+    AtlasRegion region_; // 含1像素透明边框的区域，没有位图的字形page_为-1
+    GlyphMetrics metrics_;
+    uint64_t lastUsedFrame_ = 0;
+    std::vector<CachedRun *> runs_; // 引用该字形的排版（反向索引），淘汰该字形时删除这些排版
+};
+
+// 缓存的一个字符串的排版
+struct CachedRun {
+    std::string str_;
+    std::shared_ptr<const TextRun> run_;
+    std::vector<CachedGlyph *> glyphs_; // 排版用到的字形（去重，map节点的地址在淘汰前不变），命中时标记为本帧使用
+    uint64_t lastUsedFrame_ = 0;
+};
+
+// 一种字体大小的字形缓存：一张atlas页，下面的map与计数受mutex_保护
+struct GlyphStrike {
+    std::mutex mutex_; // 同一strike的查找、分配与淘汰互斥（光栅化不持锁）
+    std::string fontPath_;
+    float pixelHeight_ = 0.0f;
+    uint32_t sdfSpread_ = 0; // 不为0时为距离场strike
+    TextureAtlas *atlas_ = nullptr; // 只有一页
+    uint32_t pageSize_ = 0;
+    std::unordered_map<uint32_t, uint32_t> glyphIndexMap_; // codepoint -> 字形id
+    std::unordered_map<uint32_t, CachedGlyph> glyphMap_;   // 字形id -> 缓存的字形
+    std::list<CachedRun> runList_; // 缓存的排版，按最近使用从新到旧
+    std::unordered_map<std::string, std::list<CachedRun>::iterator> runMap_; // 字符串 -> 排版
+    uint64_t nextRunId_ = 1;
+    uint64_t generation_ = 0; // 淘汰字形时递增（逐字符查找的路径以此使几何缓存失效）
+    uint64_t lastUploadTicket_ = 0; // 最近一次区域上传的ticket，strike在其完成后才能销毁
+    uint64_t usedPixels_ = 0;
+    bool reportedFull_ = false; // 只报告一次atlas页已满
+};
+
+static uint64_t nowNs_helper() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 记录条目在本帧被使用，已记录时不再写（避免各工作线程反复写同一缓存行）
+static void markUsed_helper(std::atomic<uint64_t> &lastUsedFrame, uint64_t frame) {
+    if (lastUsedFrame.load(std::memory_order_relaxed) != frame) {
+        lastUsedFrame.store(frame, std::memory_order_relaxed);
+    }
+}
+
+// 删除一个缓存的排版，并将其从所引用字形的反向索引中移除（skip为正在淘汰的字形，其反向索引由调用者清空）
+static void eraseRun_helper(GlyphStrike &strike, CachedRun *run, const CachedGlyph *skip) {
+    for (CachedGlyph *glyph : run->glyphs_) {
+        if (glyph == skip) {
+            continue;
+        }
+        auto found = std::find(glyph->runs_.begin(), glyph->runs_.end(), run);
+        if (found != glyph->runs_.end()) {
+            *found = glyph->runs_.back();
+            glyph->runs_.pop_back();
+        }
+    }
+    auto iter = strike.runMap_.find(run->str_);
+    strike.runList_.erase(iter->second);
+    strike.runMap_.erase(iter);
+}
 
 std::size_t TextHash::operator()(const Text& obj) const {
     std::size_t h1 = std::hash<std::string>()(obj.fontPath_);
@@ -26,515 +96,590 @@ std::size_t TextHash::operator()(const Text& obj) const {
     return h1 ^ (h2 << 1); // 使用位移和异或来混合哈希值
 }
 
-GlyphManager::GlyphManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue) {
+Text GlyphManager::makeStrikeKey(const Text &text) {
+    // SDF时同一字体的所有字号共用基准字号的距离场strike
+    return Text::MakeText(0, 0, SDF_TEXT ? SDF_BASE_PIXEL_HEIGHT : text.pixelHeight_, "", text.fontPath_);
+}
+
+GlyphManager::GlyphManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader,
+                           SamplerCache *samplerCache, uint64_t budgetBytes, uint32_t rasterizerThreads) {
     app_ = app;
     device_ = device;
     physicalDevice_ = physicalDevice;
-    commandPool_ = commandPool;
-    graphicsQueue_ = graphicsQueue;
+    textureUploader_ = textureUploader;
+    samplerCache_ = samplerCache;
+    budgetBytes_ = budgetBytes;
+    rasterizer_ = new GlyphRasterizer(rasterizerThreads);
 }
 
 GlyphManager::~GlyphManager() {
     std::unique_lock<std::shared_mutex> locker(mutex_);
     for(auto iter = fontMap_.begin(); iter != fontMap_.end(); iter++) {
-        free(iter->second.glyphTop_);
-        free(iter->second.glyphRight_);
-        free(iter->second.glyphBottom_);
-        free(iter->second.glyphLeftOffsets_);
-        free(iter->second.glyphTopOffsets_);
-
-        VulkanImageInfo imageInfo = iter->second.atlasInfo_;
-
-        // 销毁采样器 TODO: 后续和image解耦开
-        vkDestroySampler(device_, imageInfo.textureSampler_, nullptr);
-        // 销毁纹理图像
-        vkDestroyImageView(device_, imageInfo.textureImageView_, nullptr);
-        vkDestroyImage(device_, imageInfo.textureImage_, nullptr);
-        vkFreeMemory(device_, imageInfo.textureImageMemory_, nullptr);
-
+        destroyGlyphInfo(iter->second.glyphInfo_);
+    }
+    for (PendingDestroyGlyph &pending : pendingDestroyList_) {
+        destroyGlyphInfo(pending.glyphInfo_);
     }
+    delete rasterizer_;
+}
+
+void GlyphManager::destroyGlyphInfo(GlyphInfo &glyphInfo) {
+    GlyphStrike *strike = glyphInfo.strike_;
+    delete strike->atlas_; // 页的图像、视图与采样器由atlas销毁
+    delete strike;
+    glyphInfo.strike_ = nullptr;
 }
 
 bool GlyphManager::findTextTmageInfo(Text &text, GlyphInfo *glyphInfo) {
+    // 已创建的strike在快照中无锁查找
+    if (GlyphEntry *const *found = snapshot_.find(text)) {
+        *glyphInfo = (*found)->glyphInfo_;
+        markUsed_helper((*found)->lastUsedFrame_, frameCounter_.load(std::memory_order_relaxed));
+        hitCount_.add(1);
+        return true;
+    }
+
+    std::shared_future<void> pending;
     {
-        std::shared_lock<std::shared_mutex> locker(mutex_);
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        // 可能在快照查找之后刚创建完成
         auto iter = fontMap_.find(text);
         if (iter != fontMap_.end()) {
-            *glyphInfo = iter->second;
+            *glyphInfo = iter->second.glyphInfo_;
+            markUsed_helper(iter->second.lastUsedFrame_, frameCounter_.load(std::memory_order_relaxed));
+            hitCount_.add(1);
             return true;
         }
-    }
-    {
-        std::unique_lock<std::shared_mutex> locker(mutex_);
         // 未找到，判断是否有其他线程正在创建
-        auto iter2 = preparingMap_.find(text);
-        if (iter2 != preparingMap_.end()) { // 其他线程正在创建
-            cv_.wait(locker, [this, &text] {
-                return preparingMap_.find(text) == preparingMap_.end(); // 该资源已经不在准备列表中了
-            });
-
-            // 其他线程创建完毕了
-            auto iter3 = fontMap_.find(text);
-            if (iter3 != fontMap_.end()) {
-                *glyphInfo = iter3->second;
-                return true;
-            }
-            // 此处不应该走到
-            throw std::runtime_error("GlyphManager::findTextImageInfo error!");
-            return false;
-        } else {
+        if (!inFlight_.joinOrStart(text, &pending)) {
             // 我们是第一个创建的
-            preparingMap_[text] = true; // 将该资源加入准备列表，这个true不重要
+            missCount_.fetch_add(1, std::memory_order_relaxed);
             return false; // 需要我们后续创建
         }
-
     }
-}
 
-void GlyphManager::createAndInsertTextImageInfo(Text &text, GlyphInfo *glyphInfo) {
-    *glyphInfo = createFontImageInfo(text); // 解压过程很长，无需锁保护
+    // 其他线程正在创建，在锁外等待（只在该strike完成时被唤醒），创建失败时此处抛出其异常
+    inFlight_.wait(pending);
 
-    std::unique_lock<std::shared_mutex> locker(mutex_);
-    fontMap_[text] = *glyphInfo;
+    // 其他线程创建完毕了（条目只在endFrame中删除，此时仍在）
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    auto iter = fontMap_.find(text);
+    if (iter != fontMap_.end()) {
+        *glyphInfo = iter->second.glyphInfo_;
+        hitCount_.add(1);
+        return true;
+    }
+    // 此处不应该走到
+    throw std::runtime_error("GlyphManager::findTextImageInfo error!");
+}
 
-    // 资源创建完成，从准备列表移除
-    preparingMap_.erase(text);
-    cv_.notify_all(); // 此唤醒会导致所有任务唤醒，尽管有些任务在等待其他资源创建完成
+void GlyphManager::setPrefetcher(ResourcePrefetcher *prefetcher) {
+    prefetcher_ = prefetcher;
 }
 
-// ================================== 以下为一些辅助函数 ==================================
-/**
- * 查找合适的显存类型
- */
-static uint32_t findMemoryType_helper(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
+void GlyphManager::endFrame(SamplerDescriptorManager *samplerDescriptorManager) {
+    uint64_t frame = frameCounter_.fetch_add(1, std::memory_order_relaxed) + 1;
 
-    // 物理设备可用的内存类型
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    snapshot_.reclaim(); // 工作线程空闲，上一帧发布的旧快照不再被读取
 
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-    {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-        {
-            return i;
+    // 销毁到期的已淘汰strike：GPU不再使用，且其所有字形的上传已完成（工作线程空闲，无需strike的锁）
+    auto pendingEnd = std::remove_if(pendingDestroyList_.begin(), pendingDestroyList_.end(),
+                                     [this, frame, samplerDescriptorManager](PendingDestroyGlyph &pending) {
+        if (frame < pending.evictFrame_ + DESTROY_DELAY_FRAMES || !textureUploader_->isComplete(pending.glyphInfo_.strike_->lastUploadTicket_)) {
+            return false;
         }
+        samplerDescriptorManager->releaseSamplerDescriptor(pending.glyphInfo_.atlasInfo_.textureImageView_);
+        destroyGlyphInfo(pending.glyphInfo_);
+        return true;
+    });
+    pendingDestroyList_.erase(pendingEnd, pendingDestroyList_.end());
+
+    if (bytes_ <= budgetBytes_) {
+        return;
     }
 
-    throw std::runtime_error("failed to find suitable memory type!");
-}
-
-
-/**
- * 创建缓冲的辅助函数
- * 可以使用不同的大小、usage、properties
- */
-static void createBuffer_helper(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size,
-                                VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory)
-{
-    VkBufferCreateInfo bufferInfo = {};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create buffer!");
+    // 超出预算，按最近使用的帧从旧到新淘汰整个strike，上一帧用过的不淘汰
+    std::vector<std::pair<uint64_t, const Text *>> candidates;
+    for (auto &iter : fontMap_) {
+        uint64_t lastUsed = iter.second.lastUsedFrame_.load(std::memory_order_relaxed);
+        if (lastUsed + 1 < frame) {
+            candidates.emplace_back(lastUsed, &iter.first);
+        }
     }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType_helper(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate buffer memory!");
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<uint64_t, const Text *> &a, const std::pair<uint64_t, const Text *> &b) {
+        return a.first < b.first;
+    });
+    std::vector<Text> evicted;
+    for (auto &candidate : candidates) {
+        if (bytes_ <= budgetBytes_) {
+            break;
+        }
+        auto iter = fontMap_.find(*candidate.second);
+        bytes_ -= iter->second.glyphInfo_.atlasInfo_.bytes_;
+        pendingDestroyList_.push_back({iter->second.glyphInfo_, frame});
+        evicted.push_back(iter->first);
+        fontMap_.erase(iter);
+        evictCount_++;
     }
+    if (!evicted.empty()) {
+        // 一次发布不含淘汰条目的快照，之前的快照引用了已删除的条目，立即释放
+        snapshot_.update([&evicted](SnapshotMap<Text, GlyphEntry *, TextHash>::Map &map) {
+            for (const Text &text : evicted) {
+                map.erase(text);
+            }
+        });
+        snapshot_.reclaim();
+    }
+}
 
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+TextureCacheStats GlyphManager::getStats() {
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    TextureCacheStats stats;
+    stats.entryCount_ = fontMap_.size();
+    stats.bytes_ = bytes_;
+    stats.hitCount_ = hitCount_.load();
+    stats.missCount_ = missCount_.load();
+    stats.evictCount_ = evictCount_;
+    stats.pendingDestroyCount_ = pendingDestroyList_.size();
+    return stats;
 }
 
-// 创建图像及图像内存
-static void createImage_helper(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
-                               VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory)
-{
-    // 创建图像
-    VkImageCreateInfo imageInfo = {};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = width;
-    imageInfo.extent.height = height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = format;
-    imageInfo.tiling = tiling; // VK_IMAGE_TILING_OPTIMAL以对访问优化的方式排列。VK_IMAGE_TILING_LINEAR，纹素以行主序的方式排列
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = usage;                           // 作为接收方、会被着色器采样
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // 图像对象只被传输队列族使用
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;         // 多重采样（只对用作附着的图像有效，这里无关）
-    imageInfo.flags = 0;                               // Optional
-
-    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+GlyphCacheStats GlyphManager::getGlyphStats() {
+    GlyphCacheStats stats;
     {
-        throw std::runtime_error("failed to create image!");
+        std::shared_lock<std::shared_mutex> locker(mutex_);
+        for (auto &iter : fontMap_) {
+            GlyphStrike *strike = iter.second.glyphInfo_.strike_;
+            std::lock_guard<std::mutex> strikeLocker(strike->mutex_);
+            stats.glyphCount_ += strike->glyphMap_.size();
+            stats.usedPixels_ += strike->usedPixels_;
+            stats.runCount_ += strike->runMap_.size();
+        }
     }
+    stats.glyphHitCount_ = glyphHitCount_.load();
+    stats.glyphMissCount_ = glyphMissCount_.load();
+    stats.glyphEvictCount_ = glyphEvictCount_.load();
+    stats.glyphDropCount_ = glyphDropCount_.load();
+    stats.rasterizeTimeNs_ = rasterizeTimeNs_.load();
+    stats.runHitCount_ = runHitCount_.load();
+    stats.runMissCount_ = runMissCount_.load();
+    return stats;
+}
 
-    // 分配图像内存
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device, image, &memRequirements); // 获取图像内存需求
+InFlightStats GlyphManager::getInFlightStats() {
+    return inFlight_.getStats();
+}
 
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType_helper(physicalDevice, memRequirements.memoryTypeBits, properties);
+void GlyphManager::dump() {
+    TextureCacheStats stats = getStats();
+    uint64_t lookups = stats.hitCount_ + stats.missCount_;
+    LOGI("GlyphManager: %llu strikes, %.2f MB / %.2f MB, hit %llu, miss %llu (hit rate %.1f%%), evicted %llu, pending destroy %llu",
+         (unsigned long long) stats.entryCount_, stats.bytes_ / 1048576.0, budgetBytes_ / 1048576.0,
+         (unsigned long long) stats.hitCount_, (unsigned long long) stats.missCount_,
+         lookups == 0 ? 0.0 : 100.0 * stats.hitCount_ / lookups,
+         (unsigned long long) stats.evictCount_, (unsigned long long) stats.pendingDestroyCount_);
+
+    GlyphCacheStats glyphStats = getGlyphStats();
+    uint64_t glyphLookups = glyphStats.glyphHitCount_ + glyphStats.glyphMissCount_;
+    LOGI("GlyphManager: %llu glyphs, atlas occupancy %.1f%%, glyph hit %llu, miss %llu (hit rate %.1f%%), evicted %llu, dropped %llu, first-use rasterize %.3f ms (%.1f us/glyph)",
+         (unsigned long long) glyphStats.glyphCount_, stats.bytes_ == 0 ? 0.0 : 100.0 * glyphStats.usedPixels_ / stats.bytes_,
+         (unsigned long long) glyphStats.glyphHitCount_, (unsigned long long) glyphStats.glyphMissCount_,
+         glyphLookups == 0 ? 0.0 : 100.0 * glyphStats.glyphHitCount_ / glyphLookups,
+         (unsigned long long) glyphStats.glyphEvictCount_, (unsigned long long) glyphStats.glyphDropCount_,
+         glyphStats.rasterizeTimeNs_ / 1e6,
+         glyphStats.glyphMissCount_ == 0 ? 0.0 : glyphStats.rasterizeTimeNs_ / 1e3 / glyphStats.glyphMissCount_);
+    uint64_t runLookups = glyphStats.runHitCount_ + glyphStats.runMissCount_;
+    LOGI("GlyphManager: %llu cached text runs, run hit %llu, miss %llu (hit rate %.1f%%)",
+         (unsigned long long) glyphStats.runCount_, (unsigned long long) glyphStats.runHitCount_,
+         (unsigned long long) glyphStats.runMissCount_, runLookups == 0 ? 0.0 : 100.0 * glyphStats.runHitCount_ / runLookups);
+    GlyphRasterizer::dump(); // 字体打开次数与并行光栅化
+}
 
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate image memory!");
+void GlyphManager::createAndInsertTextImageInfo(Text &text, GlyphInfo *glyphInfo) {
+    try {
+        *glyphInfo = createFontImageInfo(text); // 打开字体与光栅化预取的字形较慢，无需锁保护
+    } catch (...) {
+        // 创建失败（如字体文件缺失），从准备列表移除，等待该strike的任务抛出同一异常
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        inFlight_.fail(text, std::current_exception());
+        throw;
     }
 
-    vkBindImageMemory(device, image, imageMemory, 0); // 将图像对象和内存相关联
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    GlyphEntry &entry = fontMap_[text];
+    entry.glyphInfo_ = *glyphInfo;
+    entry.lastUsedFrame_.store(frameCounter_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bytes_ += glyphInfo->atlasInfo_.bytes_;
+    snapshot_.insert(text, &entry); // 发布时条目已填写完整
+
+    // 资源创建完成，从准备列表移除，只唤醒等待该strike的任务
+    inFlight_.complete(text);
 }
 
-// 从指令池中分配指令缓冲，并开始记录
-// TODO: commandPool需要单独管理并加锁
-static VkCommandBuffer beginSingleTimeCommands_helper(VkDevice device, VkCommandPool commandPool)
+// 光栅化一种字体大小中的一组字符（重复的字形只光栅化一次），使用调用线程缓存的face
+RasterizedGlyphs GlyphManager::rasterizeGlyphs(const Text &text, const std::vector<uint32_t> &codepoints)
 {
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool; // TODO: 我们使用同样的指令池（用独立的会性能更好，因为内存传输指令的指令缓冲通常生命周期很短暂）
-    allocInfo.commandBufferCount = 1;
+    ATrace_beginSection(("rasterizeGlyphs: " + text.fontPath_).c_str());
 
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-    // 开始记录内存传输指令
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // 只使用该指令一次
+    // 返回值
+    RasterizedGlyphs rasterized;
+    std::unordered_set<uint32_t> glyphIndices;
+    rasterized.glyphs_.reserve(codepoints.size());
+    for (uint32_t codepoint : codepoints) {
+        // FT先根据Unicode获得对应的glyph id，接着用glyph id渲染出bitmap
+        uint32_t glyphIndex = GlyphRasterizer::getGlyphIndex(text.fontPath_, text.pixelHeight_, codepoint);
+        if (!glyphIndices.insert(glyphIndex).second) {
+            continue;
+        }
+        rasterized.glyphs_.emplace_back();
+        rasterized.glyphs_.back().codepoint_ = codepoint;
+        rasterized.glyphs_.back().glyphIndex_ = glyphIndex;
+    }
+    GlyphRasterizer::rasterizeSerial(text.fontPath_, text.pixelHeight_, rasterized.glyphs_.data(), rasterized.glyphs_.size(),
+                                     SDF_TEXT ? SDF_SPREAD : 0);
 
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    ATrace_endSection();
 
-    return commandBuffer;
+    return rasterized;
 }
 
-//// 结束记录、提交指令缓冲、并等待完成
-//static void endSingleTimeCommands_helper(VkCommandBuffer commandBuffer, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue)
-//{
-//    // 结束记录
-//    vkEndCommandBuffer(commandBuffer);
-//
-//    // 提交指令缓冲，完成传输
-//    VkSubmitInfo submitInfo = {};
-//    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-//    submitInfo.commandBufferCount = 1;
-//    submitInfo.pCommandBuffers = &commandBuffer;
-//
-//    // TODO: 这里会出现多线程使用一个graphicsQueue提交指令，可能会有冲突，需单独拿出来管理
-//    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-//    vkQueueWaitIdle(graphicsQueue); // 等待 // TODO: 等待看样子是唯一办法？
-//
-//    // 传输完成，清除指令缓冲
-//    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-//}
-
-// 变换图像布局
-static void transitionImageLayout_helper(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkImage image, VkFormat format,
-                                         VkImageLayout oldLayout, VkImageLayout newLayout)
+void GlyphManager::freeRasterizedGlyphs(RasterizedGlyphs &rasterized)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands_helper(device, commandPool);
-
-    VkImageMemoryBarrier barrier = {}; // 管线屏障，保障诸如图像在读取之前被写入（缓冲对象也有类似的）
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // 传递队列所有权时使用
-
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1; // 我们的图形不存在细分级别
-
-    barrier.srcAccessMask = 0; // later
-    barrier.dstAccessMask = 0; // later
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    // 传输的变换
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0; // 写入操作不需等待任何对象
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;   // 最早出现的管线阶段
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT; // 伪阶段。传输阶段
-    }
-        // 采样前的变换
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT; // 片段着色器管线阶段的读取访问掩码
-    }
-    else
-    {
-        throw std::invalid_argument("unsupported layout transition!");
-    }
-
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    endSingleTimeCommands_helper(commandBuffer, device, commandPool, graphicsQueue);
+    rasterized.glyphs_.clear();
+    rasterized.glyphs_.shrink_to_fit();
 }
 
-// 复制缓冲到图像
-static void copyBufferToImage_helper(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
-                                     VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+// 创建一种字体大小的strike：创建atlas页，字形在首次绘制时才光栅化
+GlyphInfo GlyphManager::createFontImageInfo(Text &text)
 {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands_helper(device, commandPool);
-
-    // 指定将数据复制到图像那一部分
-    VkBufferImageCopy region = {};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0; // 在内存中紧凑存放
-    region.bufferImageHeight = 0;
-    // 下面是指定复制到图像中的哪一部分
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
+    ATrace_beginSection(("createFontImageInfo: " + text.fontPath_).c_str());
 
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
+    // 在这里打开字体（调用线程第一次使用时），字体文件不存在时抛出异常
+    GlyphRasterizer::getGlyphIndex(text.fontPath_, text.pixelHeight_, 0);
 
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    GlyphStrike *strike = new GlyphStrike();
+    strike->fontPath_ = text.fontPath_;
+    strike->pixelHeight_ = text.pixelHeight_;
+    strike->sdfSpread_ = SDF_TEXT ? SDF_SPREAD : 0;
 
-    endSingleTimeCommands_helper(commandBuffer, device, commandPool, graphicsQueue);
-}
+    // 页边长：约能放下GLYPH_PAGE_CELLS x GLYPH_PAGE_CELLS个字形（字形框按字高的1.25倍估计，含边框与距离场的延伸）
+    uint32_t cellSize = static_cast<uint32_t>(std::ceil(text.pixelHeight_ * 1.25f)) + 2 + 2 * strike->sdfSpread_;
+    uint32_t pageSize = MIN_GLYPH_PAGE_SIZE;
+    while (pageSize < cellSize * GLYPH_PAGE_CELLS && pageSize < MAX_GLYPH_PAGE_SIZE) {
+        pageSize *= 2;
+    }
+    strike->pageSize_ = pageSize;
 
+    // 页在创建strike时即创建（descriptor需要页的视图），之后各字形分别上传
+    strike->atlas_ = new TextureAtlas(device_, physicalDevice_, textureUploader_, samplerCache_, pageSize, 1, VK_FORMAT_R8_UNORM);
+    strike->atlas_->addPage();
+    AtlasPageInfo pageInfo = strike->atlas_->getPageInfo(0);
 
-/**
- * 根据要求创建图像视图
- */
-static VkImageView createImageView(VkDevice device, VkImage image, VkFormat format)
-{
-    VkImageViewCreateInfo viewInfo = {};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = image;
-    // 指定图像数据的解释方式
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D; // 二维纹理
-    viewInfo.format = format;
-
-    // 使用默认的颜色通道映射（比如单色纹理可以将所有颜色通道映射到红色）
-    viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-    // subresourceRange指定图像用途和哪一部分可以被使用
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-
-    VkImageView imageView;
-    if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create texture image view!");
+    GlyphInfo glyphInfo;
+    glyphInfo.strike_ = strike;
+    glyphInfo.strikeId_ = nextStrikeId_.fetch_add(1, std::memory_order_relaxed);
+    glyphInfo.pixelHeight_ = text.pixelHeight_;
+    glyphInfo.sdf_ = strike->sdfSpread_ != 0;
+    glyphInfo.atlasInfo_.textureImage_ = pageInfo.image_;
+    glyphInfo.atlasInfo_.textureImageMemory_ = pageInfo.imageMemory_;
+    glyphInfo.atlasInfo_.textureImageView_ = pageInfo.imageView_;
+    glyphInfo.atlasInfo_.textureSampler_ = pageInfo.sampler_;
+    glyphInfo.atlasInfo_.bytes_ = static_cast<uint64_t>(pageSize) * pageSize;
+
+    // 预取线程已光栅化的字形（解析时收集到的字符）一次放入
+    RasterizedGlyphs rasterized;
+    if (prefetcher_ != nullptr && prefetcher_->takeGlyphs(text, &rasterized)) {
+        std::lock_guard<std::mutex> locker(strike->mutex_);
+        for (RasterizedGlyph &glyph : rasterized.glyphs_) {
+            strike->glyphIndexMap_[glyph.codepoint_] = glyph.glyphIndex_;
+        }
+        insertGlyphsLocked(*strike, rasterized.glyphs_, frameCounter_.load(std::memory_order_relaxed));
+        freeRasterizedGlyphs(rasterized);
     }
 
-    return imageView;
-}
+    ATrace_endSection();
 
+    return glyphInfo;
+}
 
-// 创建采样器对象
-static VkSampler createTextureSampler(VkDevice device)
+uint64_t GlyphManager::findGlyphs(GlyphInfo &glyphInfo, const std::vector<uint32_t> &codepoints, std::vector<GlyphMetrics> *glyphs)
 {
-    // 指定采样器使用的过滤和变换操作
-    VkSamplerCreateInfo samplerInfo = {};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT; // 超出图像范围时重复纹理（像地转平铺纹理）
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-
-    // 各向异性过滤
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    // samplerInfo.maxAnisotropy = 16;
+    uint64_t frame = frameCounter_.load(std::memory_order_relaxed);
+    GlyphStrike &strike = *glyphInfo.strike_;
 
-    // 边界颜色，只有当addressModeX是VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER才有用
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-
-    samplerInfo.unnormalizedCoordinates = VK_FALSE; // 为VK_FALSE时用[0,1)采样，不然则为[0,texWidth或Height)
-
-    samplerInfo.compareEnable = VK_FALSE; // 和预设值进行比较，在阴影贴图时使用
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
-
-    VkSampler textureSampler;
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
+    glyphs->resize(codepoints.size());
+    std::vector<size_t> missing; // 未缓存的字符在codepoints中的下标
+    std::vector<RasterizedGlyph> rasterized; // 待光栅化的字形（去重）
     {
-        throw std::runtime_error("failed to create texture sampler!");
+        std::lock_guard<std::mutex> locker(strike.mutex_);
+        std::unordered_set<uint32_t> glyphIndices;
+        for (size_t i = 0; i < codepoints.size(); i++) {
+            auto indexIter = strike.glyphIndexMap_.find(codepoints[i]);
+            if (indexIter == strike.glyphIndexMap_.end()) {
+                uint32_t glyphIndex = GlyphRasterizer::getGlyphIndex(strike.fontPath_, strike.pixelHeight_, codepoints[i]);
+                indexIter = strike.glyphIndexMap_.emplace(codepoints[i], glyphIndex).first;
+            }
+            auto iter = strike.glyphMap_.find(indexIter->second);
+            if (iter == strike.glyphMap_.end()) {
+                missing.push_back(i);
+                if (glyphIndices.insert(indexIter->second).second) {
+                    rasterized.emplace_back();
+                    rasterized.back().codepoint_ = codepoints[i];
+                    rasterized.back().glyphIndex_ = indexIter->second;
+                }
+                continue;
+            }
+            iter->second.lastUsedFrame_ = frame; // 本帧内不会被淘汰，释放锁后返回的度量仍然有效
+            (*glyphs)[i] = iter->second.metrics_;
+            glyphHitCount_.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (missing.empty()) {
+            return strike.generation_;
+        }
     }
-    return textureSampler;
-}
-
-// ================================== 以上为一些辅助函数 ==================================
 
+    // 光栅化不持锁，其他使用该strike的任务可以继续查找；字形较多时拆分给光栅化线程
+    ATrace_beginSection("rasterizeMissingGlyphs");
+    uint64_t startNs = nowNs_helper();
+    rasterizer_->rasterize(strike.fontPath_, strike.pixelHeight_, rasterized, strike.sdfSpread_);
+
+    // 放入atlas页并合并为一次上传（其他任务同时光栅化了的字形跳过）
+    std::lock_guard<std::mutex> locker(strike.mutex_);
+    insertGlyphsLocked(strike, rasterized, frame);
+    glyphMissCount_.fetch_add(rasterized.size(), std::memory_order_relaxed);
+    glyphHitCount_.fetch_add(missing.size() - rasterized.size(), std::memory_order_relaxed); // 同一次调用中重复的字符
+    rasterizeTimeNs_.fetch_add(nowNs_helper() - startNs, std::memory_order_relaxed);
+    ATrace_endSection();
 
+    for (size_t i : missing) {
+        uint32_t glyphIndex = strike.glyphIndexMap_.at(codepoints[i]);
+        auto iter = strike.glyphMap_.find(glyphIndex);
+        if (iter != strike.glyphMap_.end()) {
+            iter->second.lastUsedFrame_ = frame;
+            (*glyphs)[i] = iter->second.metrics_;
+            continue;
+        }
+        // atlas页放不下而未缓存的字形：不绘制，只前进
+        for (RasterizedGlyph &glyph : rasterized) {
+            if (glyph.glyphIndex_ == glyphIndex) {
+                (*glyphs)[i].advance_ = glyph.metrics_.advance_;
+                break;
+            }
+        }
+    }
+    return strike.generation_;
+}
 
-// 加载字体atlas到一个VkImage
-GlyphInfo GlyphManager::createFontImageInfo(Text &text)
+void GlyphManager::findTextRuns(GlyphInfo &glyphInfo, const std::vector<Text> &texts, std::vector<std::shared_ptr<const TextRun>> *runs)
 {
-    ATrace_beginSection(("createFontImageInfo: " + text.fontPath_).c_str());
+    uint64_t frame = frameCounter_.load(std::memory_order_relaxed);
+    GlyphStrike &strike = *glyphInfo.strike_;
 
-    // 返回值
-    GlyphInfo glyphInfo;
-    glyphInfo.glyphTop_ = (float*)malloc(sizeof(float) * ASCII_CHAR_COUNT);
-    glyphInfo.glyphRight_ = (float*)malloc(sizeof(float) * ASCII_CHAR_COUNT);
-    glyphInfo.glyphBottom_ = (float*)malloc(sizeof(float) * ASCII_CHAR_COUNT);
-    glyphInfo.glyphLeftOffsets_ = (int*) malloc(sizeof(int) * ASCII_CHAR_COUNT);
-    glyphInfo.glyphTopOffsets_ = (int*) malloc(sizeof(int) * ASCII_CHAR_COUNT);
-
-    // freetype库
-    FT_Library library;
-    if (FT_Init_FreeType(&library)) {
-        throw std::runtime_error("freetype init library error!");
+    runs->assign(texts.size(), nullptr);
+    std::vector<size_t> missing; // 未缓存排版的文本在texts中的下标
+    {
+        std::lock_guard<std::mutex> locker(strike.mutex_);
+        for (size_t i = 0; i < texts.size(); i++) {
+            auto iter = strike.runMap_.find(texts[i].str_);
+            if (iter == strike.runMap_.end()) {
+                missing.push_back(i);
+                continue;
+            }
+            CachedRun &cached = *iter->second;
+            for (CachedGlyph *glyph : cached.glyphs_) {
+                glyph->lastUsedFrame_ = frame; // 本帧内不会被淘汰，排版中的纹理坐标仍然有效
+            }
+            cached.lastUsedFrame_ = frame;
+            strike.runList_.splice(strike.runList_.begin(), strike.runList_, iter->second); // 移到LRU的最新端
+            (*runs)[i] = cached.run_;
+        }
+        runHitCount_.fetch_add(texts.size() - missing.size(), std::memory_order_relaxed);
+        if (missing.empty()) {
+            return;
+        }
     }
-
-    // freetype字体
-    FT_Face face;
-    if (FT_New_Face(library, text.fontPath_.c_str(), 0, &face)) {
-        throw std::runtime_error("freetype load font error!");
+    runMissCount_.fetch_add(missing.size(), std::memory_order_relaxed);
+
+    // 未缓存的字符串：查找（必要时光栅化）所有字形，返回的字形在本帧内不会被淘汰
+    std::vector<std::vector<uint32_t>> codepoints(missing.size());
+    std::vector<uint32_t> allCodepoints;
+    for (size_t k = 0; k < missing.size(); k++) {
+        Text::decodeUtf8(texts[missing[k]].str_, &codepoints[k]);
+        allCodepoints.insert(allCodepoints.end(), codepoints[k].begin(), codepoints[k].end());
     }
+    std::vector<GlyphMetrics> glyphs;
+    findGlyphs(glyphInfo, allCodepoints, &glyphs);
+
+    std::lock_guard<std::mutex> locker(strike.mutex_);
+    size_t glyphIndex = 0;
+    for (size_t k = 0; k < missing.size(); k++) {
+        std::shared_ptr<TextRun> run = std::make_shared<TextRun>();
+        run->id_ = strike.nextRunId_++; // 不缓存的排版也取新id，字形之后放入atlas时几何缓存不会命中缺字的几何
+        run->quads_.reserve(codepoints[k].size());
+        CachedRun cached;
+        cached.glyphs_.reserve(codepoints[k].size());
+        bool complete = true; // atlas页放不下而未缓存的字形不绘制，这样的排版不缓存
+        float penX = 0.0f;
+        for (uint32_t codepoint : codepoints[k]) {
+            const GlyphMetrics &glyph = glyphs[glyphIndex++];
+            auto iter = strike.glyphMap_.find(strike.glyphIndexMap_.at(codepoint));
+            if (iter != strike.glyphMap_.end()) {
+                cached.glyphs_.push_back(&iter->second);
+            } else {
+                complete = false;
+            }
 
-    // 设置加载字体大小
-    FT_Set_Pixel_Sizes(face, 0, text.pixelHeight_);
-
-    // TODO: 当前为了简单管理，每个glyph在atlas中都占据相同的大小。首先迭代一遍所有字符获得最大长宽
-    int maxGlyphHeight = 0;
-    int maxGlyphWidth = 0;
-
-    // 获取所有字符的最大长宽
-    for (int i = 0; i < ASCII_CHAR_COUNT; i++) {
-        wchar_t c = i; // wchar_t可以后续支持unicode
-
-        FT_Load_Char(face, c, FT_LOAD_DEFAULT); // 此处没有渲染
-        FT_GlyphSlot slot = face->glyph;
-        auto bitmap = &slot->bitmap;
-        int rows = bitmap->rows; // 获得字高
-        int cols = bitmap->width; // 获得字宽
-        glyphInfo.glyphLeftOffsets_[i] = slot->bitmap_left; // 对齐使用
-        glyphInfo.glyphTopOffsets_[i] = slot->bitmap_top;
+            float left = penX + glyph.left_;
+            penX += glyph.advance_;
+            if (glyph.width_ == 0 || glyph.height_ == 0) {
+                continue; // 空格等没有位图的字形只前进
+            }
+            GlyphQuad quad;
+            quad.left_ = left;
+            quad.top_ = -static_cast<float>(glyph.top_);
+            quad.right_ = left + glyph.width_;
+            quad.bottom_ = quad.top_ + glyph.height_;
+            quad.uvLeft_ = glyph.uvLeft_;
+            quad.uvTop_ = glyph.uvTop_;
+            quad.uvRight_ = glyph.uvRight_;
+            quad.uvBottom_ = glyph.uvBottom_;
+            run->quads_.push_back(quad);
+        }
+        run->advance_ = penX;
+        (*runs)[missing[k]] = run;
 
-        maxGlyphHeight = std::max(maxGlyphHeight, rows);
-        maxGlyphWidth = std::max(maxGlyphWidth, cols);
+        if (!complete || strike.runMap_.find(texts[missing[k]].str_) != strike.runMap_.end()) {
+            continue; // 同一字符串可能在本次调用中出现多次，或已由其他任务缓存
+        }
+        if (strike.runMap_.size() >= MAX_TEXT_RUNS) {
+            // 丢弃最久未使用的排版，它在上一帧或本帧用过时（所有排版都在使用）不缓存
+            CachedRun &oldest = strike.runList_.back();
+            if (oldest.lastUsedFrame_ + 1 >= frame) {
+                continue;
+            }
+            eraseRun_helper(strike, &oldest, nullptr);
+        }
+        std::sort(cached.glyphs_.begin(), cached.glyphs_.end());
+        cached.glyphs_.erase(std::unique(cached.glyphs_.begin(), cached.glyphs_.end()), cached.glyphs_.end());
+        cached.str_ = texts[missing[k]].str_;
+        cached.run_ = run;
+        cached.lastUsedFrame_ = frame;
+        strike.runList_.push_front(std::move(cached));
+        CachedRun *inserted = &strike.runList_.front();
+        for (CachedGlyph *glyph : inserted->glyphs_) {
+            glyph->runs_.push_back(inserted);
+        }
+        strike.runMap_.emplace(inserted->str_, strike.runList_.begin());
     }
-    glyphInfo.maxGlyphHeight_ = maxGlyphHeight;
-    glyphInfo.maxGlyphWidth_ = maxGlyphWidth;
-
-    // 纹理为纵向纹理，宽度为maxGlyphWidth，高度为maxGlyphHeight * 128
-    auto texWidth = maxGlyphWidth;
-    auto texHeight = maxGlyphHeight * ASCII_CHAR_COUNT;
-    VkDeviceSize imageSize = texHeight * texWidth;
-
-
-    // 创建图像数据的stagingBuffer（暂存缓冲）
-    ATrace_beginSection("renderAndCopyGlyphsToStageBuffer");
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer_helper(device_, physicalDevice_, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(device_, stagingBufferMemory, 0, imageSize, 0, &data);
-
-    for (int i = 0; i < ASCII_CHAR_COUNT; i++) {
-        wchar_t c = i; // wchar_t可以后续支持unicode
-
-        /* FT先根据输入，获得Unicode后获得对应的glyph id。
-        * 接着用glyph id渲染出了一张bitmap
-        */
-        FT_Load_Char(face, c, FT_LOAD_RENDER);
-        FT_GlyphSlot slot = face->glyph; // 输出结果在 slot->bitmap
-
-        auto bitmap = &slot->bitmap;
-        int rows = bitmap->rows; // 获得字高
-        int cols = bitmap->width; // 获得字宽
-
-        unsigned char *base = (unsigned char *)data + i * maxGlyphWidth * maxGlyphHeight;
+}
 
-        // 为Engine2D采用atlas，normalize到1
-        glyphInfo.glyphTop_[i] = (float)(i * maxGlyphHeight) / (float)texHeight;
-        glyphInfo.glyphBottom_[i] = (float)(i * maxGlyphHeight + rows) / (float)texHeight;
-        glyphInfo.glyphRight_[i] = (float)(cols) / (float)texWidth;
+void GlyphManager::insertGlyphsLocked(GlyphStrike &strike, std::vector<RasterizedGlyph> &glyphs, uint64_t frame)
+{
+    // 分配区域，每个字形四周留1像素的透明边框，避免线性过滤采样到相邻字形
+    std::vector<UploadRegion> regions;
+    std::vector<const RasterizedGlyph *> uploadGlyphs;
+    VkDeviceSize stagingSize = 0;
+    float pageSize = static_cast<float>(strike.pageSize_);
+    for (RasterizedGlyph &glyph : glyphs) {
+        if (strike.glyphMap_.find(glyph.glyphIndex_) != strike.glyphMap_.end()) {
+            continue;
+        }
+        CachedGlyph cached;
+        cached.metrics_ = glyph.metrics_;
+        cached.lastUsedFrame_ = frame;
+        if (glyph.bitmap_.empty()) { // 空格等没有位图的字形
+            strike.glyphMap_[glyph.glyphIndex_] = cached;
+            continue;
+        }
 
-        // copy every line
-        for (int j = 0; j < rows; j++) {
-            memcpy(base + j * maxGlyphWidth, bitmap->buffer + j * cols, cols);
-            memset(base + j * maxGlyphWidth + cols, 0, maxGlyphWidth - cols);
+        uint32_t width = static_cast<uint32_t>(glyph.metrics_.width_);
+        uint32_t height = static_cast<uint32_t>(glyph.metrics_.height_);
+        if (!allocateWithEvictionLocked(strike, width + 2, height + 2, frame, &cached.region_)) {
+            glyphDropCount_.fetch_add(1, std::memory_order_relaxed);
+            if (!strike.reportedFull_) {
+                strike.reportedFull_ = true;
+                LOGE("GlyphManager: glyph atlas (%u x %u) is full, glyphs used in one frame do not fit", strike.pageSize_, strike.pageSize_);
+            }
+            continue;
         }
-        // set the rest of lines to be all 0s
-        memset(base + maxGlyphWidth * rows, 0, maxGlyphWidth * maxGlyphHeight - maxGlyphWidth * rows); // 将剩下的字节设置为0
 
+        // 纹理坐标为去掉边框之后的子矩形
+        cached.metrics_.uvLeft_ = (cached.region_.x_ + 1) / pageSize;
+        cached.metrics_.uvTop_ = (cached.region_.y_ + 1) / pageSize;
+        cached.metrics_.uvRight_ = (cached.region_.x_ + 1 + width) / pageSize;
+        cached.metrics_.uvBottom_ = (cached.region_.y_ + 1 + height) / pageSize;
+        strike.glyphMap_[glyph.glyphIndex_] = cached;
+        strike.usedPixels_ += static_cast<uint64_t>(cached.region_.width_) * cached.region_.height_;
+
+        UploadRegion region;
+        region.bufferOffset_ = stagingSize;
+        region.x_ = static_cast<int32_t>(cached.region_.x_);
+        region.y_ = static_cast<int32_t>(cached.region_.y_);
+        region.width_ = width + 2;
+        region.height_ = height + 2;
+        regions.push_back(region);
+        uploadGlyphs.push_back(&glyph);
+        stagingSize += (static_cast<VkDeviceSize>(width + 2) * (height + 2) + 3) & ~static_cast<VkDeviceSize>(3); // 偏移按4字节对齐
+    }
+    if (regions.empty()) {
+        return;
     }
 
-    vkUnmapMemory(device_, stagingBufferMemory);
-    ATrace_endSection();
-
-    createImage_helper(device_, physicalDevice_, texWidth, texHeight, VK_FORMAT_R8_UNORM, VK_IMAGE_TILING_OPTIMAL,
-                       VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, glyphInfo.atlasInfo_.textureImage_, glyphInfo.atlasInfo_.textureImageMemory_);
-
-    ATrace_beginSection("firstTransition");
-    // 变换纹理图像到VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    transitionImageLayout_helper(device_, commandPool_, graphicsQueue_, glyphInfo.atlasInfo_.textureImage_, VK_FORMAT_R8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED /* 创建时initialLayout */, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    ATrace_endSection();
-
-    ATrace_beginSection("copyBufferToImage");
-    // 执行图像数据复制操作
-    copyBufferToImage_helper(device_, commandPool_, graphicsQueue_, stagingBuffer, glyphInfo.atlasInfo_.textureImage_, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-    ATrace_endSection();
-
-    ATrace_beginSection("secondTransition");
-    // 为了能够在着色器中采样纹理图像数据，还需进行一次变换
-    transitionImageLayout_helper(device_, commandPool_, graphicsQueue_, glyphInfo.atlasInfo_.textureImage_, VK_FORMAT_R8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    ATrace_beginSection("copyGlyphsToStageBuffer");
+    VulkanBufferInfo stagingBuffer = textureUploader_->allocStagingBuffer(stagingSize);
+    unsigned char *dst = static_cast<unsigned char *>(stagingBuffer.mappedData_);
+    for (size_t i = 0; i < regions.size(); i++) {
+        const RasterizedGlyph &glyph = *uploadGlyphs[i];
+        uint32_t paddedWidth = regions[i].width_;
+        unsigned char *base = dst + regions[i].bufferOffset_;
+        memset(base, 0, static_cast<size_t>(paddedWidth) * regions[i].height_); // 边框（以及复用槽位中的旧内容）清零
+        for (int j = 0; j < glyph.metrics_.height_; j++) {
+            memcpy(base + (j + 1) * paddedWidth + 1, glyph.bitmap_.data() + j * glyph.metrics_.width_, glyph.metrics_.width_);
+        }
+    }
     ATrace_endSection();
 
-    // 清理
-    vkDestroyBuffer(device_, stagingBuffer, nullptr);
-    vkFreeMemory(device_, stagingBufferMemory, nullptr);
-
-    // 创建图像视图
-    glyphInfo.atlasInfo_.textureImageView_ = createImageView(device_, glyphInfo.atlasInfo_.textureImage_, VK_FORMAT_R8_UNORM);
-
-    // 创建采样器 // TODO: 采样器和图片本身不耦合，后续应该和paint耦合，使用哈希表查找
-    glyphInfo.atlasInfo_.textureSampler_ = createTextureSampler(device_);
-
-    // 释放资源
-    FT_Done_Face(face);
-    FT_Done_FreeType(library);
+    // 所有新字形录制为一次复制，页中其他字形的内容保持不变
+    strike.lastUploadTicket_ = textureUploader_->uploadRegions(stagingBuffer, strike.atlas_->getPageInfo(0).image_, regions);
+}
 
-    ATrace_endSection();
+bool GlyphManager::allocateWithEvictionLocked(GlyphStrike &strike, uint32_t width, uint32_t height, uint64_t frame, AtlasRegion *region)
+{
+    if (strike.atlas_->allocate(width, height, region)) {
+        return true;
+    }
 
-    return glyphInfo;
+    // 按最近使用的帧从旧到新淘汰，上一帧及本帧用过的字形不淘汰（GPU可能仍在采样）
+    std::vector<std::pair<uint64_t, uint32_t>> candidates;
+    for (auto &iter : strike.glyphMap_) {
+        if (iter.second.region_.page_ >= 0 && iter.second.lastUsedFrame_ + DESTROY_DELAY_FRAMES <= frame) {
+            candidates.emplace_back(iter.second.lastUsedFrame_, iter.first);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    bool allocated = false;
+    for (auto &candidate : candidates) {
+        auto iter = strike.glyphMap_.find(candidate.second);
+        // 只删除引用了该字形的排版，其余排版中的纹理坐标仍然有效
+        std::vector<CachedRun *> runs = std::move(iter->second.runs_);
+        for (CachedRun *run : runs) {
+            eraseRun_helper(strike, run, &iter->second);
+        }
+        const AtlasRegion &evicted = iter->second.region_;
+        strike.usedPixels_ -= static_cast<uint64_t>(evicted.width_) * evicted.height_;
+        strike.atlas_->free(evicted);
+        strike.glyphMap_.erase(iter);
+        glyphEvictCount_.fetch_add(1, std::memory_order_relaxed);
+        if (strike.atlas_->allocate(width, height, region)) {
+            allocated = true;
+            break;
+        }
+    }
+    if (!candidates.empty()) {
+        strike.generation_++; // 逐字符查找时缓存的几何可能引用了被淘汰的区域
+    }
+    return allocated;
 }
@@ -10,66 +10,189 @@
 #include <string>
 #include <unordered_map>
 #include <shared_mutex>
-#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include "ImageManager.h"
+#include "GlyphRasterizer.h"
+#include "InFlightMap.h"
+#include "SnapshotMap.h"
 #include "text/Text.h"
 
-// 当前将前128个字符放入atlas
-#define ASCII_CHAR_COUNT 128
-
 struct TextHash {
     std::size_t operator()(const Text& obj) const;
 };
 
-// 图片（纹理）管理信息
+struct GlyphStrike;
+
+// 一种字体大小（strike）的字形缓存，由GlyphManager创建与销毁
 struct GlyphInfo {
-    VulkanImageInfo atlasInfo_;
-    float *glyphTop_; // 记录每个glyph在atlas中top的位置
-    float *glyphRight_; // 记录每个glyph在atlas中right的位置（left 始终为0）
-    float *glyphBottom_; // 记录每个glyph在atlas中bottom的位置
-    int *glyphLeftOffsets_; // 用于绘制对齐
-    int *glyphTopOffsets_;
-    int maxGlyphHeight_; // 记录最大字符像素高度
-    int maxGlyphWidth_; // 记录最大字符像素宽度
+    VulkanImageInfo atlasInfo_; // strike的atlas页（R8），用于创建descriptor
+    GlyphStrike *strike_ = nullptr;
+    uint64_t strikeId_ = 0; // 每次创建strike时递增，几何缓存以此区分重建后的strike
+    float pixelHeight_ = 0.0f; // 光栅化的字号，绘制字号不同时（SDF）度量按比例缩放
+    bool sdf_ = false; // 为true时atlas页为距离场（SDF_TEXT），需用text_sdf.frag绘制
+};
+
+// 排版后的一个字形四边形：以strike字号为单位的文本局部坐标（原点为笔的起点所在的基线，y向下）
+struct GlyphQuad {
+    float left_ = 0.0f;
+    float top_ = 0.0f;
+    float right_ = 0.0f;
+    float bottom_ = 0.0f;
+    float uvLeft_ = 0.0f;
+    float uvTop_ = 0.0f;
+    float uvRight_ = 0.0f;
+    float uvBottom_ = 0.0f;
+};
+
+// 一个字符串排版后的字形四边形（空格等没有位图的字形只计入前进量），绘制时平移（SDF时还需缩放）后复制为顶点
+struct TextRun {
+    uint64_t id_ = 0; // strike内唯一，排版因字形被淘汰而重建后改变，几何缓存的key以此区分
+    std::vector<GlyphQuad> quads_;
+    float advance_ = 0.0f; // 整个字符串的前进量
+};
+
+// 一种字体大小中一组字符的光栅化结果（预取线程在Vulkan初始化期间生成）
+struct RasterizedGlyphs {
+    std::vector<RasterizedGlyph> glyphs_;
+};
+
+// 字形缓存统计信息
+struct GlyphCacheStats {
+    uint64_t glyphCount_ = 0; // 所有strike中驻留的字形数
+    uint64_t glyphHitCount_ = 0;
+    uint64_t glyphMissCount_ = 0; // 首次使用（或淘汰后再次使用）时光栅化的字形数
+    uint64_t glyphEvictCount_ = 0; // atlas页放不下时淘汰的字形数
+    uint64_t glyphDropCount_ = 0; // 淘汰后仍放不下而未绘制的字形数
+    uint64_t rasterizeTimeNs_ = 0; // 首次使用时光栅化与录制上传的累计耗时
+    uint64_t usedPixels_ = 0; // 字形占用的atlas像素数（含1像素边框）
+    uint64_t runCount_ = 0; // 所有strike中缓存的字符串排版数
+    uint64_t runHitCount_ = 0;
+    uint64_t runMissCount_ = 0;
 };
 
 /*
- * 管理所有的字体纹理VulkanImageInfo
- * TODO: 当前只有一张字体，后续支持多字体
+ * 管理所有字体大小（strike）的字形缓存
+ * 每个strike持有一张R8的atlas页（按shelf装箱，SDF_TEXT时为基准字号的距离场），字形以字形id为key，在首次绘制时光栅化、放入atlas页并录制区域上传
+ * （一次绘制中新出现的所有字形合并为一次上传）；光栅化不持有strike的锁，字形较多时由GlyphRasterizer拆分给光栅化线程并行完成
+ * atlas页放不下时淘汰该strike中最久未使用的字形（上一帧用过的不淘汰），每次淘汰递增strike的版本号，几何缓存以此失效
+ * 每个strike还缓存字符串的排版（字形四边形），绘制已排版的字符串时不再逐字符解码与查找；排版按LRU维护最多MAX_TEXT_RUNS个，
+ * 每个字形记录引用它的排版，淘汰字形时只删除这些排版
+ * strike整体与ImageManager相同，按LRU维护最多budgetBytes的atlas页，淘汰后延迟销毁
  */
 class GlyphManager {
 public:
-    GlyphManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
-    ~GlyphManager(); // 删除所有VkImage
+    GlyphManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader,
+                 SamplerCache *samplerCache, uint64_t budgetBytes, uint32_t rasterizerThreads); // rasterizerThreads为并行光栅化的辅助线程数
+    ~GlyphManager(); // 删除所有strike，停止光栅化线程
+
+    // 文本对应的strike的key（下面的查找与创建均以此为参数）：SDF_TEXT时同一字体的所有字号对应同一个基准字号的strike
+    static Text makeStrikeKey(const Text &text);
 
-    void createAndInsertTextImageInfo(Text &text, GlyphInfo *glyphInfo); // 创建并插入字体的VulkanImageInfo，创建的值通过imageInfo参数返回
+    void createAndInsertTextImageInfo(Text &text, GlyphInfo *glyphInfo); // 创建并插入该字体大小的strike，创建的值通过glyphInfo参数返回
 
     /**
      * 查找是否有缓存的资源：
      *  若有：      返回该资源（通过参数）
-     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源
+     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源（创建失败时抛出创建者的异常）
      *             若当前为第一个使用该未创建资源的任务，则直接返回false，并将该资源列为“准备中”（其他并发任务会阻塞）
      * @return 是否有缓存的资源
      */
     bool findTextTmageInfo(Text &text, GlyphInfo *glyphInfo); // 返回是否找到
 
+    /**
+     * 查找一组字符的字形（工作线程调用）
+     * 未缓存的字形在此光栅化（不持锁，其他任务可同时查找该strike）并放入atlas页，glyphs按codepoints的顺序返回；所有返回的字形在本帧内不会被淘汰
+     * @return strike的版本号（字形被淘汰时递增），几何缓存的key需包含它
+     */
+    uint64_t findGlyphs(GlyphInfo &glyphInfo, const std::vector<uint32_t> &codepoints, std::vector<GlyphMetrics> *glyphs);
+
+    /**
+     * 查找一组文本（属于同一strike）排版后的字形四边形（工作线程调用），runs按texts的顺序返回
+     * 排版按字符串缓存在strike中：命中时只需一次查找，并将其字形标记为本帧使用；未命中的字符串通过findGlyphs查找字形后排版并缓存
+     * 淘汰字形时只删除引用了该字形的排版，几何缓存的key需包含各排版的id_（代替strike的版本号）
+     */
+    void findTextRuns(GlyphInfo &glyphInfo, const std::vector<Text> &texts, std::vector<std::shared_ptr<const TextRun>> *runs);
+
+    void setPrefetcher(ResourcePrefetcher *prefetcher); // 创建strike时放入预取线程已光栅化的字形
+
+    // 每帧开始时调用，见ImageManager::endFrame
+    void endFrame(SamplerDescriptorManager *samplerDescriptorManager);
+
+    TextureCacheStats getStats();
+    GlyphCacheStats getGlyphStats();
+    InFlightStats getInFlightStats(); // 等待其他任务创建strike的次数与阻塞时间
+    void dump(); // 以log的形式打印 for debug
+
+    // 光栅化一种字体大小中的一组字符（只涉及CPU，可在任意线程调用，包括Vulkan初始化之前）
+    static RasterizedGlyphs rasterizeGlyphs(const Text &text, const std::vector<uint32_t> &codepoints);
+    static void freeRasterizedGlyphs(RasterizedGlyphs &rasterized);
+
 private:
 
+    struct GlyphEntry {
+        GlyphInfo glyphInfo_;
+        std::atomic<uint64_t> lastUsedFrame_{0}; // 命中时无锁更新，淘汰时按此近似LRU
+    };
+
+    struct PendingDestroyGlyph {
+        GlyphInfo glyphInfo_;
+        uint64_t evictFrame_;
+    };
+
     std::shared_mutex mutex_; // 保护下面的map
-    std::condition_variable_any cv_; // 确保同时只有一个任务在创建资源
-    std::unordered_map<Text, GlyphInfo, TextHash> fontMap_;
-    std::unordered_map<Text, bool, TextHash> preparingMap_; // 维护所有正在创建的Font Image，避免多任务并发导致的重复创建
+    std::unordered_map<Text, GlyphEntry, TextHash> fontMap_;
+    InFlightMap<Text, TextHash> inFlight_; // 维护所有正在创建的strike，避免多任务并发导致的重复创建
+    std::vector<PendingDestroyGlyph> pendingDestroyList_; // 已淘汰、等待销毁的strike
+    // fontMap_的只读快照（指向map中的条目），已创建的strike无锁查找；在mutex_下更新，条目只在endFrame中删除（工作线程空闲）
+    SnapshotMap<Text, GlyphEntry *, TextHash> snapshot_;
+
+    // LRU
+    const uint64_t DESTROY_DELAY_FRAMES = 2; // 淘汰后至少等待的帧数，覆盖仍在GPU上的帧
+    uint64_t budgetBytes_;
+    uint64_t bytes_ = 0; // 受mutex_保护
+    std::atomic<uint64_t> frameCounter_{0};
+    StripedCounter hitCount_; // 命中在工作线程的热路径上，分槽计数
+    std::atomic<uint64_t> missCount_{0};
+    uint64_t evictCount_ = 0;
+    std::atomic<uint64_t> nextStrikeId_{1};
+
+    // 字形统计
+    std::atomic<uint64_t> glyphHitCount_{0};
+    std::atomic<uint64_t> glyphMissCount_{0};
+    std::atomic<uint64_t> glyphEvictCount_{0};
+    std::atomic<uint64_t> glyphDropCount_{0};
+    std::atomic<uint64_t> rasterizeTimeNs_{0};
+    std::atomic<uint64_t> runHitCount_{0};
+    std::atomic<uint64_t> runMissCount_{0};
+
+    const size_t MAX_TEXT_RUNS = 1024; // 每个strike缓存的字符串排版数上限，满时丢弃最久未使用的（上一帧及本帧用过的除外）
+
+    // atlas页的边长：能放下约GLYPH_PAGE_CELLS x GLYPH_PAGE_CELLS个该大小的字形，取2的幂并限制在[MIN, MAX]
+    const uint32_t GLYPH_PAGE_CELLS = 16;
+    const uint32_t MIN_GLYPH_PAGE_SIZE = 256;
+    const uint32_t MAX_GLYPH_PAGE_SIZE = 2048;
+
+    void destroyGlyphInfo(GlyphInfo &glyphInfo); // 销毁strike（atlas页）
 
     android_app *app_;
     VkDevice device_;
     VkPhysicalDevice physicalDevice_;
-    VkCommandPool commandPool_;
-    VkQueue graphicsQueue_;
+    TextureUploader *textureUploader_; // 纹理上传（生命周期在Engine2D）
+    SamplerCache *samplerCache_; // 所有strike的atlas页共用同一个采样器（生命周期在Engine2D）
+    ResourcePrefetcher *prefetcher_ = nullptr; // 资源预取（可为空，生命周期在VulkanMain）
+    GlyphRasterizer *rasterizer_;
 
 
-    // 创建一张图片所有的内容
+    // 创建一个strike：创建atlas页，放入预取的字形
     GlyphInfo createFontImageInfo(Text &text);
+
+    // 将光栅化的字形放入strike的atlas页并合并为一次上传（需持有strike的锁），放不下时先淘汰旧字形
+    void insertGlyphsLocked(GlyphStrike &strike, std::vector<RasterizedGlyph> &glyphs, uint64_t frame);
+    // 淘汰strike中最久未使用的字形（上一帧及本帧用过的除外），直到能分配width x height的区域
+    bool allocateWithEvictionLocked(GlyphStrike &strike, uint32_t width, uint32_t height, uint64_t frame, AtlasRegion *region);
 };
 
 
@@ -0,0 +1,236 @@
+#include "GlyphRasterizer.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <android/trace.h>
+
+// 使用freetype
+#include "ft2build.h"
+#include FT_FREETYPE_H
+#include FT_MODULE_H
+
+// 统计（所有线程共享）
+static std::atomic<uint64_t> faceOpenCount{0};
+static std::atomic<uint64_t> faceOpenTimeNs{0};
+static std::atomic<uint64_t> glyphCount{0};
+static std::atomic<uint64_t> parallelBatchCount{0};
+static std::atomic<uint64_t> helperGlyphCount{0};
+
+static uint64_t nowNs_helper() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 一个线程打开的所有字体，线程退出时关闭
+struct ThreadFaceCache {
+    struct FaceEntry {
+        FT_Face face_;
+        float pixelHeight_; // 当前设置的字体大小，相同时跳过FT_Set_Pixel_Sizes
+    };
+
+    FT_Library library_ = nullptr;
+    uint32_t sdfSpread_ = 0; // library当前设置的SDF延伸像素数（FreeType默认为8）
+    std::unordered_map<std::string, FaceEntry> faces_; // 字体路径 -> face
+
+    ~ThreadFaceCache() {
+        for (auto &iter : faces_) {
+            FT_Done_Face(iter.second.face_);
+        }
+        if (library_ != nullptr) {
+            FT_Done_FreeType(library_);
+        }
+    }
+};
+
+// 获取调用线程中该字体的face并设置字体大小（及SDF的延伸像素数），第一次使用时打开
+static FT_Face acquireFace_helper(const std::string &fontPath, float pixelHeight, uint32_t sdfSpread = 0) {
+    static thread_local ThreadFaceCache cache;
+    if (cache.library_ == nullptr && FT_Init_FreeType(&cache.library_)) {
+        cache.library_ = nullptr;
+        throw std::runtime_error("freetype init library error!");
+    }
+
+    auto iter = cache.faces_.find(fontPath);
+    if (iter == cache.faces_.end()) {
+        uint64_t startNs = nowNs_helper();
+        FT_Face face;
+        if (FT_New_Face(cache.library_, fontPath.c_str(), 0, &face)) {
+            throw std::runtime_error("freetype load font error!");
+        }
+        faceOpenCount.fetch_add(1, std::memory_order_relaxed);
+        faceOpenTimeNs.fetch_add(nowNs_helper() - startNs, std::memory_order_relaxed);
+        iter = cache.faces_.emplace(fontPath, ThreadFaceCache::FaceEntry{face, -1.0f}).first;
+    }
+    if (iter->second.pixelHeight_ != pixelHeight) {
+        FT_Set_Pixel_Sizes(iter->second.face_, 0, pixelHeight);
+        iter->second.pixelHeight_ = pixelHeight;
+    }
+    if (sdfSpread != 0 && cache.sdfSpread_ != sdfSpread) {
+        FT_Int spread = static_cast<FT_Int>(sdfSpread);
+        FT_Property_Set(cache.library_, "sdf", "spread", &spread);
+        cache.sdfSpread_ = sdfSpread;
+    }
+    return iter->second.face_;
+}
+
+// 光栅化一个字形（FT_LOAD_RENDER，8位灰度；sdf为true时为距离场），位图按行紧密排列；非灰度位图（如彩色emoji）只保留度量
+static void rasterizeGlyph_helper(FT_Face face, RasterizedGlyph *glyph, bool sdf) {
+    glyph->metrics_ = GlyphMetrics();
+    glyph->bitmap_.clear();
+    if (FT_Load_Glyph(face, glyph->glyphIndex_, sdf ? FT_LOAD_DEFAULT : FT_LOAD_RENDER)) {
+        return; // 加载失败的字形按空白处理
+    }
+    FT_GlyphSlot slot = face->glyph;
+    if (sdf && slot->format == FT_GLYPH_FORMAT_OUTLINE && slot->outline.n_points > 0 &&
+        FT_Render_Glyph(slot, FT_RENDER_MODE_SDF)) {
+        glyph->metrics_.advance_ = static_cast<float>(slot->advance.x) / 64.0f;
+        return;
+    }
+    glyph->metrics_.advance_ = static_cast<float>(slot->advance.x) / 64.0f; // 26.6定点数
+    FT_Bitmap *bitmap = &slot->bitmap;
+    if (bitmap->pixel_mode != FT_PIXEL_MODE_GRAY || bitmap->width == 0 || bitmap->rows == 0) {
+        return;
+    }
+    int rows = bitmap->rows;
+    int cols = bitmap->width;
+    glyph->metrics_.left_ = slot->bitmap_left;
+    glyph->metrics_.top_ = slot->bitmap_top;
+    glyph->metrics_.width_ = cols;
+    glyph->metrics_.height_ = rows;
+    glyph->bitmap_.resize(static_cast<size_t>(rows) * cols);
+    for (int j = 0; j < rows; j++) { // pitch可能大于宽度
+        memcpy(glyph->bitmap_.data() + j * cols, bitmap->buffer + j * bitmap->pitch, cols);
+    }
+}
+
+GlyphRasterizer::GlyphRasterizer(uint32_t threadCount) {
+    for (uint32_t i = 0; i < threadCount; i++) {
+        threads_.emplace_back(&GlyphRasterizer::workerLoop, this);
+    }
+}
+
+GlyphRasterizer::~GlyphRasterizer() {
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread &thread : threads_) {
+        thread.join();
+    }
+}
+
+uint32_t GlyphRasterizer::getGlyphIndex(const std::string &fontPath, float pixelHeight, uint32_t codepoint) {
+    return FT_Get_Char_Index(acquireFace_helper(fontPath, pixelHeight), codepoint);
+}
+
+void GlyphRasterizer::rasterizeSerial(const std::string &fontPath, float pixelHeight, RasterizedGlyph *glyphs, size_t count,
+                                      uint32_t sdfSpread) {
+    FT_Face face = acquireFace_helper(fontPath, pixelHeight, sdfSpread);
+    for (size_t i = 0; i < count; i++) {
+        rasterizeGlyph_helper(face, &glyphs[i], sdfSpread != 0);
+    }
+    glyphCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+void GlyphRasterizer::rasterize(const std::string &fontPath, float pixelHeight, std::vector<RasterizedGlyph> &glyphs, uint32_t sdfSpread) {
+    if (threads_.empty() || glyphs.size() < MIN_PARALLEL_GLYPHS) {
+        rasterizeSerial(fontPath, pixelHeight, glyphs.data(), glyphs.size(), sdfSpread);
+        return;
+    }
+
+    ATrace_beginSection("rasterizeGlyphsParallel");
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->fontPath_ = fontPath;
+    job->pixelHeight_ = pixelHeight;
+    job->sdfSpread_ = sdfSpread;
+    job->glyphs_ = glyphs.data();
+    job->count_ = glyphs.size();
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        jobs_.push_back(job);
+    }
+    cv_.notify_all();
+    parallelBatchCount.fetch_add(1, std::memory_order_relaxed);
+
+    // 调用线程同样领取段，光栅化线程都在忙时由调用线程完成全部
+    size_t ownCount = runChunks(*job);
+    {
+        std::unique_lock<std::mutex> locker(job->mutex_);
+        job->cv_.wait(locker, [&job] { return job->done_ == job->count_; });
+    }
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        auto iter = std::find(jobs_.begin(), jobs_.end(), job); // 光栅化线程尚未移除时由调用线程移除
+        if (iter != jobs_.end()) {
+            jobs_.erase(iter);
+        }
+    }
+    helperGlyphCount.fetch_add(job->count_ - ownCount, std::memory_order_relaxed);
+    ATrace_endSection();
+}
+
+size_t GlyphRasterizer::runChunks(Job &job) {
+    size_t completed = 0;
+    while (true) {
+        size_t begin = job.next_.fetch_add(CHUNK_SIZE, std::memory_order_relaxed);
+        if (begin >= job.count_) {
+            break;
+        }
+        size_t count = std::min(CHUNK_SIZE, job.count_ - begin);
+        try {
+            rasterizeSerial(job.fontPath_, job.pixelHeight_, job.glyphs_ + begin, count, job.sdfSpread_);
+        } catch (const std::exception &e) {
+            // 调用线程已用同一字体查找过字形id，此处只在打开失败等异常情况下走到，这些字形按空白处理
+            LOGE("GlyphRasterizer: %s (%s)", e.what(), job.fontPath_.c_str());
+        }
+        completed += count;
+
+        std::lock_guard<std::mutex> locker(job.mutex_);
+        job.done_ += count;
+        if (job.done_ == job.count_) {
+            job.cv_.notify_all();
+        }
+    }
+    return completed;
+}
+
+void GlyphRasterizer::workerLoop() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> locker(mutex_);
+            cv_.wait(locker, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            job = jobs_.front();
+            if (job->next_.load(std::memory_order_relaxed) >= job->count_) {
+                jobs_.pop_front(); // 所有段都已被领取
+                continue;
+            }
+        }
+        runChunks(*job);
+    }
+}
+
+GlyphRasterizerStats GlyphRasterizer::getStats() {
+    GlyphRasterizerStats stats;
+    stats.faceOpenCount_ = faceOpenCount.load();
+    stats.faceOpenTimeNs_ = faceOpenTimeNs.load();
+    stats.glyphCount_ = glyphCount.load();
+    stats.parallelBatchCount_ = parallelBatchCount.load();
+    stats.helperGlyphCount_ = helperGlyphCount.load();
+    return stats;
+}
+
+void GlyphRasterizer::dump() {
+    GlyphRasterizerStats stats = getStats();
+    LOGI("GlyphRasterizer: %llu faces opened (%.3f ms), %llu glyphs rasterized, %llu parallel batches (%llu glyphs on helper threads)",
+         (unsigned long long) stats.faceOpenCount_, stats.faceOpenTimeNs_ / 1e6, (unsigned long long) stats.glyphCount_,
+         (unsigned long long) stats.parallelBatchCount_, (unsigned long long) stats.helperGlyphCount_);
+}
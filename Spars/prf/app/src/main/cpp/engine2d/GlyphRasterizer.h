@@ -0,0 +1,96 @@
+#ifndef PRF_GLYPHRASTERIZER_H
+#define PRF_GLYPHRASTERIZER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 一个字形在atlas页中的纹理坐标与绘制度量（像素）
+struct GlyphMetrics {
+    float uvLeft_ = 0.0f;
+    float uvTop_ = 0.0f;
+    float uvRight_ = 0.0f;
+    float uvBottom_ = 0.0f;
+    int left_ = 0; // 相对笔位置的左边距
+    int top_ = 0; // 基线以上的高度
+    int width_ = 0; // 位图宽高，为0时（如空格）没有位图，只前进
+    int height_ = 0;
+    float advance_ = 0.0f; // 笔位置的前进量
+};
+
+// 光栅化后的一个字形（CPU侧）
+struct RasterizedGlyph {
+    uint32_t codepoint_ = 0;
+    uint32_t glyphIndex_ = 0; // 字体中的字形id
+    GlyphMetrics metrics_; // 纹理坐标在放入atlas后填写
+    std::vector<unsigned char> bitmap_; // R8，width_ x height_（SDF时为距离，128为轮廓，越大越靠内）
+};
+
+// 光栅化统计信息
+struct GlyphRasterizerStats {
+    uint64_t faceOpenCount_ = 0; // 所有线程打开字体文件（FT_New_Face）的次数
+    uint64_t faceOpenTimeNs_ = 0;
+    uint64_t glyphCount_ = 0; // 光栅化的字形数
+    uint64_t parallelBatchCount_ = 0; // 拆分给光栅化线程的批次数
+    uint64_t helperGlyphCount_ = 0; // 其中由光栅化线程（而非调用线程）完成的字形数
+};
+
+/*
+ * 字形光栅化（FreeType，FT_LOAD_RENDER一次得到位图与度量）
+ * sdfSpread不为0时改为有向距离场（FT_RENDER_MODE_SDF）：位图在轮廓外延伸sdfSpread像素，像素值为到轮廓的距离映射到[0, 255]
+ * FreeType的library与face不能跨线程共享：每个线程持有自己的FT_Library与已打开的FT_Face，每个字体文件在每个线程中只打开一次，
+ * 线程退出时关闭
+ * 一批字形较多时拆分为CHUNK_SIZE个一段，调用线程与空闲的光栅化线程并行领取，调用线程始终参与，因此不会比单线程慢
+ */
+class GlyphRasterizer {
+public:
+    GlyphRasterizer(uint32_t threadCount); // threadCount为0时只在调用线程中光栅化
+    ~GlyphRasterizer(); // 停止光栅化线程（等待已领取的段完成）
+
+    // 光栅化一批字形（codepoint_与glyphIndex_已填写），结果写回glyphs，阻塞直到全部完成（任意线程调用）
+    void rasterize(const std::string &fontPath, float pixelHeight, std::vector<RasterizedGlyph> &glyphs, uint32_t sdfSpread = 0);
+
+    // 查找字符对应的字形id（使用调用线程的face），字体中没有的字符为0号字形
+    static uint32_t getGlyphIndex(const std::string &fontPath, float pixelHeight, uint32_t codepoint);
+    // 在调用线程中光栅化count个字形
+    static void rasterizeSerial(const std::string &fontPath, float pixelHeight, RasterizedGlyph *glyphs, size_t count,
+                                uint32_t sdfSpread = 0);
+
+    static GlyphRasterizerStats getStats();
+    static void dump(); // 以log的形式打印 for debug
+
+private:
+    // 一批字形，各线程按段领取
+    struct Job {
+        std::string fontPath_;
+        float pixelHeight_;
+        uint32_t sdfSpread_;
+        RasterizedGlyph *glyphs_;
+        size_t count_;
+        std::atomic<size_t> next_{0}; // 下一个未领取的字形
+        std::mutex mutex_;
+        std::condition_variable cv_; // 所有段完成时唤醒调用线程
+        size_t done_ = 0; // 已完成的字形数，受mutex_保护
+    };
+
+    const size_t CHUNK_SIZE = 16;
+    const size_t MIN_PARALLEL_GLYPHS = 32; // 少于此数时直接在调用线程中光栅化
+
+    std::mutex mutex_; // 保护下面的队列
+    std::condition_variable cv_;
+    std::deque<std::shared_ptr<Job>> jobs_; // 仍有未领取段的批次
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void workerLoop();
+    size_t runChunks(Job &job); // 领取并完成段，直到没有未领取的段，返回完成的字形数
+};
+
+
+#endif //PRF_GLYPHRASTERIZER_H
@@ -0,0 +1,233 @@
+#include "GlyphRasterizerBenchmark.h"
+#include "GlyphManager.h"
+#include "GlyphRasterizer.h"
+#include "../renderTree/RenderNode.h"
+#include "../renderTree/AnimationsList.h"
+#include "../treeParser/TreeParser.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static const char *GLYPH_BENCHMARK_SCENES[] = {"RSTree/investment-X5.txt", "RSTree/chatting-X5.txt"};
+
+// 收集子树中每种字体大小用到的字符
+static void collectTexts_helper(RenderNode *node, std::unordered_map<Text, std::unordered_set<uint32_t>, TextHash> &texts) {
+    for (uint32_t i = 0; i < node->drawCmdCount(); i++) {
+        std::shared_ptr<DrawCmd> drawCmd = node->getDrawCmd(i);
+        if (drawCmd->getType() != TEXT_DRAWCMD) {
+            continue;
+        }
+        Text &text = std::static_pointer_cast<TextDrawCmd>(drawCmd)->text_;
+        std::vector<uint32_t> codepoints;
+        Text::decodeUtf8(text.str_, &codepoints);
+        texts[text].insert(codepoints.begin(), codepoints.end());
+    }
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        collectTexts_helper(node->getChild(i), texts);
+    }
+}
+
+// 释放整棵渲染树（RenderNode的析构函数不释放子节点）
+static void deleteTree_helper(RenderNode *node) {
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        deleteTree_helper(node->getChild(i));
+    }
+    delete node;
+}
+
+// 待光栅化的字形（字形id在调用线程中查找）
+static std::vector<RasterizedGlyph> makeGlyphs_helper(const Text &text, const std::vector<uint32_t> &codepoints) {
+    std::vector<RasterizedGlyph> glyphs(codepoints.size());
+    for (size_t i = 0; i < codepoints.size(); i++) {
+        glyphs[i].codepoint_ = codepoints[i];
+        glyphs[i].glyphIndex_ = GlyphRasterizer::getGlyphIndex(text.fontPath_, text.pixelHeight_, codepoints[i]);
+    }
+    return glyphs;
+}
+
+// atlas中字形占用的像素（含1像素边框，与GlyphManager的装箱一致）
+static uint64_t atlasPixels_helper(const std::vector<RasterizedGlyph> &glyphs) {
+    uint64_t pixels = 0;
+    for (const RasterizedGlyph &glyph : glyphs) {
+        if (!glyph.bitmap_.empty()) {
+            pixels += static_cast<uint64_t>(glyph.metrics_.width_ + 2) * (glyph.metrics_.height_ + 2);
+        }
+    }
+    return pixels;
+}
+
+// 在距离场位图中双线性采样（坐标以像素为单位，像素中心在+0.5处），位图外为0（远离轮廓的外部）
+static float sampleSdf_helper(const RasterizedGlyph &sdf, float u, float v) {
+    const GlyphMetrics &m = sdf.metrics_;
+    float x = u - 0.5f, y = v - 0.5f;
+    int x0 = static_cast<int>(std::floor(x)), y0 = static_cast<int>(std::floor(y));
+    float fx = x - x0, fy = y - y0;
+    auto texel = [&sdf, &m](int tx, int ty) -> float {
+        if (tx < 0 || ty < 0 || tx >= m.width_ || ty >= m.height_) {
+            return 0.0f;
+        }
+        return sdf.bitmap_[static_cast<size_t>(ty) * m.width_ + tx] / 255.0f;
+    };
+    float top = texel(x0, y0) * (1.0f - fx) + texel(x0 + 1, y0) * fx;
+    float bottom = texel(x0, y0 + 1) * (1.0f - fx) + texel(x0 + 1, y0 + 1) * fx;
+    return top * (1.0f - fy) + bottom * fy;
+}
+
+// 以scale绘制时参考位图(x, y)像素中心处的距离值
+static float sdfAt_helper(const RasterizedGlyph &sdf, const GlyphMetrics &ref, float scale, float x, float y) {
+    float gx = (ref.left_ + x + 0.5f) / scale; // 相对笔位置，y向上
+    float gy = (ref.top_ - y - 0.5f) / scale;
+    return sampleSdf_helper(sdf, gx - sdf.metrics_.left_, sdf.metrics_.top_ - gy);
+}
+
+static float smoothstep_helper(float edge0, float edge1, float x) {
+    float t = std::min(std::max((x - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// 累加一个字形重建覆盖率与参考覆盖率的误差
+static void accumulateSdfError_helper(const RasterizedGlyph &ref, const RasterizedGlyph &sdf, float scale,
+                                      double *errorSum, float *errorMax, uint64_t *pixelCount) {
+    const GlyphMetrics &m = ref.metrics_;
+    for (int y = 0; y < m.height_; y++) {
+        for (int x = 0; x < m.width_; x++) {
+            float dist = sdfAt_helper(sdf, m, scale, x, y);
+            float fwidth = std::fabs(sdfAt_helper(sdf, m, scale, x + 1, y) - dist) +
+                           std::fabs(sdfAt_helper(sdf, m, scale, x, y + 1) - dist);
+            float width = std::max(0.5f * fwidth, 1e-4f);
+            float alpha = smoothstep_helper(0.5f - width, 0.5f + width, dist);
+            float error = std::fabs(alpha - ref.bitmap_[static_cast<size_t>(y) * m.width_ + x] / 255.0f);
+            *errorSum += error;
+            *errorMax = std::max(*errorMax, error);
+            (*pixelCount)++;
+        }
+    }
+}
+
+static double elapsedMs_helper(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void runGlyphRasterizerBenchmark(android_app *app, uint32_t threadCount) {
+    GlyphRasterizer rasterizer(threadCount);
+
+    for (const char *scene : GLYPH_BENCHMARK_SCENES) {
+        TreeParser treeParser;
+        AnimationsList animationsList;
+        int32_t width, height;
+        RenderNode *rootNode = treeParser.parse(app, scene, width, height, &animationsList);
+        std::unordered_map<Text, std::unordered_set<uint32_t>, TextHash> texts;
+        collectTexts_helper(rootNode, texts);
+        deleteTree_helper(rootNode);
+
+        double totalColdMs = 0.0, totalWarmMs = 0.0, totalParallelMs = 0.0;
+        for (auto &iter : texts) {
+            const Text &text = iter.first;
+            std::vector<uint32_t> codepoints(iter.second.begin(), iter.second.end());
+            std::sort(codepoints.begin(), codepoints.end());
+
+            // 新线程中没有缓存的face：第一次为打开字体加光栅化，第二次只有光栅化
+            double coldMs = 0.0, warmMs = 0.0;
+            std::thread thread([&text, &codepoints, &coldMs, &warmMs] {
+                auto start = std::chrono::steady_clock::now();
+                std::vector<RasterizedGlyph> glyphs = makeGlyphs_helper(text, codepoints);
+                GlyphRasterizer::rasterizeSerial(text.fontPath_, text.pixelHeight_, glyphs.data(), glyphs.size());
+                coldMs = elapsedMs_helper(start);
+
+                start = std::chrono::steady_clock::now();
+                glyphs = makeGlyphs_helper(text, codepoints);
+                GlyphRasterizer::rasterizeSerial(text.fontPath_, text.pixelHeight_, glyphs.data(), glyphs.size());
+                warmMs = elapsedMs_helper(start);
+            });
+            thread.join();
+
+            // 并行：先预热一次，使调用线程与辅助线程都已打开该字体
+            std::vector<RasterizedGlyph> glyphs = makeGlyphs_helper(text, codepoints);
+            rasterizer.rasterize(text.fontPath_, text.pixelHeight_, glyphs);
+            auto start = std::chrono::steady_clock::now();
+            glyphs = makeGlyphs_helper(text, codepoints);
+            rasterizer.rasterize(text.fontPath_, text.pixelHeight_, glyphs);
+            double parallelMs = elapsedMs_helper(start);
+
+            LOGI("glyph raster benchmark [%s] %s %.0fpx: %zu glyphs, open + rasterize %.3f ms, cached face %.3f ms, parallel (%u helper threads) %.3f ms",
+                 scene, text.fontPath_.c_str(), text.pixelHeight_, codepoints.size(), coldMs, warmMs, threadCount, parallelMs);
+            totalColdMs += coldMs;
+            totalWarmMs += warmMs;
+            totalParallelMs += parallelMs;
+        }
+        LOGI("glyph raster benchmark [%s]: %zu font sizes, open + rasterize %.3f ms, cached face %.3f ms, parallel %.3f ms",
+             scene, texts.size(), totalColdMs, totalWarmMs, totalParallelMs);
+    }
+    GlyphRasterizer::dump();
+}
+
+void runSdfTextBenchmark(android_app *app, float basePixelHeight, uint32_t spread) {
+    for (const char *scene : GLYPH_BENCHMARK_SCENES) {
+        TreeParser treeParser;
+        AnimationsList animationsList;
+        int32_t width, height;
+        RenderNode *rootNode = treeParser.parse(app, scene, width, height, &animationsList);
+        std::unordered_map<Text, std::unordered_set<uint32_t>, TextHash> texts;
+        collectTexts_helper(rootNode, texts);
+        deleteTree_helper(rootNode);
+
+        // 每种字体光栅化一次基准字号的距离场（所有字号用到的字符）
+        std::unordered_map<std::string, std::unordered_set<uint32_t>> fontCodepoints;
+        for (auto &iter : texts) {
+            fontCodepoints[iter.first.fontPath_].insert(iter.second.begin(), iter.second.end());
+        }
+        std::unordered_map<std::string, std::unordered_map<uint32_t, RasterizedGlyph>> sdfGlyphs;
+        uint64_t sdfPixels = 0;
+        for (auto &iter : fontCodepoints) {
+            Text baseText = Text::MakeText(0, 0, basePixelHeight, "", iter.first);
+            std::vector<uint32_t> codepoints(iter.second.begin(), iter.second.end());
+            std::vector<RasterizedGlyph> glyphs = makeGlyphs_helper(baseText, codepoints);
+            GlyphRasterizer::rasterizeSerial(iter.first, basePixelHeight, glyphs.data(), glyphs.size(), spread);
+            sdfPixels += atlasPixels_helper(glyphs);
+            for (RasterizedGlyph &glyph : glyphs) {
+                sdfGlyphs[iter.first][glyph.codepoint_] = std::move(glyph);
+            }
+        }
+
+        uint64_t bitmapPixels = 0;
+        double errorSum = 0.0;
+        float errorMax = 0.0f;
+        uint64_t pixelCount = 0;
+        for (auto &iter : texts) {
+            const Text &text = iter.first;
+            std::vector<uint32_t> codepoints(iter.second.begin(), iter.second.end());
+            std::vector<RasterizedGlyph> glyphs = makeGlyphs_helper(text, codepoints);
+            GlyphRasterizer::rasterizeSerial(text.fontPath_, text.pixelHeight_, glyphs.data(), glyphs.size());
+            bitmapPixels += atlasPixels_helper(glyphs);
+
+            double sizeErrorSum = 0.0;
+            float sizeErrorMax = 0.0f;
+            uint64_t sizePixelCount = 0;
+            float scale = text.pixelHeight_ / basePixelHeight;
+            for (const RasterizedGlyph &glyph : glyphs) {
+                if (!glyph.bitmap_.empty()) {
+                    accumulateSdfError_helper(glyph, sdfGlyphs[text.fontPath_][glyph.codepoint_], scale,
+                                              &sizeErrorSum, &sizeErrorMax, &sizePixelCount);
+                }
+            }
+            LOGI("sdf text benchmark [%s] %s %.0fpx: %zu glyphs, coverage error mean %.4f max %.4f over %llu pixels",
+                 scene, text.fontPath_.c_str(), text.pixelHeight_, codepoints.size(),
+                 sizePixelCount == 0 ? 0.0 : sizeErrorSum / sizePixelCount, sizeErrorMax, (unsigned long long) sizePixelCount);
+            errorSum += sizeErrorSum;
+            errorMax = std::max(errorMax, sizeErrorMax);
+            pixelCount += sizePixelCount;
+        }
+        LOGI("sdf text benchmark [%s]: bitmap %zu strikes %llu glyph pixels (%.1f KB), sdf %zu fonts at %.0fpx spread %u "
+             "%llu glyph pixels (%.1f KB), coverage error mean %.4f max %.4f",
+             scene, texts.size(), (unsigned long long) bitmapPixels, bitmapPixels / 1024.0, fontCodepoints.size(),
+             basePixelHeight, spread, (unsigned long long) sdfPixels, sdfPixels / 1024.0,
+             pixelCount == 0 ? 0.0 : errorSum / pixelCount, errorMax);
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef PRF_GLYPHRASTERIZERBENCHMARK_H
+#define PRF_GLYPHRASTERIZERBENCHMARK_H
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+/**
+ * 字形atlas创建耗时（GLYPH_RASTER_BENCHMARK）
+ * 解析investment与chatting场景，收集每种字体大小用到的字符，依次测试：新线程中打开字体并单线程光栅化（每个atlas重新打开字体）、
+ * 同一线程再次光栅化（字体已缓存）、GlyphRasterizer并行光栅化（threadCount个辅助线程），结果以log输出
+ */
+void runGlyphRasterizerBenchmark(android_app *app, uint32_t threadCount);
+
+/**
+ * SDF文本与位图文本的对比（SDF_TEXT_BENCHMARK）
+ * 对investment与chatting场景，统计位图strike数与SDF字体数、两者atlas中字形占用的像素，并以各字号的位图为基准，
+ * 在CPU上按text_sdf.frag的方式（双线性采样距离场、以相邻像素的差分作为fwidth做smoothstep）重建覆盖率，输出平均与最大误差
+ */
+void runSdfTextBenchmark(android_app *app, float basePixelHeight, uint32_t spread);
+
+#endif //PRF_GLYPHRASTERIZERBENCHMARK_H
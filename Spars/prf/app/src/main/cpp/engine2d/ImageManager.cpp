@@ -9,11 +9,20 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "ImageScaler.h"
 #include "PipelineManager.h"
+#include "ResourcePrefetcher.h"
+#include "SamplerDescriptorManager.h"
+#include "TextureDiskCache.h"
+#include "../utils/AssetFile.h"
 #include "../vulkan/utils.h"
 
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <android/trace.h>
+#include <sys/mman.h>
 
 std::size_t ImageHash::operator()(const Image& obj) const {
 //    std::size_t h1 = std::hash<float>()(obj.rect_.w_);
@@ -25,74 +34,390 @@ std::size_t ImageHash::operator()(const Image& obj) const {
     return h3;
 }
 
-ImageManager::ImageManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue) {
+void destroyImageInfo_helper(VkDevice device, VulkanImageInfo &imageInfo) {
+    // 销毁纹理图像（采样器来自SamplerCache，不随图片销毁）
+    vkDestroyImageView(device, imageInfo.textureImageView_, nullptr);
+    vkDestroyImage(device, imageInfo.textureImage_, nullptr);
+    vkFreeMemory(device, imageInfo.textureImageMemory_, nullptr);
+}
+
+ImageManager::ImageManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader,
+                           SamplerCache *samplerCache, uint64_t budgetBytes) {
     app_ = app;
     device_ = device;
     physicalDevice_ = physicalDevice;
-    commandPool_ = commandPool;
-    graphicsQueue_ = graphicsQueue;
+    textureUploader_ = textureUploader;
+    samplerCache_ = samplerCache;
+    budgetBytes_ = budgetBytes;
 }
 
 ImageManager::~ImageManager() {
+    stopLoader();
+
     std::unique_lock<std::shared_mutex> locker(mutex_);
     for(auto iter = imageMap_.begin(); iter != imageMap_.end(); iter++) {
-        VulkanImageInfo imageInfo = iter->second;
+        destroyImageInfo(iter->second.imageInfo_);
+    }
+    for (PendingDestroyImage &pending : pendingDestroyList_) {
+        destroyImageInfo(pending.imageInfo_);
+    }
+    delete atlas_; // 销毁所有atlas页
+}
+
+void ImageManager::destroyImageInfo(VulkanImageInfo &imageInfo) {
+    if (imageInfo.atlasRegion_.page_ >= 0) {
+        atlas_->free(imageInfo.atlasRegion_); // 页本身由atlas管理
+    } else {
+        destroyImageInfo_helper(device_, imageInfo);
+    }
+}
 
-        // 销毁采样器 TODO: 后续和image解耦开
-        vkDestroySampler(device_, imageInfo.textureSampler_, nullptr);
-        // 销毁纹理图像
-        vkDestroyImageView(device_, imageInfo.textureImageView_, nullptr);
-        vkDestroyImage(device_, imageInfo.textureImage_, nullptr);
-        vkFreeMemory(device_, imageInfo.textureImageMemory_, nullptr);
+// 记录条目在本帧被使用，已记录时不再写（避免各工作线程反复写同一缓存行）
+static void markUsed_helper(std::atomic<uint64_t> &lastUsedFrame, uint64_t frame) {
+    if (lastUsedFrame.load(std::memory_order_relaxed) != frame) {
+        lastUsedFrame.store(frame, std::memory_order_relaxed);
+    }
+}
 
+void ImageManager::checkSize(ImageEntry &entry, const Image &image) {
+    if (!decodeAtDisplaySize_) {
+        return;
+    }
+    const VulkanImageInfo &info = entry.imageInfo_;
+    int width = static_cast<int>(std::ceil(image.rect_.w_));
+    int height = static_cast<int>(std::ceil(image.rect_.h_));
+    // 只有被缩小过的方向才可能需要更大的纹理（源尺寸即上限，不放大）
+    bool tooSmall = (width > info.width_ && info.width_ < info.sourceWidth_) ||
+                    (height > info.height_ && info.height_ < info.sourceHeight_);
+    if (!tooSmall) {
+        return;
+    }
+    bool first = !entry.redecodeRequested_.exchange(true, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> sizeLocker(sizeMutex_);
+    std::pair<int, int> &size = requestedSizeMap_[image.path_];
+    size.first = std::max(size.first, width);
+    size.second = std::max(size.second, height);
+    if (first) {
+        redecodeList_.push_back(image);
     }
 }
 
 bool ImageManager::findImageInfo(Image &image, VulkanImageInfo *imageInfo) {
+    // 已驻留的纹理在快照中无锁查找
+    if (ImageEntry *const *found = snapshot_.find(image)) {
+        *imageInfo = (*found)->imageInfo_;
+        markUsed_helper((*found)->lastUsedFrame_, frameCounter_.load(std::memory_order_relaxed));
+        checkSize(**found, image);
+        hitCount_.add(1);
+        return true;
+    }
+
+    std::shared_future<void> pending;
     {
-        std::shared_lock<std::shared_mutex> locker(mutex_);
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        // 可能在快照查找之后刚创建完成
         auto iter = imageMap_.find(image);
         if (iter != imageMap_.end()) {
-            *imageInfo = iter->second;
+            *imageInfo = iter->second.imageInfo_;
+            markUsed_helper(iter->second.lastUsedFrame_, frameCounter_.load(std::memory_order_relaxed));
+            checkSize(iter->second, image);
+            hitCount_.add(1);
             return true;
         }
-    }
-    {
-        std::unique_lock<std::shared_mutex> locker(mutex_);
         // 未找到，判断是否有其他线程正在创建
-        auto iter2 = preparingMap_.find(image);
-        if (iter2 != preparingMap_.end()) { // 其他线程正在创建
-            cv_.wait(locker, [this, &image] {
-                return preparingMap_.find(image) == preparingMap_.end(); // 该资源已经不在准备列表中了
-            });
-
-            // 其他线程创建完毕了
-            auto iter3 = imageMap_.find(image);
-            if (iter3 != imageMap_.end()) {
-                *imageInfo = iter3->second;
-                return true;
-            }
-            // 此处不应该走到
-            throw std::runtime_error("ImageManager::findImageInfo error!");
-            return false;
-        } else {
+        if (!inFlight_.joinOrStart(image, &pending)) {
             // 我们是第一个创建的
-            preparingMap_[image] = true; // 将该资源加入准备列表，这个true不重要
+            missCount_.fetch_add(1, std::memory_order_relaxed);
             return false; // 需要我们后续创建
         }
+    }
 
+    // 其他线程正在创建，在锁外等待（只在该纹理完成时被唤醒），创建失败时此处抛出其异常
+    inFlight_.wait(pending);
+
+    // 其他线程创建完毕了（条目只在endFrame中删除，此时仍在）
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    auto iter = imageMap_.find(image);
+    if (iter != imageMap_.end()) {
+        *imageInfo = iter->second.imageInfo_;
+        checkSize(iter->second, image);
+        hitCount_.add(1);
+        return true;
     }
+    // 此处不应该走到
+    throw std::runtime_error("ImageManager::findImageInfo error!");
 }
 
 void ImageManager::createAndInsertImageInfo(Image &image, VulkanImageInfo *imageInfo) {
-    *imageInfo = createTextureImageInfo(image); // 解压过程很长，无需锁保护
+    try {
+        *imageInfo = createTextureImageInfo(image); // 解压过程很长，无需锁保护
+    } catch (...) {
+        // 创建失败，从准备列表移除，等待该纹理的任务抛出同一异常
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        inFlight_.fail(image, std::current_exception());
+        throw;
+    }
 
     std::unique_lock<std::shared_mutex> locker(mutex_);
-    imageMap_[image] = *imageInfo;
+    ImageEntry &entry = imageMap_[image];
+    entry.imageInfo_ = *imageInfo;
+    entry.lastUsedFrame_.store(frameCounter_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    bytes_ += imageInfo->bytes_;
+    snapshot_.insert(image, &entry); // 发布时条目已填写完整
+
+    // 资源创建完成，从准备列表移除，只唤醒等待该纹理的任务
+    inFlight_.complete(image);
+}
+
+bool ImageManager::findImageInfoNonBlocking(Image &image, VulkanImageInfo *imageInfo, uint32_t *placeholderColor) {
+    if (ImageEntry *const *found = snapshot_.find(image)) {
+        // 上传中的纹理同样算作使用，避免被淘汰
+        markUsed_helper((*found)->lastUsedFrame_, frameCounter_.load(std::memory_order_relaxed));
+        checkSize(**found, image);
+        if (textureUploader_->isComplete((*found)->imageInfo_.uploadTicket_)) {
+            *imageInfo = (*found)->imageInfo_;
+            hitCount_.add(1);
+            return true;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    if (imageMap_.find(image) == imageMap_.end() && !inFlight_.contains(image)) {
+        // 第一次未命中，交给后台线程加载，之后的帧继续使用占位颜色直到上传完成
+        inFlight_.start(image);
+        missCount_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> loadLocker(loadMutex_);
+            loadQueue_.push_back(image);
+        }
+        loadCv_.notify_one();
+    }
+    auto colorIter = averageColorMap_.find(image.path_);
+    *placeholderColor = colorIter != averageColorMap_.end() ? colorIter->second : DEFAULT_PLACEHOLDER_COLOR;
+    return false;
+}
+
+void ImageManager::startLoader(uint32_t threadCount) {
+    for (uint32_t i = 0; i < threadCount; i++) {
+        loaderThreads_.emplace_back(&ImageManager::loaderLoop, this);
+    }
+}
 
-    // 资源创建完成，从准备列表移除
-    preparingMap_.erase(image);
-    cv_.notify_all(); // 此唤醒会导致所有任务唤醒，尽管有些任务在等待其他资源创建完成
+void ImageManager::stopLoader() {
+    {
+        std::lock_guard<std::mutex> loadLocker(loadMutex_);
+        stopLoading_ = true;
+        loadQueue_.clear();
+    }
+    loadCv_.notify_all();
+    for (std::thread &thread : loaderThreads_) {
+        thread.join();
+    }
+    loaderThreads_.clear();
+}
+
+void ImageManager::setPrefetcher(ResourcePrefetcher *prefetcher) {
+    prefetcher_ = prefetcher;
+}
+
+void ImageManager::setDecodeOptions(bool decodeAtDisplaySize, bool mipmaps) {
+    decodeAtDisplaySize_ = decodeAtDisplaySize;
+    mipmaps_ = mipmaps;
+}
+
+void ImageManager::setDiskCache(TextureDiskCache *diskCache) {
+    diskCache_ = diskCache;
+}
+
+void ImageManager::enableAtlas(uint32_t pageSize, uint32_t maxPages, uint32_t maxImageSize) {
+    atlas_ = new TextureAtlas(device_, physicalDevice_, textureUploader_, samplerCache_, pageSize, maxPages);
+    atlasMaxImageSize_ = maxImageSize;
+}
+
+bool ImageManager::findAtlasPage(Image &image, int32_t *page) {
+    ImageEntry *const *found = snapshot_.find(image);
+    if (found == nullptr || (*found)->imageInfo_.atlasRegion_.page_ < 0 ||
+        !textureUploader_->isComplete((*found)->imageInfo_.uploadTicket_)) {
+        return false;
+    }
+    // 合批后的绘制任务假设其中的图片都可以直接采样，记录使用使其在本帧的endFrame中不被淘汰
+    markUsed_helper((*found)->lastUsedFrame_, frameCounter_.load(std::memory_order_relaxed));
+    *page = (*found)->imageInfo_.atlasRegion_.page_;
+    return true;
+}
+
+void ImageManager::endFrame(SamplerDescriptorManager *samplerDescriptorManager) {
+    uint64_t frame = frameCounter_.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    snapshot_.reclaim(); // 工作线程空闲，上一帧发布的旧快照不再被读取
+
+    // 销毁到期的已淘汰纹理：GPU不再使用，且其上传已完成
+    auto pendingEnd = std::remove_if(pendingDestroyList_.begin(), pendingDestroyList_.end(),
+                                     [this, frame, samplerDescriptorManager](PendingDestroyImage &pending) {
+        if (frame < pending.evictFrame_ + DESTROY_DELAY_FRAMES || !textureUploader_->isComplete(pending.imageInfo_.uploadTicket_)) {
+            return false;
+        }
+        if (pending.imageInfo_.atlasRegion_.page_ < 0) {
+            // atlas页的descriptor由该页所有图片共享，不回收
+            samplerDescriptorManager->releaseSamplerDescriptor(pending.imageInfo_.textureImageView_);
+        }
+        destroyImageInfo(pending.imageInfo_);
+        return true;
+    });
+    pendingDestroyList_.erase(pendingEnd, pendingDestroyList_.end());
+
+    // 小于之后绘制尺寸的纹理：现在淘汰，下次使用时按记录的最大绘制尺寸重新解码。
+    // 下一帧的绘制任务已在此之前生成，合批的atlas图片已假设驻留在所在页，因此atlas中上一帧用过的图片与LRU淘汰一样跳过，
+    // 留在列表中等之后的帧再淘汰；独立纹理由工作线程在绘制时查找，可以立即淘汰
+    std::vector<Image> evicted;
+    std::vector<Image> redecodeList;
+    std::vector<Image> deferredList;
+    {
+        std::lock_guard<std::mutex> sizeLocker(sizeMutex_);
+        redecodeList.swap(redecodeList_);
+    }
+    for (const Image &image : redecodeList) {
+        auto iter = imageMap_.find(image);
+        if (iter == imageMap_.end()) {
+            continue;
+        }
+        uint64_t lastUsed = iter->second.lastUsedFrame_.load(std::memory_order_relaxed);
+        if (iter->second.imageInfo_.atlasRegion_.page_ >= 0 && lastUsed + 1 >= frame) {
+            deferredList.push_back(image); // redecodeRequested_保持为true，checkSize不会重复加入
+            continue;
+        }
+        bytes_ -= iter->second.imageInfo_.bytes_;
+        pendingDestroyList_.push_back({iter->second.imageInfo_, frame});
+        evicted.push_back(iter->first);
+        imageMap_.erase(iter);
+        redecodeCount_++;
+    }
+    if (!deferredList.empty()) {
+        std::lock_guard<std::mutex> sizeLocker(sizeMutex_);
+        redecodeList_.insert(redecodeList_.end(), deferredList.begin(), deferredList.end());
+    }
+
+    // 超出预算，按最近使用的帧从旧到新淘汰，上一帧用过的纹理不淘汰（此时工作集本身超出预算，允许暂时超出）
+    std::vector<std::pair<uint64_t, const Image *>> candidates;
+    for (auto &iter : imageMap_) {
+        if (bytes_ <= budgetBytes_) {
+            break;
+        }
+        uint64_t lastUsed = iter.second.lastUsedFrame_.load(std::memory_order_relaxed);
+        if (lastUsed + 1 < frame) {
+            candidates.emplace_back(lastUsed, &iter.first);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const std::pair<uint64_t, const Image *> &a, const std::pair<uint64_t, const Image *> &b) {
+        return a.first < b.first;
+    });
+    for (auto &candidate : candidates) {
+        if (bytes_ <= budgetBytes_) {
+            break;
+        }
+        auto iter = imageMap_.find(*candidate.second);
+        bytes_ -= iter->second.imageInfo_.bytes_;
+        pendingDestroyList_.push_back({iter->second.imageInfo_, frame});
+        evicted.push_back(iter->first);
+        imageMap_.erase(iter);
+        evictCount_++;
+    }
+    if (!evicted.empty()) {
+        // 一次发布不含淘汰条目的快照，之前的快照引用了已删除的条目，立即释放
+        snapshot_.update([&evicted](SnapshotMap<Image, ImageEntry *, ImageHash>::Map &map) {
+            for (const Image &image : evicted) {
+                map.erase(image);
+            }
+        });
+        snapshot_.reclaim();
+    }
+}
+
+TextureCacheStats ImageManager::getStats() {
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    TextureCacheStats stats;
+    stats.entryCount_ = imageMap_.size();
+    stats.bytes_ = bytes_;
+    stats.hitCount_ = hitCount_.load();
+    stats.missCount_ = missCount_.load();
+    stats.evictCount_ = evictCount_;
+    stats.redecodeCount_ = redecodeCount_;
+    stats.pendingDestroyCount_ = pendingDestroyList_.size();
+    stats.decodeTimeNs_ = decodeTimeNs_;
+    stats.resizeTimeNs_ = resizeTimeNs_;
+    stats.sourceBytes_ = sourceBytes_;
+    stats.createdBytes_ = createdBytes_;
+    stats.objectCreateCount_ = objectCreateCount_;
+    stats.objectCreateTimeNs_ = objectCreateTimeNs_;
+    for (auto &iter : imageMap_) {
+        if (iter.second.imageInfo_.atlasRegion_.page_ >= 0) {
+            stats.atlasedCount_++;
+        } else {
+            stats.imageAllocationCount_++;
+        }
+    }
+    for (PendingDestroyImage &pending : pendingDestroyList_) {
+        if (pending.imageInfo_.atlasRegion_.page_ < 0) {
+            stats.imageAllocationCount_++;
+        }
+    }
+    if (atlas_ != nullptr) {
+        stats.atlasPageCount_ = atlas_->getPageCount();
+        stats.imageAllocationCount_ += stats.atlasPageCount_;
+    }
+    return stats;
+}
+
+InFlightStats ImageManager::getInFlightStats() {
+    return inFlight_.getStats();
+}
+
+void ImageManager::dump() {
+    TextureCacheStats stats = getStats();
+    uint64_t lookups = stats.hitCount_ + stats.missCount_;
+    LOGI("ImageManager: %llu textures, %.2f MB / %.2f MB, hit %llu, miss %llu (hit rate %.1f%%), evicted %llu, redecoded %llu, pending destroy %llu",
+         (unsigned long long) stats.entryCount_, stats.bytes_ / 1048576.0, budgetBytes_ / 1048576.0,
+         (unsigned long long) stats.hitCount_, (unsigned long long) stats.missCount_,
+         lookups == 0 ? 0.0 : 100.0 * stats.hitCount_ / lookups,
+         (unsigned long long) stats.evictCount_, (unsigned long long) stats.redecodeCount_,
+         (unsigned long long) stats.pendingDestroyCount_);
+    LOGI("ImageManager: %llu textures in %llu atlas pages, %llu image memory allocations",
+         (unsigned long long) stats.atlasedCount_, (unsigned long long) stats.atlasPageCount_,
+         (unsigned long long) stats.imageAllocationCount_);
+    LOGI("ImageManager: decode %.3f ms, resize %.3f ms, created %.2f MB of textures (%.2f MB at source size), decode at display size %s, mipmaps %s",
+         stats.decodeTimeNs_ / 1e6, stats.resizeTimeNs_ / 1e6, stats.createdBytes_ / 1048576.0, stats.sourceBytes_ / 1048576.0,
+         decodeAtDisplaySize_ ? "on" : "off", mipmaps_ ? "on" : "off");
+    LOGI("ImageManager: created %llu standalone textures, image/view/sampler creation %.3f ms (%.3f us per texture)",
+         (unsigned long long) stats.objectCreateCount_, stats.objectCreateTimeNs_ / 1e6,
+         stats.objectCreateCount_ == 0 ? 0.0 : stats.objectCreateTimeNs_ / 1e3 / stats.objectCreateCount_);
+}
+
+void ImageManager::loaderLoop() {
+    while (true) {
+        Image image = Image::MakeImage(Rect::MakeXYWH(0, 0, 0, 0), "");
+        {
+            std::unique_lock<std::mutex> loadLocker(loadMutex_);
+            loadCv_.wait(loadLocker, [this] {
+                return stopLoading_ || !loadQueue_.empty();
+            });
+            if (stopLoading_) {
+                return;
+            }
+            image = loadQueue_.front();
+            loadQueue_.pop_front();
+        }
+
+        // 解码、暂存与录制上传在后台完成，上传由主线程随下一帧提交
+        VulkanImageInfo imageInfo;
+        try {
+            createAndInsertImageInfo(image, &imageInfo);
+        } catch (const std::exception &e) {
+            // 已从准备列表移除，之后的帧再次未命中时重新加载，期间继续使用占位颜色
+            LOGE("ImageManager::loaderLoop load %s failed: %s", image.path_.c_str(), e.what());
+        }
+    }
 }
 
 // ================================== 以下为一些辅助函数 ==================================
@@ -118,42 +443,8 @@ static uint32_t findMemoryType_helper(VkPhysicalDevice physicalDevice, uint32_t
 }
 
 
-/**
- * 创建缓冲的辅助函数
- * 可以使用不同的大小、usage、properties
- */
-static void createBuffer_helper(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size,
-                                VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer, VkDeviceMemory &bufferMemory)
-{
-    VkBufferCreateInfo bufferInfo = {};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = size;
-    bufferInfo.usage = usage;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create buffer!");
-    }
-
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType_helper(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate buffer memory!");
-    }
-
-    vkBindBufferMemory(device, buffer, bufferMemory, 0);
-}
-
 // 创建图像及图像内存
-static void createImage_helper(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
+static void createImage_helper(VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader, uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling,
                                VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image, VkDeviceMemory &imageMemory)
 {
     // 创建图像
@@ -163,13 +454,13 @@ static void createImage_helper(VkDevice device, VkPhysicalDevice physicalDevice,
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling; // VK_IMAGE_TILING_OPTIMAL以对访问优化的方式排列。VK_IMAGE_TILING_LINEAR，纹素以行主序的方式排列
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = usage;                           // 作为接收方、会被着色器采样
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE; // 图像对象只被传输队列族使用
+    textureUploader->setImageSharingMode(&imageInfo); // 上传与采样位于不同队列族时为CONCURRENT
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;         // 多重采样（只对用作附着的图像有效，这里无关）
     imageInfo.flags = 0;                               // Optional
 
@@ -195,137 +486,11 @@ static void createImage_helper(VkDevice device, VkPhysicalDevice physicalDevice,
     vkBindImageMemory(device, image, imageMemory, 0); // 将图像对象和内存相关联
 }
 
-// 从指令池中分配指令缓冲，并开始记录
-// TODO: commandPool需要单独管理并加锁
-static VkCommandBuffer beginSingleTimeCommands_helper(VkDevice device, VkCommandPool commandPool)
-{
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool; // TODO: 我们使用同样的指令池（用独立的会性能更好，因为内存传输指令的指令缓冲通常生命周期很短暂）
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-    // 开始记录内存传输指令
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // 只使用该指令一次
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    return commandBuffer;
-}
-
-static std::mutex mtx; // TODO: 临时方案，将queueSubmit加锁避免多线程同时提交
-// 结束记录、提交指令缓冲、并等待完成
-void endSingleTimeCommands_helper(VkCommandBuffer commandBuffer, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue)
-{
-    // 结束记录
-    vkEndCommandBuffer(commandBuffer);
-
-    // 提交指令缓冲，完成传输
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-    {
-        std::unique_lock lck(mtx);
-        // TODO: 这里会出现多线程使用一个graphicsQueue提交指令，可能会有冲突，需单独拿出来管理
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    }
-
-    vkQueueWaitIdle(graphicsQueue); // 等待 // TODO: 等待看样子是唯一办法？
-
-    // 传输完成，清除指令缓冲
-    vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-}
-
-// 变换图像布局
-static void transitionImageLayout_helper(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkImage image, VkFormat format,
-                                         VkImageLayout oldLayout, VkImageLayout newLayout)
-{
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands_helper(device, commandPool);
-
-    VkImageMemoryBarrier barrier = {}; // 管线屏障，保障诸如图像在读取之前被写入（缓冲对象也有类似的）
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // 传递队列所有权时使用
-
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1; // 我们的图形不存在细分级别
-
-    barrier.srcAccessMask = 0; // later
-    barrier.dstAccessMask = 0; // later
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    // 传输的变换
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0; // 写入操作不需等待任何对象
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;   // 最早出现的管线阶段
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT; // 伪阶段。传输阶段
-    }
-        // 采样前的变换
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT; // 片段着色器管线阶段的读取访问掩码
-    }
-    else
-    {
-        throw std::invalid_argument("unsupported layout transition!");
-    }
-
-    vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-    endSingleTimeCommands_helper(commandBuffer, device, commandPool, graphicsQueue);
-}
-
-// 复制缓冲到图像
-static void copyBufferToImage_helper(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue,
-                                     VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
-{
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands_helper(device, commandPool);
-
-    // 指定将数据复制到图像那一部分
-    VkBufferImageCopy region = {};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0; // 在内存中紧凑存放
-    region.bufferImageHeight = 0;
-    // 下面是指定复制到图像中的哪一部分
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {width, height, 1};
-
-    vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    endSingleTimeCommands_helper(commandBuffer, device, commandPool, graphicsQueue);
-}
-
 
 /**
  * 根据要求创建图像视图
  */
-static VkImageView createImageView(VkDevice device, VkImage image, VkFormat format)
+static VkImageView createImageView(VkDevice device, VkImage image, VkFormat format, uint32_t mipLevels)
 {
     VkImageViewCreateInfo viewInfo = {};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -343,7 +508,7 @@ static VkImageView createImageView(VkDevice device, VkImage image, VkFormat form
     // subresourceRange指定图像用途和哪一部分可以被使用
     viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -357,127 +522,268 @@ static VkImageView createImageView(VkDevice device, VkImage image, VkFormat form
 }
 
 
-// 创建采样器对象
-static VkSampler createTextureSampler(VkDevice device)
+// 计算RGBA8像素的平均色（ARGB），最多采样约4096个像素
+static uint32_t averageColor_helper(const unsigned char *pixels, int pixelCount)
 {
-    // 指定采样器使用的过滤和变换操作
-    VkSamplerCreateInfo samplerInfo = {};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    int step = pixelCount > 4096 ? pixelCount / 4096 : 1;
+    uint64_t sum[4] = {0, 0, 0, 0};
+    uint64_t count = 0;
+    for (int i = 0; i < pixelCount; i += step) {
+        const unsigned char *p = pixels + static_cast<size_t>(i) * 4;
+        sum[0] += p[0];
+        sum[1] += p[1];
+        sum[2] += p[2];
+        sum[3] += p[3];
+        count++;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    uint32_t r = static_cast<uint32_t>(sum[0] / count);
+    uint32_t g = static_cast<uint32_t>(sum[1] / count);
+    uint32_t b = static_cast<uint32_t>(sum[2] / count);
+    uint32_t a = static_cast<uint32_t>(sum[3] / count);
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// ================================== 以上为一些辅助函数 ==================================
 
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT; // 超出图像范围时重复纹理（像地转平铺纹理）
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 
-    // 各向异性过滤
-    samplerInfo.anisotropyEnable = VK_FALSE;
-    // samplerInfo.maxAnisotropy = 16;
 
-    // 边界颜色，只有当addressModeX是VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER才有用
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+// 读取并解码图片
+DecodedImage ImageManager::decodeImage(android_app *app, const std::string &path, int targetWidth, int targetHeight,
+                                       TextureDiskCache *diskCache)
+{
+    auto decodeStart = std::chrono::steady_clock::now();
 
-    samplerInfo.unnormalizedCoordinates = VK_FALSE; // 为VK_FALSE时用[0,1)采样，不然则为[0,texWidth或Height)
+    // 打开文件（只读视图，解码器直接读取，不复制文件内容）
+    ATrace_beginSection("readImage");
+    AssetFile asset(app, path);
+
+    // 先查找磁盘缓存，命中时像素直接来自映射的文件
+    uint64_t sourceHash = 0;
+    if (diskCache != nullptr) {
+        sourceHash = diskCache->sourceHash(path, asset);
+        DecodedImage cached;
+        if (diskCache->load(path, sourceHash, targetWidth, targetHeight, &cached)) {
+            ATrace_endSection();
+            cached.decodeTimeNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - decodeStart).count();
+            return cached;
+        }
+    }
 
-    samplerInfo.compareEnable = VK_FALSE; // 和预设值进行比较，在阴影贴图时使用
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    ATrace_endSection();
 
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.mipLodBias = 0.0f;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = 0.0f;
+    // 解压后的像素内存
+    ATrace_beginSection(("decodeImage" + path).c_str());
+    DecodedImage decoded;
+    int texChannels;
+    decoded.pixels_ = stbi_load_from_memory(asset.data(), static_cast<int>(asset.size()), &decoded.width_, &decoded.height_, &texChannels, STBI_rgb_alpha);
 
-    VkSampler textureSampler;
-    if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
+    if (!decoded.pixels_)
     {
-        throw std::runtime_error("failed to create texture sampler!");
+        throw std::runtime_error("failed to load texture image!");
     }
-    return textureSampler;
-}
 
-// ================================== 以上为一些辅助函数 ==================================
+    ATrace_endSection();
+    decoded.sourceWidth_ = decoded.width_;
+    decoded.sourceHeight_ = decoded.height_;
+    auto resizeStart = std::chrono::steady_clock::now();
+    decoded.decodeTimeNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(resizeStart - decodeStart).count();
+
+    // 源图片大于绘制尺寸时缩小到绘制尺寸（各方向独立，不放大），纹理占用与上传量随之减少
+    int width = targetWidth > 0 ? std::min(decoded.width_, targetWidth) : decoded.width_;
+    int height = targetHeight > 0 ? std::min(decoded.height_, targetHeight) : decoded.height_;
+    if (width != decoded.width_ || height != decoded.height_) {
+        ATrace_beginSection("resizeImage");
+        // 与stb使用相同的分配器，freeDecodedImage统一释放
+        unsigned char *resized = static_cast<unsigned char *>(STBI_MALLOC(static_cast<size_t>(width) * height * 4));
+        ImageScaler::resize(decoded.pixels_, decoded.width_, decoded.height_, resized, width, height);
+        stbi_image_free(decoded.pixels_);
+        decoded.pixels_ = resized;
+        decoded.width_ = width;
+        decoded.height_ = height;
+        decoded.resizeTimeNs_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - resizeStart).count();
+        ATrace_endSection();
+    }
 
+    if (diskCache != nullptr) {
+        diskCache->store(path, sourceHash, targetWidth, targetHeight, decoded);
+    }
+    return decoded;
+}
 
+void ImageManager::freeDecodedImage(DecodedImage &decoded)
+{
+    if (decoded.mappedBase_ != nullptr) {
+        munmap(decoded.mappedBase_, decoded.mappedSize_);
+        decoded.mappedBase_ = nullptr;
+        decoded.mappedSize_ = 0;
+    } else {
+        stbi_image_free(decoded.pixels_);
+    }
+    decoded.pixels_ = nullptr;
+}
 
 // 加载图像对象到一个VkImage
 VulkanImageInfo ImageManager::createTextureImageInfo(Image &image)
 {
-    // 打开文件并读取字节
     ATrace_beginSection("createTextureImage");
-    ATrace_beginSection("readImage");
-    AAsset *file = AAssetManager_open(app_->activity->assetManager,
-                                      image.path_.c_str(), AASSET_MODE_BUFFER);
 
-    size_t fileLength = AAsset_getLength(file);
-    unsigned char fileContent[fileLength];
-    AAsset_read(file, fileContent, fileLength);
-    AAsset_close(file);
-
-    ATrace_endSection();
+    // 解码尺寸为该路径被请求过的最大绘制尺寸（同一图片可能以不同尺寸绘制，按路径共享一张纹理）
+    int targetWidth = 0;
+    int targetHeight = 0;
+    if (decodeAtDisplaySize_) {
+        std::lock_guard<std::mutex> sizeLocker(sizeMutex_);
+        std::pair<int, int> &size = requestedSizeMap_[image.path_];
+        size.first = std::max(size.first, static_cast<int>(std::ceil(image.rect_.w_)));
+        size.second = std::max(size.second, static_cast<int>(std::ceil(image.rect_.h_)));
+        targetWidth = size.first;
+        targetHeight = size.second;
+    }
 
-    // 解压后的像素内存
-    ATrace_beginSection(("decodeImage" + image.path_).c_str());
-    int texWidth, texHeight, texChannels;
-    stbi_uc *pixels = stbi_load_from_memory(fileContent, fileLength, &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    // 解压后的像素内存，预取线程已解码时直接取走（预取线程按解析时收集到的最大绘制尺寸解码），比需要的尺寸小时重新解码
+    DecodedImage decoded;
+    bool prefetched = prefetcher_ != nullptr && prefetcher_->takeImage(image.path_, &decoded);
+    if (prefetched && ((decoded.width_ < targetWidth && decoded.width_ < decoded.sourceWidth_) ||
+                       (decoded.height_ < targetHeight && decoded.height_ < decoded.sourceHeight_))) {
+        freeDecodedImage(decoded);
+        prefetched = false;
+    }
+    if (!prefetched) {
+        decoded = decodeImage(app_, image.path_, targetWidth, targetHeight, diskCache_);
+    }
+    stbi_uc *pixels = decoded.pixels_;
+    int texWidth = decoded.width_;
+    int texHeight = decoded.height_;
     VkDeviceSize imageSize = texWidth * texHeight * 4;
 
-    if (!pixels)
+//    LOGI("%s tex width %d, height %d; expected width %f, height %f", image.path_.c_str(), texWidth, texHeight, image.rect_.w_, image.rect_.h_);
+
+    // 1x1的缩略图（平均色），用作上传完成前的占位颜色
     {
-        throw std::runtime_error("failed to load texture image!");
+        uint32_t averageColor = averageColor_helper(pixels, texWidth * texHeight);
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        averageColorMap_[image.path_] = averageColor;
+        decodeTimeNs_ += decoded.decodeTimeNs_;
+        resizeTimeNs_ += decoded.resizeTimeNs_;
+        sourceBytes_ += static_cast<uint64_t>(decoded.sourceWidth_) * decoded.sourceHeight_ * 4;
     }
 
-//    LOGI("%s tex width %d, height %d; expected width %f, height %f", image.path_.c_str(), texWidth, texHeight, image.rect_.w_, image.rect_.h_);
+    // 小图片放入atlas，与其他小图片共享图像、显存与descriptor
+    VulkanImageInfo imageInfo;
+    imageInfo.width_ = texWidth;
+    imageInfo.height_ = texHeight;
+    imageInfo.sourceWidth_ = decoded.sourceWidth_;
+    imageInfo.sourceHeight_ = decoded.sourceHeight_;
+    if (atlas_ != nullptr && texWidth <= static_cast<int>(atlasMaxImageSize_) && texHeight <= static_cast<int>(atlasMaxImageSize_) &&
+        createAtlasImageInfo(decoded, &imageInfo)) {
+        freeDecodedImage(decoded);
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        createdBytes_ += imageInfo.bytes_;
+        ATrace_endSection();
+        return imageInfo;
+    }
 
-    ATrace_endSection();
+    // 需要时在CPU上生成完整的mip链（2x2盒式滤波逐级减半），与第0级一起上传
+    uint32_t mipLevels = 1;
+    std::vector<unsigned char> mipChain;
+    if (mipmaps_) {
+        ATrace_beginSection("buildMipChain");
+        std::vector<uint64_t> levelSizes;
+        mipChain = ImageScaler::buildMipChain(pixels, texWidth, texHeight, &levelSizes);
+        mipLevels = static_cast<uint32_t>(levelSizes.size());
+        imageSize = mipChain.size();
+        ATrace_endSection();
+    }
 
-    // 创建图像数据的stagingBuffer（暂存缓冲）
+    // 图像数据写入stagingBuffer（暂存缓冲，从textureUploader_的持久映射大块中切分）
     ATrace_beginSection("copyToStageBuffer");
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer_helper(device_, physicalDevice_, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-    void *data;
-    vkMapMemory(device_, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device_, stagingBufferMemory);
+    VulkanBufferInfo stagingBuffer = textureUploader_->allocStagingBuffer(imageSize);
+    memcpy(stagingBuffer.mappedData_, mipChain.empty() ? pixels : mipChain.data(), static_cast<size_t>(imageSize));
     ATrace_endSection();
 
-    stbi_image_free(pixels);
+    freeDecodedImage(decoded);
 
     // 创建图像及图像内存
-    VulkanImageInfo imageInfo;
-
-    createImage_helper(device_, physicalDevice_, texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
+    imageInfo.bytes_ = imageSize;
+    auto objectStart = std::chrono::steady_clock::now();
+    createImage_helper(device_, physicalDevice_, textureUploader_, texWidth, texHeight, mipLevels, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
                        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, imageInfo.textureImage_, imageInfo.textureImageMemory_);
 
-    ATrace_beginSection("firstTransition");
-    // 变换纹理图像到VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    transitionImageLayout_helper(device_, commandPool_, graphicsQueue_, imageInfo.textureImage_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED /* 创建时initialLayout */, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    ATrace_endSection();
+    // 布局变换与复制录制为一个指令缓冲，由主线程在提交该帧前合并提交，暂存缓冲在上传完成后由textureUploader_释放
+    imageInfo.uploadTicket_ = textureUploader_->upload(stagingBuffer, imageInfo.textureImage_, static_cast<uint32_t>(texWidth),
+                                                       static_cast<uint32_t>(texHeight), mipLevels);
 
-    ATrace_beginSection("copyBufferToImage");
-    // 执行图像数据复制操作
-    copyBufferToImage_helper(device_, commandPool_, graphicsQueue_, stagingBuffer, imageInfo.textureImage_, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
     ATrace_endSection();
 
-    ATrace_beginSection("secondTransition");
-    // 为了能够在着色器中采样纹理图像数据，还需进行一次变换
-    transitionImageLayout_helper(device_, commandPool_, graphicsQueue_, imageInfo.textureImage_, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    ATrace_endSection();
+    // 创建图像视图
+    imageInfo.textureImageView_ = createImageView(device_, imageInfo.textureImage_, VK_FORMAT_R8G8B8A8_UNORM, mipLevels);
 
-    // 清理
-    vkDestroyBuffer(device_, stagingBuffer, nullptr);
-    vkFreeMemory(device_, stagingBufferMemory, nullptr);
+    // 采样器按采样状态共享，有无mip链的纹理共用一个
+    imageInfo.textureSampler_ = samplerCache_->getSampler(SamplerState::MakeTexture());
 
-    ATrace_endSection();
+    {
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        createdBytes_ += imageSize;
+        objectCreateCount_++;
+        objectCreateTimeNs_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - objectStart).count();
+    }
 
-    // 创建图像视图
-    imageInfo.textureImageView_ = createImageView(device_, imageInfo.textureImage_, VK_FORMAT_R8G8B8A8_UNORM);
+    return imageInfo;
+}
 
-    // 创建采样器 // TODO: 采样器和图片本身不耦合，后续应该和paint耦合，使用哈希表查找
-    imageInfo.textureSampler_ = createTextureSampler(device_);
+// 将小图片放入atlas：四周各扩展1像素（复制边缘像素），线性过滤时不会采到相邻图片
+bool ImageManager::createAtlasImageInfo(DecodedImage &decoded, VulkanImageInfo *imageInfo)
+{
+    uint32_t width = static_cast<uint32_t>(decoded.width_);
+    uint32_t height = static_cast<uint32_t>(decoded.height_);
+    uint32_t paddedWidth = width + 2;
+    uint32_t paddedHeight = height + 2;
+
+    AtlasRegion region;
+    if (!atlas_->allocate(paddedWidth, paddedHeight, &region)) {
+        return false; // 所有页都放不下，改为独立的纹理
+    }
 
-    return imageInfo;
+    ATrace_beginSection("copyToStageBuffer");
+    VkDeviceSize imageSize = static_cast<VkDeviceSize>(paddedWidth) * paddedHeight * 4;
+    VulkanBufferInfo stagingBuffer = textureUploader_->allocStagingBuffer(imageSize);
+    unsigned char *dst = static_cast<unsigned char *>(stagingBuffer.mappedData_);
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+    size_t paddedRowBytes = static_cast<size_t>(paddedWidth) * 4;
+    for (uint32_t y = 0; y < paddedHeight; y++) {
+        // 上下扩展的行复制第一行与最后一行
+        uint32_t srcY = y == 0 ? 0 : (y == paddedHeight - 1 ? height - 1 : y - 1);
+        const unsigned char *srcRow = decoded.pixels_ + srcY * rowBytes;
+        unsigned char *dstRow = dst + y * paddedRowBytes;
+        memcpy(dstRow, srcRow, 4); // 左侧扩展
+        memcpy(dstRow + 4, srcRow, rowBytes);
+        memcpy(dstRow + 4 + rowBytes, srcRow + rowBytes - 4, 4); // 右侧扩展
+    }
+    ATrace_endSection();
+
+    AtlasPageInfo pageInfo = atlas_->getPageInfo(region.page_);
+    imageInfo->textureImage_ = pageInfo.image_;
+    imageInfo->textureImageMemory_ = pageInfo.imageMemory_;
+    imageInfo->textureImageView_ = pageInfo.imageView_;
+    imageInfo->textureSampler_ = pageInfo.sampler_;
+    imageInfo->bytes_ = imageSize;
+    imageInfo->atlasRegion_ = region;
+
+    // 纹理坐标为去掉扩展边之后的子矩形
+    float pageSize = static_cast<float>(atlas_->getPageSize());
+    imageInfo->uvLeft_ = (region.x_ + 1) / pageSize;
+    imageInfo->uvTop_ = (region.y_ + 1) / pageSize;
+    imageInfo->uvRight_ = (region.x_ + 1 + width) / pageSize;
+    imageInfo->uvBottom_ = (region.y_ + 1 + height) / pageSize;
+
+    // 只上传该区域，页中其他图片的内容保持不变
+    imageInfo->uploadTicket_ = textureUploader_->uploadRegion(stagingBuffer, pageInfo.image_, static_cast<int32_t>(region.x_),
+                                                              static_cast<int32_t>(region.y_), paddedWidth, paddedHeight);
+    return true;
 }
@@ -10,11 +10,22 @@
 #include <string>
 #include <unordered_map>
 #include <shared_mutex>
-#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
 
 #include "image/Image.h"
+#include "InFlightMap.h"
+#include "TextureUploader.h"
+#include "TextureAtlas.h"
+#include "SamplerCache.h"
+#include "SnapshotMap.h"
 
 class Image;
+class ResourcePrefetcher;
+class SamplerDescriptorManager;
+class TextureDiskCache;
 
 struct ImageHash {
     std::size_t operator()(const Image& obj) const;
@@ -25,49 +36,207 @@ struct VulkanImageInfo {
     VkImage textureImage_;              // 纹理图像
     VkDeviceMemory textureImageMemory_; // 纹理图像显存
     VkImageView textureImageView_;      // 纹理图像视图
-    VkSampler textureSampler_;          // 采样器 // TODO: 采样器与图片本身解耦
+    VkSampler textureSampler_;          // 采样器，来自SamplerCache（按采样状态共享，不随图片销毁）
+    uint64_t uploadTicket_ = 0;         // TextureUploader返回的ticket，上传完成前不能采样
+    uint64_t bytes_ = 0;                // 纹理像素占用的字节数，用于缓存预算
+    int32_t width_ = 0;                 // 纹理（第0级）的尺寸，与源图片尺寸不同时为按绘制尺寸缩小过
+    int32_t height_ = 0;
+    int32_t sourceWidth_ = 0;
+    int32_t sourceHeight_ = 0;
+
+    // 位于atlas中的小图片：上面的图像、视图与采样器为所在页的（共享，不随该图片销毁），纹理坐标为页中的子矩形
+    AtlasRegion atlasRegion_;           // page_为-1表示独立的纹理
+    float uvLeft_ = 0.0f;
+    float uvTop_ = 0.0f;
+    float uvRight_ = 1.0f;
+    float uvBottom_ = 1.0f;
+};
+
+// 纹理缓存统计信息（ImageManager与GlyphManager共用）
+struct TextureCacheStats {
+    uint64_t entryCount_ = 0;
+    uint64_t bytes_ = 0; // 所有驻留纹理占用的字节数
+    uint64_t hitCount_ = 0;
+    uint64_t missCount_ = 0;
+    uint64_t evictCount_ = 0;
+    uint64_t redecodeCount_ = 0; // 因小于之后的绘制尺寸而淘汰、按更大尺寸重新解码的纹理数
+    uint64_t pendingDestroyCount_ = 0; // 已淘汰、等待GPU不再使用后销毁
+    uint64_t decodeTimeNs_ = 0; // 累计解码耗时（含预取线程解码的）
+    uint64_t resizeTimeNs_ = 0; // 累计缩小耗时
+    uint64_t sourceBytes_ = 0; // 所有创建过的纹理按源尺寸（无mip）需占用的字节数
+    uint64_t createdBytes_ = 0; // 所有创建过的纹理实际占用的字节数
+    uint64_t atlasedCount_ = 0; // 其中位于atlas中的图片数
+    uint64_t atlasPageCount_ = 0;
+    uint64_t imageAllocationCount_ = 0; // 纹理占用的vkAllocateMemory数（独立纹理与atlas页各一次）
+    uint64_t objectCreateCount_ = 0; // 创建过的独立纹理数
+    uint64_t objectCreateTimeNs_ = 0; // 创建独立纹理的图像、显存、视图与采样器（含录制上传）的累计耗时，不含解码
+};
+
+// 已淘汰、等待销毁的纹理
+struct PendingDestroyImage {
+    VulkanImageInfo imageInfo_;
+    uint64_t evictFrame_; // 淘汰时的帧序号
+};
+
+// 销毁一张纹理的VkImage、VkImageView、VkSampler与显存
+void destroyImageInfo_helper(VkDevice device, VulkanImageInfo &imageInfo);
+
+// 解码后的RGBA8像素（CPU侧），由stb分配（缩小后为malloc分配，同样由stbi_image_free释放）；来自磁盘缓存时指向映射的文件
+struct DecodedImage {
+    unsigned char *pixels_ = nullptr;
+    void *mappedBase_ = nullptr; // 磁盘缓存命中时映射的起始地址与大小，由freeDecodedImage解除映射
+    size_t mappedSize_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int sourceWidth_ = 0;  // 缩小前（文件中）的尺寸
+    int sourceHeight_ = 0;
+    uint64_t decodeTimeNs_ = 0; // 读取与解码的耗时
+    uint64_t resizeTimeNs_ = 0; // 缩小到显示尺寸的耗时
 };
 
 /*
  * 管理所有的纹理VulkanImageInfo
- * TODO: 采用基于LRU的上限策略，最多维护 XX MB的纹理
+ * 采用基于LRU的上限策略，最多维护budgetBytes的纹理：命中时记录帧序号，endFrame中淘汰最久未使用的纹理（上一帧用过的不淘汰）
+ * 淘汰后先从map中移除，等待DESTROY_DELAY_FRAMES帧且上传完成后，回收其descriptor并销毁
+ * 启用atlas时小图片放入共享的atlas页，淘汰后只归还其区域（页与页的descriptor保留）
  * 同时也负责管理所有的VkSampler
  */
 class ImageManager {
 public:
-    ImageManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue);
+    ImageManager(android_app *app, VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader,
+                 SamplerCache *samplerCache, uint64_t budgetBytes);
     ~ImageManager(); // 删除所有VkImage
 
-    void createAndInsertImageInfo(Image &image, VulkanImageInfo *imageInfo); // 创建并插入VulkanImageInfo，创建的值通过imageInfo参数返回
+    void createAndInsertImageInfo(Image &image, VulkanImageInfo *imageInfo); // 创建并插入VulkanImageInfo，创建的值通过imageInfo参数返回，创建失败时等待者与调用者均抛出异常
 
     /**
      * 查找是否有缓存的资源：
      *  若有：      返回该资源（通过参数）
-     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源
+     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源（创建失败时抛出创建者的异常）
      *             若当前为第一个使用该未创建资源的任务，则直接返回false，并将该资源列为“准备中”（其他并发任务会阻塞）
      * @return 是否有缓存的资源
      */
     bool findImageInfo(Image &image, VulkanImageInfo *imageInfo); // 返回是否找到
 
+    /**
+     * 非阻塞查找（NONBLOCKING_TEXTURE）：
+     *  若已上传完成：  返回该资源（通过参数）
+     *  若没有：        返回false，不阻塞；首次未命中时将加载交给后台线程，placeholderColor返回占位颜色（ARGB，来自图片的平均色，未解码时为默认灰色）
+     * @return 是否可以直接采样
+     */
+    bool findImageInfoNonBlocking(Image &image, VulkanImageInfo *imageInfo, uint32_t *placeholderColor);
+
+    void startLoader(uint32_t threadCount); // 启动后台加载线程
+    void stopLoader(); // 停止后台加载线程（丢弃尚未开始的加载），需在删除TextureUploader之前调用
+
+    void setPrefetcher(ResourcePrefetcher *prefetcher); // 创建纹理时优先使用预取线程已解码的像素
+
+    /**
+     * 解码选项，需在创建任何纹理之前调用
+     * @param decodeAtDisplaySize 源图片大于绘制尺寸时在CPU上缩小到绘制尺寸
+     * @param mipmaps 为独立纹理生成完整的mip链（atlas中的图片没有mip）
+     */
+    void setDecodeOptions(bool decodeAtDisplaySize, bool mipmaps);
+
+    void setDiskCache(TextureDiskCache *diskCache); // 解码前先查找磁盘缓存，未命中时解码后写入
+
+    // 启用atlas：宽高均不超过maxImageSize的图片放入共享的atlas页，需在创建任何纹理之前调用
+    void enableAtlas(uint32_t pageSize, uint32_t maxPages, uint32_t maxImageSize);
+
+    /**
+     * 查询图片所在的atlas页（生成DrawTask时在主线程调用，用于决定能否合批）
+     * 只有已驻留、上传完成且位于atlas中的图片返回true；同时记录使用，保证本帧内不被淘汰
+     */
+    bool findAtlasPage(Image &image, int32_t *page);
+
+    // 每帧开始时调用（工作线程空闲、上一帧已等待fence）：推进帧序号，销毁到期的已淘汰纹理，按LRU淘汰超出预算的纹理
+    void endFrame(SamplerDescriptorManager *samplerDescriptorManager);
+
+    TextureCacheStats getStats();
+    InFlightStats getInFlightStats(); // 等待其他任务创建纹理的次数与阻塞时间
+    void dump(); // 以log的形式打印 for debug
+
+    /**
+     * 读取并解码一张图片（只涉及CPU，可在任意线程调用，包括Vulkan初始化之前）
+     * targetWidth/targetHeight为该图片被绘制的最大尺寸（像素），源图片更大时缩小到该尺寸（不放大），为0时保持源尺寸
+     * diskCache不为空时先查找磁盘缓存（命中时像素为映射的文件，跳过解码），未命中时解码后写入
+     */
+    static DecodedImage decodeImage(android_app *app, const std::string &path, int targetWidth = 0, int targetHeight = 0,
+                                    TextureDiskCache *diskCache = nullptr);
+    static void freeDecodedImage(DecodedImage &decoded);
+
 private:
 
+    struct ImageEntry {
+        VulkanImageInfo imageInfo_;
+        std::atomic<uint64_t> lastUsedFrame_{0}; // 命中时无锁更新，淘汰时按此近似LRU
+        std::atomic<bool> redecodeRequested_{false}; // 已加入redecodeList_
+    };
+
     std::shared_mutex mutex_; // 保护下面的map
-    std::condition_variable_any cv_; // 确保同时只有一个任务在创建资源
-    std::unordered_map<Image, VulkanImageInfo, ImageHash> imageMap_;
-    std::unordered_map<Image, bool, ImageHash> preparingMap_; // 维护所有正在创建的Image，避免多任务并发导致的重复创建
+    std::unordered_map<Image, ImageEntry, ImageHash> imageMap_;
+    InFlightMap<Image, ImageHash> inFlight_; // 维护所有正在创建的Image，避免多任务并发导致的重复创建
+    std::vector<PendingDestroyImage> pendingDestroyList_; // 已淘汰、等待销毁的纹理
+    // imageMap_的只读快照（指向map中的条目），已驻留的纹理无锁查找；在mutex_下更新，条目只在endFrame中删除（工作线程空闲）
+    SnapshotMap<Image, ImageEntry *, ImageHash> snapshot_;
+
+    // LRU
+    const uint64_t DESTROY_DELAY_FRAMES = 2; // 淘汰后至少等待的帧数，覆盖仍在GPU上的帧
+    uint64_t budgetBytes_;
+    uint64_t bytes_ = 0; // 受mutex_保护
+    std::atomic<uint64_t> frameCounter_{0};
+    StripedCounter hitCount_; // 命中在工作线程的热路径上，分槽计数
+    std::atomic<uint64_t> missCount_{0};
+    uint64_t evictCount_ = 0;
+    uint64_t redecodeCount_ = 0;
+
+    /*
+     * 按绘制尺寸解码时，同一路径的图片可能以不同尺寸绘制：记录每个路径被请求过的最大绘制尺寸，解码时按该尺寸
+     * 命中的纹理小于本次绘制尺寸（且被缩小过）时，本帧仍使用该纹理，在endFrame中将其淘汰，下次使用时按更大的尺寸重新解码
+     */
+    std::mutex sizeMutex_; // 保护下面两项（命中路径上调用者可能已持有mutex_）
+    std::unordered_map<std::string, std::pair<int, int>> requestedSizeMap_; // 图片路径 -> 最大绘制尺寸
+    std::vector<Image> redecodeList_; // 需要按更大尺寸重新解码的已驻留纹理
+    void checkSize(ImageEntry &entry, const Image &image); // 命中时调用
+
+    // 解码统计，受mutex_保护
+    uint64_t decodeTimeNs_ = 0;
+    uint64_t resizeTimeNs_ = 0;
+    uint64_t sourceBytes_ = 0;
+    uint64_t createdBytes_ = 0;
+    uint64_t objectCreateCount_ = 0;
+    uint64_t objectCreateTimeNs_ = 0;
 
     android_app *app_;
     VkDevice device_;
     VkPhysicalDevice physicalDevice_;
-    VkCommandPool commandPool_;
-    VkQueue graphicsQueue_;
+    TextureUploader *textureUploader_; // 纹理上传（生命周期在Engine2D）
+    SamplerCache *samplerCache_; // 采样器缓存（生命周期在Engine2D）
+    ResourcePrefetcher *prefetcher_ = nullptr; // 资源预取（可为空，生命周期在VulkanMain）
+    TextureDiskCache *diskCache_ = nullptr; // 磁盘纹理缓存（可为空，生命周期在VulkanMain）
+    bool decodeAtDisplaySize_ = false;
+    bool mipmaps_ = false;
+    TextureAtlas *atlas_ = nullptr; // 小图片的atlas（可为空）
+    uint32_t atlasMaxImageSize_ = 0;
+
+    std::unordered_map<std::string, uint32_t> averageColorMap_; // 图片路径 -> 平均色（ARGB），解码后即写入，受mutex_保护
+    const uint32_t DEFAULT_PLACEHOLDER_COLOR = 0x40808080; // 平均色未知时的占位颜色
+
+    // 后台加载线程
+    std::mutex loadMutex_; // 保护下面的队列
+    std::condition_variable loadCv_;
+    std::deque<Image> loadQueue_; // 待加载的图片（Image只按路径区分，矩形用于决定解码尺寸）
+    bool stopLoading_ = false;
+    std::vector<std::thread> loaderThreads_;
+    void loaderLoop();
 
 
     // 创建一张图片所有的内容
     VulkanImageInfo createTextureImageInfo(Image &image);
+    // 将小图片放入atlas，所有页都放不下时返回false
+    bool createAtlasImageInfo(DecodedImage &decoded, VulkanImageInfo *imageInfo);
+    void destroyImageInfo(VulkanImageInfo &imageInfo); // 独立纹理销毁，atlas中的图片归还区域
 };
 
-// TODO: 临时方案，该函数含有vkQueueSubmit，都用统一锁调用，避免多线程冲突
-void endSingleTimeCommands_helper(VkCommandBuffer commandBuffer, VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue);
 
 #endif //PRF_IMAGEMANAGER_H
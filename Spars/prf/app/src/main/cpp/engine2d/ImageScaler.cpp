@@ -0,0 +1,172 @@
+#include "ImageScaler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+void ImageScaler::halve(const unsigned char *src, int width, int height, unsigned char *dst) {
+    int dstWidth = std::max(1, width / 2);
+    int dstHeight = std::max(1, height / 2);
+    size_t srcStride = static_cast<size_t>(width) * 4;
+
+    for (int y = 0; y < dstHeight; y++) {
+        const unsigned char *row0 = src + std::min(2 * y, height - 1) * srcStride;
+        const unsigned char *row1 = src + std::min(2 * y + 1, height - 1) * srcStride;
+        unsigned char *out = dst + static_cast<size_t>(y) * dstWidth * 4;
+        int x = 0;
+#if defined(__ARM_NEON)
+        // 一次读取两行各8个像素，按奇偶像素拆开后四者相加，四舍五入右移2位得到4个输出像素
+        for (; 2 * (x + 4) <= width; x += 4) {
+            uint32x4x2_t top = vld2q_u32(reinterpret_cast<const uint32_t *>(row0 + x * 8));
+            uint32x4x2_t bottom = vld2q_u32(reinterpret_cast<const uint32_t *>(row1 + x * 8));
+            uint8x16_t top0 = vreinterpretq_u8_u32(top.val[0]);
+            uint8x16_t top1 = vreinterpretq_u8_u32(top.val[1]);
+            uint8x16_t bottom0 = vreinterpretq_u8_u32(bottom.val[0]);
+            uint8x16_t bottom1 = vreinterpretq_u8_u32(bottom.val[1]);
+
+            uint16x8_t low = vaddl_u8(vget_low_u8(top0), vget_low_u8(top1));
+            low = vaddw_u8(low, vget_low_u8(bottom0));
+            low = vaddw_u8(low, vget_low_u8(bottom1));
+            uint16x8_t high = vaddl_u8(vget_high_u8(top0), vget_high_u8(top1));
+            high = vaddw_u8(high, vget_high_u8(bottom0));
+            high = vaddw_u8(high, vget_high_u8(bottom1));
+
+            vst1q_u8(out + x * 4, vcombine_u8(vrshrn_n_u16(low, 2), vrshrn_n_u16(high, 2)));
+        }
+#endif
+        // 剩余像素（及非ARM平台）
+        for (; x < dstWidth; x++) {
+            int x0 = std::min(2 * x, width - 1);
+            int x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+                out[x * 4 + c] = static_cast<unsigned char>((sum + 2) >> 2);
+            }
+        }
+    }
+}
+
+void ImageScaler::areaResize(const unsigned char *src, int srcWidth, int srcHeight,
+                             unsigned char *dst, int dstWidth, int dstHeight) {
+    // 水平方向：每个输出列覆盖源的[dx * scaleX, (dx + 1) * scaleX)，按覆盖长度加权
+    float scaleX = static_cast<float>(srcWidth) / dstWidth;
+    std::vector<float> horizontal(static_cast<size_t>(srcHeight) * dstWidth * 4);
+    for (int y = 0; y < srcHeight; y++) {
+        const unsigned char *row = src + static_cast<size_t>(y) * srcWidth * 4;
+        float *out = horizontal.data() + static_cast<size_t>(y) * dstWidth * 4;
+        for (int dx = 0; dx < dstWidth; dx++) {
+            float start = dx * scaleX;
+            float end = (dx + 1) * scaleX;
+            int first = static_cast<int>(start);
+            int last = std::min(static_cast<int>(std::ceil(end)), srcWidth);
+            float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+            float total = 0.0f;
+            for (int sx = first; sx < last; sx++) {
+                float weight = std::min(end, sx + 1.0f) - std::max(start, static_cast<float>(sx));
+                for (int c = 0; c < 4; c++) {
+                    sum[c] += weight * row[sx * 4 + c];
+                }
+                total += weight;
+            }
+            for (int c = 0; c < 4; c++) {
+                out[dx * 4 + c] = sum[c] / total;
+            }
+        }
+    }
+
+    // 垂直方向：整行累加（连续内存，编译器可向量化）
+    float scaleY = static_cast<float>(srcHeight) / dstHeight;
+    size_t rowFloats = static_cast<size_t>(dstWidth) * 4;
+    std::vector<float> accumulator(rowFloats);
+    for (int dy = 0; dy < dstHeight; dy++) {
+        float start = dy * scaleY;
+        float end = (dy + 1) * scaleY;
+        int first = static_cast<int>(start);
+        int last = std::min(static_cast<int>(std::ceil(end)), srcHeight);
+        std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+        float total = 0.0f;
+        for (int sy = first; sy < last; sy++) {
+            float weight = std::min(end, sy + 1.0f) - std::max(start, static_cast<float>(sy));
+            const float *row = horizontal.data() + sy * rowFloats;
+            for (size_t i = 0; i < rowFloats; i++) {
+                accumulator[i] += weight * row[i];
+            }
+            total += weight;
+        }
+        unsigned char *out = dst + dy * rowFloats;
+        float inverse = 1.0f / total;
+        for (size_t i = 0; i < rowFloats; i++) {
+            float value = accumulator[i] * inverse + 0.5f;
+            out[i] = static_cast<unsigned char>(std::min(255.0f, std::max(0.0f, value)));
+        }
+    }
+}
+
+void ImageScaler::resize(const unsigned char *src, int srcWidth, int srcHeight,
+                         unsigned char *dst, int dstWidth, int dstHeight) {
+    const unsigned char *current = src;
+    int width = srcWidth;
+    int height = srcHeight;
+    std::vector<unsigned char> buffers[2];
+    int next = 0;
+
+    // 两个方向都至少为目标的两倍时先减半，减半的开销远小于面积滤波
+    while (width >= 2 * dstWidth && height >= 2 * dstHeight) {
+        buffers[next].resize(static_cast<size_t>(width / 2) * (height / 2) * 4);
+        halve(current, width, height, buffers[next].data());
+        current = buffers[next].data();
+        width /= 2;
+        height /= 2;
+        next ^= 1;
+    }
+
+    if (width == dstWidth && height == dstHeight) {
+        memcpy(dst, current, static_cast<size_t>(width) * height * 4);
+    } else {
+        areaResize(current, width, height, dst, dstWidth, dstHeight);
+    }
+}
+
+uint32_t ImageScaler::mipLevelCount(int width, int height) {
+    uint32_t levels = 1;
+    int size = std::max(width, height);
+    while (size > 1) {
+        size /= 2;
+        levels++;
+    }
+    return levels;
+}
+
+std::vector<unsigned char> ImageScaler::buildMipChain(const unsigned char *src, int width, int height,
+                                                      std::vector<uint64_t> *levelSizes) {
+    uint32_t levels = mipLevelCount(width, height);
+    levelSizes->clear();
+
+    // 先计算总大小，一次分配
+    uint64_t totalSize = 0;
+    int w = width;
+    int h = height;
+    for (uint32_t level = 0; level < levels; level++) {
+        levelSizes->push_back(static_cast<uint64_t>(w) * h * 4);
+        totalSize += levelSizes->back();
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+
+    std::vector<unsigned char> chain(totalSize);
+    memcpy(chain.data(), src, (*levelSizes)[0]);
+    uint64_t offset = 0;
+    w = width;
+    h = height;
+    for (uint32_t level = 1; level < levels; level++) {
+        halve(chain.data() + offset, w, h, chain.data() + offset + (*levelSizes)[level - 1]);
+        offset += (*levelSizes)[level - 1];
+        w = std::max(1, w / 2);
+        h = std::max(1, h / 2);
+    }
+    return chain;
+}
@@ -0,0 +1,41 @@
+#ifndef PRF_IMAGESCALER_H
+#define PRF_IMAGESCALER_H
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * RGBA8像素的CPU缩小（只涉及CPU，可在任意线程调用）
+ * 先以2x2盒式滤波反复减半（ARM上使用NEON，一次处理4个输出像素），直到不足目标尺寸的两倍，
+ * 再用面积加权的盒式滤波缩放到目标尺寸；减半同时用于生成mip链
+ */
+class ImageScaler {
+public:
+    /**
+     * 缩小到dstWidth x dstHeight（不放大：目标不小于源尺寸的方向保持不变，由调用者保证）
+     * @param dst 需有dstWidth * dstHeight * 4字节
+     */
+    static void resize(const unsigned char *src, int srcWidth, int srcHeight,
+                       unsigned char *dst, int dstWidth, int dstHeight);
+
+    // 2x2盒式滤波减半，输出尺寸为max(1, width / 2) x max(1, height / 2)，奇数边的最后一行（列）与自身平均
+    static void halve(const unsigned char *src, int width, int height, unsigned char *dst);
+
+    // 完整mip链的级数（直到1x1）
+    static uint32_t mipLevelCount(int width, int height);
+
+    /**
+     * 生成完整的mip链，各级紧凑地依次存放（第0级为源像素本身）
+     * @return 所有级的像素，levelSizes返回每一级的字节数
+     */
+    static std::vector<unsigned char> buildMipChain(const unsigned char *src, int width, int height,
+                                                    std::vector<uint64_t> *levelSizes);
+
+private:
+    // 面积加权的盒式滤波（可处理任意比例的缩小），先水平后垂直
+    static void areaResize(const unsigned char *src, int srcWidth, int srcHeight,
+                           unsigned char *dst, int dstWidth, int dstHeight);
+};
+
+
+#endif //PRF_IMAGESCALER_H
@@ -0,0 +1,104 @@
+#ifndef PRF_INFLIGHTMAP_H
+#define PRF_INFLIGHTMAP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+// 等待其他任务创建资源的统计
+struct InFlightStats {
+    uint64_t waitCount_ = 0; // 阻塞等待的次数（每次等待只在该资源完成时被唤醒一次）
+    uint64_t stallTimeNs_ = 0; // 累计阻塞时间
+    uint64_t failCount_ = 0; // 创建失败的次数
+};
+
+/*
+ * 正在创建的资源（各Manager共用）：每个key一个shared_future，创建完成或失败时只唤醒等待该key的任务
+ * start/join/complete/fail需在调用者的锁下调用，wait在释放锁之后调用
+ * 创建失败时等待者从wait中抛出创建者的异常，不会一直阻塞
+ */
+template <typename Key, typename Hash = std::hash<Key>>
+class InFlightMap {
+public:
+    bool contains(const Key &key) const {
+        return pending_.find(key) != pending_.end();
+    }
+
+    // 登记为由调用者创建（调用者需保证该key不在创建中）
+    void start(const Key &key) {
+        pending_.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple());
+    }
+
+    /**
+     * 该key正在创建时返回true，并通过future返回等待对象
+     * 否则登记为由调用者创建，返回false（调用者之后需调用complete或fail）
+     */
+    bool joinOrStart(const Key &key, std::shared_future<void> *future) {
+        auto iter = pending_.find(key);
+        if (iter != pending_.end()) {
+            *future = iter->second.future_;
+            return true;
+        }
+        start(key);
+        return false;
+    }
+
+    // 创建完成（资源已插入），唤醒等待该key的任务
+    void complete(const Key &key) {
+        auto iter = pending_.find(key);
+        if (iter == pending_.end()) {
+            return;
+        }
+        iter->second.promise_.set_value();
+        pending_.erase(iter);
+    }
+
+    // 创建失败，等待该key的任务从wait中抛出error
+    void fail(const Key &key, std::exception_ptr error) {
+        auto iter = pending_.find(key);
+        if (iter == pending_.end()) {
+            return;
+        }
+        iter->second.promise_.set_exception(error);
+        pending_.erase(iter);
+        failCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 阻塞直到该key创建完成（不持有调用者的锁），失败时抛出创建者的异常
+    void wait(const std::shared_future<void> &future) {
+        auto start = std::chrono::steady_clock::now();
+        future.wait();
+        waitCount_.fetch_add(1, std::memory_order_relaxed);
+        stallTimeNs_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        future.get();
+    }
+
+    InFlightStats getStats() const {
+        InFlightStats stats;
+        stats.waitCount_ = waitCount_.load();
+        stats.stallTimeNs_ = stallTimeNs_.load();
+        stats.failCount_ = failCount_.load();
+        return stats;
+    }
+
+private:
+    struct Pending {
+        std::promise<void> promise_;
+        std::shared_future<void> future_;
+        Pending() : future_(promise_.get_future().share()) {}
+    };
+
+    std::unordered_map<Key, Pending, Hash> pending_; // 受调用者的锁保护
+    std::atomic<uint64_t> waitCount_{0};
+    std::atomic<uint64_t> stallTimeNs_{0};
+    std::atomic<uint64_t> failCount_{0};
+};
+
+#endif //PRF_INFLIGHTMAP_H
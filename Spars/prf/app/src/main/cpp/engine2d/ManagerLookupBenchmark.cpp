@@ -0,0 +1,138 @@
+#include "ManagerLookupBenchmark.h"
+#include "SnapshotMap.h"
+#include "../log.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#define BENCHMARK_MAX_THREADS 8
+#define BENCHMARK_ENTRY_COUNT 256 // 与SAMPLER_DESCRIPTOR_POOL_SIZE相当
+#define BENCHMARK_DURATION_MS 200 // 每种线程数的测试时长
+
+// 与VulkanPipelineInfo/VulkanImageInfo相当大小的值
+struct BenchmarkValue {
+    uint64_t handles_[4];
+};
+
+// 原来的读路径：每次查找获取共享锁，命中计数为单个原子变量
+class LockedLookup {
+public:
+    void insert(uint64_t key, const BenchmarkValue &value) {
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        map_[key] = value;
+    }
+
+    bool find(uint64_t key, BenchmarkValue *value) {
+        std::shared_lock<std::shared_mutex> locker(mutex_);
+        auto iter = map_.find(key);
+        if (iter == map_.end()) {
+            return false;
+        }
+        *value = iter->second;
+        hitCount_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    std::shared_mutex mutex_;
+    std::unordered_map<uint64_t, BenchmarkValue> map_;
+    std::atomic<uint64_t> hitCount_{0};
+};
+
+// 新的读路径：无锁快照，命中分槽计数
+class SnapshotLookup {
+public:
+    void insert(uint64_t key, const BenchmarkValue &value) {
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        snapshot_.insert(key, value);
+        snapshot_.reclaim(); // 测试线程尚未开始
+    }
+
+    bool find(uint64_t key, BenchmarkValue *value) {
+        const BenchmarkValue *found = snapshot_.find(key);
+        if (found == nullptr) {
+            return false;
+        }
+        *value = *found;
+        hitCount_.add(1);
+        return true;
+    }
+
+private:
+    std::shared_mutex mutex_;
+    SnapshotMap<uint64_t, BenchmarkValue> snapshot_;
+    StripedCounter hitCount_;
+};
+
+// threadCount个线程查找BENCHMARK_DURATION_MS，返回每秒查找次数
+template <typename Lookup>
+static double measure_helper(Lookup &lookup, const std::vector<uint64_t> &keys, uint32_t threadCount) {
+    std::atomic<bool> start{false};
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> counts(threadCount, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&lookup, &keys, &start, &stop, &counts, t] {
+            std::minstd_rand rand(t + 1);
+            std::uniform_int_distribution<size_t> keyDist(0, keys.size() - 1);
+            std::vector<uint64_t> order(1024); // 预先生成查找顺序，不计入随机数的开销
+            for (uint64_t &key : order) {
+                key = keys[keyDist(rand)];
+            }
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            uint64_t count = 0;
+            BenchmarkValue value;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (uint64_t key : order) {
+                    lookup.find(key, &value);
+                }
+                count += order.size();
+            }
+            counts[t] = count;
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_DURATION_MS));
+    stop.store(true, std::memory_order_relaxed);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    return total / seconds;
+}
+
+void runManagerLookupBenchmark() {
+    LockedLookup locked;
+    SnapshotLookup snapshot;
+    std::vector<uint64_t> keys;
+    std::minstd_rand rand(42);
+    for (uint32_t i = 0; i < BENCHMARK_ENTRY_COUNT; i++) {
+        uint64_t key = (static_cast<uint64_t>(rand()) << 32) | rand(); // 与VkImageView等句柄相似的分布
+        BenchmarkValue value = {{key, key + 1, key + 2, key + 3}};
+        locked.insert(key, value);
+        snapshot.insert(key, value);
+        keys.push_back(key);
+    }
+
+    for (uint32_t threadCount = 1; threadCount <= BENCHMARK_MAX_THREADS; threadCount++) {
+        double lockedRate = measure_helper(locked, keys, threadCount);
+        double snapshotRate = measure_helper(snapshot, keys, threadCount);
+        LOGI("manager lookup benchmark: %u threads, shared_mutex %.2f M lookups/s, snapshot %.2f M lookups/s (x%.2f)",
+             threadCount, lockedRate / 1e6, snapshotRate / 1e6, lockedRate == 0.0 ? 0.0 : snapshotRate / lockedRate);
+    }
+}
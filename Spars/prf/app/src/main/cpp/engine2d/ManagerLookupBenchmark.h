@@ -0,0 +1,11 @@
+#ifndef PRF_MANAGERLOOKUPBENCHMARK_H
+#define PRF_MANAGERLOOKUPBENCHMARK_H
+
+/**
+ * Manager热路径查找测试（MANAGER_LOOKUP_BENCHMARK）
+ * 1~8个线程满速查找已存在的条目（数量与单个描述符池的容量相当），对比原来的共享锁+原子命中计数与无锁快照+分槽计数，
+ * 以log输出每秒查找次数
+ */
+void runManagerLookupBenchmark();
+
+#endif //PRF_MANAGERLOOKUPBENCHMARK_H
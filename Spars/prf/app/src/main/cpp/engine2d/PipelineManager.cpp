@@ -9,6 +9,10 @@ PipelineManager::PipelineManager(VkDevice device) {
 }
 
 PipelineManager::~PipelineManager() {
+    clear();
+}
+
+void PipelineManager::clear() {
     std::unique_lock<std::shared_mutex> locker(mutex_);
     for(auto iter = pipelineMap_.begin(); iter != pipelineMap_.end(); iter++) {
         VulkanPipelineInfo pipelineInfo = iter->second;
@@ -19,47 +23,66 @@ PipelineManager::~PipelineManager() {
         vkDestroyPipeline(device_, pipelineInfo.pipeline_, nullptr);
         vkDestroyPipelineLayout(device_, pipelineInfo.pipelineLayout_, nullptr);
     }
+    pipelineMap_.clear();
+    snapshot_.clear();
+    snapshot_.reclaim(); // 工作线程空闲
+}
+
+void PipelineManager::endFrame() {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    snapshot_.reclaim();
 }
 
 void PipelineManager::insertPipeline(uint32_t key, VulkanPipelineInfo pipelineInfo) {
     std::unique_lock<std::shared_mutex> locker(mutex_); // 插入操作使用unique_lock
     pipelineMap_[key] = pipelineInfo;
+    snapshot_.insert(key, pipelineInfo);
 
-    // 资源创建完成，从准备列表移除
-    preparingMap_.erase(key);
-    cv_.notify_all(); // 此唤醒会导致所有任务唤醒，尽管有些任务在等待其他资源创建完成
+    // 资源创建完成，从准备列表移除，只唤醒等待该管线的任务
+    inFlight_.complete(key);
+}
+
+void PipelineManager::abandonPipeline(uint32_t key, std::exception_ptr error) {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    inFlight_.fail(key, error);
 }
 
 bool PipelineManager::findPipeline(uint32_t key, VulkanPipelineInfo *pipelineInfo) {
+    // 已创建的管线在快照中无锁查找
+    if (const VulkanPipelineInfo *found = snapshot_.find(key)) {
+        *pipelineInfo = *found;
+        return true;
+    }
+
+    std::shared_future<void> pending;
     {
-        std::shared_lock<std::shared_mutex> locker(mutex_); // 读取操作使用shared_lock
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        // 可能在快照查找之后刚创建完成
         auto iter = pipelineMap_.find(key);
         if (iter != pipelineMap_.end()) {
             *pipelineInfo = iter->second;
             return true;
         }
-    }
-    {
-        std::unique_lock<std::shared_mutex> locker(mutex_);
         // 未找到，判断是否有其他线程正在创建
-        auto iter2 = preparingMap_.find(key);
-        if (iter2 != preparingMap_.end()) { // 其他线程正在创建
-            cv_.wait(locker, [this, &key] {
-                return preparingMap_.find(key) == preparingMap_.end(); // 该资源已经不在准备列表中了
-            });
-
-            // 其他线程创建完毕了
-            auto iter3 = pipelineMap_.find(key);
-            if (iter3 != pipelineMap_.end()) {
-                *pipelineInfo = iter3->second;
-                return true;
-            }
-            // 此处不应该走到
-            throw std::runtime_error("PipelineManager::findPipeline error!");
-            return false;
+        if (!inFlight_.joinOrStart(key, &pending)) {
+            return false; // 我们是第一个创建的，需要我们后续创建
         }
-        // 我们是第一个创建的
-        preparingMap_[key] = true; // 将该资源加入准备列表，这个true不重要
-        return false; // 需要我们后续创建
     }
-}
\ No newline at end of file
+
+    // 其他线程正在创建，在锁外等待，创建失败时此处抛出其异常
+    inFlight_.wait(pending);
+
+    // 其他线程创建完毕了
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    auto iter = pipelineMap_.find(key);
+    if (iter != pipelineMap_.end()) {
+        *pipelineInfo = iter->second;
+        return true;
+    }
+    // 此处不应该走到
+    throw std::runtime_error("PipelineManager::findPipeline error!");
+}
+
+InFlightStats PipelineManager::getInFlightStats() {
+    return inFlight_.getStats();
+}
@@ -9,7 +9,10 @@
 
 #include <unordered_map>
 #include <shared_mutex>
-#include <condition_variable>
+#include <exception>
+
+#include "InFlightMap.h"
+#include "SnapshotMap.h"
 
 // 所有渲染管线的种类，作为key
 #define RECT_PIPELINE 1
@@ -17,6 +20,7 @@
 #define IMAGE_PIPELINE 3
 #define TEXT_PIPELINE 4
 #define RRECT_PIPELINE 5
+#define TEXT_SDF_PIPELINE 6
 
 // 渲染管线信息
 struct VulkanPipelineInfo {
@@ -39,19 +43,29 @@ public:
     /**
      * 查找是否有缓存的资源：
      *  若有：      返回该资源（通过参数）
-     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源
+     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源（创建失败时抛出创建者的异常）
      *             若当前为第一个使用该未创建资源的任务，则直接返回false，并将该资源列为“准备中”（其他并发任务会阻塞）
+     *             此时调用者需在创建完成后调用insertPipeline，或在创建失败时调用abandonPipeline
      * @return 是否有缓存的资源
      */
     bool findPipeline(uint32_t key, VulkanPipelineInfo *pipelineInfo); // 返回是否找到
 
+    // findPipeline返回false之后创建失败时调用，等待该管线的任务从findPipeline中抛出error
+    void abandonPipeline(uint32_t key, std::exception_ptr error);
+
+    InFlightStats getInFlightStats(); // 等待其他任务创建管线的次数与阻塞时间
+
+    void clear(); // 删除所有pipeline相关对象，调用时GPU与工作线程均空闲（仅用于对比resize时全部重建的开销）
+
+    void endFrame(); // 每帧开始时调用（工作线程空闲），释放旧的查找快照
+
 private:
     VkDevice device_;
 
     std::shared_mutex mutex_; // 保护下面的map
-    std::condition_variable_any cv_; // 确保同时只有一个任务在创建资源
     std::unordered_map<uint32_t, VulkanPipelineInfo> pipelineMap_;
-    std::unordered_map<uint32_t, bool> preparingMap_; // 维护所有正在创建的Pipeline，避免多任务并发导致的重复创建
+    InFlightMap<uint32_t> inFlight_; // 维护所有正在创建的Pipeline，避免多任务并发导致的重复创建；在mutex_下更新
+    SnapshotMap<uint32_t, VulkanPipelineInfo> snapshot_; // pipelineMap_的只读快照，已创建的管线无锁查找；在mutex_下更新
 };
 
 #endif //PRF_PIPELINEMANAGER_H
@@ -0,0 +1,285 @@
+#include "ResourcePrefetcher.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <android/trace.h>
+
+ResourcePrefetcher::ResourcePrefetcher(android_app *app, uint32_t threadCount, bool decodeAtDisplaySize) {
+    app_ = app;
+    threadCount_ = threadCount;
+    decodeAtDisplaySize_ = decodeAtDisplaySize;
+}
+
+ResourcePrefetcher::~ResourcePrefetcher() {
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        stopping_ = true;
+        tasks_.clear();
+    }
+    cv_.notify_all();
+    for (std::thread &thread : threads_) {
+        thread.join();
+    }
+
+    // 释放未被取走的结果
+    for (auto &iter : imageMap_) {
+        if (iter.second.state_ == PrefetchState::DONE) {
+            ImageManager::freeDecodedImage(iter.second.decoded_);
+        }
+    }
+    for (auto &iter : glyphMap_) {
+        if (iter.second.state_ == PrefetchState::DONE) {
+            GlyphManager::freeRasterizedGlyphs(iter.second.rasterized_);
+        }
+    }
+}
+
+void ResourcePrefetcher::setDiskCache(TextureDiskCache *diskCache) {
+    diskCache_ = diskCache;
+}
+
+void ResourcePrefetcher::addImage(const std::string &path, const Rect &rect, bool visible) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    auto iter = imageMap_.find(path);
+    if (iter == imageMap_.end()) {
+        iter = imageMap_.emplace(path, ImageEntry()).first;
+        iter->second.order_ = nextOrder_++;
+    }
+    iter->second.maxWidth_ = std::max(iter->second.maxWidth_, static_cast<int>(std::ceil(rect.w_)));
+    iter->second.maxHeight_ = std::max(iter->second.maxHeight_, static_cast<int>(std::ceil(rect.h_)));
+    if (visible) {
+        iter->second.visibleRects_.push_back(rect);
+    }
+}
+
+void ResourcePrefetcher::addText(const Text &text, const Rect &rect, bool visible) {
+    Text strikeKey = GlyphManager::makeStrikeKey(text); // SDF时不同字号共用一个strike
+    std::lock_guard<std::mutex> locker(mutex_);
+    auto iter = glyphMap_.find(strikeKey);
+    if (iter == glyphMap_.end()) {
+        iter = glyphMap_.emplace(strikeKey, GlyphEntry()).first;
+        iter->second.order_ = nextOrder_++;
+        texts_.push_back(strikeKey);
+    }
+    std::vector<uint32_t> codepoints;
+    Text::decodeUtf8(text.str_, &codepoints);
+    iter->second.codepointSet_.insert(codepoints.begin(), codepoints.end());
+    if (visible) {
+        iter->second.visibleRects_.push_back(rect);
+    }
+}
+
+uint32_t ResourcePrefetcher::getPriority(const std::vector<Rect> &visibleRects, const Rect &viewport) {
+    if (visibleRects.empty()) {
+        return 2;
+    }
+    for (const Rect &rect : visibleRects) {
+        if (isOverlap(rect, viewport)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void ResourcePrefetcher::start(int32_t viewportWidth, int32_t viewportHeight) {
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        Rect viewport = Rect::MakeXYWH(0, 0, viewportWidth, viewportHeight);
+
+        std::vector<PrefetchTask> tasks;
+        for (auto &iter : imageMap_) {
+            tasks.push_back({true, iter.first, 0, getPriority(iter.second.visibleRects_, viewport), iter.second.order_});
+        }
+        for (size_t i = 0; i < texts_.size(); i++) {
+            GlyphEntry &entry = glyphMap_.at(texts_[i]);
+            entry.codepoints_.assign(entry.codepointSet_.begin(), entry.codepointSet_.end());
+            std::sort(entry.codepoints_.begin(), entry.codepoints_.end());
+            tasks.push_back({false, "", i, getPriority(entry.visibleRects_, viewport), entry.order_});
+        }
+
+        // 首屏优先，同一优先级按解析顺序（大致为绘制顺序）
+        std::sort(tasks.begin(), tasks.end(), [](const PrefetchTask &a, const PrefetchTask &b) {
+            return a.priority_ != b.priority_ ? a.priority_ < b.priority_ : a.order_ < b.order_;
+        });
+
+        stats_.imageCount_ = imageMap_.size();
+        stats_.glyphCount_ = glyphMap_.size();
+        for (const PrefetchTask &task : tasks) {
+            if (task.priority_ == 0) {
+                stats_.firstViewportCount_++;
+            }
+        }
+
+        tasks_.assign(tasks.begin(), tasks.end());
+        remaining_ = tasks_.size();
+        startTime_ = std::chrono::steady_clock::now();
+    }
+
+    for (uint32_t i = 0; i < threadCount_; i++) {
+        threads_.emplace_back(&ResourcePrefetcher::prefetchLoop, this);
+    }
+}
+
+void ResourcePrefetcher::finishTaskLocked() {
+    remaining_--;
+    if (remaining_ == 0) {
+        stats_.allDoneMs_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime_).count();
+    }
+}
+
+void ResourcePrefetcher::prefetchLoop() {
+    while (true) {
+        PrefetchTask task;
+        int targetWidth = 0;
+        int targetHeight = 0;
+        std::vector<uint32_t> codepoints;
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            // 跳过已被取用者取消的任务
+            while (!tasks_.empty()) {
+                const PrefetchTask &front = tasks_.front();
+                PrefetchState &state = front.isImage_ ? imageMap_.at(front.path_).state_
+                                                      : glyphMap_.at(texts_[front.textIndex_]).state_;
+                if (state == PrefetchState::QUEUED) {
+                    state = PrefetchState::RUNNING;
+                    break;
+                }
+                tasks_.pop_front();
+            }
+            if (stopping_ || tasks_.empty()) {
+                return;
+            }
+            task = tasks_.front();
+            tasks_.pop_front();
+            if (task.isImage_ && decodeAtDisplaySize_) {
+                ImageEntry &entry = imageMap_.at(task.path_);
+                targetWidth = entry.maxWidth_;
+                targetHeight = entry.maxHeight_;
+            } else if (!task.isImage_) {
+                codepoints = glyphMap_.at(texts_[task.textIndex_]).codepoints_;
+            }
+        }
+
+        // 解码不持锁
+        auto decodeStart = std::chrono::steady_clock::now();
+        DecodedImage decoded;
+        RasterizedGlyphs rasterized;
+        bool failed = false;
+        try {
+            if (task.isImage_) {
+                decoded = ImageManager::decodeImage(app_, task.path_, targetWidth, targetHeight, diskCache_);
+            } else {
+                rasterized = GlyphManager::rasterizeGlyphs(texts_[task.textIndex_], codepoints);
+            }
+        } catch (const std::exception &e) {
+            // 预取包含不可见的资源，失败时不终止，交给使用者自行解码（并在其正常路径上报告错误）
+            LOGE("ResourcePrefetcher::prefetchLoop prefetch %s failed: %s",
+                 task.isImage_ ? task.path_.c_str() : texts_[task.textIndex_].fontPath_.c_str(), e.what());
+            failed = true;
+        }
+        uint64_t decodeTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - decodeStart).count();
+
+        {
+            std::lock_guard<std::mutex> locker(mutex_);
+            PrefetchState state = failed ? PrefetchState::FAILED : PrefetchState::DONE;
+            if (task.isImage_) {
+                ImageEntry &entry = imageMap_.at(task.path_);
+                entry.decoded_ = decoded;
+                entry.state_ = state;
+            } else {
+                GlyphEntry &entry = glyphMap_.at(texts_[task.textIndex_]);
+                entry.rasterized_ = std::move(rasterized);
+                entry.state_ = state;
+            }
+            if (failed) {
+                stats_.failures_++;
+            }
+            stats_.decodeTimeNs_ += decodeTimeNs;
+            finishTaskLocked();
+        }
+        cv_.notify_all();
+    }
+}
+
+bool ResourcePrefetcher::takeImage(const std::string &path, DecodedImage *decoded) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    auto iter = imageMap_.find(path);
+    if (iter == imageMap_.end() || iter->second.state_ == PrefetchState::TAKEN) {
+        return false;
+    }
+    ImageEntry &entry = iter->second;
+    if (entry.state_ == PrefetchState::QUEUED) {
+        // 预取线程还没轮到它，取用者自行解码比排队更快
+        entry.state_ = PrefetchState::TAKEN;
+        stats_.misses_++;
+        finishTaskLocked();
+        return false;
+    }
+    bool waited = entry.state_ == PrefetchState::RUNNING;
+    if (waited) {
+        cv_.wait(locker, [&entry] { return entry.state_ != PrefetchState::RUNNING; });
+    }
+    if (entry.state_ == PrefetchState::FAILED) {
+        // 预取失败（任务已在预取线程中结束），按未命中处理
+        entry.state_ = PrefetchState::TAKEN;
+        stats_.misses_++;
+        return false;
+    }
+    if (waited) {
+        stats_.waitHits_++;
+    } else {
+        stats_.readyHits_++;
+    }
+    *decoded = entry.decoded_;
+    entry.decoded_ = DecodedImage();
+    entry.state_ = PrefetchState::TAKEN;
+    return true;
+}
+
+bool ResourcePrefetcher::takeGlyphs(const Text &text, RasterizedGlyphs *rasterized) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    auto iter = glyphMap_.find(text);
+    if (iter == glyphMap_.end() || iter->second.state_ == PrefetchState::TAKEN) {
+        return false;
+    }
+    GlyphEntry &entry = iter->second;
+    if (entry.state_ == PrefetchState::QUEUED) {
+        entry.state_ = PrefetchState::TAKEN;
+        stats_.misses_++;
+        finishTaskLocked();
+        return false;
+    }
+    bool waited = entry.state_ == PrefetchState::RUNNING;
+    if (waited) {
+        cv_.wait(locker, [&entry] { return entry.state_ != PrefetchState::RUNNING; });
+    }
+    if (entry.state_ == PrefetchState::FAILED) {
+        // 预取失败（任务已在预取线程中结束），按未命中处理
+        entry.state_ = PrefetchState::TAKEN;
+        stats_.misses_++;
+        return false;
+    }
+    if (waited) {
+        stats_.waitHits_++;
+    } else {
+        stats_.readyHits_++;
+    }
+    *rasterized = std::move(entry.rasterized_);
+    entry.rasterized_ = RasterizedGlyphs();
+    entry.state_ = PrefetchState::TAKEN;
+    return true;
+}
+
+PrefetchStats ResourcePrefetcher::getStats() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return stats_;
+}
+
+void ResourcePrefetcher::dump() {
+    PrefetchStats stats = getStats();
+    LOGI("ResourcePrefetcher: %u images, %u glyph strikes (%u in first viewport), %u ready, %u waited, %u missed, %u failed, decode %.3f ms, all done %.3f ms after start",
+         stats.imageCount_, stats.glyphCount_, stats.firstViewportCount_, stats.readyHits_, stats.waitHits_, stats.misses_, stats.failures_,
+         stats.decodeTimeNs_ / 1e6, stats.allDoneMs_);
+}
@@ -0,0 +1,122 @@
+#ifndef PRF_RESOURCEPREFETCHER_H
+#define PRF_RESOURCEPREFETCHER_H
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ImageManager.h"
+#include "GlyphManager.h"
+#include "rects/Rect.h"
+#include "text/Text.h"
+
+// 预取统计信息
+struct PrefetchStats {
+    uint32_t imageCount_ = 0; // 解析时收集到的不同图片数
+    uint32_t glyphCount_ = 0; // 解析时收集到的不同字体大小数
+    uint32_t firstViewportCount_ = 0; // 其中出现在首屏的资源数
+    uint32_t readyHits_ = 0; // 首次使用时已完成预取
+    uint32_t waitHits_ = 0; // 首次使用时正在预取，等待其完成
+    uint32_t misses_ = 0; // 首次使用时尚未开始预取或预取失败，由使用者自行解码
+    uint32_t failures_ = 0; // 预取线程解码或光栅化失败的资源数
+    uint64_t decodeTimeNs_ = 0; // 预取线程解码与光栅化的累计耗时
+    double allDoneMs_ = 0.0; // 从start到所有预取完成的耗时
+};
+
+/*
+ * 资源预取
+ * 解析渲染树时收集所有图片路径与字体大小（及其中出现的字符），在Vulkan初始化的同时由后台线程池解码图片、光栅化这些字形（只涉及CPU）
+ * 首屏中可见的资源优先，其次为其他可见资源，最后为不可见资源
+ * ImageManager/GlyphManager在首次创建纹理时取走结果：已完成则直接使用，正在进行则等待，尚未开始或失败则由调用者自行解码（并取消该预取）
+ * 每个资源只能被取走一次，之后（如被淘汰后重建）由调用者自行解码
+ */
+class ResourcePrefetcher {
+public:
+    ResourcePrefetcher(android_app *app, uint32_t threadCount, bool decodeAtDisplaySize); // decodeAtDisplaySize为true时图片按其最大绘制尺寸解码
+    ~ResourcePrefetcher(); // 停止预取线程，释放未被取走的结果
+
+    // 解析时调用，rect为节点的绝对坐标（所有出现位置中最大的宽高决定图片的解码尺寸）
+    void addImage(const std::string &path, const Rect &rect, bool visible);
+    void addText(const Text &text, const Rect &rect, bool visible);
+
+    void setDiskCache(TextureDiskCache *diskCache); // 图片先查找磁盘缓存，需在start之前调用
+
+    void start(int32_t viewportWidth, int32_t viewportHeight); // 解析完成后调用，按优先级排序并启动预取线程
+
+    // 取走预取结果（任意线程调用），返回false时调用者需自行解码
+    bool takeImage(const std::string &path, DecodedImage *decoded);
+    bool takeGlyphs(const Text &text, RasterizedGlyphs *rasterized);
+
+    PrefetchStats getStats();
+    void dump(); // 以log的形式打印 for debug
+
+private:
+    enum class PrefetchState {
+        QUEUED,   // 等待预取线程
+        RUNNING,  // 预取线程正在解码
+        DONE,     // 已完成，等待取走
+        FAILED,   // 解码失败，取用者自行解码并在其正常路径上报告错误
+        TAKEN,    // 已取走或已取消
+    };
+
+    struct ImageEntry {
+        PrefetchState state_ = PrefetchState::QUEUED;
+        uint32_t order_; // 解析顺序
+        std::vector<Rect> visibleRects_; // 可见的出现位置，用于判断是否在首屏
+        int maxWidth_ = 0; // 所有出现位置中最大的绘制尺寸
+        int maxHeight_ = 0;
+        DecodedImage decoded_;
+    };
+
+    struct GlyphEntry {
+        PrefetchState state_ = PrefetchState::QUEUED;
+        uint32_t order_;
+        std::vector<Rect> visibleRects_;
+        std::unordered_set<uint32_t> codepointSet_; // 所有出现位置中的字符
+        std::vector<uint32_t> codepoints_; // start时由codepointSet_生成（排序）
+        RasterizedGlyphs rasterized_;
+    };
+
+    // 预取任务，图片以路径、字体以在texts_中的下标区分
+    struct PrefetchTask {
+        bool isImage_;
+        std::string path_;
+        size_t textIndex_;
+        uint32_t priority_; // 越小越先，0为首屏，1为其他可见，2为不可见
+        uint32_t order_;
+    };
+
+    android_app *app_;
+    uint32_t threadCount_;
+    bool decodeAtDisplaySize_;
+    TextureDiskCache *diskCache_ = nullptr;
+
+    std::mutex mutex_; // 保护下面所有成员
+    std::condition_variable cv_; // 预取完成时唤醒等待的取用者
+    std::unordered_map<std::string, ImageEntry> imageMap_;
+    std::unordered_map<Text, GlyphEntry, TextHash> glyphMap_;
+    std::vector<Text> texts_; // 字体大小去重后的Text
+    std::deque<PrefetchTask> tasks_;
+    uint32_t nextOrder_ = 0;
+    uint32_t remaining_ = 0; // 尚未完成（或取消）的任务数
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    PrefetchStats stats_;
+    std::chrono::steady_clock::time_point startTime_;
+
+    void prefetchLoop();
+    void finishTaskLocked();
+    static uint32_t getPriority(const std::vector<Rect> &visibleRects, const Rect &viewport);
+};
+
+
+#endif //PRF_RESOURCEPREFETCHER_H
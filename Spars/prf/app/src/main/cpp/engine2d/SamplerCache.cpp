@@ -0,0 +1,124 @@
+#include "SamplerCache.h"
+#include "../log.h"
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+SamplerState SamplerState::MakeTexture() {
+    SamplerState state;
+    state.filter_ = VK_FILTER_LINEAR;
+    state.mipmapMode_ = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    state.addressMode_ = VK_SAMPLER_ADDRESS_MODE_REPEAT; // 超出图像范围时重复纹理（像地转平铺纹理）
+    state.maxLod_ = VK_LOD_CLAMP_NONE; // 只有一级时视图只有一级，不做mip采样
+    return state;
+}
+
+SamplerState SamplerState::MakeAtlas() {
+    SamplerState state;
+    state.filter_ = VK_FILTER_LINEAR;
+    state.mipmapMode_ = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    state.addressMode_ = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE; // 图片四周各有1像素的边缘扩展，采样不会越过槽位
+    state.maxLod_ = 0.0f;
+    return state;
+}
+
+std::size_t SamplerStateHash::operator()(const SamplerState &obj) const {
+    std::size_t h1 = std::hash<int>()(obj.filter_);
+    std::size_t h2 = std::hash<int>()(obj.mipmapMode_);
+    std::size_t h3 = std::hash<int>()(obj.addressMode_);
+    std::size_t h4 = std::hash<float>()(obj.maxLod_);
+    return h1 ^ (h2 << 1) ^ (h3 << 2) ^ (h4 << 3);
+}
+
+// ================================== 以下为一些辅助函数 ==================================
+static VkSampler createSampler_helper(VkDevice device, const SamplerState &state)
+{
+    VkSamplerCreateInfo samplerInfo = {};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = state.filter_;
+    samplerInfo.minFilter = state.filter_;
+    samplerInfo.addressModeU = state.addressMode_;
+    samplerInfo.addressModeV = state.addressMode_;
+    samplerInfo.addressModeW = state.addressMode_;
+
+    // 各向异性过滤
+    samplerInfo.anisotropyEnable = VK_FALSE;
+
+    // 边界颜色，只有当addressModeX是VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER才有用
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+    samplerInfo.unnormalizedCoordinates = VK_FALSE; // 为VK_FALSE时用[0,1)采样，不然则为[0,texWidth或Height)
+
+    samplerInfo.compareEnable = VK_FALSE; // 和预设值进行比较，在阴影贴图时使用
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+
+    samplerInfo.mipmapMode = state.mipmapMode_;
+    samplerInfo.mipLodBias = 0.0f;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = state.maxLod_;
+
+    VkSampler sampler;
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create texture sampler!");
+    }
+    return sampler;
+}
+// ================================== 以上为一些辅助函数 ==================================
+
+SamplerCache::SamplerCache(VkDevice device) {
+    device_ = device;
+}
+
+SamplerCache::~SamplerCache() {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    for (auto iter = samplerMap_.begin(); iter != samplerMap_.end(); iter++) {
+        vkDestroySampler(device_, iter->second, nullptr);
+    }
+    samplerMap_.clear();
+}
+
+VkSampler SamplerCache::getSampler(const SamplerState &state) {
+    requestCount_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::shared_lock<std::shared_mutex> locker(mutex_);
+        auto iter = samplerMap_.find(state);
+        if (iter != samplerMap_.end()) {
+            return iter->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    auto iter = samplerMap_.find(state); // 等待写锁期间可能已被其他任务创建
+    if (iter != samplerMap_.end()) {
+        return iter->second;
+    }
+    // 创建一个采样器很快且只发生数次，直接在写锁下创建
+    auto start = std::chrono::steady_clock::now();
+    VkSampler sampler = createSampler_helper(device_, state);
+    createTimeNs_.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    samplerMap_[state] = sampler;
+    return sampler;
+}
+
+SamplerCacheStats SamplerCache::getStats() {
+    SamplerCacheStats stats;
+    {
+        std::shared_lock<std::shared_mutex> locker(mutex_);
+        stats.samplerCount_ = samplerMap_.size();
+    }
+    stats.requestCount_ = requestCount_.load();
+    stats.createTimeNs_ = createTimeNs_.load();
+    return stats;
+}
+
+void SamplerCache::dump() {
+    SamplerCacheStats stats = getStats();
+    LOGI("SamplerCache: %llu samplers for %llu requests (saved %llu VkSampler objects), create %.3f ms (%.3f us per sampler)",
+         (unsigned long long) stats.samplerCount_, (unsigned long long) stats.requestCount_,
+         (unsigned long long) (stats.requestCount_ - stats.samplerCount_), stats.createTimeNs_ / 1e6,
+         stats.samplerCount_ == 0 ? 0.0 : stats.createTimeNs_ / 1e3 / stats.samplerCount_);
+}
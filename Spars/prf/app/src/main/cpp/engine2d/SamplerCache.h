@@ -0,0 +1,69 @@
+#ifndef PRF_SAMPLERCACHE_H
+#define PRF_SAMPLERCACHE_H
+
+#include <vulkan_wrapper.h>
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <unordered_map>
+
+// 采样器的状态（创建参数中会变化的部分），相同状态的纹理共享同一个VkSampler
+struct SamplerState {
+    VkFilter filter_ = VK_FILTER_LINEAR; // mag与min共用
+    VkSamplerMipmapMode mipmapMode_ = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressMode_ = VK_SAMPLER_ADDRESS_MODE_REPEAT; // U、V、W共用
+    float maxLod_ = 0.0f;
+
+    bool operator==(const SamplerState &other) const {
+        return filter_ == other.filter_ && mipmapMode_ == other.mipmapMode_ &&
+               addressMode_ == other.addressMode_ && maxLod_ == other.maxLod_;
+    }
+
+    /**
+     * 独立纹理：线性过滤，超出范围时重复
+     * maxLod不限制（VK_LOD_CLAMP_NONE），实际的级数由图像视图决定，无论有没有mip链都共用一个采样器
+     */
+    static SamplerState MakeTexture();
+    // atlas页（图片与字形）：线性过滤，超出范围时clamp，只有一级
+    static SamplerState MakeAtlas();
+};
+
+struct SamplerStateHash {
+    std::size_t operator()(const SamplerState &obj) const;
+};
+
+// 采样器缓存统计信息
+struct SamplerCacheStats {
+    uint64_t samplerCount_ = 0; // 实际创建的VkSampler数
+    uint64_t requestCount_ = 0; // 请求数（去重之前每次请求都会创建一个VkSampler）
+    uint64_t createTimeNs_ = 0; // vkCreateSampler的累计耗时
+};
+
+/*
+ * 按采样状态去重的采样器缓存（ImageManager、GlyphManager与各TextureAtlas共用，生命周期在Engine2D）
+ * 采样器与图片解耦：纹理与atlas页销毁时不再销毁采样器，所有采样器在析构时统一销毁（需在所有使用它的管线布局与descriptor销毁之后）
+ * 采样状态只有少数几种，getSampler命中时只需一次读锁下的查找
+ */
+class SamplerCache {
+public:
+    explicit SamplerCache(VkDevice device);
+    ~SamplerCache(); // 销毁所有采样器
+
+    VkSampler getSampler(const SamplerState &state); // 返回该状态的采样器，不存在时创建（任意线程调用，线程安全）
+
+    SamplerCacheStats getStats();
+    void dump(); // 以log的形式打印 for debug
+
+private:
+    std::shared_mutex mutex_; // 保护samplerMap_
+    std::unordered_map<SamplerState, VkSampler, SamplerStateHash> samplerMap_;
+
+    std::atomic<uint64_t> requestCount_{0};
+    std::atomic<uint64_t> createTimeNs_{0};
+
+    VkDevice device_;
+};
+
+
+#endif //PRF_SAMPLERCACHE_H
@@ -3,110 +3,120 @@
 //
 
 #include "SamplerDescriptorManager.h"
+#include "../log.h"
 
 #include <vulkan_wrapper.h>
+#include <algorithm>
 #include <array>
+#include <chrono>
+
+PFN_vkCmdPushDescriptorSetKHR SamplerDescriptorManager::cmdPushDescriptorSet_ = nullptr;
 
 /**
- * 创建描述符集
+ * 组合图像采样器的描述符写入
  */
-static VkDescriptorSet createDescriptorSet(VkDevice device, VkDescriptorSetLayout descriptorSetLayout, VkDescriptorPool descriptorPool, VulkanImageInfo &vulkanImageInfo)
+static VkWriteDescriptorSet makeSamplerWrite_helper(VkDescriptorSet descriptorSet, const VkDescriptorImageInfo *imageInfo)
 {
-    // 只为该图像创建一个描述符集
-    VkDescriptorSetAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = 1;
-    allocInfo.pSetLayouts = &descriptorSetLayout;
-
-    VkDescriptorSet descriptorSet; // 描述符集对象
-
-    if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to allocate descriptor sets!");
-    }
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet; // push descriptor时忽略
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = imageInfo;
+    return descriptorWrite;
+}
 
+void SamplerDescriptorManager::createAndInsertSamplerDescriptor(VkImageView imageView, VkDescriptorSetLayout descriptorSetLayout, VulkanImageInfo &vulkanImageInfo, VkDescriptorSet *descriptorSet) {
+    // 组合图像采样器
+    PendingWrite write;
+    write.imageInfo_ = {};
+    write.imageInfo_.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    write.imageInfo_.imageView = vulkanImageInfo.textureImageView_;
+    write.imageInfo_.sampler = vulkanImageInfo.textureSampler_;
 
-//        // 配置描述符引用的缓冲对象
-//        VkDescriptorBufferInfo bufferInfo = {};
-//        bufferInfo.buffer = uniformBuffers[i];
-//        bufferInfo.offset = 0;
-//        bufferInfo.range = sizeof(UniformBufferObject);
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    auto start = std::chrono::steady_clock::now();
 
-    // 组合图像采样器
-    VkDescriptorImageInfo imageInfo = {};
-    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfo.imageView = vulkanImageInfo.textureImageView_;
-    imageInfo.sampler = vulkanImageInfo.textureSampler_;
-
-    // 用于更新描述符配置的vkUpdateDescriptorSets
-    std::array<VkWriteDescriptorSet, 1> descriptorWrites = {}; // 原本是2
-
-//        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-//        descriptorWrites[0].dstSet = descriptorSets[i];
-//        descriptorWrites[0].dstBinding = 0;
-//        descriptorWrites[0].dstArrayElement = 0;
-//        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-//        descriptorWrites[0].descriptorCount = 1;
-//        descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-    descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrites[0].dstSet = descriptorSet;
-    descriptorWrites[0].dstBinding = 0;
-    descriptorWrites[0].dstArrayElement = 0;
-    descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    descriptorWrites[0].descriptorCount = 1;
-    descriptorWrites[0].pImageInfo = &imageInfo;
-
-    vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr); // 这样我们就可以在着色器中使用描述符了
+    // 优先复用已回收的相同layout的描述符集
+    auto freeIter = freeDescriptorSets_.find(descriptorSetLayout);
+    if (freeIter != freeDescriptorSets_.end() && !freeIter->second.empty()) {
+        write.descriptorSet_ = freeIter->second.back();
+        freeIter->second.pop_back();
+        recycleCount_++;
+    } else {
+        try {
+            write.descriptorSet_ = allocateDescriptorSet(descriptorSetLayout);
+        } catch (...) {
+            // 创建失败，从准备列表移除，等待该descriptor的任务抛出同一异常
+            inFlight_.fail(imageView, std::current_exception());
+            throw;
+        }
+        allocCount_++;
+    }
 
-    return descriptorSet;
-}
+    if (batchUpdates_) {
+        // 推迟到flushWrites（录制绑定之前）与本帧其他新建的描述符集一起写入
+        pendingWrites_.push_back(write);
+        pendingWriteCount_.store(static_cast<uint32_t>(pendingWrites_.size()), std::memory_order_release);
+    } else {
+        VkWriteDescriptorSet descriptorWrite = makeSamplerWrite_helper(write.descriptorSet_, &write.imageInfo_);
+        vkUpdateDescriptorSets(device_, 1, &descriptorWrite, 0, nullptr); // 这样我们就可以在着色器中使用描述符了
+        writeCount_++;
+        updateCallCount_++;
+    }
 
-void SamplerDescriptorManager::createAndInsertSamplerDescriptor(VkImageView imageView, VkDescriptorSetLayout descriptorSetLayout, VulkanImageInfo &vulkanImageInfo, VkDescriptorSet *descriptorSet) {
-    std::unique_lock<std::shared_mutex> locker(mutex_);
+    *descriptorSet = write.descriptorSet_;
+    descriptorSetMap_[imageView] = {*descriptorSet, descriptorSetLayout};
+    snapshot_.insert(imageView, *descriptorSet);
 
-    *descriptorSet = createDescriptorSet(device_, descriptorSetLayout, descriptorPool_, vulkanImageInfo);
-    descriptorSetMap_[imageView] = *descriptorSet;
+    uint64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    allocTimeNs_ += elapsedNs;
+    maxAllocTimeNs_ = std::max(maxAllocTimeNs_, elapsedNs);
 
-    // 资源创建完成，从准备列表移除
-    preparingMap_.erase(imageView);
-    cv_.notify_all(); // 此唤醒会导致所有任务唤醒，尽管有些任务在等待其他资源创建完成
+    // 资源创建完成，从准备列表移除，只唤醒等待该descriptor的任务
+    inFlight_.complete(imageView);
 }
 
 bool SamplerDescriptorManager::findSamplerDescriptor(VkImageView imageView, VkDescriptorSet *descriptorSet) {
+    // 已创建的descriptor在快照中无锁查找
+    if (const VkDescriptorSet *found = snapshot_.find(imageView)) {
+        *descriptorSet = *found;
+        return true;
+    }
+
+    std::shared_future<void> pending;
     {
-        std::shared_lock<std::shared_mutex> locker(mutex_);
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        // 可能在快照查找之后刚创建完成
         auto iter = descriptorSetMap_.find(imageView);
         if (iter != descriptorSetMap_.end()) {
-            *descriptorSet = iter->second;
+            *descriptorSet = iter->second.descriptorSet_;
             return true;
         }
-    }
-    {
-        std::unique_lock<std::shared_mutex> locker(mutex_);
         // 未找到，判断是否有其他线程正在创建
-        auto iter2 = preparingMap_.find(imageView);
-        if (iter2 != preparingMap_.end()) { // 其他线程正在创建
-            cv_.wait(locker, [this, &imageView] {
-                return preparingMap_.find(imageView) == preparingMap_.end(); // 该资源已经不在准备列表中了
-            });
-
-            // 其他线程创建完毕了
-            auto iter3 = descriptorSetMap_.find(imageView);
-            if (iter3 != descriptorSetMap_.end()) {
-                *descriptorSet = iter3->second;
-                return true;
-            }
-            // 此处不应该走到
-            throw std::runtime_error("SamplerDescriptorManager::findSamplerDescriptor error!");
-            return false;
-        } else {
-            // 我们是第一个创建的
-            preparingMap_[imageView] = true; // 将该资源加入准备列表，这个true不重要
-            return false; // 需要我们后续创建
+        if (!inFlight_.joinOrStart(imageView, &pending)) {
+            return false; // 我们是第一个创建的，需要我们后续创建
         }
     }
+
+    // 其他线程正在创建，在锁外等待（只在该descriptor完成时被唤醒），创建失败时此处抛出其异常
+    inFlight_.wait(pending);
+
+    // 其他线程创建完毕了
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    auto iter = descriptorSetMap_.find(imageView);
+    if (iter != descriptorSetMap_.end()) {
+        *descriptorSet = iter->second.descriptorSet_;
+        return true;
+    }
+    // 此处不应该走到
+    throw std::runtime_error("SamplerDescriptorManager::findSamplerDescriptor error!");
+}
+
+InFlightStats SamplerDescriptorManager::getInFlightStats() {
+    return inFlight_.getStats();
 }
 
 /**
@@ -123,13 +133,13 @@ static VkDescriptorPool createDescriptorPool(VkDevice device)
     // 描述符池可以分配的描述符集
     std::array<VkDescriptorPoolSize, 1> poolSizes = {};
     poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; // 组合图像采样器
-    poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_SAMPLER_DESCRIPTOR_COUNT);
+    poolSizes[0].descriptorCount = static_cast<uint32_t>(SAMPLER_DESCRIPTOR_POOL_SIZE);
 
     VkDescriptorPoolCreateInfo poolInfo = {};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
     poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_SAMPLER_DESCRIPTOR_COUNT);
+    poolInfo.maxSets = static_cast<uint32_t>(SAMPLER_DESCRIPTOR_POOL_SIZE);
 
     VkDescriptorPool descriptorPool;
     if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
@@ -140,11 +150,146 @@ static VkDescriptorPool createDescriptorPool(VkDevice device)
     return descriptorPool;
 }
 
-SamplerDescriptorManager::SamplerDescriptorManager(VkDevice device) {
+SamplerDescriptorManager::SamplerDescriptorManager(VkDevice device, bool batchUpdates) {
     device_ = device;
-    descriptorPool_ = createDescriptorPool(device);
+    batchUpdates_ = batchUpdates;
+    descriptorPools_.push_back(createDescriptorPool(device));
+}
+
+VkDescriptorSet SamplerDescriptorManager::allocateDescriptorSet(VkDescriptorSetLayout descriptorSetLayout) {
+    // 当前池用满时换到下一个池；池中只有组合图像采样器且每个集合一个描述符，用满只取决于集合数
+    if (currentPoolSetCount_ == SAMPLER_DESCRIPTOR_POOL_SIZE) {
+        currentPool_++;
+        currentPoolSetCount_ = 0;
+        if (currentPool_ == descriptorPools_.size()) {
+            descriptorPools_.push_back(createDescriptorPool(device_));
+        }
+    }
+
+    // 只为该图像创建一个描述符集
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPools_[currentPool_];
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    VkDescriptorSet descriptorSet; // 描述符集对象
+    if (vkAllocateDescriptorSets(device_, &allocInfo, &descriptorSet) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate descriptor sets!");
+    }
+    currentPoolSetCount_++;
+    return descriptorSet;
+}
+
+void SamplerDescriptorManager::writeDescriptorSets(const std::vector<PendingWrite> &writes) {
+    std::vector<VkWriteDescriptorSet> descriptorWrites;
+    descriptorWrites.reserve(writes.size());
+    for (const PendingWrite &write : writes) {
+        descriptorWrites.push_back(makeSamplerWrite_helper(write.descriptorSet_, &write.imageInfo_));
+    }
+    vkUpdateDescriptorSets(device_, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+void SamplerDescriptorManager::flushWrites() {
+    if (pendingWriteCount_.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    std::vector<PendingWrite> writes;
+    {
+        std::unique_lock<std::shared_mutex> locker(mutex_);
+        writes.swap(pendingWrites_);
+        pendingWriteCount_.store(0, std::memory_order_relaxed);
+        writeCount_ += writes.size();
+        updateCallCount_++;
+    }
+    // 各描述符集只由此处写入，无需持锁；工作线程此时新建的描述符集进入下一批
+    writeDescriptorSets(writes);
+}
+
+void SamplerDescriptorManager::releaseSamplerDescriptor(VkImageView imageView) {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    auto iter = descriptorSetMap_.find(imageView);
+    if (iter == descriptorSetMap_.end()) { // 从未绘制过，或已随clear归还
+        return;
+    }
+    // 尚未flushWrites的写入一并丢弃，否则复用该描述符集的新纹理会被旧的imageView覆盖（旧的imageView此时可能已销毁）
+    VkDescriptorSet descriptorSet = iter->second.descriptorSet_;
+    pendingWrites_.erase(std::remove_if(pendingWrites_.begin(), pendingWrites_.end(),
+                                        [descriptorSet](const PendingWrite &write) { return write.descriptorSet_ == descriptorSet; }),
+                         pendingWrites_.end());
+    pendingWriteCount_.store(static_cast<uint32_t>(pendingWrites_.size()), std::memory_order_release);
+    freeDescriptorSets_[iter->second.descriptorSetLayout_].push_back(descriptorSet);
+    descriptorSetMap_.erase(iter);
+    snapshot_.erase(imageView); // 纹理淘汰时调用（工作线程空闲），之后的帧不会再查找到
+}
+
+void SamplerDescriptorManager::clear() {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    // 保留所有池，重置后从第一个池重新分配
+    for (VkDescriptorPool descriptorPool : descriptorPools_) {
+        if (vkResetDescriptorPool(device_, descriptorPool, 0) != VK_SUCCESS) {
+            throw std::runtime_error("failed to reset descriptor pool!");
+        }
+    }
+    currentPool_ = 0;
+    currentPoolSetCount_ = 0;
+    descriptorSetMap_.clear();
+    freeDescriptorSets_.clear();
+    pendingWrites_.clear();
+    pendingWriteCount_.store(0, std::memory_order_relaxed);
+    snapshot_.clear();
+    snapshot_.reclaim();
+}
+
+void SamplerDescriptorManager::endFrame() {
+    std::unique_lock<std::shared_mutex> locker(mutex_);
+    snapshot_.reclaim();
+}
+
+void SamplerDescriptorManager::loadPushDescriptor(VkDevice device) {
+    cmdPushDescriptorSet_ = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdPushDescriptorSetKHR"));
+    if (cmdPushDescriptorSet_ == nullptr) {
+        throw std::runtime_error("failed to load vkCmdPushDescriptorSetKHR!");
+    }
+}
+
+void SamplerDescriptorManager::pushSamplerDescriptor(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const VkDescriptorImageInfo &imageInfo) {
+    VkWriteDescriptorSet descriptorWrite = makeSamplerWrite_helper(VK_NULL_HANDLE, &imageInfo);
+    cmdPushDescriptorSet_(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorWrite);
+}
+
+DescriptorStats SamplerDescriptorManager::getDescriptorStats() {
+    std::shared_lock<std::shared_mutex> locker(mutex_);
+    DescriptorStats stats;
+    stats.inUseCount_ = descriptorSetMap_.size();
+    for (auto &iter : freeDescriptorSets_) {
+        stats.freeCount_ += iter.second.size();
+    }
+    stats.poolCount_ = descriptorPools_.size();
+    stats.allocCount_ = allocCount_;
+    stats.recycleCount_ = recycleCount_;
+    stats.allocTimeNs_ = allocTimeNs_;
+    stats.maxAllocTimeNs_ = maxAllocTimeNs_;
+    stats.writeCount_ = writeCount_;
+    stats.updateCallCount_ = updateCallCount_;
+    return stats;
+}
+
+void SamplerDescriptorManager::dump() {
+    DescriptorStats stats = getDescriptorStats();
+    uint64_t createCount = stats.allocCount_ + stats.recycleCount_;
+    LOGI("SamplerDescriptorManager: %llu descriptor sets in use, %llu recycled, %llu pools of %d, created %llu (%llu reused), %.2f us/create (max %.2f us), %llu writes in %llu vkUpdateDescriptorSets",
+         (unsigned long long) stats.inUseCount_, (unsigned long long) stats.freeCount_,
+         (unsigned long long) stats.poolCount_, SAMPLER_DESCRIPTOR_POOL_SIZE,
+         (unsigned long long) createCount, (unsigned long long) stats.recycleCount_,
+         createCount == 0 ? 0.0 : stats.allocTimeNs_ / 1e3 / createCount, stats.maxAllocTimeNs_ / 1e3,
+         (unsigned long long) stats.writeCount_, (unsigned long long) stats.updateCallCount_);
 }
 
 SamplerDescriptorManager::~SamplerDescriptorManager() {
-    vkDestroyDescriptorPool(device_, descriptorPool_, nullptr);
-}
\ No newline at end of file
+    for (VkDescriptorPool descriptorPool : descriptorPools_) {
+        vkDestroyDescriptorPool(device_, descriptorPool, nullptr);
+    }
+}
@@ -6,22 +6,45 @@
 #define PRF_SAMPLERDESCRIPTORMANAGER_H
 
 #include <vulkan_wrapper.h>
+#include <atomic>
 #include <shared_mutex>
-#include <condition_variable>
+#include <unordered_map>
+#include <vector>
 
 #include "image/Image.h"
+#include "InFlightMap.h"
+#include "SnapshotMap.h"
 
-// 最多可以绘制的图片数量 TODO: 后续以LRU等策略管理
-#define MAX_SAMPLER_DESCRIPTOR_COUNT 256
+// 每个描述符池可分配的descriptor set数，用满时新建一个池（池只在clear时重置、析构时销毁）
+#define SAMPLER_DESCRIPTOR_POOL_SIZE 256
 
 struct VulkanDescriptorSetInfo {
     bool valid_ = false; // 有些DrawResource可能不需要descriptor，RenderWorkerPool在插入时需要判断
     VkDescriptorSet descriptorSet_;
+    bool push_ = false; // 为true时不使用descriptorSet_，录制时以push descriptor写入imageInfo_（VK_KHR_push_descriptor）
+    VkDescriptorImageInfo imageInfo_;
+};
+
+// 描述符集分配统计
+struct DescriptorStats {
+    uint64_t inUseCount_ = 0;
+    uint64_t freeCount_ = 0; // 已回收、可复用的
+    uint64_t poolCount_ = 0;
+    uint64_t allocCount_ = 0; // 从池中新分配的次数
+    uint64_t recycleCount_ = 0; // 复用已回收描述符集的次数
+    uint64_t allocTimeNs_ = 0; // 创建描述符集（持锁部分）的累计耗时
+    uint64_t maxAllocTimeNs_ = 0;
+    uint64_t writeCount_ = 0; // 写入的描述符数
+    uint64_t updateCallCount_ = 0; // vkUpdateDescriptorSets的调用次数
 };
 
 class SamplerDescriptorManager {
 public:
-    SamplerDescriptorManager(VkDevice device);
+    /**
+     * @param batchUpdates 为true时新建描述符集的写入推迟到flushWrites，合并为一次vkUpdateDescriptorSets；
+     *                     为false时创建时立即写入
+     */
+    SamplerDescriptorManager(VkDevice device, bool batchUpdates);
     ~SamplerDescriptorManager();
 
     void createAndInsertSamplerDescriptor(VkImageView imageView, VkDescriptorSetLayout descriptorSetLayout, VulkanImageInfo &vulkanImageInfo, VkDescriptorSet *descriptorSet); // 创建并插入VkDescriptorSet，创建的值通过descriptorSet参数返回
@@ -29,22 +52,73 @@ public:
     /**
      * 查找是否有缓存的资源：
      *  若有：      返回该资源（通过参数）
-     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源
+     *  若没有：    若当前正有其他并发任务在创建该资源，则阻塞，在其创建完成后返回该资源（创建失败时抛出创建者的异常）
      *             若当前为第一个使用该未创建资源的任务，则直接返回false，并将该资源列为“准备中”（其他并发任务会阻塞）
      * @return 是否有缓存的资源
      */
     bool findSamplerDescriptor(VkImageView imageView, VkDescriptorSet *descriptorSet); // 返回是否找到
 
+    // 回收该图像视图的VkDescriptorSet（纹理销毁前调用，此时GPU已不再使用该descriptor），之后相同layout的创建会复用它
+    void releaseSamplerDescriptor(VkImageView imageView);
+
+    void clear(); // 归还所有VkDescriptorSet（其layout随pipeline销毁时），调用时GPU与工作线程均空闲
+
+    /**
+     * 提交尚未写入的描述符集（batchUpdates），在主线程录制绑定描述符集之前调用
+     * 待写入的描述符集尚未被任何指令缓冲绑定，因此此时写入是安全的；没有待写入时只读一个原子变量
+     */
+    void flushWrites();
+
+    void endFrame(); // 每帧开始时在纹理淘汰之后调用（工作线程空闲），释放旧的查找快照
+
+    // 设备已启用VK_KHR_push_descriptor时调用一次，获取vkCmdPushDescriptorSetKHR
+    static void loadPushDescriptor(VkDevice device);
+    // 录制时将一个组合图像采样器写入pipelineLayout的set 0（其layout需以PUSH_DESCRIPTOR创建）
+    static void pushSamplerDescriptor(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, const VkDescriptorImageInfo &imageInfo);
+
+    InFlightStats getInFlightStats(); // 等待其他任务创建descriptor的次数与阻塞时间
+    DescriptorStats getDescriptorStats();
+    void dump(); // 以log的形式打印 for debug
+
 private:
+    struct DescriptorSetEntry {
+        VkDescriptorSet descriptorSet_;
+        VkDescriptorSetLayout descriptorSetLayout_; // 回收后只能给相同layout复用
+    };
 
     std::shared_mutex mutex_; // 保护下面的map
-    std::condition_variable_any cv_; // 确保同时只有一个任务在创建资源
 
-    std::unordered_map<VkImageView, VkDescriptorSet> descriptorSetMap_; // 此处的索引为VkImageView，决定对应的descriptor
-    std::unordered_map<VkImageView, bool> preparingMap_; // 维护所有正在创建的Descriptor，避免多任务并发导致的重复创建
+    std::unordered_map<VkImageView, DescriptorSetEntry> descriptorSetMap_; // 此处的索引为VkImageView，决定对应的descriptor
+    InFlightMap<VkImageView> inFlight_; // 维护所有正在创建的Descriptor，避免多任务并发导致的重复创建
+    SnapshotMap<VkImageView, VkDescriptorSet> snapshot_; // descriptorSetMap_的只读快照，已创建的descriptor无锁查找；在mutex_下更新
+    std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeDescriptorSets_; // 已回收、可复用的VkDescriptorSet
+
+    // 尚未写入的描述符集（batchUpdates），受mutex_保护
+    struct PendingWrite {
+        VkDescriptorSet descriptorSet_;
+        VkDescriptorImageInfo imageInfo_;
+    };
+    std::vector<PendingWrite> pendingWrites_;
+    std::atomic<uint32_t> pendingWriteCount_{0}; // flushWrites无锁判断是否有待写入
 
     VkDevice device_;
-    VkDescriptorPool descriptorPool_;
+    bool batchUpdates_;
+    std::vector<VkDescriptorPool> descriptorPools_; // 按创建顺序，只从currentPool_及之后的池分配
+    uint32_t currentPool_ = 0;
+    uint32_t currentPoolSetCount_ = 0; // currentPool_已分配的描述符集数
+
+    // 统计，受mutex_保护
+    uint64_t allocCount_ = 0;
+    uint64_t recycleCount_ = 0;
+    uint64_t allocTimeNs_ = 0;
+    uint64_t maxAllocTimeNs_ = 0;
+    uint64_t writeCount_ = 0;
+    uint64_t updateCallCount_ = 0;
+
+    static PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet_;
+
+    VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout descriptorSetLayout); // 在mutex_下调用，当前池用满时换到下一个池（没有时新建）
+    void writeDescriptorSets(const std::vector<PendingWrite> &writes); // 合并为一次vkUpdateDescriptorSets
 };
 
 
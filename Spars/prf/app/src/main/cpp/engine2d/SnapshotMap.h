@@ -0,0 +1,114 @@
+#ifndef PRF_SNAPSHOTMAP_H
+#define PRF_SNAPSHOTMAP_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * 只读快照哈希表，用于各Manager的热路径查找（资源已存在时）
+ * 读取不加锁：一次acquire load取得当前快照后直接查找，不写任何共享的缓存行
+ * 写入（插入、删除）需在调用者的写锁下进行：复制当前快照、修改后发布，旧快照放入待释放列表
+ * 旧快照在reclaim()中释放，调用者需保证此时没有读取者（帧开始时工作线程空闲），读取到的值指针在下一次reclaim之前有效
+ * 写入为O(n)的复制，适用于读远多于写、条目数为数百量级的表（管线、纹理、字体strike、descriptor）
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class SnapshotMap {
+public:
+    using Map = std::unordered_map<Key, Value, Hash>;
+
+    SnapshotMap() : current_(new Map()) {}
+
+    ~SnapshotMap() {
+        reclaim();
+        delete current_.load(std::memory_order_relaxed);
+    }
+
+    SnapshotMap(const SnapshotMap &) = delete;
+    SnapshotMap &operator=(const SnapshotMap &) = delete;
+
+    // 无锁查找，未找到时返回nullptr
+    const Value *find(const Key &key) const {
+        const Map *map = current_.load(std::memory_order_acquire);
+        auto iter = map->find(key);
+        return iter == map->end() ? nullptr : &iter->second;
+    }
+
+    // 以下在调用者的写锁下调用
+    void insert(const Key &key, const Value &value) {
+        update([&key, &value](Map &map) { map[key] = value; });
+    }
+
+    void erase(const Key &key) {
+        update([&key](Map &map) { map.erase(key); });
+    }
+
+    void clear() {
+        publish(new Map());
+    }
+
+    // 一次复制中完成多个修改（如一帧中淘汰的所有条目）
+    template <typename Fn>
+    void update(Fn mutate) {
+        Map *next = new Map(*current_.load(std::memory_order_relaxed));
+        mutate(*next);
+        publish(next);
+    }
+
+    // 释放旧快照（调用者的写锁下，且没有读取者）
+    void reclaim() {
+        for (const Map *map : retired_) {
+            delete map;
+        }
+        retired_.clear();
+    }
+
+    size_t retiredCount() const { return retired_.size(); } // 待释放的旧快照数（调用者的锁下）
+
+private:
+    void publish(Map *next) {
+        retired_.push_back(current_.exchange(next, std::memory_order_acq_rel));
+    }
+
+    std::atomic<const Map *> current_;
+    std::vector<const Map *> retired_; // 受调用者的写锁保护
+};
+
+/*
+ * 分槽计数器：各线程累加到不同缓存行上的槽，读取时求和
+ * 用于热路径上的命中计数，避免所有工作线程对同一个原子变量做读-改-写
+ */
+class StripedCounter {
+public:
+    void add(uint64_t n) {
+        slots_[slotIndex()].value_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t load() const {
+        uint64_t sum = 0;
+        for (const Slot &slot : slots_) {
+            sum += slot.value_.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+private:
+    static const size_t SLOT_COUNT = 16;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value_{0};
+    };
+    Slot slots_[SLOT_COUNT];
+
+    // 每个线程第一次使用时分配一个槽
+    static size_t slotIndex() {
+        static std::atomic<size_t> nextSlot{0};
+        static thread_local size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+        return slot;
+    }
+};
+
+#endif //PRF_SNAPSHOTMAP_H
@@ -0,0 +1,333 @@
+#include "TextureAtlas.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// ================================== 以下为一些辅助函数 ==================================
+/**
+ * 查找合适的显存类型
+ */
+static uint32_t findMemoryType_helper(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    // 物理设备可用的内存类型
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+    {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+// 创建一页atlas的图像、显存与视图，采样器取自samplerCache
+static AtlasPageInfo createPage_helper(VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader, SamplerCache *samplerCache,
+                                       uint32_t pageSize, VkFormat format)
+{
+    AtlasPageInfo pageInfo;
+
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = pageSize;
+    imageInfo.extent.height = pageSize;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    textureUploader->setImageSharingMode(&imageInfo); // 上传与采样位于不同队列族时为CONCURRENT
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.flags = 0;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &pageInfo.image_) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create atlas image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, pageInfo.image_, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType_helper(physicalDevice, memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &pageInfo.imageMemory_) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to allocate atlas image memory!");
+    }
+    vkBindImageMemory(device, pageInfo.image_, pageInfo.imageMemory_, 0);
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pageInfo.image_;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &pageInfo.imageView_) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create atlas image view!");
+    }
+
+    // 采样器按状态共享（线性过滤，超出范围时clamp：图片四周各有1像素的边缘扩展，采样不会越过槽位）
+    pageInfo.sampler_ = samplerCache->getSampler(SamplerState::MakeAtlas());
+
+    return pageInfo;
+}
+// ================================== 以上为一些辅助函数 ==================================
+
+TextureAtlas::TextureAtlas(VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader, SamplerCache *samplerCache,
+                           uint32_t pageSize, uint32_t maxPages, VkFormat format) {
+    device_ = device;
+    physicalDevice_ = physicalDevice;
+    textureUploader_ = textureUploader;
+    samplerCache_ = samplerCache;
+    pageSize_ = pageSize;
+    maxPages_ = maxPages;
+    format_ = format;
+    pages_.reserve(maxPages);
+}
+
+TextureAtlas::~TextureAtlas() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    for (Page &page : pages_) {
+        vkDestroyImageView(device_, page.info_.imageView_, nullptr);
+        vkDestroyImage(device_, page.info_.image_, nullptr);
+        vkFreeMemory(device_, page.info_.imageMemory_, nullptr);
+    }
+}
+
+bool TextureAtlas::allocate(uint32_t width, uint32_t height, AtlasRegion *region) {
+    if (width == 0 || height == 0 || width > pageSize_ || height > pageSize_) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    for (size_t i = 0; i < pages_.size(); i++) {
+        if (allocateInPage(pages_[i], static_cast<int32_t>(i), width, height, region)) {
+            regionCount_++;
+            return true;
+        }
+    }
+
+    // 已有的页都放不下，创建新页
+    if (pages_.size() >= maxPages_) {
+        return false;
+    }
+    createPage();
+    if (!allocateInPage(pages_.back(), static_cast<int32_t>(pages_.size() - 1), width, height, region)) {
+        return false;
+    }
+    regionCount_++;
+    return true;
+}
+
+bool TextureAtlas::allocateInPage(Page &page, int32_t pageIndex, uint32_t width, uint32_t height, AtlasRegion *region) {
+    uint32_t shelfHeight = (height + SHELF_HEIGHT_ALIGNMENT - 1) / SHELF_HEIGHT_ALIGNMENT * SHELF_HEIGHT_ALIGNMENT;
+    shelfHeight = std::min(shelfHeight, pageSize_);
+
+    for (size_t i = 0; i < page.shelves_.size(); i++) {
+        Shelf &shelf = page.shelves_[i];
+        if (shelf.height_ != shelfHeight) {
+            continue;
+        }
+
+        // 先复用空闲槽位（取能放下的最窄者），只切出所需的宽度，剩余部分仍为空闲槽位
+        size_t best = shelf.freeSlots_.size();
+        for (size_t j = 0; j < shelf.freeSlots_.size(); j++) {
+            if (shelf.freeSlots_[j].width_ >= width &&
+                (best == shelf.freeSlots_.size() || shelf.freeSlots_[j].width_ < shelf.freeSlots_[best].width_)) {
+                best = j;
+            }
+        }
+        if (best != shelf.freeSlots_.size()) {
+            Slot &slot = shelf.freeSlots_[best];
+            *region = {pageIndex, static_cast<uint32_t>(i), slot.x_, shelf.y_, width, height};
+            if (slot.width_ > width) {
+                slot.x_ += width;
+                slot.width_ -= width;
+            } else {
+                shelf.freeSlots_.erase(shelf.freeSlots_.begin() + best);
+            }
+            shelf.regionCount_++;
+            return true;
+        }
+
+        // 再使用shelf的剩余部分
+        if (shelf.nextX_ + width <= pageSize_) {
+            *region = {pageIndex, static_cast<uint32_t>(i), shelf.nextX_, shelf.y_, width, height};
+            shelf.nextX_ += width;
+            shelf.regionCount_++;
+            return true;
+        }
+    }
+
+    // 开一个新的shelf
+    int32_t index = openShelf(page, shelfHeight);
+    if (index < 0) {
+        return false;
+    }
+    Shelf &shelf = page.shelves_[index];
+    shelf.nextX_ = width;
+    shelf.regionCount_ = 1;
+    *region = {pageIndex, static_cast<uint32_t>(index), 0, shelf.y_, width, height};
+    return true;
+}
+
+int32_t TextureAtlas::openShelf(Page &page, uint32_t height) {
+    // 优先切分能放下的最矮的空闲shelf（高度相同的已在allocateInPage中直接使用）
+    int32_t best = -1;
+    for (size_t i = 0; i < page.shelves_.size(); i++) {
+        const Shelf &shelf = page.shelves_[i];
+        if (shelf.height_ >= height && shelf.regionCount_ == 0 &&
+            (best < 0 || shelf.height_ < page.shelves_[best].height_)) {
+            best = static_cast<int32_t>(i);
+        }
+    }
+    if (best >= 0) {
+        uint32_t remaining = page.shelves_[best].height_ - height;
+        if (remaining > 0) {
+            uint32_t rest = newShelfEntry(page); // 可能追加条目，之后再取引用
+            page.shelves_[rest].y_ = page.shelves_[best].y_ + height;
+            page.shelves_[rest].height_ = remaining;
+        }
+        page.shelves_[best].height_ = height;
+        return best;
+    }
+
+    if (page.nextShelfY_ + height > pageSize_) {
+        return -1;
+    }
+    uint32_t index = newShelfEntry(page);
+    page.shelves_[index].y_ = page.nextShelfY_;
+    page.shelves_[index].height_ = height;
+    page.nextShelfY_ += height;
+    return static_cast<int32_t>(index);
+}
+
+uint32_t TextureAtlas::newShelfEntry(Page &page) {
+    for (size_t i = 0; i < page.shelves_.size(); i++) {
+        if (page.shelves_[i].height_ == 0) {
+            page.shelves_[i] = Shelf();
+            return static_cast<uint32_t>(i);
+        }
+    }
+    page.shelves_.emplace_back();
+    return static_cast<uint32_t>(page.shelves_.size() - 1);
+}
+
+void TextureAtlas::reclaimShelf(Page &page, uint32_t index) {
+    Shelf &shelf = page.shelves_[index];
+    shelf.nextX_ = 0;
+    shelf.freeSlots_.clear();
+
+    // 与上下相邻的空闲shelf合并（空闲shelf总是已合并，上下各至多一个）
+    for (size_t i = 0; i < page.shelves_.size(); i++) {
+        Shelf &other = page.shelves_[i];
+        if (i == index || other.height_ == 0 || other.regionCount_ != 0) {
+            continue;
+        }
+        if (other.y_ + other.height_ == shelf.y_) {
+            shelf.y_ = other.y_;
+            shelf.height_ += other.height_;
+            other = Shelf();
+        } else if (shelf.y_ + shelf.height_ == other.y_) {
+            shelf.height_ += other.height_;
+            other = Shelf();
+        }
+    }
+
+    // 位于已使用部分的顶端时整体退回页
+    if (shelf.y_ + shelf.height_ == page.nextShelfY_) {
+        page.nextShelfY_ = shelf.y_;
+        shelf = Shelf();
+    }
+}
+
+void TextureAtlas::createPage() {
+    Page page;
+    page.info_ = createPage_helper(device_, physicalDevice_, textureUploader_, samplerCache_, pageSize_, format_);
+    // 在返回任何区域之前录制布局变换，之后对该页的区域上传都排在其后
+    textureUploader_->initializeImage(page.info_.image_);
+    pages_.push_back(page);
+    LOGI("TextureAtlas: created page %zu (%ux%u)", pages_.size() - 1, pageSize_, pageSize_);
+}
+
+bool TextureAtlas::addPage() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (pages_.size() >= maxPages_) {
+        return false;
+    }
+    createPage();
+    return true;
+}
+
+void TextureAtlas::free(const AtlasRegion &region) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    Page &page = pages_.at(region.page_);
+    Shelf &shelf = page.shelves_.at(region.shelf_);
+    regionCount_--;
+    if (--shelf.regionCount_ == 0) {
+        reclaimShelf(page, region.shelf_);
+        return;
+    }
+
+    // 按x有序插入，并与左右相邻的空闲槽位合并
+    auto iter = std::lower_bound(shelf.freeSlots_.begin(), shelf.freeSlots_.end(), region.x_,
+                                 [](const Slot &slot, uint32_t x) { return slot.x_ < x; });
+    iter = shelf.freeSlots_.insert(iter, {region.x_, region.width_});
+    auto next = std::next(iter);
+    if (next != shelf.freeSlots_.end() && iter->x_ + iter->width_ == next->x_) {
+        iter->width_ += next->width_;
+        shelf.freeSlots_.erase(next);
+    }
+    if (iter != shelf.freeSlots_.begin()) {
+        auto prev = std::prev(iter);
+        if (prev->x_ + prev->width_ == iter->x_) {
+            prev->width_ += iter->width_;
+            iter = shelf.freeSlots_.erase(iter) - 1;
+        }
+    }
+
+    // 合并后位于shelf末尾，退回未使用部分
+    if (iter->x_ + iter->width_ == shelf.nextX_) {
+        shelf.nextX_ = iter->x_;
+        shelf.freeSlots_.erase(iter);
+    }
+}
+
+AtlasPageInfo TextureAtlas::getPageInfo(int32_t page) {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return pages_.at(page).info_;
+}
+
+uint32_t TextureAtlas::getPageSize() {
+    return pageSize_;
+}
+
+uint32_t TextureAtlas::getPageCount() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return static_cast<uint32_t>(pages_.size());
+}
+
+uint32_t TextureAtlas::getRegionCount() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    return regionCount_;
+}
@@ -0,0 +1,99 @@
+#ifndef PRF_TEXTUREATLAS_H
+#define PRF_TEXTUREATLAS_H
+
+#include <vulkan_wrapper.h>
+
+#include <mutex>
+#include <vector>
+
+#include "SamplerCache.h"
+#include "TextureUploader.h"
+
+// atlas中的一个区域（像素坐标），由allocate返回，free时原样交回
+struct AtlasRegion {
+    int32_t page_ = -1; // 所在页，-1表示无效
+    uint32_t shelf_ = 0; // 所在shelf
+    uint32_t x_ = 0;
+    uint32_t y_ = 0;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+};
+
+// 一页atlas的Vulkan资源，所有落在该页的图片共享
+struct AtlasPageInfo {
+    VkImage image_;
+    VkDeviceMemory imageMemory_;
+    VkImageView imageView_;
+    VkSampler sampler_; // 来自SamplerCache，不随页销毁
+};
+
+/*
+ * 小图片的纹理atlas：多张pageSize x pageSize的页（默认RGBA8，字形atlas为R8），每页按shelf（行）装箱
+ * shelf高度按8像素向上取整，同一shelf内从左到右分配；释放的槽位按x有序挂在所在shelf的空闲列表上并与相邻的空闲槽位合并，
+ * 复用时只切出所需的宽度；shelf的区域全部释放后回收，与上下相邻的空闲shelf合并，可切分给其他高度的shelf
+ * 页在第一次需要时创建（最多maxPages页），创建时由TextureUploader变换为SHADER_READ_ONLY_OPTIMAL，之后各区域分别上传
+ * 页只在析构时销毁（需在TextureUploader删除之后，此时GPU空闲）
+ */
+class TextureAtlas {
+public:
+    TextureAtlas(VkDevice device, VkPhysicalDevice physicalDevice, TextureUploader *textureUploader, SamplerCache *samplerCache,
+                 uint32_t pageSize, uint32_t maxPages, VkFormat format = VK_FORMAT_R8G8B8A8_UNORM);
+    ~TextureAtlas(); // 销毁所有页（采样器由SamplerCache销毁）
+
+    /**
+     * 分配一个width x height的区域（任意线程调用，线程安全）
+     * @return 是否成功，所有页都放不下时返回false（调用者改为创建独立的纹理）
+     */
+    bool allocate(uint32_t width, uint32_t height, AtlasRegion *region);
+    void free(const AtlasRegion &region); // 归还区域，调用时GPU已不再采样该区域
+
+    bool addPage(); // 预先创建一页（在分配任何区域之前就需要页的视图时），已达maxPages时返回false
+
+    AtlasPageInfo getPageInfo(int32_t page);
+    uint32_t getPageSize();
+    uint32_t getPageCount();
+    uint32_t getRegionCount(); // 当前已分配的区域数
+
+private:
+    struct Slot {
+        uint32_t x_;
+        uint32_t width_;
+    };
+
+    struct Shelf {
+        uint32_t y_ = 0;
+        uint32_t height_ = 0; // 为0时该条目已回收（区域中的shelf_下标需保持不变，条目不删除，之后开新shelf时复用）
+        uint32_t nextX_ = 0; // 该shelf尚未使用部分的起点
+        uint32_t regionCount_ = 0; // 已分配的区域数，为0时为空闲shelf
+        std::vector<Slot> freeSlots_; // 已释放、可复用的槽位，按x_有序且互不相邻
+    };
+
+    struct Page {
+        AtlasPageInfo info_;
+        std::vector<Shelf> shelves_;
+        uint32_t nextShelfY_ = 0; // 尚未分配给shelf的部分的起点
+    };
+
+    const uint32_t SHELF_HEIGHT_ALIGNMENT = 8; // 高度相近的图片共享shelf，减少shelf数量
+
+    std::mutex mutex_; // 保护下面的页与计数
+    std::vector<Page> pages_;
+    uint32_t regionCount_ = 0;
+
+    VkDevice device_;
+    VkPhysicalDevice physicalDevice_;
+    TextureUploader *textureUploader_;
+    SamplerCache *samplerCache_; // 页的采样器（生命周期在Engine2D）
+    uint32_t pageSize_;
+    uint32_t maxPages_;
+    VkFormat format_;
+
+    bool allocateInPage(Page &page, int32_t pageIndex, uint32_t width, uint32_t height, AtlasRegion *region);
+    int32_t openShelf(Page &page, uint32_t height); // 开一个新的shelf（优先切分空闲shelf），返回其下标，放不下时返回-1
+    uint32_t newShelfEntry(Page &page); // 取一个已回收的条目或追加一个
+    void reclaimShelf(Page &page, uint32_t index); // shelf的区域已全部释放：与相邻的空闲shelf合并，位于顶端时退回页
+    void createPage(); // 需持有mutex_
+};
+
+
+#endif //PRF_TEXTUREATLAS_H
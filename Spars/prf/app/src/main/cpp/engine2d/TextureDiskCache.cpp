@@ -0,0 +1,260 @@
+#include "TextureDiskCache.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <android/trace.h>
+
+static uint64_t nowNs_helper() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TextureDiskCache::TextureDiskCache(const std::string &directory, uint64_t budgetBytes) {
+    directory_ = directory;
+    budgetBytes_ = budgetBytes;
+
+    mkdir(directory_.c_str(), 0700); // 已存在时失败，无需处理
+
+    // 扫描已有的文件，以mtime作为最近使用时间；上次异常退出遗留的临时文件直接删除
+    DIR *dir = opendir(directory_.c_str());
+    if (dir == nullptr) {
+        LOGE("TextureDiskCache: failed to open %s", directory_.c_str());
+        return;
+    }
+    std::lock_guard<std::mutex> locker(mutex_);
+    while (dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        std::string fullPath = directory_ + "/" + name;
+        if (name.find(".tmp") != std::string::npos) {
+            unlink(fullPath.c_str());
+            continue;
+        }
+        struct stat fileStat;
+        if (stat(fullPath.c_str(), &fileStat) != 0) {
+            continue;
+        }
+        files_[name] = {static_cast<uint64_t>(fileStat.st_size), static_cast<int64_t>(fileStat.st_mtime)};
+        bytes_ += fileStat.st_size;
+    }
+    closedir(dir);
+    evictLocked("");
+}
+
+uint64_t TextureDiskCache::hashBytes(const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t TextureDiskCache::sourceHash(const std::string &path, const AssetFile &asset) {
+    {
+        std::lock_guard<std::mutex> locker(mutex_);
+        auto iter = sourceHashMap_.find(path);
+        if (iter != sourceHashMap_.end()) {
+            return iter->second;
+        }
+    }
+
+    // 不持锁计算（多个线程同时计算同一路径时结果相同）
+    ATrace_beginSection("hashSource");
+    uint64_t hash = asset.contentHash();
+    ATrace_endSection();
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    sourceHashMap_[path] = hash;
+    return hash;
+}
+
+std::string TextureDiskCache::makeFileName(const std::string &path, int targetWidth, int targetHeight) {
+    char name[64];
+    snprintf(name, sizeof(name), "%016llx_%dx%d.tex", (unsigned long long) hashBytes(path.data(), path.size()),
+             targetWidth, targetHeight);
+    return name;
+}
+
+bool TextureDiskCache::load(const std::string &path, uint64_t sourceHash, int targetWidth, int targetHeight, DecodedImage *decoded) {
+    uint64_t startNs = nowNs_helper();
+    std::string fileName = makeFileName(path, targetWidth, targetHeight);
+    std::string fullPath = directory_ + "/" + fileName;
+
+    int fd = open(fullPath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::lock_guard<std::mutex> locker(mutex_);
+        stats_.missCount_++;
+        return false;
+    }
+
+    ATrace_beginSection("loadTextureFromDiskCache");
+    struct stat fileStat;
+    void *mapped = MAP_FAILED;
+    if (fstat(fd, &fileStat) == 0 && static_cast<size_t>(fileStat.st_size) >= sizeof(FileHeader)) {
+        mapped = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd); // 映射建立后可以关闭文件
+
+    // 校验：魔数、版本、源文件哈希、尺寸与文件大小
+    bool valid = false;
+    if (mapped != MAP_FAILED) {
+        const FileHeader *header = static_cast<const FileHeader *>(mapped);
+        valid = header->magic_ == MAGIC && header->version_ == VERSION && header->format_ == FORMAT_RGBA8 &&
+                header->sourceHash_ == sourceHash && header->width_ > 0 && header->height_ > 0 &&
+                header->payloadSize_ == static_cast<uint64_t>(header->width_) * header->height_ * 4 &&
+                sizeof(FileHeader) + header->payloadSize_ == static_cast<uint64_t>(fileStat.st_size);
+        if (valid) {
+            decoded->pixels_ = static_cast<unsigned char *>(mapped) + sizeof(FileHeader);
+            decoded->width_ = header->width_;
+            decoded->height_ = header->height_;
+            decoded->sourceWidth_ = header->sourceWidth_;
+            decoded->sourceHeight_ = header->sourceHeight_;
+            decoded->mappedBase_ = mapped;
+            decoded->mappedSize_ = fileStat.st_size;
+            // 按需分页，提示内核预读，随后的复制不会逐页缺页
+            madvise(mapped, fileStat.st_size, MADV_WILLNEED);
+        } else {
+            munmap(mapped, fileStat.st_size);
+        }
+    }
+    ATrace_endSection();
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    if (!valid) {
+        removeLocked(fileName);
+        stats_.invalidCount_++;
+        stats_.missCount_++;
+        return false;
+    }
+
+    // 更新最近使用时间（同时写回mtime，下次启动时仍按此排序）
+    int64_t now = static_cast<int64_t>(time(nullptr));
+    auto iter = files_.find(fileName);
+    if (iter != files_.end()) {
+        iter->second.lastUsed_ = now;
+    }
+    utimensat(AT_FDCWD, fullPath.c_str(), nullptr, 0);
+
+    stats_.hitCount_++;
+    stats_.loadTimeNs_ += nowNs_helper() - startNs;
+    return true;
+}
+
+void TextureDiskCache::store(const std::string &path, uint64_t sourceHash, int targetWidth, int targetHeight, const DecodedImage &decoded) {
+    uint64_t startNs = nowNs_helper();
+    std::string fileName = makeFileName(path, targetWidth, targetHeight);
+    std::string fullPath = directory_ + "/" + fileName;
+    std::string tempPath = fullPath + "." + std::to_string(tempCounter_.fetch_add(1)) + ".tmp";
+
+    FileHeader header = {};
+    header.magic_ = MAGIC;
+    header.version_ = VERSION;
+    header.sourceHash_ = sourceHash;
+    header.width_ = decoded.width_;
+    header.height_ = decoded.height_;
+    header.sourceWidth_ = decoded.sourceWidth_;
+    header.sourceHeight_ = decoded.sourceHeight_;
+    header.format_ = FORMAT_RGBA8;
+    header.payloadSize_ = static_cast<uint64_t>(decoded.width_) * decoded.height_ * 4;
+
+    ATrace_beginSection("storeTextureToDiskCache");
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        ATrace_endSection();
+        LOGE("TextureDiskCache: failed to create %s", tempPath.c_str());
+        return;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   fwrite(decoded.pixels_, 1, header.payloadSize_, file) == header.payloadSize_;
+    written = fclose(file) == 0 && written;
+    if (!written || rename(tempPath.c_str(), fullPath.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        ATrace_endSection();
+        LOGE("TextureDiskCache: failed to write %s", fullPath.c_str());
+        return;
+    }
+    ATrace_endSection();
+
+    std::lock_guard<std::mutex> locker(mutex_);
+    uint64_t size = sizeof(header) + header.payloadSize_;
+    auto iter = files_.find(fileName);
+    if (iter != files_.end()) {
+        bytes_ -= iter->second.size_; // 其他线程同时写入了同一个文件，rename覆盖
+    }
+    files_[fileName] = {size, static_cast<int64_t>(time(nullptr))};
+    bytes_ += size;
+    stats_.writeCount_++;
+    stats_.storeTimeNs_ += nowNs_helper() - startNs;
+    evictLocked(fileName);
+}
+
+void TextureDiskCache::removeLocked(const std::string &fileName) {
+    unlink((directory_ + "/" + fileName).c_str()); // 已映射的文件在解除映射前仍然可读
+    auto iter = files_.find(fileName);
+    if (iter != files_.end()) {
+        bytes_ -= iter->second.size_;
+        files_.erase(iter);
+    }
+}
+
+void TextureDiskCache::evictLocked(const std::string &keepFileName) {
+    if (bytes_ <= budgetBytes_) {
+        return;
+    }
+    std::vector<std::pair<int64_t, std::string>> candidates;
+    for (auto &iter : files_) {
+        if (iter.first != keepFileName) {
+            candidates.emplace_back(iter.second.lastUsed_, iter.first);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    for (auto &candidate : candidates) {
+        if (bytes_ <= budgetBytes_) {
+            break;
+        }
+        removeLocked(candidate.second);
+        stats_.evictCount_++;
+    }
+}
+
+void TextureDiskCache::clear() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    std::vector<std::string> fileNames;
+    for (auto &iter : files_) {
+        fileNames.push_back(iter.first);
+    }
+    for (const std::string &fileName : fileNames) {
+        removeLocked(fileName);
+    }
+}
+
+TextureDiskCacheStats TextureDiskCache::getStats() {
+    std::lock_guard<std::mutex> locker(mutex_);
+    TextureDiskCacheStats stats = stats_;
+    stats.fileCount_ = files_.size();
+    stats.bytes_ = bytes_;
+    return stats;
+}
+
+void TextureDiskCache::dump() {
+    TextureDiskCacheStats stats = getStats();
+    LOGI("TextureDiskCache: %llu files, %.2f MB / %.2f MB, hit %llu (load %.3f ms), miss %llu (invalid %llu), written %llu (store %.3f ms), evicted %llu",
+         (unsigned long long) stats.fileCount_, stats.bytes_ / 1048576.0, budgetBytes_ / 1048576.0,
+         (unsigned long long) stats.hitCount_, stats.loadTimeNs_ / 1e6,
+         (unsigned long long) stats.missCount_, (unsigned long long) stats.invalidCount_,
+         (unsigned long long) stats.writeCount_, stats.storeTimeNs_ / 1e6, (unsigned long long) stats.evictCount_);
+}
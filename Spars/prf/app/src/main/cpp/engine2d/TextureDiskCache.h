@@ -0,0 +1,100 @@
+#ifndef PRF_TEXTUREDISKCACHE_H
+#define PRF_TEXTUREDISKCACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ImageManager.h"
+#include "../utils/AssetFile.h"
+
+// 磁盘纹理缓存统计信息
+struct TextureDiskCacheStats {
+    uint64_t hitCount_ = 0;
+    uint64_t missCount_ = 0;
+    uint64_t invalidCount_ = 0; // 校验失败（源图片已改变、文件损坏或版本不符）而删除的文件数
+    uint64_t writeCount_ = 0;
+    uint64_t evictCount_ = 0;
+    uint64_t loadTimeNs_ = 0; // 命中时打开与映射的累计耗时
+    uint64_t storeTimeNs_ = 0; // 写入的累计耗时
+    uint64_t fileCount_ = 0;
+    uint64_t bytes_ = 0; // 缓存目录中所有文件的字节数
+};
+
+/*
+ * 磁盘纹理缓存：首次解码（及缩小到绘制尺寸）后，将可直接上传的RGBA8像素连同宽高与格式写入应用私有目录，
+ * 之后的启动直接mmap该文件，像素由映射的内存复制进暂存缓冲，跳过stb解码
+ * 文件名由图片路径与目标尺寸决定；文件头记录源文件内容的哈希，源图片改变时校验失败并删除
+ * 所有文件的总大小不超过budgetBytes，超出时按最近使用时间（文件的mtime，命中时更新）删除最旧的
+ * 线程安全，可在预取线程、后台加载线程与工作线程中同时使用
+ */
+class TextureDiskCache {
+public:
+    TextureDiskCache(const std::string &directory, uint64_t budgetBytes); // 目录不存在时创建，并扫描已有的文件
+
+    // 源文件内容的哈希（64位FNV-1a）
+    static uint64_t hashBytes(const void *data, size_t size);
+
+    /**
+     * 图片源文件完整内容的哈希（AssetFile::contentHash），用于校验缓存文件（源图片任何字节改变都会使其失效）
+     * 每个路径在进程内只计算一次，之后直接返回记录的值
+     */
+    uint64_t sourceHash(const std::string &path, const AssetFile &asset);
+
+    /**
+     * 查找缓存的像素：命中时decoded的像素指向映射的内存（由ImageManager::freeDecodedImage解除映射）
+     * @return 是否命中
+     */
+    bool load(const std::string &path, uint64_t sourceHash, int targetWidth, int targetHeight, DecodedImage *decoded);
+
+    // 写入解码结果（先写临时文件再rename，其他线程不会读到写了一半的文件）
+    void store(const std::string &path, uint64_t sourceHash, int targetWidth, int targetHeight, const DecodedImage &decoded);
+
+    void clear(); // 删除所有缓存文件（用于冷启动对比）
+
+    TextureDiskCacheStats getStats();
+    void dump(); // 以log的形式打印 for debug
+
+private:
+    // 文件头，其后紧跟width_ * height_ * 4字节的像素
+    struct FileHeader {
+        uint32_t magic_;
+        uint32_t version_;
+        uint64_t sourceHash_;
+        int32_t width_;
+        int32_t height_;
+        int32_t sourceWidth_;
+        int32_t sourceHeight_;
+        uint32_t format_; // 目前只有FORMAT_RGBA8
+        uint32_t reserved_;
+        uint64_t payloadSize_;
+    };
+
+    struct FileInfo {
+        uint64_t size_;
+        int64_t lastUsed_; // 秒，来自文件的mtime
+    };
+
+    const uint32_t MAGIC = 0x58455450; // "PTEX"
+    const uint32_t VERSION = 2; // 文件格式、源文件哈希或解码（缩小）算法改变时递增，旧文件校验失败
+    const uint32_t FORMAT_RGBA8 = 0;
+
+    std::string directory_;
+    uint64_t budgetBytes_;
+
+    std::mutex mutex_; // 保护下面的文件表与统计
+    std::unordered_map<std::string, FileInfo> files_; // 文件名 -> 大小与最近使用时间
+    uint64_t bytes_ = 0;
+    TextureDiskCacheStats stats_;
+    std::atomic<uint64_t> tempCounter_{0}; // 临时文件名，避免多个线程同时写同一个文件
+    std::unordered_map<std::string, uint64_t> sourceHashMap_; // 图片路径 -> 源文件内容的哈希，受mutex_保护
+
+    std::string makeFileName(const std::string &path, int targetWidth, int targetHeight);
+    void removeLocked(const std::string &fileName);
+    void evictLocked(const std::string &keepFileName); // 超出预算时删除最久未使用的文件
+};
+
+
+#endif //PRF_TEXTUREDISKCACHE_H
@@ -0,0 +1,61 @@
+#include "TextureDiskCacheBenchmark.h"
+#include "TextureDiskCache.h"
+#include "ImageManager.h"
+#include "../renderTree/RenderNode.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 收集子树中所有图片的路径及其最大绘制尺寸
+static void collectImages_helper(RenderNode *node, std::unordered_map<std::string, std::pair<int, int>> &images) {
+    for (uint32_t i = 0; i < node->drawCmdCount(); i++) {
+        std::shared_ptr<DrawCmd> drawCmd = node->getDrawCmd(i);
+        if (drawCmd->getType() != IMAGE_DRAWCMD) {
+            continue;
+        }
+        Image &image = std::static_pointer_cast<ImageDrawCmd>(drawCmd)->image_;
+        std::pair<int, int> &size = images[image.path_];
+        size.first = std::max(size.first, static_cast<int>(std::ceil(image.rect_.w_)));
+        size.second = std::max(size.second, static_cast<int>(std::ceil(image.rect_.h_)));
+    }
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        collectImages_helper(node->getChild(i), images);
+    }
+}
+
+// 解码（或从缓存映射）所有图片并复制像素，返回耗时（毫秒）
+static double decodeAll_helper(android_app *app, TextureDiskCache *diskCache,
+                               std::unordered_map<std::string, std::pair<int, int>> &images, std::vector<unsigned char> &staging) {
+    auto start = std::chrono::steady_clock::now();
+    for (auto &iter : images) {
+        DecodedImage decoded = ImageManager::decodeImage(app, iter.first, iter.second.first, iter.second.second, diskCache);
+        size_t size = static_cast<size_t>(decoded.width_) * decoded.height_ * 4;
+        if (staging.size() < size) {
+            staging.resize(size);
+        }
+        memcpy(staging.data(), decoded.pixels_, size);
+        ImageManager::freeDecodedImage(decoded);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void runTextureDiskCacheBenchmark(android_app *app, TextureDiskCache *diskCache, RenderNode *rootNode) {
+    std::unordered_map<std::string, std::pair<int, int>> images;
+    collectImages_helper(rootNode, images);
+    std::vector<unsigned char> staging;
+
+    double decodeMs = decodeAll_helper(app, nullptr, images, staging);
+    diskCache->clear();
+    double coldMs = decodeAll_helper(app, diskCache, images, staging);
+    double warmMs = decodeAll_helper(app, diskCache, images, staging);
+
+    LOGI("texture disk cache benchmark: %zu images, decode only %.3f ms, cold (decode + store) %.3f ms, warm (mmap) %.3f ms, speedup %.2fx",
+         images.size(), decodeMs, coldMs, warmMs, warmMs > 0.0 ? decodeMs / warmMs : 0.0);
+    diskCache->dump();
+}
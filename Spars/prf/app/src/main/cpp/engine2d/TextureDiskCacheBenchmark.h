@@ -0,0 +1,16 @@
+#ifndef PRF_TEXTUREDISKCACHEBENCHMARK_H
+#define PRF_TEXTUREDISKCACHEBENCHMARK_H
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+class RenderNode;
+class TextureDiskCache;
+
+/**
+ * 磁盘纹理缓存冷热对比（TEXTURE_DISK_CACHE_BENCHMARK）
+ * 收集渲染树中的所有图片（按最大绘制尺寸），依次测试：不使用缓存解码、清空缓存后解码并写入（冷）、从缓存映射（热），
+ * 每次都将像素复制到一块暂存内存（模拟上传前的复制），结果以log输出；结束后缓存保持为热
+ */
+void runTextureDiskCacheBenchmark(android_app *app, TextureDiskCache *diskCache, RenderNode *rootNode);
+
+#endif //PRF_TEXTUREDISKCACHEBENCHMARK_H
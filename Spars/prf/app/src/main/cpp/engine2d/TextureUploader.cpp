@@ -0,0 +1,399 @@
+#include "TextureUploader.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <time.h>
+#include <android/trace.h>
+
+static uint64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+TextureUploader::TextureUploader(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamilyIndex,
+                                 uint32_t transferQueueFamilyIndex, VkQueue transferQueue, bool async) {
+    device_ = device;
+    transferQueue_ = transferQueue;
+    queueFamilyIndices_[0] = graphicsQueueFamilyIndex;
+    queueFamilyIndices_[1] = transferQueueFamilyIndex;
+    dedicatedQueue_ = graphicsQueueFamilyIndex != transferQueueFamilyIndex;
+    async_ = async;
+    stagingBufferManager_ = new BufferManager(device, physicalDevice, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+
+    // 上传专用的指令池，指令缓冲生命周期很短
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = transferQueueFamilyIndex;
+    if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    LOGI("texture uploader: %s queue family %u, %s", dedicatedQueue_ ? "dedicated transfer" : "graphics",
+         transferQueueFamilyIndex, async_ ? "async" : "blocking");
+}
+
+TextureUploader::~TextureUploader() {
+    std::unique_lock<std::mutex> locker(mutex_);
+    for (auto &batch : inFlightBatches_) {
+        vkWaitForFences(device_, 1, &batch.fence_, VK_TRUE, UINT64_MAX);
+        releaseBatchLocked(batch);
+    }
+    inFlightBatches_.clear();
+    // 从未提交的上传直接丢弃
+    for (auto &upload : pendingUploads_) {
+        vkFreeCommandBuffers(device_, commandPool_, 1, &upload.commandBuffer_);
+    }
+    pendingUploads_.clear();
+    for (VkFence fence : freeFences_) {
+        vkDestroyFence(device_, fence, nullptr);
+    }
+    for (VkSemaphore semaphore : freeSemaphores_) {
+        vkDestroySemaphore(device_, semaphore, nullptr);
+    }
+    vkDestroyCommandPool(device_, commandPool_, nullptr);
+    delete stagingBufferManager_; // 释放所有暂存缓冲的大块
+}
+
+VulkanBufferInfo TextureUploader::allocStagingBuffer(VkDeviceSize size) {
+    return stagingBufferManager_->allocPersistentBuffer(size);
+}
+
+void TextureUploader::freeStagingBuffer(const VulkanBufferInfo &stagingBuffer) {
+    stagingBufferManager_->freePersistentBuffer(stagingBuffer);
+}
+
+void TextureUploader::setImageSharingMode(VkImageCreateInfo *imageCreateInfo) {
+    if (dedicatedQueue_) {
+        imageCreateInfo->sharingMode = VK_SHARING_MODE_CONCURRENT;
+        imageCreateInfo->queueFamilyIndexCount = 2;
+        imageCreateInfo->pQueueFamilyIndices = queueFamilyIndices_;
+    } else {
+        imageCreateInfo->sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    }
+}
+
+// 两次布局变换与复制录制在同一个指令缓冲中
+void TextureUploader::recordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkImage image,
+                                   const std::vector<VkBufferImageCopy> &copies, uint32_t mipLevels, VkImageLayout oldLayout) {
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // 只使用该指令一次
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // CONCURRENT模式下无需转移所有权
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    if (stagingBuffer == VK_NULL_HANDLE) {
+        // 只做布局变换：UNDEFINED -> SHADER_READ_ONLY_OPTIMAL
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        vkEndCommandBuffer(commandBuffer);
+        return;
+    }
+
+    // oldLayout -> TRANSFER_DST_OPTIMAL
+    // 新图像为UNDEFINED；atlas页为SHADER_READ_ONLY_OPTIMAL，需保留其他区域的内容，并排在之前对同一页的复制之后
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+        barrier.srcAccessMask = 0;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    } else {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(copies.size()), copies.data());
+
+    // TRANSFER_DST_OPTIMAL -> SHADER_READ_ONLY_OPTIMAL
+    // transfer队列不支持片段着色器阶段，对采样的可见性由帧提交等待的信号量（或fence）保证
+    // 目标阶段为TRANSFER，使之后对同一atlas页的上传（源阶段TRANSFER）与本次布局变换形成依赖链
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkEndCommandBuffer(commandBuffer);
+}
+
+// 暂存缓冲中bufferOffset处紧凑存放的像素复制到图像的(x, y)处
+static VkBufferImageCopy makeCopy_helper(VkDeviceSize bufferOffset, uint32_t mipLevel, int32_t x, int32_t y, uint32_t width, uint32_t height) {
+    VkBufferImageCopy copy = {};
+    copy.bufferOffset = bufferOffset;
+    copy.bufferRowLength = 0; // 在内存中紧凑存放
+    copy.bufferImageHeight = 0;
+    copy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy.imageSubresource.mipLevel = mipLevel;
+    copy.imageSubresource.baseArrayLayer = 0;
+    copy.imageSubresource.layerCount = 1;
+    copy.imageOffset = {x, y, 0};
+    copy.imageExtent = {width, height, 1};
+    return copy;
+}
+
+uint64_t TextureUploader::upload(const VulkanBufferInfo &stagingBuffer, VkImage image, uint32_t width, uint32_t height,
+                                 uint32_t mipLevels) {
+    // 每一级一个复制区域，各级在暂存缓冲中依次紧凑存放（RGBA8）
+    std::vector<VkBufferImageCopy> copies(mipLevels);
+    VkDeviceSize bufferOffset = 0;
+    for (uint32_t level = 0; level < mipLevels; level++) {
+        uint32_t levelWidth = std::max(1u, width >> level);
+        uint32_t levelHeight = std::max(1u, height >> level);
+        copies[level] = makeCopy_helper(bufferOffset, level, 0, 0, levelWidth, levelHeight);
+        bufferOffset += static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4;
+    }
+    return uploadInternal(stagingBuffer, image, copies, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+uint64_t TextureUploader::uploadRegion(const VulkanBufferInfo &stagingBuffer, VkImage image, int32_t x, int32_t y,
+                                       uint32_t width, uint32_t height) {
+    std::vector<VkBufferImageCopy> copies = {makeCopy_helper(0, 0, x, y, width, height)};
+    return uploadInternal(stagingBuffer, image, copies, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+uint64_t TextureUploader::uploadRegions(const VulkanBufferInfo &stagingBuffer, VkImage image,
+                                        const std::vector<UploadRegion> &regions) {
+    std::vector<VkBufferImageCopy> copies;
+    copies.reserve(regions.size());
+    for (const UploadRegion &region : regions) {
+        copies.push_back(makeCopy_helper(region.bufferOffset_, 0, region.x_, region.y_, region.width_, region.height_));
+    }
+    return uploadInternal(stagingBuffer, image, copies, 1, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+uint64_t TextureUploader::initializeImage(VkImage image) {
+    VulkanBufferInfo noStagingBuffer = {};
+    noStagingBuffer.buffer_ = VK_NULL_HANDLE;
+    std::vector<VkBufferImageCopy> copies;
+    return uploadInternal(noStagingBuffer, image, copies, 1, VK_IMAGE_LAYOUT_UNDEFINED);
+}
+
+uint64_t TextureUploader::uploadInternal(const VulkanBufferInfo &stagingBuffer, VkImage image, std::vector<VkBufferImageCopy> &copies,
+                                         uint32_t mipLevels, VkImageLayout oldLayout) {
+    ATrace_beginSection("uploadTexture");
+    uint64_t startNs = nowNs();
+
+    // 暂存缓冲是大块中的一段，复制区域的偏移相对于段的起始
+    if (stagingBuffer.buffer_ != VK_NULL_HANDLE) {
+        stagingBufferManager_->flushBuffer(stagingBuffer);
+        for (VkBufferImageCopy &copy : copies) {
+            copy.bufferOffset += stagingBuffer.offset_;
+        }
+    }
+
+    std::unique_lock<std::mutex> locker(mutex_);
+
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = commandPool_;
+    allocInfo.commandBufferCount = 1;
+
+    PendingUpload upload;
+    upload.ticket_ = nextTicket_++;
+    upload.stagingBuffer_ = stagingBuffer;
+    if (vkAllocateCommandBuffers(device_, &allocInfo, &upload.commandBuffer_) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+    recordUpload(upload.commandBuffer_, stagingBuffer.buffer_, image, copies, mipLevels, oldLayout);
+
+    stats_.uploadCount_++;
+    stats_.uploadBytes_ += stagingBuffer.buffer_ != VK_NULL_HANDLE ? stagingBuffer.requestedSize_ : 0;
+
+    if (async_) {
+        pendingUploads_.push_back(upload);
+        stats_.recordTimeNs_ += nowNs() - startNs;
+        ATrace_endSection();
+        return upload.ticket_;
+    }
+
+    // 阻塞模式：直接提交并等待该次提交的fence（不再vkQueueWaitIdle）
+    UploadBatch batch;
+    batch.uploads_.push_back(upload);
+    batch.lastTicket_ = upload.ticket_;
+    batch.fence_ = acquireFenceLocked();
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &upload.commandBuffer_;
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> queueLocker(queueMutex_);
+        result = vkQueueSubmit(transferQueue_, 1, &submitInfo, batch.fence_);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit texture upload!");
+    }
+    stats_.submitCount_++;
+
+    locker.unlock();
+    vkWaitForFences(device_, 1, &batch.fence_, VK_TRUE, UINT64_MAX);
+    locker.lock();
+
+    releaseBatchLocked(batch);
+    // 多个工作线程并发上传时完成顺序不确定，只单调增加
+    if (completedTicket_.load() < upload.ticket_) {
+        completedTicket_.store(upload.ticket_);
+    }
+    stats_.recordTimeNs_ += nowNs() - startNs;
+    ATrace_endSection();
+    return upload.ticket_;
+}
+
+VkSemaphore TextureUploader::submit() {
+    std::unique_lock<std::mutex> locker(mutex_);
+    if (pendingUploads_.empty()) {
+        return VK_NULL_HANDLE;
+    }
+
+    inFlightBatches_.emplace_back();
+    UploadBatch &batch = inFlightBatches_.back();
+    batch.uploads_.swap(pendingUploads_);
+    batch.lastTicket_ = batch.uploads_.back().ticket_;
+    batch.fence_ = acquireFenceLocked();
+    batch.semaphore_ = acquireSemaphoreLocked();
+
+    std::vector<VkCommandBuffer> commandBuffers;
+    commandBuffers.reserve(batch.uploads_.size());
+    for (auto &upload : batch.uploads_) {
+        commandBuffers.push_back(upload.commandBuffer_);
+    }
+
+    // 该帧所有新纹理的上传合并为一次提交
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &batch.semaphore_;
+    VkResult result;
+    {
+        std::lock_guard<std::mutex> queueLocker(queueMutex_);
+        result = vkQueueSubmit(transferQueue_, 1, &submitInfo, batch.fence_);
+    }
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit texture upload!");
+    }
+    stats_.submitCount_++;
+    submittedTicket_ = batch.lastTicket_;
+    cv_.notify_all();
+
+    return batch.semaphore_;
+}
+
+void TextureUploader::collect() {
+    std::unique_lock<std::mutex> locker(mutex_);
+    // 同一队列上的提交按顺序完成，遇到第一个未完成的即可停止
+    while (!inFlightBatches_.empty()) {
+        UploadBatch &batch = inFlightBatches_.front();
+        if (vkGetFenceStatus(device_, batch.fence_) != VK_SUCCESS) {
+            break;
+        }
+        completedTicket_.store(batch.lastTicket_);
+        releaseBatchLocked(batch);
+        inFlightBatches_.pop_front();
+    }
+    locker.unlock();
+    // 暂存缓冲没有帧内分配，这里只推进帧序号并释放长期空闲的大块（上传高峰之后归还显存）
+    stagingBufferManager_->freeAllBuffers(0);
+}
+
+bool TextureUploader::isComplete(uint64_t ticket) {
+    return ticket <= completedTicket_.load();
+}
+
+void TextureUploader::wait(uint64_t ticket) {
+    std::unique_lock<std::mutex> locker(mutex_);
+    cv_.wait(locker, [this, ticket] {
+        return ticket <= submittedTicket_ || ticket <= completedTicket_.load();
+    });
+    for (auto &batch : inFlightBatches_) {
+        if (batch.lastTicket_ >= ticket) {
+            VkFence fence = batch.fence_;
+            locker.unlock(); // fence只在collect中回收，collect与wait都不在绘制期间调用
+            vkWaitForFences(device_, 1, &fence, VK_TRUE, UINT64_MAX);
+            return;
+        }
+    }
+}
+
+VkFence TextureUploader::acquireFenceLocked() {
+    VkFence fence;
+    if (!freeFences_.empty()) {
+        fence = freeFences_.back();
+        freeFences_.pop_back();
+        vkResetFences(device_, 1, &fence);
+        return fence;
+    }
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(device_, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence!");
+    }
+    return fence;
+}
+
+VkSemaphore TextureUploader::acquireSemaphoreLocked() {
+    VkSemaphore semaphore;
+    if (!freeSemaphores_.empty()) {
+        semaphore = freeSemaphores_.back();
+        freeSemaphores_.pop_back();
+        return semaphore;
+    }
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload semaphore!");
+    }
+    return semaphore;
+}
+
+// 回收一次已完成的提交；其信号量已被等待它的帧消耗（collect在该帧的fence之后调用）
+void TextureUploader::releaseBatchLocked(UploadBatch &batch) {
+    for (auto &upload : batch.uploads_) {
+        vkFreeCommandBuffers(device_, commandPool_, 1, &upload.commandBuffer_);
+        if (upload.stagingBuffer_.buffer_ != VK_NULL_HANDLE) {
+            stagingBufferManager_->freePersistentBuffer(upload.stagingBuffer_);
+        }
+    }
+    batch.uploads_.clear();
+    freeFences_.push_back(batch.fence_);
+    if (batch.semaphore_ != VK_NULL_HANDLE) {
+        freeSemaphores_.push_back(batch.semaphore_);
+    }
+}
+
+TextureUploadStats TextureUploader::getStats() {
+    std::unique_lock<std::mutex> locker(mutex_);
+    return stats_;
+}
+
+void TextureUploader::dump() {
+    TextureUploadStats stats = getStats();
+    LOGI("texture uploads (%s): %llu textures, %llu bytes, %llu submits, %.3f ms recording on workers",
+         async_ ? "async" : "blocking", (unsigned long long) stats.uploadCount_,
+         (unsigned long long) stats.uploadBytes_, (unsigned long long) stats.submitCount_,
+         static_cast<double>(stats.recordTimeNs_) / 1e6);
+}
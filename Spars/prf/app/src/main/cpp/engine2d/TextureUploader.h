@@ -0,0 +1,142 @@
+#ifndef PRF_TEXTUREUPLOADER_H
+#define PRF_TEXTUREUPLOADER_H
+
+#include <vulkan_wrapper.h>
+#include "BufferManager.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <vector>
+
+// 纹理上传统计信息
+struct TextureUploadStats {
+    uint64_t uploadCount_ = 0; // 累计上传的纹理数
+    uint64_t uploadBytes_ = 0; // 累计上传的字节数
+    uint64_t submitCount_ = 0; // 累计vkQueueSubmit次数
+    uint64_t recordTimeNs_ = 0; // 工作线程录制上传指令的累计耗时（含阻塞模式下的等待）
+};
+
+// 一次上传中的一个区域：暂存缓冲中从bufferOffset_开始紧凑存放的width_ x height_像素，复制到图像的(x_, y_)处
+struct UploadRegion {
+    VkDeviceSize bufferOffset_; // 需为4的倍数（transfer队列的要求）
+    int32_t x_;
+    int32_t y_;
+    uint32_t width_;
+    uint32_t height_;
+};
+
+/*
+ * 纹理异步上传服务
+ * 存在独立的transfer队列族时使用其队列，否则使用graphics队列，但指令池与渲染的指令池分开
+ * 工作线程调用upload将一张纹理的两次布局变换与复制录制进一个指令缓冲，不提交、不等待，立即返回ticket；
+ * 主线程在提交该帧之前调用submit，将所有待提交的上传合并为一次vkQueueSubmit，并返回该帧需要等待的信号量；
+ * 每次提交带一个fence，collect中查询fence，完成后释放暂存缓冲与指令缓冲
+ * 暂存缓冲由allocStagingBuffer从一个持久映射的BufferManager中切分，不再为每次上传单独申请VkBuffer与显存
+ * 阻塞模式（ASYNC_TEXTURE_UPLOAD为0）下upload直接提交并等待自己的fence，仅用于对比
+ * 没有独立的transfer队列族时transferQueue与渲染使用的队列为同一VkQueue，对其的提交都需持有queueMutex()
+ */
+class TextureUploader {
+public:
+    TextureUploader(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamilyIndex,
+                    uint32_t transferQueueFamilyIndex, VkQueue transferQueue, bool async);
+    ~TextureUploader(); // 等待所有上传完成并释放资源
+
+    // 申请一段大小至少为size的暂存缓冲（任意线程调用），像素写入mappedData_后交给upload*，不上传时需用freeStagingBuffer归还
+    VulkanBufferInfo allocStagingBuffer(VkDeviceSize size);
+    void freeStagingBuffer(const VulkanBufferInfo &stagingBuffer);
+
+    /**
+     * 上传一张纹理（工作线程调用，线程安全）
+     * 图像需处于VK_IMAGE_LAYOUT_UNDEFINED，上传完成后为VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+     * 暂存缓冲的所有权转移给TextureUploader，上传完成后由其归还
+     * mipLevels大于1时暂存缓冲中依次紧凑存放各级（每级宽高减半，最小为1），一次上传所有级
+     * @return ticket，可用isComplete查询是否完成
+     */
+    uint64_t upload(const VulkanBufferInfo &stagingBuffer, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels = 1);
+
+    /**
+     * 上传到图像的一个区域（用于atlas页），图像需已由initializeImage变换为VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+     * 同一图像的多次上传按录制顺序执行，互不覆盖
+     */
+    uint64_t uploadRegion(const VulkanBufferInfo &stagingBuffer, VkImage image, int32_t x, int32_t y, uint32_t width, uint32_t height);
+
+    // 将暂存缓冲中的多个区域一次上传到同一图像（如一次绘制中新光栅化的所有字形），要求同uploadRegion
+    uint64_t uploadRegions(const VulkanBufferInfo &stagingBuffer, VkImage image, const std::vector<UploadRegion> &regions);
+
+    // 将新建的图像从VK_IMAGE_LAYOUT_UNDEFINED变换为VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL（不复制数据），需在该图像的第一次uploadRegion之前调用
+    uint64_t initializeImage(VkImage image);
+
+    /**
+     * 提交所有待提交的上传（主线程在提交该帧之前调用）
+     * @return 该帧的渲染需等待的信号量，没有需要提交的上传时为VK_NULL_HANDLE
+     */
+    VkSemaphore submit();
+
+    // 释放已完成的上传，并释放长期空闲的暂存缓冲大块（主线程调用，如resetFrame）
+    void collect();
+
+    bool isComplete(uint64_t ticket); // 任意线程调用
+    void wait(uint64_t ticket); // 阻塞直到该ticket完成，不能在工作线程绘制期间调用（此时主线程尚未submit）
+
+    // 主线程向渲染队列提交与present时持有，与阻塞模式下工作线程的上传提交互斥（两者可能为同一VkQueue）
+    std::mutex &queueMutex() { return queueMutex_; }
+
+    // 设置纹理的共享模式：上传与采样位于不同队列族时使用CONCURRENT，避免队列族所有权转移
+    void setImageSharingMode(VkImageCreateInfo *imageCreateInfo);
+
+    TextureUploadStats getStats();
+    void dump(); // 以log的形式打印 for debug
+
+private:
+    // 一张纹理的上传
+    struct PendingUpload {
+        uint64_t ticket_;
+        VkCommandBuffer commandBuffer_;
+        VulkanBufferInfo stagingBuffer_; // buffer_为VK_NULL_HANDLE时没有暂存缓冲（initializeImage）
+    };
+
+    // 一次提交
+    struct UploadBatch {
+        std::vector<PendingUpload> uploads_;
+        uint64_t lastTicket_ = 0;
+        VkFence fence_;
+        VkSemaphore semaphore_ = VK_NULL_HANDLE; // 阻塞模式下不使用
+    };
+
+    VkDevice device_;
+    VkQueue transferQueue_;
+    uint32_t queueFamilyIndices_[2]; // graphics, transfer
+    bool dedicatedQueue_; // 是否为独立的transfer队列族
+    bool async_;
+
+    std::mutex queueMutex_; // 保护transferQueue_上的vkQueueSubmit（阻塞模式下工作线程与主线程并发提交）
+
+    // 暂存缓冲只以persistent段申请与归还（均加BufferManager自己的锁），collect中的freeAllBuffers只推进帧序号并回收空闲的大块
+    BufferManager *stagingBufferManager_;
+
+    std::mutex mutex_; // 保护指令池（录制也需要外部同步）及下面的列表
+    std::condition_variable cv_; // submit后唤醒wait
+    VkCommandPool commandPool_;
+    std::vector<PendingUpload> pendingUploads_; // 已录制、尚未提交
+    std::list<UploadBatch> inFlightBatches_; // 已提交、尚未回收，按提交顺序
+    std::vector<VkFence> freeFences_;
+    std::vector<VkSemaphore> freeSemaphores_;
+    uint64_t nextTicket_ = 1;
+    uint64_t submittedTicket_ = 0; // 不大于该值的ticket都已提交
+    std::atomic<uint64_t> completedTicket_{0}; // 不大于该值的ticket都已完成（同一队列按提交顺序完成）
+
+    TextureUploadStats stats_; // 受mutex_保护
+
+    // stagingBuffer为VK_NULL_HANDLE时只做布局变换
+    void recordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer, VkImage image,
+                      const std::vector<VkBufferImageCopy> &copies, uint32_t mipLevels, VkImageLayout oldLayout);
+    uint64_t uploadInternal(const VulkanBufferInfo &stagingBuffer, VkImage image, std::vector<VkBufferImageCopy> &copies,
+                            uint32_t mipLevels, VkImageLayout oldLayout);
+    VkFence acquireFenceLocked();
+    VkSemaphore acquireSemaphoreLocked();
+    void releaseBatchLocked(UploadBatch &batch);
+};
+
+#endif //PRF_TEXTUREUPLOADER_H
@@ -0,0 +1,74 @@
+#ifndef PRF_VERTEXFORMAT_H
+#define PRF_VERTEXFORMAT_H
+
+#include <vulkan_wrapper.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "paint/Paint.h"
+#include "../config.h"
+
+/* 紧凑的顶点格式
+ * 颜色统一打包为RGBA8（VK_FORMAT_R8G8B8A8_UNORM），shader中仍然读取为vec3/vec4
+ * 坐标为相对所属变换节点的屏幕像素坐标，由vertex shader根据DrawTransform转换为NDC，与显示尺寸无关
+ * 坐标为32位浮点数：像素坐标在大屏上超过2048，16位浮点数在此范围内的步长已达2像素，不能使用 */
+
+struct VertexPos {
+    float x_;
+    float y_;
+};
+#define VERTEX_POSITION_FORMAT VK_FORMAT_R32G32_SFLOAT
+
+#define VERTEX_COLOR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+
+// 矩形、圆形、圆角矩形使用的顶点：坐标+颜色
+struct ColorVertex {
+    VertexPos pos_;
+    uint32_t color_;
+};
+
+// 图片使用的顶点：坐标+纹理坐标
+struct ImageVertex {
+    VertexPos pos_;
+    float u_;
+    float v_;
+};
+
+// 文字使用的顶点：坐标+纹理坐标+颜色
+struct TextVertex {
+    VertexPos pos_;
+    float u_;
+    float v_;
+    uint32_t color_;
+};
+
+// 每次绘制的push constant，与vertex shader中的push_constant块一一对应（后续可加入透明度）
+// gl_Position = (inPos + translate) * scale - 1
+struct DrawTransform {
+    float translateX_ = 0.0f; // 像素坐标下的平移，几何以所属变换节点为原点生成
+    float translateY_ = 0.0f;
+    float scaleX_ = 0.0f; // 像素到NDC的缩放，即2/宽，每帧按当前显示尺寸填写
+    float scaleY_ = 0.0f; // 2/高
+};
+
+// 旧格式每个顶点所占的float数，仅用于统计上传字节数的下降
+#define LEGACY_COLOR_VERTEX_FLOATS 5
+#define LEGACY_RRECT_VERTEX_FLOATS 6
+#define LEGACY_IMAGE_VERTEX_FLOATS 4
+#define LEGACY_TEXT_VERTEX_FLOATS 7
+
+inline VertexPos makeVertexPos(float x, float y) {
+    return VertexPos{x, y};
+}
+
+// 将Paint打包为RGBA8，内存中的字节顺序为R、G、B、A（小端）
+inline uint32_t packColor(const Paint &paint) {
+    auto toByte = [](float c) -> uint32_t {
+        c = c < 0.0f ? 0.0f : (c > 1.0f ? 1.0f : c);
+        return static_cast<uint32_t>(c * 255.0f + 0.5f);
+    };
+    return toByte(paint.r_) | (toByte(paint.g_) << 8) | (toByte(paint.b_) << 16) | (toByte(paint.a_) << 24);
+}
+
+#endif //PRF_VERTEXFORMAT_H
@@ -3,43 +3,70 @@
 //
 #include "pipeline_helper.h"
 #include "../log.h"
+#include "VertexFormat.h"
+#include "../utils/AssetFile.h"
 
 #include <array>
+#include <cstddef>
+#include <cstring>
+#include <vector>
 
 static VkShaderModule loadShaderFromFile(android_app *androidAppCtx, VkDevice device, const char *filePath) {
     // Read the file
     assert(androidAppCtx);
-    AAsset *file = AAssetManager_open(androidAppCtx->activity->assetManager,
-                                      filePath, AASSET_MODE_BUFFER);
-    size_t fileLength = AAsset_getLength(file);
-
-    char *fileContent = new char[fileLength];
-
-    AAsset_read(file, fileContent, fileLength);
-    AAsset_close(file);
+    AssetFile file(androidAppCtx, filePath);
+    size_t fileLength = file.size();
+
+    // pCode需4字节对齐，视图未对齐时才复制一份（zipalign过的APK中的资源通常已对齐）
+    std::vector<uint32_t> alignedCode;
+    const uint32_t *code = reinterpret_cast<const uint32_t *>(file.data());
+    if (reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0) {
+        alignedCode.resize((fileLength + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+        memcpy(alignedCode.data(), file.data(), fileLength);
+        code = alignedCode.data();
+    }
 
     VkShaderModuleCreateInfo shaderModuleCreateInfo{
             .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
             .pNext = nullptr,
             .flags = 0,
             .codeSize = fileLength,
-            .pCode = (const uint32_t *) fileContent,
+            .pCode = code,
     };
 
     VkShaderModule shader;
 
     CALL_VK(vkCreateShaderModule(device, &shaderModuleCreateInfo, nullptr, &shader));
 
-    delete[] fileContent;
-
     return shader;
 }
 
 
+// 所有管线共用的push constant范围：每次绘制的DrawTransform
+static VkPushConstantRange getDrawTransformRange() {
+    VkPushConstantRange range = {};
+    range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    range.offset = 0;
+    range.size = sizeof(DrawTransform);
+    return range;
+}
+
+// 所有管线的viewport与scissor均为动态状态，在录制命令时按当前显示尺寸设置，管线不随resize重建
+static const VkDynamicState DYNAMIC_STATES[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+static VkPipelineDynamicStateCreateInfo getDynamicStateInfo() {
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = {};
+    dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicStateInfo.dynamicStateCount = sizeof(DYNAMIC_STATES) / sizeof(DYNAMIC_STATES[0]);
+    dynamicStateInfo.pDynamicStates = DYNAMIC_STATES;
+    return dynamicStateInfo;
+}
+
 /**
   * 创建描述符布局（与管线紧耦合）
+  * immutableSampler不为空时采样器固定在布局中（descriptor中的采样器被忽略），需在布局销毁之后才能销毁该采样器
   */
-VkDescriptorSetLayout createDescriptorSetLayoutImage(VkDevice device)
+VkDescriptorSetLayout createDescriptorSetLayoutImage(VkDevice device, bool pushDescriptor, VkSampler immutableSampler)
 {
     // 描述绑定
 //    VkDescriptorSetLayoutBinding uboLayoutBinding = {};
@@ -54,13 +81,14 @@ VkDescriptorSetLayout createDescriptorSetLayoutImage(VkDevice device)
     samplerLayoutBinding.binding = 0; // 不使用ubo，因此这个binding变为第一个了
     samplerLayoutBinding.descriptorCount = 1;
     samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    samplerLayoutBinding.pImmutableSamplers = nullptr;
+    samplerLayoutBinding.pImmutableSamplers = immutableSampler != VK_NULL_HANDLE ? &immutableSampler : nullptr;
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
 //    std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
     std::array<VkDescriptorSetLayoutBinding, 1> bindings = {samplerLayoutBinding};
     VkDescriptorSetLayoutCreateInfo layoutInfo = {};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.flags = pushDescriptor ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
     layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
     layoutInfo.pBindings = bindings.data();
 
@@ -86,13 +114,14 @@ void createGraphicsPipelineHelperImage(android_app *androidAppCtx, VulkanDeviceI
     VkRenderPass renderPass = renderInfo.renderPass_;
 
     // 管线布局（即定义uniform变量）
+    VkPushConstantRange drawTransformRange = getDrawTransformRange();
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .setLayoutCount = 1, // 原来是0
             .pSetLayouts = &descriptorSetLayout, // 原来是nullptr
-            .pushConstantRangeCount = 0,
-            .pPushConstantRanges = nullptr,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &drawTransformRange,
     };
 
     pipelineInfo->hasDescriptorSetLayout_ = true;
@@ -138,7 +167,8 @@ void createGraphicsPipelineHelperImage(android_app *androidAppCtx, VulkanDeviceI
             .offset {.x = 0, .y = 0,},
             .extent = extent2D,
     };
-    // Specify viewport info
+    // Specify viewport info（viewport与scissor为动态状态，此处的值会被忽略）
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = getDynamicStateInfo();
     VkPipelineViewportStateCreateInfo viewportInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
             .pNext = nullptr,
@@ -211,20 +241,20 @@ void createGraphicsPipelineHelperImage(android_app *androidAppCtx, VulkanDeviceI
     // Specify vertex input state
     VkVertexInputBindingDescription vertex_input_bindings{
             .binding = 0,
-            .stride = 4 * sizeof(float), // 二维顶点+二维纹理坐标
+            .stride = sizeof(ImageVertex), // 二维顶点+二维纹理坐标
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
     };
     VkVertexInputAttributeDescription vertex_input_attributes[2]{{
                                                                          .binding = 0,
                                                                          .location = 0,
-                                                                         .format = VK_FORMAT_R32G32_SFLOAT, // 二维顶点
-                                                                         .offset = 0,
+                                                                         .format = VERTEX_POSITION_FORMAT, // 二维顶点
+                                                                         .offset = offsetof(ImageVertex, pos_),
                                                                  },
                                                                  {
                                                                          .binding = 0,
                                                                          .location = 1,
                                                                          .format = VK_FORMAT_R32G32_SFLOAT, // 二维纹理坐标
-                                                                         .offset = 2 * sizeof(float),
+                                                                         .offset = offsetof(ImageVertex, u_),
                                                                  }};
     ////////////////////////////////////////////////// TODO
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{
@@ -251,7 +281,7 @@ void createGraphicsPipelineHelperImage(android_app *androidAppCtx, VulkanDeviceI
             .pMultisampleState = &multisampleInfo,
             .pDepthStencilState = nullptr,
             .pColorBlendState = &colorBlendInfo,
-            .pDynamicState = nullptr,
+            .pDynamicState = &dynamicStateInfo,
             .layout = pipelineInfo->pipelineLayout_,
             .renderPass = renderPass,
             .subpass = 0,
@@ -260,7 +290,7 @@ void createGraphicsPipelineHelperImage(android_app *androidAppCtx, VulkanDeviceI
     };
 
     CALL_VK(vkCreateGraphicsPipelines(
-            device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
+            device, renderInfo.pipelineCache_, 1, &pipelineCreateInfo, nullptr,
             &pipelineInfo->pipeline_));
 
     // We don't need the shaders anymore, we can release their memory
@@ -281,13 +311,14 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
     VkRenderPass renderPass = renderInfo.renderPass_;
 
     // 管线布局（即定义uniform变量）
+    VkPushConstantRange drawTransformRange = getDrawTransformRange();
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .setLayoutCount = 1, // 原来是0
             .pSetLayouts = &descriptorSetLayout, // 原来是nullptr
-            .pushConstantRangeCount = 0,
-            .pPushConstantRanges = nullptr,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &drawTransformRange,
     };
 
     pipelineInfo->hasDescriptorSetLayout_ = true;
@@ -333,7 +364,8 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
             .offset {.x = 0, .y = 0,},
             .extent = extent2D,
     };
-    // Specify viewport info
+    // Specify viewport info（viewport与scissor为动态状态，此处的值会被忽略）
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = getDynamicStateInfo();
     VkPipelineViewportStateCreateInfo viewportInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
             .pNext = nullptr,
@@ -406,26 +438,26 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
     // Specify vertex input state
     VkVertexInputBindingDescription vertex_input_bindings{
             .binding = 0,
-            .stride = 7 * sizeof(float), // 二维顶点+二维纹理坐标+三维颜色
+            .stride = sizeof(TextVertex), // 二维顶点+二维纹理坐标+RGBA8颜色
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
     };
     VkVertexInputAttributeDescription vertex_input_attributes[3]{{
                                                                          .binding = 0,
                                                                          .location = 0,
-                                                                         .format = VK_FORMAT_R32G32_SFLOAT, // 二维顶点
-                                                                         .offset = 0,
+                                                                         .format = VERTEX_POSITION_FORMAT, // 二维顶点
+                                                                         .offset = offsetof(TextVertex, pos_),
                                                                  },
                                                                  {
                                                                          .binding = 0,
                                                                          .location = 1,
                                                                          .format = VK_FORMAT_R32G32_SFLOAT, // 二维纹理坐标
-                                                                         .offset = 2 * sizeof(float),
+                                                                         .offset = offsetof(TextVertex, u_),
                                                                  },
                                                                  {
                                                                          .binding = 0,
                                                                          .location = 2,
-                                                                         .format = VK_FORMAT_R32G32B32_SFLOAT, // 三维颜色
-                                                                         .offset = 4 * sizeof(float),
+                                                                         .format = VERTEX_COLOR_FORMAT, // 颜色（shader中只读取rgb）
+                                                                         .offset = offsetof(TextVertex, color_),
                                                                  }};
     ////////////////////////////////////////////////// TODO
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{
@@ -452,7 +484,7 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
             .pMultisampleState = &multisampleInfo,
             .pDepthStencilState = nullptr,
             .pColorBlendState = &colorBlendInfo,
-            .pDynamicState = nullptr,
+            .pDynamicState = &dynamicStateInfo,
             .layout = pipelineInfo->pipelineLayout_,
             .renderPass = renderPass,
             .subpass = 0,
@@ -461,7 +493,7 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
     };
 
     CALL_VK(vkCreateGraphicsPipelines(
-            device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
+            device, renderInfo.pipelineCache_, 1, &pipelineCreateInfo, nullptr,
             &pipelineInfo->pipeline_));
 
     // We don't need the shaders anymore, we can release their memory
@@ -470,20 +502,21 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
 }
 // 创建Graphics Pipeline（使用pipelineCache）
 void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                  VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo,
+                                  VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo,
                                   char *vsFilePath, char *fsFilePath) {
 
 //    LOGI("createPipeline %s", vsFilePath);
 
     memset(pipelineInfo, 0, sizeof(VulkanPipelineInfo));
     // 管线布局（即定义uniform变量）
+    VkPushConstantRange drawTransformRange = getDrawTransformRange();
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .setLayoutCount = 0,
             .pSetLayouts = nullptr,
-            .pushConstantRangeCount = 0,
-            .pPushConstantRanges = nullptr,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &drawTransformRange,
     };
     pipelineInfo->hasDescriptorSetLayout_ = false;
     CALL_VK(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo,
@@ -526,7 +559,8 @@ void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, V
             .offset {.x = 0, .y = 0,},
             .extent = extent2D,
     };
-    // Specify viewport info
+    // Specify viewport info（viewport与scissor为动态状态，此处的值会被忽略）
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = getDynamicStateInfo();
     VkPipelineViewportStateCreateInfo viewportInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
             .pNext = nullptr,
@@ -598,20 +632,20 @@ void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, V
     // Specify vertex input state
     VkVertexInputBindingDescription vertex_input_bindings{
             .binding = 0,
-            .stride = 5 * sizeof(float), // 二维顶点+三维颜色
+            .stride = sizeof(ColorVertex), // 二维顶点+RGBA8颜色
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
     };
     VkVertexInputAttributeDescription vertex_input_attributes[2]{{
                                                                          .binding = 0,
                                                                          .location = 0,
-                                                                         .format = VK_FORMAT_R32G32_SFLOAT, // 二维顶点
-                                                                         .offset = 0,
+                                                                         .format = VERTEX_POSITION_FORMAT, // 二维顶点
+                                                                         .offset = offsetof(ColorVertex, pos_),
                                                                  },
                                                                  {
                                                                          .binding = 0,
                                                                          .location = 1,
-                                                                         .format = VK_FORMAT_R32G32B32_SFLOAT, // 三维颜色
-                                                                         .offset = 2 * sizeof(float),
+                                                                         .format = VERTEX_COLOR_FORMAT, // 颜色（shader中只读取rgb）
+                                                                         .offset = offsetof(ColorVertex, color_),
                                                                  }};
     ////////////////////////////////////////////////// TODO
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{
@@ -638,7 +672,7 @@ void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, V
             .pMultisampleState = &multisampleInfo,
             .pDepthStencilState = nullptr,
             .pColorBlendState = &colorBlendInfo,
-            .pDynamicState = nullptr,
+            .pDynamicState = &dynamicStateInfo,
             .layout = pipelineInfo->pipelineLayout_,
             .renderPass = renderPass,
             .subpass = 0,
@@ -647,7 +681,7 @@ void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, V
     };
 
     CALL_VK(vkCreateGraphicsPipelines(
-            device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
+            device, pipelineCache, 1, &pipelineCreateInfo, nullptr,
             &pipelineInfo->pipeline_));
 
     // We don't need the shaders anymore, we can release their memory
@@ -659,20 +693,21 @@ void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, V
 
 // 创建Graphics Pipeline（使用pipelineCache）
 void createGraphicsPipelineHelperRRect(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                  VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo,
+                                  VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo,
                                   char *vsFilePath, char *fsFilePath) {
 
 //    LOGI("createPipeline %s", vsFilePath);
 
     memset(pipelineInfo, 0, sizeof(VulkanPipelineInfo));
     // 管线布局（即定义uniform变量）
+    VkPushConstantRange drawTransformRange = getDrawTransformRange();
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
             .pNext = nullptr,
             .setLayoutCount = 0,
             .pSetLayouts = nullptr,
-            .pushConstantRangeCount = 0,
-            .pPushConstantRanges = nullptr,
+            .pushConstantRangeCount = 1,
+            .pPushConstantRanges = &drawTransformRange,
     };
     pipelineInfo->hasDescriptorSetLayout_ = false;
     CALL_VK(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo,
@@ -715,7 +750,8 @@ void createGraphicsPipelineHelperRRect(android_app *androidAppCtx, VkDevice devi
             .offset {.x = 0, .y = 0,},
             .extent = extent2D,
     };
-    // Specify viewport info
+    // Specify viewport info（viewport与scissor为动态状态，此处的值会被忽略）
+    VkPipelineDynamicStateCreateInfo dynamicStateInfo = getDynamicStateInfo();
     VkPipelineViewportStateCreateInfo viewportInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
             .pNext = nullptr,
@@ -786,20 +822,20 @@ void createGraphicsPipelineHelperRRect(android_app *androidAppCtx, VkDevice devi
     // Specify vertex input state
     VkVertexInputBindingDescription vertex_input_bindings{
             .binding = 0,
-            .stride = 6 * sizeof(float), // 二维顶点+四维颜色
+            .stride = sizeof(ColorVertex), // 二维顶点+RGBA8颜色
             .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
     };
     VkVertexInputAttributeDescription vertex_input_attributes[2]{{
                                                                          .binding = 0,
                                                                          .location = 0,
-                                                                         .format = VK_FORMAT_R32G32_SFLOAT, // 二维顶点
-                                                                         .offset = 0,
+                                                                         .format = VERTEX_POSITION_FORMAT, // 二维顶点
+                                                                         .offset = offsetof(ColorVertex, pos_),
                                                                  },
                                                                  {
                                                                          .binding = 0,
                                                                          .location = 1,
-                                                                         .format = VK_FORMAT_R32G32B32A32_SFLOAT, // 四维颜色
-                                                                         .offset = 2 * sizeof(float),
+                                                                         .format = VERTEX_COLOR_FORMAT, // 四维颜色
+                                                                         .offset = offsetof(ColorVertex, color_),
                                                                  }};
     ////////////////////////////////////////////////// TODO
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{
@@ -826,7 +862,7 @@ void createGraphicsPipelineHelperRRect(android_app *androidAppCtx, VkDevice devi
             .pMultisampleState = &multisampleInfo,
             .pDepthStencilState = nullptr,
             .pColorBlendState = &colorBlendInfo,
-            .pDynamicState = nullptr,
+            .pDynamicState = &dynamicStateInfo,
             .layout = pipelineInfo->pipelineLayout_,
             .renderPass = renderPass,
             .subpass = 0,
@@ -835,7 +871,7 @@ void createGraphicsPipelineHelperRRect(android_app *androidAppCtx, VkDevice devi
     };
 
     CALL_VK(vkCreateGraphicsPipelines(
-            device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
+            device, pipelineCache, 1, &pipelineCreateInfo, nullptr,
             &pipelineInfo->pipeline_));
 
     // We don't need the shaders anymore, we can release their memory
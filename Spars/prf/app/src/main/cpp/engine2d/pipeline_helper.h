@@ -12,13 +12,13 @@
 #include "../vulkan/utils.h"
 #include "image/Image.h"
 
-// 绘制矩形和圆形的管线
+// 绘制矩形和圆形的管线（pipelineCache可为VK_NULL_HANDLE，图片与文字的管线使用renderInfo中的）
 void createGraphicsPipelineHelper(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                            VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo,
+                            VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo,
                             char *vsFilePath, char *fsFilePath);
 
 void createGraphicsPipelineHelperRRect(android_app *androidAppCtx, VkDevice device, VkExtent2D extent2D,
-                                  VkRenderPass renderPass, VulkanPipelineInfo *pipelineInfo,
+                                  VkRenderPass renderPass, VkPipelineCache pipelineCache, VulkanPipelineInfo *pipelineInfo,
                                   char *vsFilePath, char *fsFilePath);
 
 // 绘制图片的管线
@@ -31,8 +31,8 @@ void createGraphicsPipelineHelperText(android_app *androidAppCtx, VulkanDeviceIn
                                        VulkanRenderInfo renderInfo, VulkanPipelineInfo *pipelineInfo,
                                        char *vsFilePath, char *fsFilePath, VkDescriptorSetLayout descriptorSetLayout);
 
-// 绘制图片所用的descriptor（用来存放纹理）
-VkDescriptorSetLayout createDescriptorSetLayoutImage(VkDevice device);
+// 绘制图片所用的descriptor（用来存放纹理），pushDescriptor为true时以push descriptor写入（VK_KHR_push_descriptor），不从池中分配
+VkDescriptorSetLayout createDescriptorSetLayoutImage(VkDevice device, bool pushDescriptor = false, VkSampler immutableSampler = VK_NULL_HANDLE);
 
 
 #endif //PRF_PIPELINE_HELPER_H
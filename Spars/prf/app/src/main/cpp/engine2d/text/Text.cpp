@@ -18,4 +18,53 @@ bool Text::operator==(const Text& other) const {
 
     // 比较字体和大小
     return fontPath_ == other.fontPath_ && pixelHeight_ == other.pixelHeight_;
-}
\ No newline at end of file
+}
+void Text::decodeUtf8(const std::string &str, std::vector<uint32_t> *codepoints) {
+    const uint32_t REPLACEMENT = 0xFFFD;
+    size_t i = 0;
+    while (i < str.size()) {
+        unsigned char lead = static_cast<unsigned char>(str[i]);
+        uint32_t codepoint;
+        size_t length;
+        if (lead < 0x80) {
+            codepoint = lead;
+            length = 1;
+        } else if ((lead & 0xE0) == 0xC0) {
+            codepoint = lead & 0x1F;
+            length = 2;
+        } else if ((lead & 0xF0) == 0xE0) {
+            codepoint = lead & 0x0F;
+            length = 3;
+        } else if ((lead & 0xF8) == 0xF0) {
+            codepoint = lead & 0x07;
+            length = 4;
+        } else {
+            codepoints->push_back(REPLACEMENT); // 孤立的后续字节或非法的首字节
+            i++;
+            continue;
+        }
+
+        // 后续字节必须为10xxxxxx，截断或不合法时只跳过首字节
+        size_t j = 1;
+        for (; j < length && i + j < str.size(); j++) {
+            unsigned char next = static_cast<unsigned char>(str[i + j]);
+            if ((next & 0xC0) != 0x80) {
+                break;
+            }
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+        if (j != length) {
+            codepoints->push_back(REPLACEMENT);
+            i++;
+            continue;
+        }
+
+        // 过长编码、代理区与超出范围的码位
+        static const uint32_t MIN_CODEPOINT[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (codepoint < MIN_CODEPOINT[length] || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF) {
+            codepoint = REPLACEMENT;
+        }
+        codepoints->push_back(codepoint);
+        i += length;
+    }
+}
@@ -5,7 +5,9 @@
 #ifndef PRF_TEXT_H
 #define PRF_TEXT_H
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 /* 定义了一个文本，左上角坐标XY，文字大小（字符的高度像素数量），和文字内容*/
 class Text {
@@ -17,6 +19,9 @@ public:
 
     static Text MakeText(float x, float y, float pixelHeight, std::string str, std::string fontPath);
 
+    // 将UTF-8字符串解码为Unicode码位（追加到codepoints），非法的字节序列解码为U+FFFD
+    static void decodeUtf8(const std::string &str, std::vector<uint32_t> *codepoints);
+
     /* GlyphManager中会将Text作为key，查找GlyphInfo */
     bool operator==(const Text& other) const;
 private:
@@ -2,4 +2,8 @@
 
 Animation::Animation (RenderNode *target) {
     target_ = target;
+}
+
+RenderNode *Animation::getTarget() {
+    return target_;
 }
\ No newline at end of file
@@ -21,6 +21,7 @@ public:
      */
     virtual bool animate(VSyncInfo &vsyncInfo) = 0;
     virtual std::string getName() = 0; // 该动画的名字
+    RenderNode *getTarget(); // 该动画作用的节点
 
 protected:
     RenderNode *target_;
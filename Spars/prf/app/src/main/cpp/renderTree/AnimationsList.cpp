@@ -16,6 +16,14 @@ void AnimationsList::addAnimation(const std::shared_ptr<Animation>& animation) {
     animList_.push_back(animation);
 }
 
+void AnimationsList::clear() {
+    animList_.clear();
+}
+
+const std::vector<std::shared_ptr<Animation>> &AnimationsList::getAnimations() {
+    return animList_;
+}
+
 void AnimationsList::updateTree(RenderNode *root, bool needUpdate) {
 
     // 该节点需要更新，且该节点的子节点也会更新
@@ -28,6 +28,8 @@ public:
      */
     void updateTree(RenderNode *root, bool needUpdate=false); // 更新所有节点的绝对信息
     void addAnimation(const std::shared_ptr<Animation>& animation);
+    void clear(); // 移除所有动画（切换渲染树时）
+    const std::vector<std::shared_ptr<Animation>> &getAnimations(); // 系统中所有的动画（如序列化渲染树时）
 
 private:
     std::vector<std::shared_ptr<Animation>> animList_; // 系统中所有的动画
@@ -46,8 +46,8 @@ std::shared_ptr<DrawTask> RectDrawCmd::encapsulateIntoDrawTask(uint32_t taskId,
 {
     std::vector<Rect> rects;
     std::vector<Paint> paints;
-    rects.push_back(Rect::MakeXYWH(renderNode->getAbsX() + rect_.x_,
-                                   renderNode->getAbsY() + rect_.y_,
+    rects.push_back(Rect::MakeXYWH(renderNode->getLocalX() + rect_.x_,
+                                   renderNode->getLocalY() + rect_.y_,
                                    rect_.w_,
                                    rect_.h_));
     paints.push_back(getPaint());
@@ -79,8 +79,8 @@ std::shared_ptr<DrawTask> CircleDrawCmd::encapsulateIntoDrawTask(uint32_t taskId
 {
     std::vector<Circle> circles;
     std::vector<Paint> paints;
-    circles.push_back(Circle::MakeXYR(renderNode->getAbsX() + circle_.x_,
-                                      renderNode->getAbsY() + circle_.y_,
+    circles.push_back(Circle::MakeXYR(renderNode->getLocalX() + circle_.x_,
+                                      renderNode->getLocalY() + circle_.y_,
                                       circle_.r_));
     paints.push_back(getPaint());
 
@@ -109,8 +109,8 @@ DrawCmdType ImageDrawCmd::getType()
 
 std::shared_ptr<DrawTask> ImageDrawCmd::encapsulateIntoDrawTask(uint32_t taskId, RenderNode *renderNode)
 {
-    Rect rect = Rect::MakeXYWH(renderNode->getAbsX() + image_.rect_.x_,
-                               renderNode->getAbsY() + image_.rect_.y_,
+    Rect rect = Rect::MakeXYWH(renderNode->getLocalX() + image_.rect_.x_,
+                               renderNode->getLocalY() + image_.rect_.y_,
                                image_.rect_.w_,
                                image_.rect_.h_);
 
@@ -144,8 +144,8 @@ std::shared_ptr<DrawTask> TextDrawCmd::encapsulateIntoDrawTask(uint32_t taskId,
 {
     std::vector<Text> texts;
     std::vector<Paint> paints;
-    texts.push_back(Text::MakeText(renderNode->getAbsX() + text_.x_,
-                                      renderNode->getAbsY() + text_.y_,
+    texts.push_back(Text::MakeText(renderNode->getLocalX() + text_.x_,
+                                      renderNode->getLocalY() + text_.y_,
                                       text_.pixelHeight_,
                                       text_.str_,
                                       text_.fontPath_));
@@ -180,8 +180,8 @@ std::shared_ptr<DrawTask> RRectDrawCmd::encapsulateIntoDrawTask(uint32_t taskId,
 {
     std::vector<RRect> rrects;
     std::vector<Paint> paints;
-    rrects.push_back(RRect::MakeXYWHR(renderNode->getAbsX() + rrect_.x_,
-                                   renderNode->getAbsY() + rrect_.y_,
+    rrects.push_back(RRect::MakeXYWHR(renderNode->getLocalX() + rrect_.x_,
+                                   renderNode->getLocalY() + rrect_.y_,
                                    rrect_.w_,
                                    rrect_.h_,
                                    rrect_.r_));
@@ -35,4 +35,19 @@ bool HorLnrMovAnimation::animate(VSyncInfo &vsyncInfo)
 std::string HorLnrMovAnimation::getName()
 {
     return "HorLnrMovAnimation";
-}
\ No newline at end of file
+}
+
+int32_t HorLnrMovAnimation::getStartX()
+{
+    return startX_;
+}
+
+int32_t HorLnrMovAnimation::getSpeed()
+{
+    return speed_;
+}
+
+int32_t HorLnrMovAnimation::getEndX()
+{
+    return endX_;
+}
@@ -16,6 +16,9 @@ public:
     HorLnrMovAnimation(RenderNode *target, int32_t startX, int32_t speed, int32_t endX);
     bool animate(VSyncInfo &vsyncInfo) override;
     std::string getName() override;
+    int32_t getStartX();
+    int32_t getSpeed();
+    int32_t getEndX();
 private:
     int32_t startX_;
     int32_t speed_;
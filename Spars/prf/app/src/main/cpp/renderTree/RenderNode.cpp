@@ -15,6 +15,7 @@ RenderNode::RenderNode(RenderNode *parent, uint64_t index)
 {
     parent_ = parent;
     index_ = index;
+    updateTransformRootCache();
 }
 
 RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t absY, int32_t absW, int32_t absH)
@@ -22,6 +23,7 @@ RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t
     parent_ = parent;
     index_ = index;
     setAbsXYWH(absX, absY, absW, absH);
+    updateTransformRootCache();
 }
 
 RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t absY, int32_t absW, int32_t absH, int32_t relX, int32_t relY)
@@ -31,6 +33,7 @@ RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t
     setAbsXYWH(absX, absY, absW, absH);
     relX_ = relX;
     relY_ = relY;
+    updateTransformRootCache();
 }
 
 RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t absY, int32_t absW, int32_t absH, bool visible)
@@ -39,6 +42,7 @@ RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t
     index_ = index;
     setAbsXYWH(absX, absY, absW, absH);
     visible_ = visible;
+    updateTransformRootCache();
 }
 
 RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t absY, int32_t absW, int32_t absH, bool visible, int32_t relX, int32_t relY)
@@ -49,11 +53,13 @@ RenderNode::RenderNode(RenderNode *parent, uint64_t index, int32_t absX, int32_t
     visible_ = visible;
     relX_ = relX;
     relY_ = relY;
+    updateTransformRootCache();
 }
 
 void RenderNode::setParent(RenderNode *parent)
 {
     parent_ = parent;
+    updateTransformRootCache();
 }
 
 RenderNode *RenderNode::getParent()
@@ -69,6 +75,7 @@ RenderNode *RenderNode::getChild(uint64_t index)
 void RenderNode::addChild(RenderNode *child)
 {
     children_.push_back(child);
+    child->updateTransformRootCache();
 }
 
 uint32_t RenderNode::childrenSize()
@@ -106,6 +113,10 @@ std::string RenderNode::dumpTree(uint32_t layer)
     return ss.str();
 }
 
+uint64_t RenderNode::getIndex() {
+    return index_;
+}
+
 int32_t RenderNode::getAbsX() {
     return absX_;
 }
@@ -193,6 +204,42 @@ void RenderNode::updateAbsUsingRel() {
     }
 }
 
+bool RenderNode::getTransformRoot() {
+    return transformRoot_;
+}
+
+void RenderNode::setTransformRoot(bool transformRoot) {
+    transformRoot_ = transformRoot;
+    updateTransformRootCache();
+}
+
+void RenderNode::updateTransformRootCache() {
+    transformRootCache_ = transformRoot_ ? this : (parent_ == nullptr ? nullptr : parent_->transformRootCache_);
+    for (RenderNode *child : children_) {
+        child->updateTransformRootCache();
+    }
+}
+
+RenderNode *RenderNode::findTransformRoot() {
+    return transformRootCache_;
+}
+
+int32_t RenderNode::getOriginX() {
+    return transformRootCache_ == nullptr ? 0 : transformRootCache_->absX_;
+}
+
+int32_t RenderNode::getOriginY() {
+    return transformRootCache_ == nullptr ? 0 : transformRootCache_->absY_;
+}
+
+int32_t RenderNode::getLocalX() {
+    return absX_ - getOriginX();
+}
+
+int32_t RenderNode::getLocalY() {
+    return absY_ - getOriginY();
+}
+
 void RenderNode::addDrawCmd(std::shared_ptr<DrawCmd> drawCmd) {
     cmdList_.push_back(drawCmd);
 }
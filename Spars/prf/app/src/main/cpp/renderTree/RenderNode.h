@@ -35,6 +35,12 @@ private:
 
     bool visible_ = true; // 对于visible为false的节点，跳过绘制指令
 
+    bool transformRoot_ = false; // 变换节点（如动画节点）：子树的几何以该节点为原点生成，平移通过push constant提供
+    // 最近的变换节点（包括自身）的缓存，父节点或变换节点改变时更新（工作线程只读）；原点读取其当前的绝对位置，动画移动时无需失效
+    RenderNode *transformRootCache_ = nullptr;
+
+    void updateTransformRootCache(); // 根据父节点更新本节点及子树的缓存
+
     /* 绘制指令列表 */
     std::vector<std::shared_ptr<DrawCmd>> cmdList_;
 
@@ -58,6 +64,7 @@ public:
     virtual std::string dumpNode();
 
     /* 节点属性相关函数 */
+    uint64_t getIndex();
     int32_t getAbsX();
     int32_t getAbsY();
     int32_t getAbsW();
@@ -85,6 +92,15 @@ public:
      */
     void updateAbsUsingRel();
 
+    /* 变换相关函数 */
+    bool getTransformRoot();
+    void setTransformRoot(bool transformRoot);
+    RenderNode *findTransformRoot(); // 最近的变换节点（包括自身），没有则返回nullptr；O(1)，读取缓存
+    int32_t getOriginX(); // 所属变换节点的绝对位置，没有变换节点时为0
+    int32_t getOriginY();
+    int32_t getLocalX(); // 相对于所属变换节点的位置，动画移动变换节点时保持不变
+    int32_t getLocalY();
+
     /* 绘制相关函数*/
     void addDrawCmd(std::shared_ptr<DrawCmd> drawCmd);          // 向该节点的cmdList中添加指令
     uint32_t drawCmdCount();
@@ -5,6 +5,7 @@
 #include <android/trace.h>
 
 #include "RenderWorkerPool.h"
+#include "../engine2d/Engine2D.h"
 #include "../log.h"
 
 RenderWorkerPool::RenderWorkerPool() {
@@ -79,6 +80,22 @@ void RenderWorkerPool::renderAll(VulkanDeviceInfo &deviceInfo, VulkanSwapchainIn
     vkCmdBeginRenderPass(renderInfo.cmdBuffer_[frameIndex], &renderPassBeginInfo,
                          VK_SUBPASS_CONTENTS_INLINE);
 
+    // viewport与scissor为动态状态，按当前显示尺寸设置（resize时无需重建管线）
+    VkViewport viewport{
+            .x = 0,
+            .y = 0,
+            .width = (float) swapchainInfo.displaySize_.width,
+            .height = (float) swapchainInfo.displaySize_.height,
+            .minDepth = 0.0f,
+            .maxDepth = 1.0f,
+    };
+    VkRect2D scissor = {
+            .offset {.x = 0, .y = 0,},
+            .extent = swapchainInfo.displaySize_,
+    };
+    vkCmdSetViewport(renderInfo.cmdBuffer_[frameIndex], 0, 1, &viewport);
+    vkCmdSetScissor(renderInfo.cmdBuffer_[frameIndex], 0, 1, &scissor);
+
 
     const uint32_t numTasks = drawTaskList->getTaskNum();
     for(uint32_t i = 0; i < numTasks; i++) {
@@ -91,21 +108,30 @@ void RenderWorkerPool::renderAll(VulkanDeviceInfo &deviceInfo, VulkanSwapchainIn
 //            LOGE("test error");
 //        }
 
+        // 没有图元的任务（index段未申请）不录制
+        if (drawResource->indexCount_ == 0) {
+            continue;
+        }
+
         // 绑定VkPipeline
         vkCmdBindPipeline(renderInfo.cmdBuffer_[frameIndex],
                           VK_PIPELINE_BIND_POINT_GRAPHICS, drawResource->pipelineInfo_.pipeline_);
 
-        // 绑定vertex buffer
-        VkDeviceSize offset = 0;
+        // 绑定vertex buffer（段位于大块中的offset_处）
         vkCmdBindVertexBuffers(renderInfo.cmdBuffer_[frameIndex], 0, 1,
-                               &drawResource->vertexBufferInfo_.buffer_, &offset);
+                               &drawResource->vertexBufferInfo_.buffer_, &drawResource->vertexBufferInfo_.offset_);
 
         // 绑定index buffer
         vkCmdBindIndexBuffer(renderInfo.cmdBuffer_[frameIndex],
-                             drawResource->indexBufferInfo_.buffer_, 0, VK_INDEX_TYPE_UINT32);
+                             drawResource->indexBufferInfo_.buffer_, drawResource->indexBufferInfo_.offset_, drawResource->indexType_);
 
         // 绑定描述符集（只有部分图元绘制用到）
-        if (drawResource->descriptorSetInfo_.valid_) {
+        if (drawResource->descriptorSetInfo_.push_) {
+            SamplerDescriptorManager::pushSamplerDescriptor(renderInfo.cmdBuffer_[frameIndex],
+                                                            drawResource->pipelineInfo_.pipelineLayout_,
+                                                            drawResource->descriptorSetInfo_.imageInfo_);
+        } else if (drawResource->descriptorSetInfo_.valid_) {
+            Engine2D::flushDescriptorWrites(); // 新建的描述符集在第一次被绑定之前写入
             vkCmdBindDescriptorSets(renderInfo.cmdBuffer_[frameIndex],
                                     VK_PIPELINE_BIND_POINT_GRAPHICS,
                                     drawResource->pipelineInfo_.pipelineLayout_,
@@ -113,6 +139,10 @@ void RenderWorkerPool::renderAll(VulkanDeviceInfo &deviceInfo, VulkanSwapchainIn
                                     nullptr);
         }
 
+        // 该任务的变换（以所属变换节点为原点的像素坐标在此平移到屏幕位置并转换为NDC）
+        vkCmdPushConstants(renderInfo.cmdBuffer_[frameIndex], drawResource->pipelineInfo_.pipelineLayout_,
+                           VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawTransform), &drawResource->transform_);
+
         // 记录draw call
         vkCmdDrawIndexed(renderInfo.cmdBuffer_[frameIndex], drawResource->indexCount_, 1, 0, 0, 0);
 
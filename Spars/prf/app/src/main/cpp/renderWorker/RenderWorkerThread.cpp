@@ -12,6 +12,7 @@
 #include <pthread.h>
 #include <sched.h>
 #include <stdio.h>
+#include <time.h>
 
 
 int affinityArray[9] = {4, 6, 5, 7, 8, 0, 1, 2, 3};
@@ -75,7 +76,7 @@ void RenderWorkerThread::main() {
                 ATrace_beginSection((std::string("circles_task") + std::to_string(drawTask->getTaskId())).c_str());
                 break;
             case IMAGE_DRAWTASK:
-                ATrace_beginSection((std::string("image_task") + std::to_string(drawTask->getTaskId()) + ": " + dynamic_cast<ImageDrawTask*>(drawTask)->image_.path_).c_str());
+                ATrace_beginSection((std::string("image_task") + std::to_string(drawTask->getTaskId()) + ": " + dynamic_cast<ImageDrawTask*>(drawTask)->getImages()[0].path_).c_str());
                 break;
             case TEXTS_DRAWTASK:
                 ATrace_beginSection((std::string("texts_task") + std::to_string(drawTask->getTaskId())).c_str());
@@ -88,10 +89,19 @@ void RenderWorkerThread::main() {
         }
 
         // 调用drawTask重写的draw函数。每个不同种类的drawTask内部调用Engine2D::drawXXX
+#if GEOMETRY_CACHE_STATS
+        timespec drawStart, drawEnd; // 统计该线程的CPU时间，不包含阻塞等待
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &drawStart);
+#endif
         std::shared_ptr<DrawResource> drawResource (new DrawResource(drawTask->draw()));
+#if GEOMETRY_CACHE_STATS
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &drawEnd);
+        Engine2D::recordDrawTime((drawEnd.tv_sec - drawStart.tv_sec) * 1000000000ULL + drawEnd.tv_nsec - drawStart.tv_nsec);
+#endif
 
         // 返回数据
         drawResource->taskId_ = drawTask->getTaskId();
+        Engine2D::setTranslate(drawTask->originX_, drawTask->originY_, drawResource.get());
         drcqOut_->produce(drawResource);
 
         ATrace_endSection();
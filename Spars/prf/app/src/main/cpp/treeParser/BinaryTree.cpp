@@ -0,0 +1,450 @@
+#include "BinaryTree.h"
+#include "TreeParser.h"
+#include "../renderTree/HorLnrMovAnimation.h"
+#include "../utils/AssetFile.h"
+#include "../log.h"
+#include "../config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// ================================== 以下为一些辅助函数 ==================================
+static uint64_t align8_helper(uint64_t offset) {
+    return (offset + 7) & ~static_cast<uint64_t>(7);
+}
+
+// 释放整棵渲染树（RenderNode的析构函数不释放子节点）
+static void deleteTree_helper(RenderNode *node) {
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        deleteTree_helper(node->getChild(i));
+    }
+    delete node;
+}
+
+// 将字符串加入字符串表（相同的字符串只存一份）
+static BinaryStringRef addString_helper(const std::string &str, std::string &table,
+                                        std::unordered_map<std::string, BinaryStringRef> &refs) {
+    auto iter = refs.find(str);
+    if (iter != refs.end()) {
+        return iter->second;
+    }
+    BinaryStringRef ref;
+    ref.offset_ = static_cast<uint32_t>(table.size());
+    ref.length_ = static_cast<uint32_t>(str.size());
+    table += str;
+    refs[str] = ref;
+    return ref;
+}
+
+static void setPaint_helper(BinaryTreeCmd &record, DrawCmd *drawCmd) {
+    Paint paint = drawCmd->getPaint();
+    record.r_ = paint.r_;
+    record.g_ = paint.g_;
+    record.b_ = paint.b_;
+    record.a_ = paint.a_;
+}
+
+// 段[offset, offset + count * size)是否在文件内且按8字节对齐
+static bool sectionInFile_helper(uint64_t offset, uint64_t count, uint64_t size, uint64_t fileSize) {
+    return offset % 8 == 0 && offset <= fileSize && count <= (fileSize - offset) / size;
+}
+
+static bool stringInTable_helper(const BinaryStringRef &ref, uint32_t stringTableSize) {
+    return static_cast<uint64_t>(ref.offset_) + ref.length_ <= stringTableSize;
+}
+
+/**
+ * 检查头部与各段的范围，以及所有记录中的索引与偏移（在创建任何节点之前），不合法时抛出std::runtime_error
+ * 检查之后可以直接按结构体访问文件中的各段
+ */
+static const BinaryTreeHeader *checkFile_helper(const AssetFile &file) {
+    if (file.size() < sizeof(BinaryTreeHeader) || memcmp(file.data(), BINARY_TREE_MAGIC, 4) != 0) {
+        throw std::runtime_error("not a binary render tree!");
+    }
+    if (reinterpret_cast<uintptr_t>(file.data()) % 8 != 0) {
+        throw std::runtime_error("binary render tree is not 8-byte aligned in memory!");
+    }
+    const BinaryTreeHeader *header = reinterpret_cast<const BinaryTreeHeader *>(file.data());
+    if (header->version_ != BINARY_TREE_VERSION) {
+        throw std::runtime_error("unsupported binary render tree version " + std::to_string(header->version_));
+    }
+    uint64_t fileSize = file.size();
+    if (header->fileSize_ != fileSize ||
+        !sectionInFile_helper(header->nodesOffset_, header->nodeCount_, sizeof(BinaryTreeNode), fileSize) ||
+        !sectionInFile_helper(header->childrenOffset_, header->childCount_, sizeof(uint32_t), fileSize) ||
+        !sectionInFile_helper(header->cmdsOffset_, header->cmdCount_, sizeof(BinaryTreeCmd), fileSize) ||
+        !sectionInFile_helper(header->stringsOffset_, header->stringTableSize_, 1, fileSize)) {
+        throw std::runtime_error("truncated binary render tree!");
+    }
+    if (header->nodeCount_ > 0 && header->childCount_ != header->nodeCount_ - 1) {
+        throw std::runtime_error("invalid child count in binary render tree!");
+    }
+
+    const unsigned char *base = file.data();
+    auto nodes = reinterpret_cast<const BinaryTreeNode *>(base + header->nodesOffset_);
+    auto children = reinterpret_cast<const uint32_t *>(base + header->childrenOffset_);
+    auto cmds = reinterpret_cast<const BinaryTreeCmd *>(base + header->cmdsOffset_);
+
+    std::vector<bool> listed(header->nodeCount_, false); // 每个节点只能作为一个子节点出现一次
+    for (uint32_t i = 0; i < header->nodeCount_; i++) {
+        const BinaryTreeNode &node = nodes[i];
+        bool parentValid = i == 0 ? node.parent_ == BINARY_TREE_NO_PARENT : node.parent_ < i; // 先序：父节点在前
+        if (!parentValid ||
+            static_cast<uint64_t>(node.firstChild_) + node.childCount_ > header->childCount_ ||
+            static_cast<uint64_t>(node.firstCmd_) + node.cmdCount_ > header->cmdCount_) {
+            throw std::runtime_error("invalid node " + std::to_string(i) + " in binary render tree!");
+        }
+        for (uint32_t j = 0; j < node.childCount_; j++) {
+            uint32_t child = children[node.firstChild_ + j];
+            if (child >= header->nodeCount_ || nodes[child].parent_ != i || listed[child]) {
+                throw std::runtime_error("invalid child of node " + std::to_string(i) + " in binary render tree!");
+            }
+            listed[child] = true;
+        }
+    }
+    for (uint32_t i = 0; i < header->cmdCount_; i++) {
+        const BinaryTreeCmd &cmd = cmds[i];
+        if (cmd.type_ > RRECT_DRAWCMD || !stringInTable_helper(cmd.str0_, header->stringTableSize_) ||
+            !stringInTable_helper(cmd.str1_, header->stringTableSize_)) {
+            throw std::runtime_error("invalid draw cmd " + std::to_string(i) + " in binary render tree!");
+        }
+    }
+    return header;
+}
+// ================================== 以上为一些辅助函数 ==================================
+
+size_t BinaryTree::write(const std::string &path, RenderNode *rootNode, int32_t width, int32_t height,
+                         AnimationsList *animationsList, uint64_t sourceSize, uint64_t sourceHash) {
+    // 先序遍历，确定每个节点的索引
+    std::vector<RenderNode *> order;
+    std::unordered_map<RenderNode *, uint32_t> ids;
+    std::vector<RenderNode *> stack;
+    if (rootNode != nullptr) {
+        stack.push_back(rootNode);
+    }
+    while (!stack.empty()) {
+        RenderNode *node = stack.back();
+        stack.pop_back();
+        ids[node] = static_cast<uint32_t>(order.size());
+        order.push_back(node);
+        for (uint32_t i = node->childrenSize(); i > 0; i--) { // 逆序入栈，保证子节点按原顺序出栈
+            stack.push_back(node->getChild(i - 1));
+        }
+    }
+
+    // 动画按其作用的节点记录
+    std::unordered_map<RenderNode *, HorLnrMovAnimation *> animations;
+    if (animationsList != nullptr) {
+        for (const std::shared_ptr<Animation> &animation : animationsList->getAnimations()) {
+            auto horLnrMov = dynamic_cast<HorLnrMovAnimation *>(animation.get());
+            if (horLnrMov == nullptr) {
+                throw std::runtime_error("failed to store animation " + animation->getName() + " in binary render tree!");
+            }
+            animations[horLnrMov->getTarget()] = horLnrMov;
+        }
+    }
+
+    std::vector<BinaryTreeNode> nodes(order.size());
+    std::vector<uint32_t> children;
+    std::vector<BinaryTreeCmd> cmds;
+    std::string strings;
+    std::unordered_map<std::string, BinaryStringRef> stringRefs;
+    children.reserve(order.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        RenderNode *node = order[i];
+        BinaryTreeNode &record = nodes[i];
+        memset(&record, 0, sizeof(record));
+        record.index_ = node->getIndex();
+        record.absX_ = node->getAbsX();
+        record.absY_ = node->getAbsY();
+        record.absW_ = node->getAbsW();
+        record.absH_ = node->getAbsH();
+        record.relX_ = node->getRelX();
+        record.relY_ = node->getRelY();
+        record.parent_ = i == 0 ? BINARY_TREE_NO_PARENT : ids[node->getParent()];
+
+        record.firstChild_ = static_cast<uint32_t>(children.size());
+        record.childCount_ = node->childrenSize();
+        for (uint32_t j = 0; j < node->childrenSize(); j++) {
+            children.push_back(ids[node->getChild(j)]);
+        }
+
+        record.firstCmd_ = static_cast<uint32_t>(cmds.size());
+        record.cmdCount_ = node->drawCmdCount();
+        for (uint32_t j = 0; j < node->drawCmdCount(); j++) {
+            std::shared_ptr<DrawCmd> drawCmd = node->getDrawCmd(j);
+            BinaryTreeCmd cmd;
+            memset(&cmd, 0, sizeof(cmd));
+            cmd.type_ = drawCmd->getType();
+            setPaint_helper(cmd, drawCmd.get());
+            switch (drawCmd->getType()) {
+                case RECT_DRAWCMD: {
+                    Rect &rect = std::static_pointer_cast<RectDrawCmd>(drawCmd)->rect_;
+                    cmd.params_[0] = rect.x_;
+                    cmd.params_[1] = rect.y_;
+                    cmd.params_[2] = rect.w_;
+                    cmd.params_[3] = rect.h_;
+                    break;
+                }
+                case CIRCLE_DRAWCMD: {
+                    Circle &circle = std::static_pointer_cast<CircleDrawCmd>(drawCmd)->circle_;
+                    cmd.params_[0] = circle.x_;
+                    cmd.params_[1] = circle.y_;
+                    cmd.params_[2] = circle.r_;
+                    break;
+                }
+                case IMAGE_DRAWCMD: {
+                    Image &image = std::static_pointer_cast<ImageDrawCmd>(drawCmd)->image_;
+                    cmd.params_[0] = image.rect_.x_;
+                    cmd.params_[1] = image.rect_.y_;
+                    cmd.params_[2] = image.rect_.w_;
+                    cmd.params_[3] = image.rect_.h_;
+                    cmd.str0_ = addString_helper(image.path_, strings, stringRefs);
+                    break;
+                }
+                case TEXT_DRAWCMD: {
+                    Text &text = std::static_pointer_cast<TextDrawCmd>(drawCmd)->text_;
+                    cmd.params_[0] = text.x_;
+                    cmd.params_[1] = text.y_;
+                    cmd.params_[2] = text.pixelHeight_;
+                    cmd.str0_ = addString_helper(text.str_, strings, stringRefs);
+                    cmd.str1_ = addString_helper(text.fontPath_, strings, stringRefs);
+                    break;
+                }
+                case RRECT_DRAWCMD: {
+                    RRect &rrect = std::static_pointer_cast<RRectDrawCmd>(drawCmd)->rrect_;
+                    cmd.params_[0] = rrect.x_;
+                    cmd.params_[1] = rrect.y_;
+                    cmd.params_[2] = rrect.w_;
+                    cmd.params_[3] = rrect.h_;
+                    cmd.params_[4] = rrect.r_;
+                    break;
+                }
+                default:
+                    throw std::runtime_error("failed to store unknown draw cmd in binary render tree!");
+            }
+            cmds.push_back(cmd);
+        }
+
+        record.flags_ = (node->getVisible() ? BINARY_NODE_VISIBLE : 0) | (node->getTransformRoot() ? BINARY_NODE_TRANSFORM_ROOT : 0);
+        auto animIter = animations.find(node);
+        if (animIter != animations.end()) {
+            record.flags_ |= BINARY_NODE_HOR_LNR_MOV;
+            record.animStartX_ = animIter->second->getStartX();
+            record.animSpeed_ = animIter->second->getSpeed();
+            record.animEndX_ = animIter->second->getEndX();
+        }
+    }
+
+    // 布局：头部、节点、子节点索引、绘制指令、字符串表
+    BinaryTreeHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, BINARY_TREE_MAGIC, 4);
+    header.version_ = BINARY_TREE_VERSION;
+    header.sourceSize_ = sourceSize;
+    header.sourceHash_ = sourceHash;
+    header.divideBy_ = static_cast<float>(DIVIDE_BY);
+    header.width_ = width;
+    header.height_ = height;
+    header.nodeCount_ = static_cast<uint32_t>(nodes.size());
+    header.childCount_ = static_cast<uint32_t>(children.size());
+    header.cmdCount_ = static_cast<uint32_t>(cmds.size());
+    header.stringTableSize_ = static_cast<uint32_t>(strings.size());
+    header.nodesOffset_ = align8_helper(sizeof(BinaryTreeHeader));
+    header.childrenOffset_ = align8_helper(header.nodesOffset_ + nodes.size() * sizeof(BinaryTreeNode));
+    header.cmdsOffset_ = align8_helper(header.childrenOffset_ + children.size() * sizeof(uint32_t));
+    header.stringsOffset_ = align8_helper(header.cmdsOffset_ + cmds.size() * sizeof(BinaryTreeCmd));
+    header.fileSize_ = header.stringsOffset_ + strings.size();
+
+    std::vector<uint8_t> data(header.fileSize_, 0);
+    memcpy(data.data(), &header, sizeof(header));
+    memcpy(data.data() + header.nodesOffset_, nodes.data(), nodes.size() * sizeof(BinaryTreeNode));
+    memcpy(data.data() + header.childrenOffset_, children.data(), children.size() * sizeof(uint32_t));
+    memcpy(data.data() + header.cmdsOffset_, cmds.data(), cmds.size() * sizeof(BinaryTreeCmd));
+    memcpy(data.data() + header.stringsOffset_, strings.data(), strings.size());
+
+    // 先写临时文件再rename，进程中途被杀时不会留下不完整的文件
+    std::string tempPath = path + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        LOGE("failed to open %s", tempPath.c_str());
+        return 0;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+    fclose(file);
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOGE("failed to save binary render tree %s", path.c_str());
+        remove(tempPath.c_str());
+        return 0;
+    }
+    return data.size();
+}
+
+size_t BinaryTree::convert(android_app *app, const std::string &txtPath, const std::string &binPath) {
+    AssetFile source(app, txtPath);
+    TreeParser treeParser;
+    AnimationsList animationsList;
+    int32_t width, height;
+    RenderNode *rootNode = treeParser.parse(source, width, height, &animationsList);
+    size_t size;
+    try {
+        size = write(binPath, rootNode, width, height, &animationsList, source.size(), source.contentHash());
+    } catch (...) {
+        if (rootNode != nullptr) {
+            deleteTree_helper(rootNode);
+        }
+        throw;
+    }
+    if (rootNode != nullptr) {
+        deleteTree_helper(rootNode);
+    }
+    return size;
+}
+
+bool BinaryTree::isUpToDate(const AssetFile &file, const AssetFile &source) {
+    if (file.size() < sizeof(BinaryTreeHeader)) {
+        return false;
+    }
+    BinaryTreeHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic_, BINARY_TREE_MAGIC, 4) != 0 || header.version_ != BINARY_TREE_VERSION ||
+        header.fileSize_ != file.size() || header.sourceSize_ != source.size() || header.divideBy_ != static_cast<float>(DIVIDE_BY)) {
+        return false;
+    }
+    // 大小相同时再比较内容哈希（需读取整个源文本，但远快于解析）
+    return header.sourceHash_ == source.contentHash();
+}
+
+RenderNode *BinaryTree::load(const AssetFile &file, int32_t &width, int32_t &height, AnimationsList *animationsList,
+                             ResourcePrefetcher *prefetcher) {
+    const BinaryTreeHeader *header = checkFile_helper(file);
+    const unsigned char *base = file.data();
+    auto nodes = reinterpret_cast<const BinaryTreeNode *>(base + header->nodesOffset_);
+    auto children = reinterpret_cast<const uint32_t *>(base + header->childrenOffset_);
+    auto cmds = reinterpret_cast<const BinaryTreeCmd *>(base + header->cmdsOffset_);
+    auto strings = reinterpret_cast<const char *>(base + header->stringsOffset_);
+    width = header->width_;
+    height = header->height_;
+
+    // 先序排列，创建节点时其父节点已经存在
+    std::vector<RenderNode *> renderNodes(header->nodeCount_);
+    for (uint32_t i = 0; i < header->nodeCount_; i++) {
+        const BinaryTreeNode &record = nodes[i];
+        RenderNode *parent = record.parent_ == BINARY_TREE_NO_PARENT ? nullptr : renderNodes[record.parent_];
+        RenderNode *curr = new RenderNode(parent, record.index_, record.absX_, record.absY_, record.absW_, record.absH_,
+                                          record.relX_, record.relY_);
+        renderNodes[i] = curr;
+        bool visible = (record.flags_ & BINARY_NODE_VISIBLE) != 0;
+        curr->setVisible(visible);
+        if (record.flags_ & BINARY_NODE_TRANSFORM_ROOT) {
+            curr->setTransformRoot(true);
+        }
+
+        for (uint32_t j = 0; j < record.cmdCount_; j++) {
+            const BinaryTreeCmd &cmd = cmds[record.firstCmd_ + j];
+            const float *p = cmd.params_;
+            Paint paint;
+            paint.r_ = cmd.r_;
+            paint.g_ = cmd.g_;
+            paint.b_ = cmd.b_;
+            paint.a_ = cmd.a_;
+            switch (cmd.type_) {
+                case RECT_DRAWCMD: {
+                    Rect rect = Rect::MakeXYWH(p[0], p[1], p[2], p[3]);
+                    curr->addDrawCmd(std::make_shared<RectDrawCmd>(paint, rect));
+                    break;
+                }
+                case CIRCLE_DRAWCMD: {
+                    Circle circle = Circle::MakeXYR(p[0], p[1], p[2]);
+                    curr->addDrawCmd(std::make_shared<CircleDrawCmd>(paint, circle));
+                    break;
+                }
+                case IMAGE_DRAWCMD: {
+                    Rect rect = Rect::MakeXYWH(p[0], p[1], p[2], p[3]);
+                    Image image = Image::MakeImage(rect, std::string(strings + cmd.str0_.offset_, cmd.str0_.length_));
+                    curr->addDrawCmd(std::make_shared<ImageDrawCmd>(paint, image));
+                    if (prefetcher) {
+                        prefetcher->addImage(image.path_, Rect::MakeXYWH(curr->getAbsX(), curr->getAbsY(), curr->getAbsW(), curr->getAbsH()),
+                                             visible);
+                    }
+                    break;
+                }
+                case TEXT_DRAWCMD: {
+                    Text text = Text::MakeText(p[0], p[1], p[2], std::string(strings + cmd.str0_.offset_, cmd.str0_.length_),
+                                               std::string(strings + cmd.str1_.offset_, cmd.str1_.length_));
+                    curr->addDrawCmd(std::make_shared<TextDrawCmd>(paint, text));
+                    if (prefetcher) {
+                        prefetcher->addText(text, Rect::MakeXYWH(curr->getAbsX(), curr->getAbsY(), curr->getAbsW(), curr->getAbsH()),
+                                            visible);
+                    }
+                    break;
+                }
+                case RRECT_DRAWCMD: {
+                    RRect rrect = RRect::MakeXYWHR(p[0], p[1], p[2], p[3], p[4]);
+                    curr->addDrawCmd(std::make_shared<RRectDrawCmd>(paint, rrect));
+                    break;
+                }
+            }
+        }
+
+        if (record.flags_ & BINARY_NODE_HOR_LNR_MOV) {
+            auto anim = std::make_shared<HorLnrMovAnimation>(curr, record.animStartX_, record.animSpeed_, record.animEndX_);
+            animationsList->addAnimation(anim);
+        }
+    }
+
+    for (uint32_t i = 0; i < header->nodeCount_; i++) {
+        const BinaryTreeNode &record = nodes[i];
+        for (uint32_t j = 0; j < record.childCount_; j++) {
+            renderNodes[i]->addChild(renderNodes[children[record.firstChild_ + j]]);
+        }
+    }
+    return renderNodes.empty() ? nullptr : renderNodes[0];
+}
+
+std::string BinaryTree::cachePath(const std::string &directory, const std::string &txtPath) {
+    std::string name = txtPath;
+    for (char &c : name) {
+        if (c == '/') {
+            c = '_';
+        }
+    }
+    return directory + "/" + name + ".bin";
+}
+
+RenderNode *BinaryTree::loadOrConvert(android_app *app, const std::string &txtPath, const std::string &binPath, int32_t &width,
+                                      int32_t &height, AnimationsList *animationsList, ResourcePrefetcher *prefetcher) {
+    auto start = std::chrono::steady_clock::now();
+    AssetFile source(app, txtPath);
+    try {
+        AssetFile file = AssetFile::MakeFromFile(binPath);
+        if (isUpToDate(file, source)) {
+            RenderNode *rootNode = load(file, width, height, animationsList, prefetcher);
+            LOGI("BinaryTree: loaded %s (%zu bytes) in %.3f ms", binPath.c_str(), file.size(),
+                 std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            return rootNode;
+        }
+        LOGI("BinaryTree: %s is stale, converting %s", binPath.c_str(), txtPath.c_str());
+    } catch (const std::runtime_error &e) {
+        LOGI("BinaryTree: %s unavailable (%s), converting %s", binPath.c_str(), e.what(), txtPath.c_str());
+    }
+
+    // 没有可用的二进制文件：解析文本，写出二进制文件供下次启动使用
+    TreeParser treeParser;
+    RenderNode *rootNode = treeParser.parse(source, width, height, animationsList, prefetcher);
+    double parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    auto writeStart = std::chrono::steady_clock::now();
+    size_t size = 0;
+    try {
+        size = write(binPath, rootNode, width, height, animationsList, source.size(), source.contentHash());
+    } catch (const std::runtime_error &e) {
+        LOGE("BinaryTree: failed to convert %s: %s", txtPath.c_str(), e.what());
+    }
+    LOGI("BinaryTree: parsed %s in %.3f ms, wrote %s (%zu bytes) in %.3f ms", txtPath.c_str(), parseMs, binPath.c_str(), size,
+         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - writeStart).count());
+    return rootNode;
+}
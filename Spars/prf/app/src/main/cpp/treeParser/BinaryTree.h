@@ -0,0 +1,124 @@
+#ifndef PRF_BINARYTREE_H
+#define PRF_BINARYTREE_H
+
+#include "../renderTree/RenderNode.h"
+#include "../renderTree/AnimationsList.h"
+#include "../engine2d/ResourcePrefetcher.h"
+
+#include <cstdint>
+#include <string>
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+class AssetFile;
+
+/*
+ * 二进制渲染树格式（小端，可直接mmap后按结构体读取）：
+ *   BinaryTreeHeader
+ *   BinaryTreeNode[nodeCount_]    先序排列，父节点总在子节点之前，根节点为第0个
+ *   uint32_t[childCount_]         子节点索引数组，节点的子节点为[firstChild_, firstChild_ + childCount_)
+ *   BinaryTreeCmd[cmdCount_]      绘制指令，节点的指令为[firstCmd_, firstCmd_ + cmdCount_)
+ *   char[stringTableSize_]        字符串表（图片路径、文本、字体路径，相同的字符串只存一份），不以'\0'结尾
+ * 各段的起始位置按8字节对齐，坐标为转换时已除以DIVIDE_BY的值
+ */
+#define BINARY_TREE_MAGIC "SRTB"
+// 格式版本：结构体布局或转换结果（TreeParser与write的输出，如坐标、颜色、动画参数的处理）改变时必须递增，旧的二进制文件随之失效
+#define BINARY_TREE_VERSION 2
+#define BINARY_TREE_NO_PARENT 0xFFFFFFFFu
+
+struct BinaryTreeHeader {
+    char magic_[4];
+    uint32_t version_;
+    uint64_t fileSize_;      // 整个文件的大小（检查截断）
+    uint64_t sourceSize_;    // 转换时源文本的大小
+    uint64_t sourceHash_;    // 转换时源文本内容的哈希（AssetFile::contentHash），与大小一起判断源文本是否已改变
+    float divideBy_;         // 转换时的DIVIDE_BY
+    int32_t width_;          // 显示节点的宽高
+    int32_t height_;
+    uint32_t nodeCount_;
+    uint32_t childCount_;
+    uint32_t cmdCount_;
+    uint32_t stringTableSize_;
+    uint32_t reserved_;
+    uint64_t nodesOffset_;   // 各段相对文件开头的偏移
+    uint64_t childrenOffset_;
+    uint64_t cmdsOffset_;
+    uint64_t stringsOffset_;
+};
+
+enum BinaryNodeFlag : uint32_t {
+    BINARY_NODE_VISIBLE = 1u << 0,
+    BINARY_NODE_TRANSFORM_ROOT = 1u << 1,
+    BINARY_NODE_HOR_LNR_MOV = 1u << 2, // 带有HorLnrMov动画，参数为anim*_
+};
+
+struct BinaryTreeNode {
+    uint64_t index_;
+    int32_t absX_, absY_, absW_, absH_;
+    int32_t relX_, relY_;
+    uint32_t parent_;        // 根节点为BINARY_TREE_NO_PARENT
+    uint32_t firstChild_;
+    uint32_t childCount_;
+    uint32_t firstCmd_;
+    uint32_t cmdCount_;
+    uint32_t flags_;         // BinaryNodeFlag
+    int32_t animStartX_, animSpeed_, animEndX_;
+    uint32_t reserved_;
+};
+
+struct BinaryStringRef {
+    uint32_t offset_;        // 在字符串表中的偏移
+    uint32_t length_;
+};
+
+struct BinaryTreeCmd {
+    uint32_t type_;          // DrawCmdType
+    float r_, g_, b_, a_;    // Paint
+    float params_[5];        // 形状：Rect/Image为xywh，Circle为xyr，Text为x, y, pixelHeight，RRect为xywhr
+    BinaryStringRef str0_;   // Image的路径，Text的文本
+    BinaryStringRef str1_;   // Text的字体路径
+};
+
+static_assert(sizeof(BinaryTreeHeader) == 96, "binary tree header layout changed, bump BINARY_TREE_VERSION");
+static_assert(sizeof(BinaryTreeNode) == 72, "binary tree node layout changed, bump BINARY_TREE_VERSION");
+static_assert(sizeof(BinaryTreeCmd) == 56, "binary tree cmd layout changed, bump BINARY_TREE_VERSION");
+
+/**
+ * 渲染树的二进制格式：由文本渲染树转换而来，加载时直接按记录创建节点与绘制指令，不做任何文本解析
+ * 文本中没有Paint的节点颜色为解析时的随机值，转换后固定为转换时的颜色
+ */
+class BinaryTree {
+public:
+    /**
+     * 将一棵渲染树（及其动画）写为二进制文件（先写临时文件再rename），返回写入的字节数
+     * sourceSize与sourceHash为源文本的大小与内容哈希，用于之后判断二进制文件是否过期；
+     * 文件写入失败时返回0，遇到无法表示的动画时抛出std::runtime_error
+     */
+    static size_t write(const std::string &path, RenderNode *rootNode, int32_t width, int32_t height,
+                        AnimationsList *animationsList, uint64_t sourceSize, uint64_t sourceHash);
+
+    // 解析文本渲染树（资源）并写为二进制文件，返回写入的字节数
+    static size_t convert(android_app *app, const std::string &txtPath, const std::string &binPath);
+
+    // 二进制文件是否为当前版本、当前DIVIDE_BY且由该源文本（大小与内容哈希均相同）转换而来
+    static bool isUpToDate(const AssetFile &file, const AssetFile &source);
+
+    /**
+     * 由映射的二进制文件创建渲染树，接口与TreeParser::parse一致
+     * 文件损坏（越界的偏移、索引等）时抛出std::runtime_error，此时不会留下已创建的节点
+     */
+    RenderNode *load(const AssetFile &file, int32_t &width, int32_t &height, AnimationsList *animationsList,
+                     ResourcePrefetcher *prefetcher = nullptr);
+
+    // 文本渲染树资源txtPath在directory（如internalDataPath）中对应的二进制文件路径
+    static std::string cachePath(const std::string &directory, const std::string &txtPath);
+
+    /**
+     * 启动时使用：binPath存在且未过期时直接加载，否则解析文本资源txtPath并将结果写为binPath（供下次启动使用）
+     */
+    RenderNode *loadOrConvert(android_app *app, const std::string &txtPath, const std::string &binPath, int32_t &width,
+                              int32_t &height, AnimationsList *animationsList, ResourcePrefetcher *prefetcher = nullptr);
+};
+
+
+#endif //PRF_BINARYTREE_H
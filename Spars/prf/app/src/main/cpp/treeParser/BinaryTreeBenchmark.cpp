@@ -0,0 +1,210 @@
+#include "BinaryTreeBenchmark.h"
+#include "BinaryTree.h"
+#include "TreeParser.h"
+#include "../utils/AssetFile.h"
+#include "../log.h"
+#include "../config.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <sys/stat.h>
+
+static const char *BINARY_TREE_SCENES[] = {
+        "RSTree/chatting-XT.txt", "RSTree/desktop-XT.txt", "RSTree/investment-XT.txt", "RSTree/lifestyle-XT.txt",
+        "RSTree/movies-XT.txt", "RSTree/music-XT.txt", "RSTree/services-XT.txt", "RSTree/settings-XT.txt",
+        "RSTree/shopping-XT.txt", "RSTree/social-XT.txt",
+};
+
+static const uint32_t SYNTHETIC_MAX_DEPTH = 9; // 合成渲染树的最大深度（根节点为0）
+static const uint32_t SYNTHETIC_REPEAT = 3; // 合成渲染树较大，只重复几次
+
+struct TreeCounts {
+    uint32_t nodeCount_ = 0;
+    uint32_t cmdCount_ = 0;
+};
+
+// ================================== 以下为一些辅助函数 ==================================
+static void deleteTree_helper(RenderNode *node) {
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        deleteTree_helper(node->getChild(i));
+    }
+    delete node;
+}
+
+static void countTree_helper(RenderNode *node, TreeCounts &counts) {
+    counts.nodeCount_++;
+    counts.cmdCount_ += node->drawCmdCount();
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        countTree_helper(node->getChild(i), counts);
+    }
+}
+
+// 文本解析（打开文件 + 解析）的平均耗时，fromAssets为false时path为文件系统中的文件
+static double measureTextParse_helper(android_app *app, const std::string &path, bool fromAssets, uint32_t repeat,
+                                      TreeCounts &counts) {
+    double totalMs = 0.0;
+    for (uint32_t i = 0; i < repeat; i++) {
+        TreeParser treeParser;
+        AnimationsList animationsList;
+        int32_t width, height;
+        auto start = std::chrono::steady_clock::now();
+        RenderNode *rootNode;
+        if (fromAssets) {
+            rootNode = treeParser.parse(app, path, width, height, &animationsList);
+        } else {
+            AssetFile file = AssetFile::MakeFromFile(path);
+            rootNode = treeParser.parse(file, width, height, &animationsList);
+        }
+        totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0) {
+            countTree_helper(rootNode, counts);
+        }
+        deleteTree_helper(rootNode);
+    }
+    return totalMs / repeat;
+}
+
+// 二进制加载（mmap + 创建节点）的平均耗时
+static double measureBinaryLoad_helper(const std::string &binPath, uint32_t repeat, TreeCounts &counts) {
+    double totalMs = 0.0;
+    for (uint32_t i = 0; i < repeat; i++) {
+        BinaryTree binaryTree;
+        AnimationsList animationsList;
+        int32_t width, height;
+        auto start = std::chrono::steady_clock::now();
+        RenderNode *rootNode;
+        {
+            AssetFile file = AssetFile::MakeFromFile(binPath);
+            rootNode = binaryTree.load(file, width, height, &animationsList);
+        }
+        totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0) {
+            countTree_helper(rootNode, counts);
+        }
+        deleteTree_helper(rootNode);
+    }
+    return totalMs / repeat;
+}
+
+static void report_helper(const char *name, size_t txtSize, size_t binSize, double convertMs, double textMs, double binaryMs,
+                          const TreeCounts &textCounts, const TreeCounts &binaryCounts) {
+    LOGI("BinaryTree benchmark [%s]: %u nodes, %u cmds, txt %zu bytes -> bin %zu bytes, convert %.3f ms, "
+         "text parse %.3f ms, binary load %.3f ms (%.1fx)", name, textCounts.nodeCount_, textCounts.cmdCount_, txtSize, binSize,
+         convertMs, textMs, binaryMs, binaryMs > 0.0 ? textMs / binaryMs : 0.0);
+    if (textCounts.nodeCount_ != binaryCounts.nodeCount_ || textCounts.cmdCount_ != binaryCounts.cmdCount_) {
+        LOGE("BinaryTree benchmark [%s]: binary tree has %u nodes, %u cmds, mismatch!", name, binaryCounts.nodeCount_,
+             binaryCounts.cmdCount_);
+    }
+}
+
+// 写出一个合成节点（与RS dump的格式一致）及其子树，depth对应'|'前的缩进
+static void writeSyntheticNode_helper(FILE *file, uint32_t depth, uint32_t &count, uint32_t nodeCount, std::mt19937 &random) {
+    std::uniform_int_distribution<int32_t> posDist(0, 1000);
+    std::uniform_int_distribution<int32_t> sizeDist(16, 400);
+    std::uniform_int_distribution<uint32_t> colorDist(0, 0xFFFFFF);
+    std::uniform_int_distribution<uint32_t> childDist(1, 8);
+
+    fprintf(file, "%*s| CANVAS_NODE[%u], Bounds[%d %d %d %d]", depth * 2, "", count, posDist(random), posDist(random),
+            sizeDist(random), sizeDist(random));
+    switch (count % 6) {
+        case 0:
+            fprintf(file, ", Rect, Paint: [0xff%06x]", colorDist(random));
+            break;
+        case 1:
+            fprintf(file, ", Circle, Paint: [0xff%06x]", colorDist(random));
+            break;
+        case 2:
+            fprintf(file, ", Text: [\"Item %u\", \"DroidSans.ttf\"40], Paint: [0xff000000]", count);
+            break;
+        case 3:
+            fprintf(file, ", Image: \"photo%u.jpg\"", count % 30 + 1);
+            break;
+        case 4:
+            fprintf(file, ", CornerRadius[12 12 12 12], Paint: [0xff%06x]", colorDist(random));
+            break;
+        default: // 只作为容器
+            break;
+    }
+    fputc('\n', file);
+    count++;
+
+    if (depth < SYNTHETIC_MAX_DEPTH) {
+        uint32_t childCount = childDist(random);
+        for (uint32_t i = 0; i < childCount && count < nodeCount; i++) {
+            writeSyntheticNode_helper(file, depth + 1, count, nodeCount, random);
+        }
+    }
+}
+
+// 写出约nodeCount个节点的合成渲染树文本，返回文件大小
+static size_t writeSyntheticTree_helper(const std::string &path, uint32_t nodeCount) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("failed to open " + path);
+    }
+    fprintf(file, "| RS_NODE[0], Bounds[-inf -inf -inf -inf]\n");
+    fprintf(file, "  | DISPLAY_NODE[1], Bounds[0.0 0.0 3184.0 2232.0]\n");
+    fprintf(file, "    | SURFACE_NODE[2], Name [Synthetic], Bounds[0.0 0.0 3184.0 2232.0]\n");
+    uint32_t count = 3;
+    std::mt19937 random(1);
+    while (count < nodeCount) {
+        writeSyntheticNode_helper(file, 3, count, nodeCount, random);
+    }
+    long size = ftell(file);
+    fclose(file);
+    return static_cast<size_t>(size);
+}
+// ================================== 以上为一些辅助函数 ==================================
+
+void runBinaryTreeBenchmark(android_app *app) {
+    std::string directory = std::string(app->activity->internalDataPath) + "/binary_tree_benchmark";
+    mkdir(directory.c_str(), 0700); // 已存在时失败，无需处理
+
+    // XT场景：文本为资源，二进制文件由转换写入internalDataPath
+    double totalTextMs = 0.0, totalBinaryMs = 0.0;
+    for (const char *scene : BINARY_TREE_SCENES) {
+        std::string binPath = BinaryTree::cachePath(directory, scene);
+        auto start = std::chrono::steady_clock::now();
+        size_t binSize = BinaryTree::convert(app, scene, binPath);
+        double convertMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        TreeCounts textCounts, binaryCounts;
+        double textMs = measureTextParse_helper(app, scene, true, BINARY_TREE_BENCHMARK_REPEAT, textCounts);
+        double binaryMs = measureBinaryLoad_helper(binPath, BINARY_TREE_BENCHMARK_REPEAT, binaryCounts);
+        report_helper(scene, AssetFile::assetSize(app, scene), binSize, convertMs, textMs, binaryMs, textCounts, binaryCounts);
+        totalTextMs += textMs;
+        totalBinaryMs += binaryMs;
+    }
+    LOGI("BinaryTree benchmark: all XT scenes text parse %.3f ms, binary load %.3f ms (%.1fx)", totalTextMs, totalBinaryMs,
+         totalBinaryMs > 0.0 ? totalTextMs / totalBinaryMs : 0.0);
+
+    // 合成渲染树：文本与二进制文件均在internalDataPath中
+    std::string txtPath = directory + "/synthetic.txt";
+    std::string binPath = directory + "/synthetic.bin";
+    size_t txtSize = writeSyntheticTree_helper(txtPath, BINARY_TREE_SYNTHETIC_NODES);
+
+    auto start = std::chrono::steady_clock::now();
+    size_t binSize;
+    {
+        TreeParser treeParser;
+        AnimationsList animationsList;
+        int32_t width, height;
+        AssetFile file = AssetFile::MakeFromFile(txtPath);
+        RenderNode *rootNode = treeParser.parse(file, width, height, &animationsList);
+        binSize = BinaryTree::write(binPath, rootNode, width, height, &animationsList, txtSize, file.contentHash());
+        deleteTree_helper(rootNode);
+    }
+    double convertMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    TreeCounts textCounts, binaryCounts;
+    double textMs = measureTextParse_helper(app, txtPath, false, SYNTHETIC_REPEAT, textCounts);
+    double binaryMs = measureBinaryLoad_helper(binPath, SYNTHETIC_REPEAT, binaryCounts);
+    report_helper("synthetic", txtSize, binSize, convertMs, textMs, binaryMs, textCounts, binaryCounts);
+
+    remove(txtPath.c_str());
+    remove(binPath.c_str());
+}
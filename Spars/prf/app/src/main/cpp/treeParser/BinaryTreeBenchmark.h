@@ -0,0 +1,13 @@
+#ifndef PRF_BINARYTREEBENCHMARK_H
+#define PRF_BINARYTREEBENCHMARK_H
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+/**
+ * 二进制渲染树测试（BINARY_TREE_BENCHMARK）
+ * 对所有XT场景与一棵合成的渲染树（BINARY_TREE_SYNTHETIC_NODES个节点，文本写入internalDataPath），
+ * 分别打印文件大小、转换耗时、文本解析与二进制加载（均包括打开文件）的平均耗时，并检查两者得到的节点数与绘制指令数一致
+ */
+void runBinaryTreeBenchmark(android_app *app);
+
+#endif //PRF_BINARYTREEBENCHMARK_H
@@ -1,8 +1,10 @@
 #include "TreeParser.h"
 #include "../renderTree/HorLnrMovAnimation.h"
+#include "../utils/AssetFile.h"
 
 #include "../config.h"
 
+#include <cstring>
 #include <string>
 #include <map>
 
@@ -10,24 +12,24 @@
 
 
 RenderNode *TreeParser::parse(android_app *androidAppCtx, std::string filename, int32_t &width,
-                              int32_t &height, AnimationsList *animationsList) {
+                              int32_t &height, AnimationsList *animationsList, ResourcePrefetcher *prefetcher) {
+    // 打开文件（只读视图，逐行直接读取，不复制文件内容）
+    AssetFile file(androidAppCtx, filename);
+    return parse(file, width, height, animationsList, prefetcher);
+}
+
+RenderNode *TreeParser::parse(const AssetFile &file, int32_t &width, int32_t &height, AnimationsList *animationsList,
+                              ResourcePrefetcher *prefetcher) {
     // 返回值
     RenderNode *rootNode = nullptr;
     width = 0;
     height = 0;
 
-    // 打开文件
-    AAsset *file = AAssetManager_open(androidAppCtx->activity->assetManager,
-                                      filename.c_str(), AASSET_MODE_BUFFER);
-    size_t fileLength = AAsset_getLength(file);
-
-    char *fileContent = new char[fileLength];
-
-    AAsset_read(file, fileContent, fileLength);
-    AAsset_close(file);
+    const char *fileContent = reinterpret_cast<const char *>(file.data());
+    const char *fileEnd = fileContent + file.size();
 
     // each line of the file.
-    char *curLine = fileContent;
+    const char *curLine = fileContent;
 
     // 读取渲染树文本时，每级深度的节点
     std::map<int, RenderNode *> records;
@@ -38,12 +40,10 @@ RenderNode *TreeParser::parse(android_app *androidAppCtx, std::string filename,
     // read each line from the file
     while (curLine) {
 
-        char * nextLine = strchr(curLine, '\n');
-        if (nextLine) *nextLine = '\0';  // temporarily terminate the current line
-
-        std::string line = curLine;
+        // 视图只读且不以'\0'结尾，按长度查找行尾
+        const char *nextLine = static_cast<const char *>(memchr(curLine, '\n', fileEnd - curLine));
+        std::string line(curLine, nextLine ? nextLine : fileEnd);
 
-        if (nextLine) *nextLine = '\n';  // then restore newline-char, just to be tidy
         curLine = nextLine ? (nextLine+1) : NULL;
 
         // 移除注释
@@ -105,6 +105,14 @@ RenderNode *TreeParser::parse(android_app *androidAppCtx, std::string filename,
                 height = curr->getAbsY() + curr->getAbsH();
             }
 
+            // 标记可见性（预取需要用到）
+            if (isSurfaceNode(line)) { // 对于surface节点，使用自己的可见性
+                visibilities[i] = getVisible(line);
+            } else { // 对于其他节点，使用父节点的可见性
+                visibilities[i] = visibilities[i - 2];
+            }
+            curr->setVisible(visibilities[i]);
+
             // 插入绘制指令和动画
             if (curr->getAbsW() > 0 && curr->getAbsH() > 0) {
 
@@ -115,6 +123,10 @@ RenderNode *TreeParser::parse(android_app *androidAppCtx, std::string filename,
                         Image image = Image::MakeImage(rect, getImagePath(line)); // 此图像未被真正解码
                         auto cmd = std::make_shared<ImageDrawCmd>(paint, image);
                         curr->addDrawCmd(cmd);
+                        if (prefetcher) {
+                            prefetcher->addImage(image.path_, Rect::MakeXYWH(curr->getAbsX(), curr->getAbsY(), curr->getAbsW(), curr->getAbsH()),
+                                                 visibilities[i]);
+                        }
                     }
                     // 绘制文本
                     else if (line.find("Text:") != -1) {
@@ -123,6 +135,10 @@ RenderNode *TreeParser::parse(android_app *androidAppCtx, std::string filename,
                         Text text = Text::MakeText(0, 0, getTextPixelHeight(line), getTextStr(line), getTextFontPath(line)); // TODO: 将pixelHeight变为可设置的
                         auto cmd = std::make_shared<TextDrawCmd>(paint, text);
                         curr->addDrawCmd(cmd);
+                        if (prefetcher) {
+                            prefetcher->addText(text, Rect::MakeXYWH(curr->getAbsX(), curr->getAbsY(), curr->getAbsW(), curr->getAbsH()),
+                                                visibilities[i]);
+                        }
                     }
                     // 绘制圆角矩形
                     else if (line.find("CornerRadius") != -1) {
@@ -161,21 +177,16 @@ RenderNode *TreeParser::parse(android_app *androidAppCtx, std::string filename,
                         if (line.find("HorLnrMov") != -1) {
                             auto anim = std::make_shared<HorLnrMovAnimation>(curr, curr->getAbsX(), -100, curr->getAbsX() - 700);
                             animationsList->addAnimation(anim);
+#if NODE_LOCAL_GEOMETRY
+                            curr->setTransformRoot(true); // 子树的几何相对该节点生成，移动时只需更新平移
+#endif
                         }
                     }
             }
 
-            // 标记可见性
-            if (isSurfaceNode(line)) { // 对于surface节点，使用自己的可见性
-                visibilities[i] = getVisible(line);
-            } else { // 对于其他节点，使用父节点的可见性
-                visibilities[i] = visibilities[i - 2];
-            }
-            curr->setVisible(visibilities[i]);
         }
     }
 
-    delete[] fileContent;
     return rootNode;
 }
 
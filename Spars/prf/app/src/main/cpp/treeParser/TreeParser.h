@@ -3,15 +3,23 @@
 
 #include "../renderTree/RenderNode.h"
 #include "../renderTree/AnimationsList.h"
+#include "../engine2d/ResourcePrefetcher.h"
 
 #include <string>
 
 #include <game-activity/native_app_glue/android_native_app_glue.h>
 
+class AssetFile;
+
 class TreeParser {
 
 public:
-    RenderNode *parse(android_app *androidAppCtx, std::string filename, int32_t &width, int32_t &height, AnimationsList *animationsList);
+    // prefetcher不为空时，将遇到的图片与字体交给其预取（解析完成后由调用者start）
+    RenderNode *parse(android_app *androidAppCtx, std::string filename, int32_t &width, int32_t &height, AnimationsList *animationsList,
+                      ResourcePrefetcher *prefetcher = nullptr);
+    // 解析已打开的渲染树文本（如AssetFile::MakeFromFile映射的、不在资源中的文件）
+    RenderNode *parse(const AssetFile &file, int32_t &width, int32_t &height, AnimationsList *animationsList,
+                      ResourcePrefetcher *prefetcher = nullptr);
 
 private:
     uint64_t getIndex(std::string line);
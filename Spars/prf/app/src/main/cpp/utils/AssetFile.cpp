@@ -0,0 +1,137 @@
+#include "AssetFile.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__ANDROID__)
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+#endif
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+AssetFile::AssetFile(android_app *app, const std::string &path) {
+#if defined(__ANDROID__)
+    asset_ = AAssetManager_open(app->activity->assetManager, path.c_str(), AASSET_MODE_BUFFER);
+    if (asset_ == nullptr) {
+        throw std::runtime_error("failed to open asset " + path);
+    }
+    size_ = AAsset_getLength(asset_);
+    data_ = static_cast<const unsigned char *>(AAsset_getBuffer(asset_));
+    if (data_ == nullptr && size_ > 0) {
+        AAsset_close(asset_);
+        asset_ = nullptr;
+        throw std::runtime_error("failed to map asset " + path);
+    }
+#else
+    (void) app;
+    mapFile(path);
+#endif
+}
+
+AssetFile AssetFile::MakeFromFile(const std::string &path) {
+    AssetFile file;
+    file.mapFile(path);
+    return file;
+}
+
+size_t AssetFile::assetSize(android_app *app, const std::string &path) {
+#if defined(__ANDROID__)
+    AAsset *asset = AAssetManager_open(app->activity->assetManager, path.c_str(), AASSET_MODE_UNKNOWN);
+    if (asset == nullptr) {
+        throw std::runtime_error("failed to open asset " + path);
+    }
+    size_t size = AAsset_getLength(asset);
+    AAsset_close(asset);
+    return size;
+#else
+    (void) app;
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat) != 0) {
+        throw std::runtime_error("failed to stat asset " + path);
+    }
+    return fileStat.st_size;
+#endif
+}
+
+uint64_t AssetFile::contentHash() const {
+    // 剩余不足8字节的部分逐字节处理，最后混入长度
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size_; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data_ + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    for (; i < size_; i++) {
+        hash ^= data_[i];
+        hash *= 1099511628211ULL;
+    }
+    hash ^= static_cast<uint64_t>(size_);
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+void AssetFile::mapFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open file " + path);
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        throw std::runtime_error("failed to stat file " + path);
+    }
+    size_ = fileStat.st_size;
+    if (size_ > 0) {
+        void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("failed to map file " + path);
+        }
+        mappedBase_ = mapped;
+        data_ = static_cast<const unsigned char *>(mapped);
+    }
+    ::close(fd); // 映射建立后可以关闭文件
+}
+
+AssetFile::~AssetFile() {
+    close();
+}
+
+AssetFile::AssetFile(AssetFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+AssetFile &AssetFile::operator=(AssetFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        asset_ = other.asset_;
+        mappedBase_ = other.mappedBase_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.asset_ = nullptr;
+        other.mappedBase_ = nullptr;
+    }
+    return *this;
+}
+
+void AssetFile::close() {
+#if defined(__ANDROID__)
+    if (asset_ != nullptr) {
+        AAsset_close(asset_);
+    }
+#endif
+    if (mappedBase_ != nullptr) { // 主机构建或MakeFromFile映射的文件
+        munmap(mappedBase_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    asset_ = nullptr;
+    mappedBase_ = nullptr;
+}
@@ -0,0 +1,48 @@
+#ifndef PRF_ASSETFILE_H
+#define PRF_ASSETFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct android_app;
+struct AAsset;
+
+/**
+ * 只读的资源文件视图，不复制文件内容
+ * Android上为AAsset_getBuffer（APK中未压缩的资源直接映射APK，压缩的资源由AAsset解压到其内部缓冲），
+ * 非Android（主机测试）构建时直接mmap该路径的文件
+ * MakeFromFile则在所有平台上mmap文件系统中的文件（如运行时写入internalDataPath的文件）
+ * 视图在AssetFile析构前有效，只能移动不能复制
+ */
+class AssetFile {
+public:
+    AssetFile() = default;
+    AssetFile(android_app *app, const std::string &path); // 打开失败时抛出std::runtime_error
+    static AssetFile MakeFromFile(const std::string &path); // 映射文件系统中的文件，失败时抛出std::runtime_error
+    static size_t assetSize(android_app *app, const std::string &path); // 资源文件的大小，不读取其内容
+    ~AssetFile();
+
+    AssetFile(AssetFile &&other) noexcept;
+    AssetFile &operator=(AssetFile &&other) noexcept;
+    AssetFile(const AssetFile &) = delete;
+    AssetFile &operator=(const AssetFile &) = delete;
+
+    const unsigned char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // 全部内容的64位哈希（FNV-1a，按8字节一步），会读取整个文件；用于判断由该文件生成的缓存是否过期
+    uint64_t contentHash() const;
+
+private:
+    const unsigned char *data_ = nullptr;
+    size_t size_ = 0;
+    AAsset *asset_ = nullptr; // Android
+    void *mappedBase_ = nullptr; // 主机构建或MakeFromFile时映射的起始地址
+
+    void mapFile(const std::string &path);
+    void close();
+};
+
+
+#endif //PRF_ASSETFILE_H
@@ -0,0 +1,123 @@
+#include "AssetFileBenchmark.h"
+#include "AssetFile.h"
+#include "../engine2d/stb_image.h"
+#include "../renderTree/RenderNode.h"
+#include "../log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// 重置峰值RSS（VmHWM），需Linux 4.0+
+static void resetPeakRss_helper() {
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+}
+
+// 当前的峰值RSS（KB）
+static long peakRssKb_helper() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        long kb;
+        if (sscanf(line.c_str(), "VmHWM: %ld kB", &kb) == 1) {
+            return kb;
+        }
+    }
+    return 0;
+}
+
+static long currentRssKb_helper() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        long kb;
+        if (sscanf(line.c_str(), "VmRSS: %ld kB", &kb) == 1) {
+            return kb;
+        }
+    }
+    return 0;
+}
+
+static void collectImages_helper(RenderNode *node, std::unordered_set<std::string> &paths) {
+    for (uint32_t i = 0; i < node->drawCmdCount(); i++) {
+        std::shared_ptr<DrawCmd> drawCmd = node->getDrawCmd(i);
+        if (drawCmd->getType() == IMAGE_DRAWCMD) {
+            paths.insert(std::static_pointer_cast<ImageDrawCmd>(drawCmd)->image_.path_);
+        }
+    }
+    for (uint32_t i = 0; i < node->childrenSize(); i++) {
+        collectImages_helper(node->getChild(i), paths);
+    }
+}
+
+// 旧的读取方式：整个文件复制到堆缓冲
+static std::vector<unsigned char> readCopy_helper(android_app *app, const std::string &path) {
+    AAsset *file = AAssetManager_open(app->activity->assetManager, path.c_str(), AASSET_MODE_BUFFER);
+    std::vector<unsigned char> content(AAsset_getLength(file));
+    AAsset_read(file, content.data(), content.size());
+    AAsset_close(file);
+    return content;
+}
+
+// 逐行扫描（与TreeParser相同的访问模式），返回行数
+static size_t countLines_helper(const unsigned char *data, size_t size) {
+    size_t lines = 0;
+    const unsigned char *cur = data;
+    const unsigned char *end = data + size;
+    while (cur && cur < end) {
+        const unsigned char *next = static_cast<const unsigned char *>(memchr(cur, '\n', end - cur));
+        lines++;
+        cur = next ? next + 1 : nullptr;
+    }
+    return lines;
+}
+
+static void decode_helper(const unsigned char *data, size_t size) {
+    int width, height, channels;
+    stbi_uc *pixels = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+    stbi_image_free(pixels);
+}
+
+void runAssetFileBenchmark(android_app *app, const char *treePath, RenderNode *rootNode) {
+    std::unordered_set<std::string> imagePaths;
+    collectImages_helper(rootNode, imagePaths);
+
+    for (int useView = 0; useView < 2; useView++) {
+        long baseRssKb = currentRssKb_helper();
+        resetPeakRss_helper();
+        auto start = std::chrono::steady_clock::now();
+        size_t lines;
+        if (useView) {
+            AssetFile file(app, treePath);
+            lines = countLines_helper(file.data(), file.size());
+        } else {
+            std::vector<unsigned char> content = readCopy_helper(app, treePath);
+            lines = countLines_helper(content.data(), content.size());
+        }
+        double treeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        long treePeakKb = peakRssKb_helper() - baseRssKb;
+
+        baseRssKb = currentRssKb_helper();
+        resetPeakRss_helper();
+        start = std::chrono::steady_clock::now();
+        for (const std::string &path : imagePaths) {
+            if (useView) {
+                AssetFile file(app, path);
+                decode_helper(file.data(), file.size());
+            } else {
+                std::vector<unsigned char> content = readCopy_helper(app, path);
+                decode_helper(content.data(), content.size());
+            }
+        }
+        double imageMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        long imagePeakKb = peakRssKb_helper() - baseRssKb;
+
+        LOGI("asset io benchmark (%s): tree %s (%zu lines) %.3f ms, peak RSS +%ld KB; %zu images read + decode %.3f ms, peak RSS +%ld KB",
+             useView ? "view" : "copy", treePath, lines, treeMs, treePeakKb, imagePaths.size(), imageMs, imagePeakKb);
+    }
+}
@@ -0,0 +1,15 @@
+#ifndef PRF_ASSETFILEBENCHMARK_H
+#define PRF_ASSETFILEBENCHMARK_H
+
+#include <game-activity/native_app_glue/android_native_app_glue.h>
+
+class RenderNode;
+
+/**
+ * 资源读取测试（ASSET_IO_BENCHMARK）
+ * 对渲染树文件与树中的所有图片，分别以复制（AAsset_read到堆缓冲）与只读视图（AssetFile）两种方式读取，
+ * 渲染树逐行扫描、图片解码，打印两种方式的耗时与峰值RSS的增长
+ */
+void runAssetFileBenchmark(android_app *app, const char *treePath, RenderNode *rootNode);
+
+#endif //PRF_ASSETFILEBENCHMARK_H
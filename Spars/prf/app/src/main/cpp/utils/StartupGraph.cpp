@@ -0,0 +1,128 @@
+#include "StartupGraph.h"
+#include "../log.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+StartupGraph::StartupGraph(bool concurrent) {
+    concurrent_ = concurrent;
+}
+
+uint32_t StartupGraph::addTask(const std::string &name, std::function<void()> run, const std::vector<uint32_t> &deps, bool mainThread) {
+    uint32_t id = static_cast<uint32_t>(tasks_.size());
+    for (uint32_t dep : deps) {
+        if (dep >= id) {
+            throw std::runtime_error("startup task " + name + " depends on a task added after it!");
+        }
+    }
+    tasks_.emplace_back();
+    Task &task = tasks_.back();
+    task.name_ = name;
+    task.run_ = std::move(run);
+    task.deps_ = deps;
+    task.mainThread_ = mainThread;
+    task.future_ = task.done_.get_future().share();
+    return id;
+}
+
+void StartupGraph::setTeardown(uint32_t id, std::function<void()> teardown) {
+    tasks_.at(id).teardown_ = std::move(teardown);
+}
+
+double StartupGraph::elapsedMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime_).count();
+}
+
+void StartupGraph::runTask(Task &task) {
+    // 等待所有依赖，任一依赖失败时不执行，把其异常传给依赖本任务的任务
+    try {
+        for (uint32_t dep : task.deps_) {
+            tasks_[dep].future_.get();
+            task.readyMs_ = std::max(task.readyMs_, tasks_[dep].endMs_); // 依赖的时间线在其完成前写入
+        }
+    } catch (...) {
+        task.skipped_ = true;
+        task.startMs_ = task.endMs_ = elapsedMs();
+        task.done_.set_exception(std::current_exception());
+        return;
+    }
+
+    // 主线程任务的开始可能晚于ready（主线程正忙于之前的任务）
+    task.startMs_ = elapsedMs();
+    try {
+        task.run_();
+        task.endMs_ = elapsedMs();
+        task.completed_ = true;
+        task.done_.set_value();
+    } catch (...) {
+        task.endMs_ = elapsedMs();
+        LOGE("StartupGraph: task %s failed", task.name_.c_str());
+        task.done_.set_exception(std::current_exception());
+    }
+}
+
+void StartupGraph::run() {
+    startTime_ = std::chrono::steady_clock::now();
+    if (!concurrent_) {
+        for (Task &task : tasks_) {
+            runTask(task);
+        }
+    } else {
+        // 非主线程任务各自一个线程，在线程中等待其依赖
+        std::vector<std::thread> threads;
+        for (Task &task : tasks_) {
+            if (!task.mainThread_) {
+                threads.emplace_back([this, &task] {
+                    runTask(task);
+                });
+            }
+        }
+        // 主线程任务按添加顺序执行（依赖只能是之前添加的任务，不会死锁）
+        for (Task &task : tasks_) {
+            if (task.mainThread_) {
+                runTask(task);
+            }
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+    totalMs_ = elapsedMs();
+
+    // 抛出第一个失败的任务的异常（被跳过的任务携带的是其依赖的异常）
+    for (Task &task : tasks_) {
+        if (!task.skipped_) {
+            task.future_.get();
+        }
+    }
+}
+
+void StartupGraph::teardown() {
+    // 任务只能依赖之前添加的任务，逆序撤销时依赖某资源的任务总是先被撤销
+    for (auto iter = tasks_.rbegin(); iter != tasks_.rend(); iter++) {
+        if (!iter->completed_ || !iter->teardown_) {
+            continue;
+        }
+        try {
+            iter->teardown_();
+        } catch (const std::exception &e) {
+            LOGE("StartupGraph: teardown of %s failed: %s", iter->name_.c_str(), e.what());
+        }
+        iter->completed_ = false;
+    }
+}
+
+void StartupGraph::dumpTimeline(const char *tag) {
+    LOGI("%s startup timeline (%s): %.3f ms", tag, concurrent_ ? "concurrent" : "serial", totalMs_);
+    double busyMs = 0.0;
+    for (Task &task : tasks_) {
+        busyMs += task.endMs_ - task.startMs_;
+        LOGI("%s   %-16s ready %8.3f  start %8.3f  end %8.3f ms (%8.3f ms)%s%s", tag, task.name_.c_str(),
+             task.readyMs_, task.startMs_, task.endMs_, task.endMs_ - task.startMs_,
+             task.mainThread_ ? " [main]" : "", task.skipped_ ? " [skipped]" : "");
+    }
+    // 串行执行时的总耗时约为各任务耗时之和
+    LOGI("%s startup tasks sum %.3f ms, overlap saved %.3f ms", tag, busyMs, busyMs - totalMs_);
+}
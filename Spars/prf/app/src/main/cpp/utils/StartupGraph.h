@@ -0,0 +1,62 @@
+#ifndef PRF_STARTUPGRAPH_H
+#define PRF_STARTUPGRAPH_H
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+/*
+ * 启动任务图：每个任务声明其依赖的任务，互不依赖的任务并发执行
+ * 标记为mainThread的任务按添加顺序在调用run的线程上执行（如需绑定主线程的步骤），其余任务各自一个线程，依赖完成后开始
+ * 任务需按依赖顺序添加（依赖只能是已添加的任务）；某任务抛出异常时依赖它的任务不再执行，run在所有线程结束后重新抛出第一个异常
+ * concurrent为false时所有任务按添加顺序在调用线程上串行执行（用于对比）
+ * run失败时调用者可调用teardown，按添加顺序的逆序（即依赖的逆序）撤销已成功完成的任务
+ * run结束后可打印启动时间线：各任务的开始、结束时间（相对run开始）与等待依赖的时间
+ */
+class StartupGraph {
+public:
+    explicit StartupGraph(bool concurrent);
+
+    // 添加一个任务，返回其id（作为其他任务的依赖）
+    uint32_t addTask(const std::string &name, std::function<void()> run, const std::vector<uint32_t> &deps = {}, bool mainThread = false);
+
+    // 设置任务的撤销函数（释放该任务创建的资源），只在run失败后由teardown调用
+    void setTeardown(uint32_t id, std::function<void()> teardown);
+
+    void run(); // 阻塞直到所有任务完成
+    void teardown(); // 在run之后（所有线程已结束）调用，逆序执行已成功完成的任务的撤销函数
+    void dumpTimeline(const char *tag); // 以log的形式打印启动时间线
+
+private:
+    struct Task {
+        std::string name_;
+        std::function<void()> run_;
+        std::function<void()> teardown_;
+        std::vector<uint32_t> deps_;
+        bool mainThread_ = false;
+        std::promise<void> done_;
+        std::shared_future<void> future_;
+
+        // 时间线（相对run开始，毫秒）
+        double readyMs_ = 0.0; // 所有依赖完成的时间
+        double startMs_ = 0.0;
+        double endMs_ = 0.0;
+        bool skipped_ = false; // 依赖失败而未执行
+        bool completed_ = false; // 成功完成（只由执行该任务的线程写入，run结束后读取）
+    };
+
+    bool concurrent_;
+    std::vector<Task> tasks_;
+    std::chrono::steady_clock::time_point startTime_;
+    double totalMs_ = 0.0;
+
+    void runTask(Task &task); // 等待依赖后执行，结果（或异常）写入done_
+    double elapsedMs();
+};
+
+
+#endif //PRF_STARTUPGRAPH_H
@@ -9,13 +9,32 @@
 #include "utils.h"
 #include "../log.h"
 
+#include <cstring>
 #include <vector>
 
-VkDevice getDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex) {
+// 设备是否支持该扩展
+bool hasDeviceExtension(VkPhysicalDevice physicalDevice, const char *extensionName) {
+    uint32_t extensionCount = 0;
+    CALL_VK(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr));
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    CALL_VK(vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data()));
+    for (const auto &extension: extensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// transferQueueFamilyIndex与queueFamilyIndex不同时额外创建一个transfer队列，pushDescriptor为true时启用VK_KHR_push_descriptor（需设备支持）
+VkDevice getDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t transferQueueFamilyIndex, bool pushDescriptor) {
 
     // 所需设备扩展
     std::vector<const char *> device_extensions;
     device_extensions.push_back("VK_KHR_swapchain");
+    if (pushDescriptor) {
+        device_extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
 
     LOGI("device extensions needed:");
     for (const auto &extension: device_extensions) {
@@ -24,20 +43,30 @@ VkDevice getDevice(VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex) {
 
     // Create a logical device (vulkan device)
     float priorities = 1.0f;
-    VkDeviceQueueCreateInfo queueCreateInfo{
-            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-            .pNext = nullptr,
-            .flags = 0,
-            .queueFamilyIndex = queueFamilyIndex,
-            .queueCount = 1, // 针对一个队列族我们所需的队列数量
-            .pQueuePriorities = &priorities, // 必须显示地赋予队列优先级
-    };
+    VkDeviceQueueCreateInfo queueCreateInfos[2]{
+            {
+                    .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                    .pNext = nullptr,
+                    .flags = 0,
+                    .queueFamilyIndex = queueFamilyIndex,
+                    .queueCount = 1, // 针对一个队列族我们所需的队列数量
+                    .pQueuePriorities = &priorities, // 必须显示地赋予队列优先级
+            },
+            {
+                    .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+                    .pNext = nullptr,
+                    .flags = 0,
+                    .queueFamilyIndex = transferQueueFamilyIndex,
+                    .queueCount = 1,
+                    .pQueuePriorities = &priorities,
+            }};
+    uint32_t queueCreateInfoCount = transferQueueFamilyIndex != queueFamilyIndex ? 2 : 1;
 
     VkDeviceCreateInfo deviceCreateInfo{
             .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
             .pNext = nullptr,
-            .queueCreateInfoCount = 1,
-            .pQueueCreateInfos = &queueCreateInfo,
+            .queueCreateInfoCount = queueCreateInfoCount,
+            .pQueueCreateInfos = queueCreateInfos,
             .enabledLayerCount = 0,
             .ppEnabledLayerNames = nullptr,
             .enabledExtensionCount = static_cast<uint32_t>(device_extensions.size()),
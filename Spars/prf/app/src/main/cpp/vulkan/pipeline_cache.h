@@ -7,14 +7,66 @@
 
 #include <vulkan_wrapper.h>
 #include "utils.h"
+#include "../log.h"
 
-VkPipelineCache getPipelineCache(VkDevice device) {
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// 管线缓存数据的头部（VK_PIPELINE_CACHE_HEADER_VERSION_ONE）
+struct PipelineCacheHeader {
+    uint32_t headerSize_;
+    uint32_t headerVersion_;
+    uint32_t vendorID_;
+    uint32_t deviceID_;
+    uint8_t pipelineCacheUUID_[VK_UUID_SIZE];
+};
+
+/**
+ * 读取磁盘上的管线缓存数据，文件不存在、头部不完整或不是当前设备与驱动生成的（驱动升级后UUID变化）时返回空
+ * 驱动本身也会校验并忽略不匹配的数据，这里提前检查以便区分冷、热启动
+ */
+std::vector<uint8_t> loadPipelineCacheData(VkPhysicalDevice physicalDevice, const std::string &path) {
+    std::vector<uint8_t> data;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return data;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size >= static_cast<long>(sizeof(PipelineCacheHeader))) {
+        data.resize(static_cast<size_t>(size));
+        if (fread(data.data(), 1, data.size(), file) != data.size()) {
+            data.clear();
+        }
+    }
+    fclose(file);
+    if (data.empty()) {
+        return data;
+    }
+
+    PipelineCacheHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    if (header.headerVersion_ != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || header.vendorID_ != properties.vendorID ||
+        header.deviceID_ != properties.deviceID || memcmp(header.pipelineCacheUUID_, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        LOGI("pipeline cache %s is stale, ignored", path.c_str());
+        data.clear();
+    }
+    return data;
+}
+
+// 创建管线缓存，initialData为空时创建空的缓存
+VkPipelineCache getPipelineCache(VkDevice device, const std::vector<uint8_t> &initialData) {
     VkPipelineCacheCreateInfo pipelineCacheInfo{
             .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
             .pNext = nullptr,
-            .flags = 0,  // reserved, must be 0
-            .initialDataSize = 0,
-            .pInitialData = nullptr,
+            .flags = 0,  // 不设置EXTERNALLY_SYNCHRONIZED：多个线程同时用它创建管线
+            .initialDataSize = initialData.size(),
+            .pInitialData = initialData.empty() ? nullptr : initialData.data(),
     };
 
     VkPipelineCache pipelineCache;
@@ -23,4 +75,27 @@ VkPipelineCache getPipelineCache(VkDevice device) {
     return pipelineCache;
 }
 
+// 将管线缓存写回磁盘（先写临时文件再rename，进程中途被杀时不会留下不完整的文件），返回写入的字节数
+size_t savePipelineCache(VkDevice device, VkPipelineCache pipelineCache, const std::string &path) {
+    size_t size = 0;
+    CALL_VK(vkGetPipelineCacheData(device, pipelineCache, &size, nullptr));
+    std::vector<uint8_t> data(size);
+    CALL_VK(vkGetPipelineCacheData(device, pipelineCache, &size, data.data()));
+
+    std::string tempPath = path + ".tmp";
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        LOGE("failed to open %s", tempPath.c_str());
+        return 0;
+    }
+    bool written = fwrite(data.data(), 1, size, file) == size;
+    fclose(file);
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        LOGE("failed to save pipeline cache %s", path.c_str());
+        remove(tempPath.c_str());
+        return 0;
+    }
+    return size;
+}
+
 #endif //PRF_PIPELINE_CACHE_H
@@ -34,4 +34,22 @@ uint32_t getQueueFamilyIndex(VkPhysicalDevice physicalDevice) {
     return queueFamilyIndex;
 }
 
+// 查找一个只支持transfer（不支持graphics与compute）的队列族，通常对应独立的DMA引擎；没有则返回graphicsQueueFamilyIndex
+uint32_t getTransferQueueFamilyIndex(VkPhysicalDevice physicalDevice, uint32_t graphicsQueueFamilyIndex) {
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                             nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount,
+                                             queueFamilyProperties.data());
+
+    for (uint32_t queueFamilyIndex = 0; queueFamilyIndex < queueFamilyCount; queueFamilyIndex++) {
+        VkQueueFlags flags = queueFamilyProperties[queueFamilyIndex].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            return queueFamilyIndex;
+        }
+    }
+    return graphicsQueueFamilyIndex;
+}
+
 #endif //PRF_QUEUE_FAMILY_INDEX_H
@@ -28,9 +28,13 @@ struct VulkanDeviceInfo {
     VkPhysicalDevice physicalDevice_;
     VkDevice device_;
     uint32_t queueFamilyIndex_;
+    uint32_t transferQueueFamilyIndex_; // 纹理上传使用的队列族，没有独立的transfer队列族时与queueFamilyIndex_相同
 
     VkSurfaceKHR surface_;
     VkQueue queue_;
+    VkQueue transferQueue_; // 没有独立的transfer队列族时与queue_相同
+
+    bool pushDescriptor_; // 已启用VK_KHR_push_descriptor（PUSH_DESCRIPTORS且设备支持），图片与文字的纹理在录制时push
 };
 
 // Vulkan交换链信息
@@ -54,7 +58,7 @@ struct VulkanRenderInfo {
     std::vector<VkCommandBuffer> cmdBuffer_; // 每个帧缓冲有一个VkCommandBuffer（3或4）
     VkSemaphore imageAvailableSemaphore_;
     VkFence renderFinishedFence_;
-    // VkPipelineCache pipelineCache_; // TODO: 暂时不使用VkPipelineCache
+    VkPipelineCache pipelineCache_ = VK_NULL_HANDLE; // 所有管线共用，启动时从磁盘加载（PIPELINE_CACHE），为空时不使用
 };
 
 #endif //PRF_VULKAN_UTILS_H
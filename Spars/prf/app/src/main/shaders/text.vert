@@ -9,8 +9,14 @@ layout(location = 2) in vec3 inColor;
 layout(location = 0) out vec2 fragTexCoord;
 layout(location = 1) out vec3 fragColor;
 
+// 每次绘制的变换（与DrawTransform一致），几何以所属变换节点为原点、以屏幕像素为单位生成
+layout(push_constant) uniform DrawTransform {
+   vec2 translate; // 像素坐标下的平移
+   vec2 scale; // 像素到NDC的缩放，即(2/宽, 2/高)，随显示尺寸变化
+} transform;
+
 void main() {
-   gl_Position = vec4(inPos, 0.0, 1.0);
+   gl_Position = vec4((inPos + transform.translate) * transform.scale - 1.0, 0.0, 1.0);
    fragTexCoord = inTexCoord; //纹理坐标，会被插值后传递给片段着色器
    fragColor = inColor;
 }
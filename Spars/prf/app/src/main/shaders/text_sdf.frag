@@ -0,0 +1,17 @@
+#version 400
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (location = 0) out vec4 uFragColor;
+
+layout(location = 0) in vec2 fragTexCoord;
+layout(location = 1) in vec3 fragColor;
+
+layout(binding = 0) uniform sampler2D texSampler;
+
+// 有向距离场文本：0.5为轮廓（越大越靠内），过渡带宽度约为一个屏幕像素，因此任意字号都保持清晰的边缘
+void main() {
+   float dist = texture(texSampler, fragTexCoord).r;
+   float width = 0.5 * fwidth(dist);
+   uFragColor = vec4(fragColor, smoothstep(0.5 - width, 0.5 + width, dist));
+}